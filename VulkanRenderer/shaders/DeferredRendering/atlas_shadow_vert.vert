@@ -0,0 +1,23 @@
+#version 460 core
+#extension GL_GOOGLE_include_directive : require
+
+// depth only, into one tile of the shadow atlas. the tile's viewport places it, see ShadowAtlas.h
+
+layout(location = 0) in vec4 aPos;
+layout(location = 1) in vec2 aTexcoord;
+layout(location = 2) in vec4 aNormal;
+layout(location = 3) in uint aObjectIndex; // per instance
+
+// the tile's light view projection
+layout(push_constant) uniform Tile
+{
+	mat4 viewProj;
+};
+
+#define OBJECT_TABLE_SET 0
+#include "../Global/object_table.glsl"
+
+void main()
+{
+	gl_Position = viewProj * objects[aObjectIndex].model * aPos;
+}
@@ -1,46 +1,134 @@
 #version 460 core
+#extension GL_GOOGLE_include_directive : require
 
 layout (location = 0) in vec2 inUV;
 
-layout (binding = 0) uniform sampler2D colorTexture;
-layout (binding = 1) uniform sampler2D normalsTexture;
-layout (binding = 2) uniform sampler2D positionsTexture;
+// written by the g-buffer subpass at this same pixel
+layout (input_attachment_index = 0, binding = 0) uniform subpassInput colorInput;
+layout (input_attachment_index = 1, binding = 1) uniform subpassInput normalsInput;
+layout (input_attachment_index = 2, binding = 2) uniform subpassInput depthInput;
+
+// 0 lit, 1 colors, 2 normals, 3 positions, 4 lights per cluster
+layout (push_constant) uniform GBufferView
+{
+	int gBufferView;
+};
 
 layout (location = 0) out vec4 fragColor;
 
-struct SceneLight
+layout (binding = 3) uniform Composition
+{
+	mat4 invViewProj;
+	mat4 viewProj;
+	vec4 screenSize;
+};
+
+// off when light volumes are drawn over the ambient term instead
+layout (constant_id = 2) const bool CLUSTERED_LIGHTS = true; // 0 and 1 are the PCF kernel, see pcf.glsl
+
+struct Light
+{
+	vec4 positionRadius; // xyz = world space position, w = radius
+	vec4 colorIntensity; // rgb = color, a = intensity
+};
+
+// see LightClusters.h
+layout (set = 1, binding = 0) uniform ClusterParams
+{
+	uvec4 gridSize;	  // tiles x, tiles y, slices, lights per cluster
+	vec4 sliceParams; // xy = tile size in pixels, z = slice scale, w = slice bias
+	vec4 depthRange;  // x = near plane, y = far plane
+};
+
+layout (set = 1, binding = 1) readonly buffer LightBuffer
 {
-	vec4 position;
-	vec4 color;
-	float radius;
-	float intensity;
+	Light lights[];
 };
 
-layout (binding = 3) uniform Lights
+// per cluster a light count followed by its light indices
+layout (set = 1, binding = 2) readonly buffer ClusterBuffer
 {
-	SceneLight lights[100];
+	uint clusterLights[];
 };
 
+#include "shadow_atlas.glsl"
+
+vec3 decodeNormal(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+// back through the inverse view projection from the pixel's clip space position
+vec3 worldPosition(float depth)
+{
+	vec4 world = invViewProj * vec4(inUV * 2.0 - 1.0, depth, 1.0);
+	return world.xyz / world.w;
+}
+
+// offset of the pixel's cluster in the cluster buffer. slices are exponential in view depth
+uint clusterOffset(float depth)
+{
+	float viewDepth = depthRange.x * depthRange.y / (depthRange.y - depth * (depthRange.y - depthRange.x));
+	uint slice = uint(max(log(viewDepth) * sliceParams.z + sliceParams.w, 0.0));
+
+	uvec3 cluster = min(uvec3(uvec2(gl_FragCoord.xy / sliceParams.xy), slice), gridSize.xyz - 1);
+	return (cluster.x + cluster.y * gridSize.x + cluster.z * gridSize.x * gridSize.y) * (gridSize.w + 1);
+}
+
 void main()
 {
-	vec3 albedo = texture(colorTexture, inUV).rgb;
-	vec3 fragNormal = normalize(texture(normalsTexture, inUV).xyz);
-	vec3 fragPos = texture(positionsTexture, inUV).xyz;
+	vec3 albedo = subpassLoad(colorInput).rgb;
+	vec3 fragNormal = decodeNormal(subpassLoad(normalsInput).xy);
+	float depth = subpassLoad(depthInput).r;
+	vec3 fragPos = worldPosition(depth);
+
+	// nothing culls the clusters while light volumes are drawn
+	uint cluster = 0, lightCount = 0;
+	if (CLUSTERED_LIGHTS)
+	{
+		cluster = clusterOffset(depth);
+		lightCount = clusterLights[cluster];
+	}
 
+	if (gBufferView == 4)
+	{
+		// black for no lights, then green to red as the cluster fills up
+		float load = float(lightCount) / float(gridSize.w);
+		fragColor = vec4(lightCount == 0 ? vec3(0.0) : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), load), 1.0);
+		return;
+	}
+
+	if (gBufferView != 0)
+	{
+		fragColor = vec4(gBufferView == 1 ? albedo : (gBufferView == 2 ? fragNormal : fragPos), 1.0);
+		return;
+	}
+
+	// only the lights whose spheres touch this pixel's cluster
 	vec3 outputColor = albedo * 0.1; // ambient light
-	for (int i = 0; i < 100; i++)
+	for (uint i = 0; i < lightCount; i++)
 	{
-		vec3 lightDir = lights[i].position.xyz - fragPos;
+		uint lightIndex = clusterLights[cluster + 1 + i];
+		Light light = lights[lightIndex];
+		float radius = light.positionRadius.w;
+
+		vec3 lightDir = light.positionRadius.xyz - fragPos;
 		float dist = length(lightDir);
 		lightDir = normalize(lightDir);
 		
 		// only illuminate if within a light's radius
-		if (dist < lights[i].radius)
+		if (dist < radius)
 		{
-			float attenuation = lights[i].radius / (pow(dist, 2.0) + 1.0);
+			float attenuation = radius / (pow(dist, 2.0) + 1.0);
 			float lambert = max(0.0, dot(fragNormal, lightDir));
 
-			vec3 diffuseLight = (lights[i].color.rgb * lights[i].intensity) * albedo * lambert * attenuation;
+			float shadow = shadowFactor(lightIndex, light.positionRadius.xyz, fragPos);
+
+			vec3 diffuseLight = (light.colorIntensity.rgb * light.colorIntensity.a) * albedo * lambert * attenuation * shadow;
 			outputColor += diffuseLight;
 		}
 	}
@@ -1,39 +1,29 @@
 #version 460 core
+#extension GL_GOOGLE_include_directive : require
 
+#include "../Global/material_table.glsl"
 
-layout (set = 2, binding = 0) uniform Material
-{
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-	vec3 transmittance;
-	vec3 emission;
-
-	float shininess;		
-	float ior;				   
-	float dissolve;			   
-	int illum;				
-	float roughness;           
-	float metallic;            
-	float sheen;               
-	float clearcoat_thickness; 
-	float clearcoat_roughness; 
-	float anisotropy;          
-	float anisotropy_rotation; 
-	float pad0;
-	int dummy;	
-} material;
-
-layout (location = 0) in vec3 inPos;
 layout (location = 1) in vec3 inNormal;
+layout (location = 2) flat in uint inMaterialIndex;
 
 layout (location = 0) out vec4 colorOutput;
-layout (location = 1) out vec4 normalOutput;
-layout (location = 2) out vec4 positionOutput;
+layout (location = 1) out vec2 normalOutput;
+
+// unit vector to the [-1, 1] square: projected onto the octahedron, with the lower half folded over the upper one
+vec2 octWrap(vec2 v)
+{
+	return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encodeNormal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	return n.z >= 0.0 ? n.xy : octWrap(n.xy);
+}
 
 void main()
 {
+	Material material = materials[inMaterialIndex];
 	colorOutput = vec4(material.diffuse, 1.0);
-	normalOutput = vec4(normalize(inNormal), 1.0);
-	positionOutput = vec4(inPos, 1.0);
+	normalOutput = encodeNormal(normalize(inNormal));
 }
\ No newline at end of file
@@ -1,29 +1,28 @@
 #version 460 core
+#extension GL_GOOGLE_include_directive : require
 
 layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec2 aTexcoord;
 layout (location = 2) in vec4 aNormal;
+layout (location = 3) in uint aObjectIndex; // per instance
 
 layout (set = 0, binding = 0) uniform UBO
 {
 	mat4 viewProj;
 };
 
-layout (set = 1, binding = 0) uniform Mesh
-{
-	mat4 model;
-	mat4 normal;
-} mesh;
+#include "../Global/object_table.glsl"
 
-layout (location = 0) out vec3 outPos;
 layout (location = 1) out vec3 outNormal;
+layout (location = 2) flat out uint outMaterialIndex;
 
 void main()
 {
-	vec4 worldPos = mesh.model * aPos;
+	Object object = objects[aObjectIndex];
+	vec4 worldPos = object.model * aPos;
 
-	outPos = worldPos.xyz;
-	outNormal = (mesh.normal * aNormal).xyz;
+	outNormal = (object.normal * aNormal).xyz;
+	outMaterialIndex = object.materialIndex;
 
 	gl_Position = viewProj * worldPos;
 }
\ No newline at end of file
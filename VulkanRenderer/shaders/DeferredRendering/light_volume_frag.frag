@@ -0,0 +1,71 @@
+#version 460 core
+#extension GL_GOOGLE_include_directive : require
+
+// a single light's contribution, added on top of the ambient pass. only runs where the stencil says the g-buffer's
+// surface is inside a light volume
+
+layout (location = 0) flat in uint inLightIndex;
+
+// written by the g-buffer subpass at this same pixel
+layout (input_attachment_index = 0, binding = 0) uniform subpassInput colorInput;
+layout (input_attachment_index = 1, binding = 1) uniform subpassInput normalsInput;
+layout (input_attachment_index = 2, binding = 2) uniform subpassInput depthInput;
+
+layout (binding = 3) uniform Composition
+{
+	mat4 invViewProj;
+	mat4 viewProj;
+	vec4 screenSize;
+};
+
+struct Light
+{
+	vec4 positionRadius; // xyz = world space position, w = radius
+	vec4 colorIntensity; // rgb = color, a = intensity
+};
+
+layout (set = 1, binding = 1) readonly buffer LightBuffer
+{
+	Light lights[];
+};
+
+#include "shadow_atlas.glsl"
+
+layout (location = 0) out vec4 fragColor;
+
+vec3 decodeNormal(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main()
+{
+	vec3 albedo = subpassLoad(colorInput).rgb;
+	vec3 fragNormal = decodeNormal(subpassLoad(normalsInput).xy);
+
+	vec2 uv = gl_FragCoord.xy / screenSize.xy;
+	vec4 world = invViewProj * vec4(uv * 2.0 - 1.0, subpassLoad(depthInput).r, 1.0);
+	vec3 fragPos = world.xyz / world.w;
+
+	Light light = lights[inLightIndex];
+	float radius = light.positionRadius.w;
+
+	vec3 lightDir = light.positionRadius.xyz - fragPos;
+	float dist = length(lightDir);
+	lightDir = normalize(lightDir);
+
+	// the stencil only knows the surface is inside some light's volume, not necessarily this one's
+	if (dist >= radius)
+		discard;
+
+	float attenuation = radius / (pow(dist, 2.0) + 1.0);
+	float lambert = max(0.0, dot(fragNormal, lightDir));
+	float shadow = shadowFactor(inLightIndex, light.positionRadius.xyz, fragPos);
+
+	// blended additively, alpha stays as the ambient pass wrote it
+	fragColor = vec4((light.colorIntensity.rgb * light.colorIntensity.a) * albedo * lambert * attenuation * shadow, 0.0);
+}
@@ -0,0 +1,37 @@
+#version 460 core
+
+// one instance per light, the sphere mesh scaled to the light's radius
+
+layout (location = 0) in vec4 aPos;
+
+layout (binding = 3) uniform Composition
+{
+	mat4 invViewProj;
+	mat4 viewProj;
+	vec4 screenSize;
+};
+
+struct Light
+{
+	vec4 positionRadius; // xyz = world space position, w = radius
+	vec4 colorIntensity; // rgb = color, a = intensity
+};
+
+layout (set = 1, binding = 1) readonly buffer LightBuffer
+{
+	Light lights[];
+};
+
+// from the mesh's radius to 1, and a bit more so its flat faces still enclose the whole sphere
+layout (constant_id = 0) const float VOLUME_SCALE = 1.0;
+
+layout (location = 0) flat out uint outLightIndex;
+
+void main()
+{
+	vec4 light = lights[gl_InstanceIndex].positionRadius;
+	vec3 worldPos = light.xyz + aPos.xyz * light.w * VOLUME_SCALE;
+
+	outLightIndex = gl_InstanceIndex;
+	gl_Position = viewProj * vec4(worldPos, 1.0);
+}
@@ -0,0 +1,63 @@
+// shadow lookups into the deferred scene's shadow atlas, shared by the composition and light volume shaders.
+// include after #extension GL_GOOGLE_include_directive : require
+
+#include "../Global/pcf.glsl"
+
+// see ShadowAtlas.h
+struct ShadowTile
+{
+	mat4 viewProj;
+	vec4 rect; // xy = offset, zw = size, in atlas uv
+};
+
+// read through a comparison sampler
+layout (set = 2, binding = 0) uniform sampler2DShadow shadowAtlas;
+
+layout (set = 2, binding = 1) readonly buffer ShadowTileBuffer
+{
+	ShadowTile shadowTiles[];
+};
+
+// per light its first tile and tile count, 0 for no shadow, 6 for a point light's cube faces
+layout (set = 2, binding = 2) readonly buffer ShadowLightBuffer
+{
+	ivec2 shadowLights[];
+};
+
+// 1 lit, 0 in shadow. a point light's fragment reads the tile of the cube face it lies in
+float shadowFactor(uint lightIndex, vec3 lightPos, vec3 fragPos)
+{
+	ivec2 entry = shadowLights[lightIndex];
+	if (entry.y == 0)
+		return 1.0;
+
+	int tile = entry.x;
+	if (entry.y == 6)
+	{
+		// +x, -x, +y, -y, +z, -z, like a cube map
+		vec3 dir = fragPos - lightPos;
+		vec3 a = abs(dir);
+		tile += a.x >= a.y && a.x >= a.z ? (dir.x > 0.0 ? 0 : 1) : (a.y >= a.z ? (dir.y > 0.0 ? 2 : 3) : (dir.z > 0.0 ? 4 : 5));
+	}
+
+	ShadowTile shadow = shadowTiles[tile];
+	vec4 clip = shadow.viewProj * vec4(fragPos, 1.0);
+	vec3 projCoords = clip.xyz / clip.w;
+
+	// outside a spot light's cone or past its range. a cube face always covers its fragments, up to rounding
+	bool outsideCone = entry.y == 1 && any(greaterThan(abs(projCoords.xy), vec2(1.0)));
+	if (outsideCone || projCoords.z > 1.0)
+		return 1.0;
+
+	// the pcf.glsl kernel, clamped so no tap reaches into another light's tile
+	vec2 texel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+	vec2 uv = shadow.rect.xy + (projCoords.xy * 0.5 + 0.5) * shadow.rect.zw;
+	vec2 minUV = shadow.rect.xy + texel * 0.5;
+	vec2 maxUV = shadow.rect.xy + shadow.rect.zw - texel * 0.5;
+
+	float lit = 0.0;
+	for (int i = 0; i < tapCount(); i++)
+		lit += texture(shadowAtlas, vec3(clamp(uv + tapOffset(i) * texel, minUV, maxUV), projCoords.z));
+
+	return lit / float(tapCount());
+}
@@ -0,0 +1,31 @@
+// the shared MaterialTable, must match Material::Parameters (std430). indexed with the object's material index.
+// include after #extension GL_GOOGLE_include_directive : require
+
+struct Material
+{
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+	vec3 transmittance;
+	vec3 emission;
+
+	float shininess;			// specular exponent
+	float ior;				    // index of refraction
+	float dissolve;			    // 1 == opaque; 0 == fully transparent 
+	int illum;					// illumination model
+	float roughness;            // [0, 1] default 0
+	float metallic;             // [0, 1] default 0
+	float sheen;                // [0, 1] default 0
+	float clearcoat_thickness;  // [0, 1] default 0
+	float clearcoat_roughness;  // [0, 1] default 0
+	float anisotropy;           // aniso. [0, 1] default 0
+	float anisotropy_rotation;  // anisor. [0, 1] default 0
+	float pad0;
+	int dummy;					// Suppress padding warning.
+	uint textureIndices[12];	// TextureTable slots, indexed with TextureType - 1
+};
+
+layout(set = 1, binding = 1) readonly buffer MaterialTable
+{
+	Material materials[];
+};
@@ -0,0 +1,24 @@
+// GPUCuller's object table, must match GPUObject (std430). vertex shaders index it with the object index each
+// instance reads at location 3, see GPUCuller::getAttributeDescriptions().
+// graphics pipelines bind it at set 1, define OBJECT_TABLE_SET before the include to read it from another set.
+// include after #extension GL_GOOGLE_include_directive : require
+
+#ifndef OBJECT_TABLE_SET
+#define OBJECT_TABLE_SET 1
+#endif
+
+struct Object
+{
+	mat4 model;
+	mat4 normal;
+	vec4 boundingSphere; // xyz = local center, w = local radius
+	uint batchIndex;
+	uint materialIndex;
+	uint pad0;
+	uint pad1;
+};
+
+layout(set = OBJECT_TABLE_SET, binding = 0) readonly buffer ObjectBuffer
+{
+	Object objects[];
+};
@@ -0,0 +1,50 @@
+// shadow filtering shared by everything that samples a shadow map, see ShadowMap::CreateScenePipelines()
+// and DeferredRendering/shadow_atlas.glsl. include after #extension GL_GOOGLE_include_directive : require
+
+// the filter kernel, see ShadowMap::pcfPattern. every tap is a hardware filtered 2x2 depth compare
+layout (constant_id = 0) const int PCF_RADIUS = 1;	// in texels, 0 is a single tap
+layout (constant_id = 1) const int PCF_PATTERN = 1; // 0 grid, 1 poisson disk, 2 rotated grid
+
+const vec2 poissonDisk[12] = vec2[](
+	vec2(-0.326, -0.406), vec2(-0.840, -0.074), vec2(-0.696, 0.457), vec2(-0.203, 0.621),
+	vec2(0.962, -0.195), vec2(0.473, -0.480), vec2(0.519, 0.767), vec2(0.185, -0.893),
+	vec2(0.507, 0.064), vec2(0.896, 0.412), vec2(-0.322, -0.933), vec2(-0.792, -0.598));
+
+// four taps, each offset on both axes, so together they cover four rows and four columns
+const vec2 rotatedGrid[4] = vec2[](vec2(0.25, 0.75), vec2(0.75, -0.25), vec2(-0.25, -0.75), vec2(-0.75, 0.25));
+
+// turns the disk per pixel, its banding becomes noise
+float interleavedGradientNoise(vec2 pixel)
+{
+	return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+int tapCount()
+{
+	if (PCF_RADIUS == 0)
+		return 1;
+
+	return PCF_PATTERN == 0 ? (2 * PCF_RADIUS + 1) * (2 * PCF_RADIUS + 1) : (PCF_PATTERN == 1 ? 12 : 4);
+}
+
+// where a tap goes, in texels from the center
+vec2 tapOffset(int tap)
+{
+	if (PCF_RADIUS == 0)
+		return vec2(0.0);
+
+	if (PCF_PATTERN == 0)
+	{
+		int side = 2 * PCF_RADIUS + 1;
+		return vec2(tap % side - PCF_RADIUS, tap / side - PCF_RADIUS);
+	}
+
+	if (PCF_PATTERN == 1)
+	{
+		float angle = 6.2831853 * interleavedGradientNoise(gl_FragCoord.xy);
+		mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+		return rotation * poissonDisk[tap] * float(PCF_RADIUS);
+	}
+
+	return rotatedGrid[tap] * float(PCF_RADIUS);
+}
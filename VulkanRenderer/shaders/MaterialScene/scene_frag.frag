@@ -1,7 +1,9 @@
 #version 460 core
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec3 inFragWorldNormal;
 layout(location = 1) in vec3 inFragWorld;
+layout (location = 2) flat in uint inMaterialIndex;
 
 layout(location = 0) out vec4 fragColor;
 
@@ -9,56 +11,81 @@ layout(set = 0, binding = 0) uniform UBO
 {
 	mat4 proj;
 	mat4 view;
-	vec3 lightPos;
 	vec3 viewPos;
 };
 
-vec3 lightColor = vec3(1.0);
+#include "../Global/material_table.glsl"
 
-// material data
-layout(set = 2, binding = 0) uniform Material
+struct Light
 {
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-	vec3 transmittance;
-	vec3 emission;
-
-	float shininess;			// specular exponent
-	float ior;				    // index of refraction
-	float dissolve;			    // 1 == opaque; 0 == fully transparent 
-	int illum;					// illumination model
-	float roughness;            // [0, 1] default 0
-	float metallic;             // [0, 1] default 0
-	float sheen;                // [0, 1] default 0
-	float clearcoat_thickness;  // [0, 1] default 0
-	float clearcoat_roughness;  // [0, 1] default 0
-	float anisotropy;           // aniso. [0, 1] default 0
-	float anisotropy_rotation;  // anisor. [0, 1] default 0
-	float pad0;
-	int dummy;					// Suppress padding warning.
-} mat;
+	vec4 positionRadius; // xyz = world space position, w = radius
+	vec4 colorIntensity; // rgb = color, a = intensity
+};
+
+// see LightClusters.h
+layout(set = 2, binding = 0) uniform ClusterParams
+{
+	uvec4 gridSize;	  // tiles x, tiles y, slices, lights per cluster
+	vec4 sliceParams; // xy = tile size in pixels, z = slice scale, w = slice bias
+	vec4 depthRange;  // x = near plane, y = far plane
+};
+
+layout(set = 2, binding = 1) readonly buffer LightBuffer
+{
+	Light lights[];
+};
+
+// per cluster a light count followed by its light indices
+layout(set = 2, binding = 2) readonly buffer ClusterBuffer
+{
+	uint clusterLights[];
+};
+
+// offset of the fragment's cluster in the cluster buffer. slices are exponential in view depth
+uint clusterOffset()
+{
+	float viewDepth = depthRange.x * depthRange.y / (depthRange.y - gl_FragCoord.z * (depthRange.y - depthRange.x));
+	uint slice = uint(max(log(viewDepth) * sliceParams.z + sliceParams.w, 0.0));
+
+	uvec3 cluster = min(uvec3(uvec2(gl_FragCoord.xy / sliceParams.xy), slice), gridSize.xyz - 1);
+	return (cluster.x + cluster.y * gridSize.x + cluster.z * gridSize.x * gridSize.y) * (gridSize.w + 1);
+}
 
 void main()
 {
-	vec3 lightDir = lightPos - inFragWorld;
+	Material mat = materials[inMaterialIndex];
 	vec3 view = normalize(viewPos - inFragWorld);
 	vec3 normal = normalize(inFragWorldNormal);
 
-	float attenuation = 1.0f / dot(lightDir, lightDir);
-	lightDir = normalize(lightDir); // normalize after attenuation so values are correct
+	vec3 diffuseLight = vec3(0.0), specularLight = vec3(0.0);
+
+	// only the lights whose spheres touch this fragment's cluster
+	uint cluster = clusterOffset();
+	uint lightCount = clusterLights[cluster];
+
+	for (uint i = 0; i < lightCount; i++)
+	{
+		Light light = lights[clusterLights[cluster + 1 + i]];
+		float radius = light.positionRadius.w;
 
-	// diffuse
-	float lambertian = max(dot(lightDir, normal), 0.0);
-	vec3 lightIntensity = lightColor * attenuation;
-	vec3 diffuseLight = lightIntensity * lambertian;
+		vec3 lightDir = light.positionRadius.xyz - inFragWorld;
+		float dist = length(lightDir);
+		if (dist >= radius)
+			continue;
 
+		lightDir = lightDir / dist;
+		float attenuation = radius / (dist * dist + 1.0);
+		vec3 lightIntensity = light.colorIntensity.rgb * light.colorIntensity.a * attenuation;
 
-	// blinn phong
-	vec3 halfAngle = normalize(lightDir + view);
-	float blinn = pow(max(dot(normal, halfAngle), 0.0), mat.shininess);
-	vec3 specularLight = lightIntensity * blinn * mat.specular;
+		// diffuse
+		float lambertian = max(dot(lightDir, normal), 0.0);
+		diffuseLight += lightIntensity * lambertian;
 
+		// blinn phong
+		vec3 halfAngle = normalize(lightDir + view);
+		float blinn = pow(max(dot(normal, halfAngle), 0.0), mat.shininess);
+		specularLight += lightIntensity * blinn * mat.specular;
+	}
 
 	fragColor = vec4(mat.ambient + (diffuseLight * mat.diffuse) + specularLight, 1.0);
 }
\ No newline at end of file
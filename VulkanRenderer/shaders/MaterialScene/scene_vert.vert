@@ -1,31 +1,34 @@
 #version 460 core
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec4 aPos;
 layout(location = 1) in vec2 aTexcoord;
 layout(location = 2) in vec4 aNormal;
+layout(location = 3) in uint aObjectIndex; // per instance
 
 layout(set = 0, binding = 0) uniform UBO
 {
 	mat4 proj;		 //	camera projection
 	mat4 view;		 //	camera view 
-	vec3 lightPos;	 //	point light position
 	vec3 viewPos;	 //	camera position
 };
 
-layout(set = 1, binding = 0) uniform Mesh
-{
-	mat4 model;
-	mat4 normal;
-};
+#include "../Global/object_table.glsl"
+
+// the depth pre-pass runs this same shader, the shading pass only keeps fragments at exactly its depth
+invariant gl_Position;
 
 layout(location = 0) out vec3 outFragNormalWorld;
 layout(location = 1) out vec3 outFragWorld;
+layout(location = 2) flat out uint outMaterialIndex;
 
 void main()
 {
-	vec4 vertWorld = model * aPos;
+	Object object = objects[aObjectIndex];
+	vec4 vertWorld = object.model * aPos;
 	outFragWorld = vertWorld.xyz;
-	outFragNormalWorld = vec3(normal * aNormal);
+	outFragNormalWorld = vec3(object.normal * aNormal);
+	outMaterialIndex = object.materialIndex;
 
 	gl_Position = proj * view * vertWorld;
 }
\ No newline at end of file
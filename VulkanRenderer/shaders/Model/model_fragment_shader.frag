@@ -1,61 +1,90 @@
 #version 460
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec3 viewDir;
 layout(location = 1) in vec3 fragPos;
 layout(location = 2) in vec3 outNormal;
 layout(location = 3) in vec2 outTexcoord;
+layout(location = 4) flat in uint inMaterialIndex;
 
 layout(location = 0) out vec4 fragColor;
 
-layout (set = 2, binding = 0) uniform Material
-{
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-	vec3 transmittance;
-	vec3 emission;
-	
-	float shininess;			// specular exponent
-	float ior;				    // index of refraction
-	float dissolve;			    // 1 == opaque; 0 == fully transparent 
-	int illum;					// illumination model
-	float roughness;            // [0, 1] default 0
-	float metallic;             // [0, 1] default 0
-	float sheen;                // [0, 1] default 0
-	float clearcoat_thickness;  // [0, 1] default 0
-	float clearcoat_roughness;  // [0, 1] default 0
-	float anisotropy;           // aniso. [0, 1] default 0
-	float anisotropy_rotation;  // anisor. [0, 1] default 0
-	float pad0;
-	int dummy;					// Suppress padding warning.
-} material;
+#include "../Global/material_table.glsl"
 
 layout(set = 2, binding = 2) uniform sampler2D textureSampler;
 
+struct Light
+{
+	vec4 positionRadius; // xyz = world space position, w = radius
+	vec4 colorIntensity; // rgb = color, a = intensity
+};
 
-const vec3 lightPosition = vec3(0.0f, 1.0f, -5.0f);
-const vec3 lightColor = vec3(1.0f, 1.0f, 1.0f);
+// see LightClusters.h
+layout(set = 3, binding = 0) uniform ClusterParams
+{
+	uvec4 gridSize;	  // tiles x, tiles y, slices, lights per cluster
+	vec4 sliceParams; // xy = tile size in pixels, z = slice scale, w = slice bias
+	vec4 depthRange;  // x = near plane, y = far plane
+};
+
+layout(set = 3, binding = 1) readonly buffer LightBuffer
+{
+	Light lights[];
+};
+
+// per cluster a light count followed by its light indices
+layout(set = 3, binding = 2) readonly buffer ClusterBuffer
+{
+	uint clusterLights[];
+};
+
+// offset of the fragment's cluster in the cluster buffer. slices are exponential in view depth
+uint clusterOffset()
+{
+	float viewDepth = depthRange.x * depthRange.y / (depthRange.y - gl_FragCoord.z * (depthRange.y - depthRange.x));
+	uint slice = uint(max(log(viewDepth) * sliceParams.z + sliceParams.w, 0.0));
+
+	uvec3 cluster = min(uvec3(uvec2(gl_FragCoord.xy / sliceParams.xy), slice), gridSize.xyz - 1);
+	return (cluster.x + cluster.y * gridSize.x + cluster.z * gridSize.x * gridSize.y) * (gridSize.w + 1);
+}
 
 
 void main()
 {
+	Material material = materials[inMaterialIndex];
+
 	// Phong Model
 	vec3 albedo = texture(textureSampler, outTexcoord).rgb;
 
 	// ambient
-	vec3 ambient = albedo * material.ambient;
-	
-	// diffuse
-	vec3 lightDirection = normalize(lightPosition - fragPos);
-	float d = max(dot(outNormal, lightDirection), 0.0f);
-	vec3 diffuse = albedo * (d * material.diffuse);
-
-	// specular
-	vec3 reflection = reflect(-lightDirection, outNormal);
-	float spec = pow(max(dot(viewDir, reflection), 0.0f), material.shininess);
-	vec3 specular = albedo * lightColor * (spec * material.specular);
-
-	vec3 lighting = ambient + diffuse + specular;
+	vec3 lighting = albedo * material.ambient;
+
+	// only the lights whose spheres touch this fragment's cluster
+	uint cluster = clusterOffset();
+	uint lightCount = clusterLights[cluster];
+
+	for (uint i = 0; i < lightCount; i++)
+	{
+		Light light = lights[clusterLights[cluster + 1 + i]];
+		float radius = light.positionRadius.w;
+
+		vec3 lightDirection = light.positionRadius.xyz - fragPos;
+		float dist = length(lightDirection);
+		if (dist >= radius)
+			continue;
+
+		lightDirection = lightDirection / dist;
+		vec3 lightColor = light.colorIntensity.rgb * light.colorIntensity.a * radius / (dist * dist + 1.0f);
+
+		// diffuse
+		float d = max(dot(outNormal, lightDirection), 0.0f);
+		lighting += albedo * lightColor * (d * material.diffuse);
+
+		// specular
+		vec3 reflection = reflect(-lightDirection, outNormal);
+		float spec = pow(max(dot(viewDir, reflection), 0.0f), material.shininess);
+		lighting += albedo * lightColor * (spec * material.specular);
+	}
 
 	fragColor = vec4(lighting, 1.0f);
 }
\ No newline at end of file
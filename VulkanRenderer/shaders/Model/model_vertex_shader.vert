@@ -12,17 +12,37 @@ layout(binding = 0) uniform UniformBufferObject
 	vec3 cameraPosition;
 } ubo;
 
+// per mesh matrices, indexed by the firstInstance each mesh draws with
+struct ObjectData
+{
+	mat4 model;
+	mat4 normal;
+	uint materialIndex;
+};
+
+layout(set = 1, binding = 0) readonly buffer ObjectTable
+{
+	ObjectData objects[];
+};
+
+
+// the depth pre-pass runs this same shader, the shading pass only keeps fragments at exactly its depth
+invariant gl_Position;
 
 layout(location = 0) out vec3 viewDir;
 layout(location = 1) out vec3 fragPos;
 layout(location = 2) out vec3 outNormal;
 layout(location = 3) out vec2 outTexcoord;
+layout(location = 4) flat out uint outMaterialIndex;
 
 void main()
 {
-	gl_Position = ubo.projection * ubo.view * ubo.model * position;
-	fragPos = vec3(ubo.model * position);
+	mat4 model = ubo.model * objects[gl_InstanceIndex].model;
+
+	gl_Position = ubo.projection * ubo.view * model * position;
+	fragPos = vec3(model * position);
 	viewDir = normalize(ubo.cameraPosition - fragPos);
-	outNormal = normalize(vec3(ubo.projection * ubo.view * ubo.model * normal));
+	outNormal = normalize(vec3(ubo.projection * ubo.view * model * normal));
 	outTexcoord = texcoord;
+	outMaterialIndex = objects[gl_InstanceIndex].materialIndex;
 }
\ No newline at end of file
@@ -1,20 +1,40 @@
 #version 460
 
-layout(location = 0) in vec4 position;
-layout(location = 1) in vec4 color;
+// one vertex per live particle, fetched through the alive list. only its position and color are read
 
-
-layout(binding = 1) uniform UBO
+layout(set = 0, binding = 1) uniform UBO
 {
 	mat4 model;
 	mat4 view;
 	mat4 proj;
 };
 
+// xyz = world space position, w = fraction of its life gone
+layout(set = 1, binding = 0) readonly buffer PositionBuffer
+{
+	vec4 positions[];
+};
+
+// RGBA8
+layout(set = 1, binding = 1) readonly buffer ColorBuffer
+{
+	uint colors[];
+};
+
+layout(set = 1, binding = 2) readonly buffer AliveBuffer
+{
+	uint alive[];
+};
+
 layout(location = 0) out vec3 pColor;
 void main()
 {
+	uint index = alive[gl_VertexIndex];
+	vec4 position = positions[index];
+
 	gl_PointSize = 1.0f;
-	gl_Position = proj * view * model * position;
-	pColor = (position * color).rgb;
-}
\ No newline at end of file
+	gl_Position = proj * view * model * vec4(position.xyz, 1.0f);
+
+	// fade out over the particle's life
+	pColor = unpackUnorm4x8(colors[index]).rgb * (1.0f - clamp(position.w, 0.0f, 1.0f));
+}
@@ -0,0 +1,102 @@
+#version 460 core
+#extension GL_GOOGLE_include_directive : require
+
+// must match ShadowMap::CASCADE_COUNT
+const uint CASCADE_COUNT = 4;
+
+layout(set = 0, binding = 0) uniform Scene
+{
+	mat4 proj;
+	mat4 view;
+	mat4 lightViewProj;
+	vec4 lightPos;
+} scene;
+
+// one layer per cascade
+layout(set = 0, binding = 1) uniform sampler2DArrayShadow cascadeMap;
+
+#include "../Global/pcf.glsl"
+
+layout(set = 0, binding = 2) uniform Cascades
+{
+	mat4 viewProj[CASCADE_COUNT];
+	vec4 splitDepths;	 // view space distance each cascade ends at
+	vec4 lightDirection; // xyz = direction the light travels in
+	vec4 params;		 // x = blend band, y = tint the cascades
+} cascades;
+
+#include "../Global/material_table.glsl"
+
+// data from vertex shader
+layout (location = 0) in vec3 inFragPos;
+layout (location = 1) in vec3 inFragNormal;
+layout (location = 2) in vec3 inViewVec;
+layout (location = 3) in vec4 inLightSpacePos;
+layout (location = 4) in vec3 inLightPos;
+layout (location = 5) flat in uint inMaterialIndex;
+
+// output color
+layout(location = 0) out vec4 fragColor;
+
+vec3 lightColor = vec3(1.0);
+
+const vec3 cascadeColors[4] = vec3[](vec3(1.0, 0.4, 0.4), vec3(0.4, 1.0, 0.4), vec3(0.4, 0.4, 1.0), vec3(1.0, 1.0, 0.4));
+
+float calculate_shadow(uint cascade)
+{
+	vec4 lightSpacePos = cascades.viewProj[cascade] * vec4(inFragPos, 1.0);
+	vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w;
+
+	// xy from [-1,1] to [0,1], depth already is [0,1]
+	vec2 uv = projCoords.xy * 0.5 + 0.5;
+
+	// each tap is the lit fraction of the 2x2 texels around it
+	vec2 texel = 1.0 / vec2(textureSize(cascadeMap, 0).xy);
+	float lit = 0.0;
+	for (int i = 0; i < tapCount(); i++)
+		lit += texture(cascadeMap, vec4(uv + tapOffset(i) * texel, float(cascade), projCoords.z));
+
+	return 1.0 - lit / float(tapCount());
+}
+
+void main()
+{
+	Material mat = materials[inMaterialIndex];
+	vec3 lightDir = normalize(-cascades.lightDirection.xyz);
+	vec3 normal = normalize(inFragNormal);
+
+	float diff = max(dot(normal, lightDir), 0.0);
+
+	vec3 ambientLight = mat.ambient * lightColor;
+	vec3 diffuseLight = mat.diffuse * lightColor * diff;
+
+	// the first cascade whose slice reaches past the fragment
+	float viewDepth = -(scene.view * vec4(inFragPos, 1.0)).z;
+	uint cascade = 0;
+	while (cascade < CASCADE_COUNT && viewDepth > cascades.splitDepths[cascade])
+		cascade++;
+
+	float shadow = 0.0;
+	if (cascade < CASCADE_COUNT)
+	{
+		shadow = calculate_shadow(cascade);
+
+		// near the end of a slice, fade into the next cascade so the change in resolution doesn't show as a seam.
+		// the last one fades out, past it nothing is shadowed
+		float sliceStart = cascade == 0 ? 0.0 : cascades.splitDepths[cascade - 1];
+		float band = cascades.params.x * (cascades.splitDepths[cascade] - sliceStart);
+		float fade = (cascades.splitDepths[cascade] - viewDepth) / max(band, 0.0001);
+
+		if (fade < 1.0)
+		{
+			float nextShadow = cascade + 1 < CASCADE_COUNT ? calculate_shadow(cascade + 1) : 0.0;
+			shadow = mix(nextShadow, shadow, fade);
+		}
+	}
+
+	vec3 color = ambientLight + (1.0 - shadow) * diffuseLight;
+	if (cascades.params.y > 0.0 && cascade < CASCADE_COUNT)
+		color *= cascadeColors[cascade];
+
+	fragColor = vec4(color, 1.0);
+}
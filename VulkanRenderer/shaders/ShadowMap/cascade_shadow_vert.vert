@@ -0,0 +1,28 @@
+#version 460 core
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_multiview : enable
+
+// runs once per cascade, gl_ViewIndex is the cascade and the layer it renders to
+
+layout(location = 0) in vec4 aPos;
+layout(location = 1) in vec2 aTexcoord;
+layout(location = 2) in vec4 aNormal;
+layout(location = 3) in uint aObjectIndex; // per instance
+
+// must match ShadowMap::CASCADE_COUNT
+const uint CASCADE_COUNT = 4;
+
+layout(set = 0, binding = 0) uniform Cascades
+{
+	mat4 viewProj[CASCADE_COUNT];
+	vec4 splitDepths;
+	vec4 lightDirection;
+	vec4 params;
+} cascades;
+
+#include "../Global/object_table.glsl"
+
+void main()
+{
+	gl_Position = cascades.viewProj[gl_ViewIndex] * objects[aObjectIndex].model * aPos;
+}
@@ -0,0 +1,88 @@
+#version 460 core
+#extension GL_GOOGLE_include_directive : require
+
+layout(set = 0, binding = 0) uniform Scene
+{
+	mat4 proj;
+	mat4 view;
+	mat4 lightViewProj;
+	vec4 lightPos;
+} scene;
+
+// one layer per cube face, in cube map order
+layout(set = 0, binding = 1) uniform sampler2DArrayShadow cubeMap;
+
+#include "../Global/pcf.glsl"
+
+layout(set = 0, binding = 2) uniform Point
+{
+	mat4 faceViewProj[6]; // +x, -x, +y, -y, +z, -z
+	vec4 lightPosRange;	  // xyz = world space position, w = range
+} point;
+
+#include "../Global/material_table.glsl"
+
+// data from vertex shader
+layout (location = 0) in vec3 inFragPos;
+layout (location = 1) in vec3 inFragNormal;
+layout (location = 2) in vec3 inViewVec;
+layout (location = 3) in vec4 inLightSpacePos;
+layout (location = 4) in vec3 inLightPos;
+layout (location = 5) flat in uint inMaterialIndex;
+
+// output color
+layout(location = 0) out vec4 fragColor;
+
+vec3 lightColor = vec3(1.0);
+
+// the face a direction from the light points through, the same one a cube map lookup would pick
+uint cubeFace(vec3 direction)
+{
+	vec3 a = abs(direction);
+	if (a.x >= a.y && a.x >= a.z)
+		return direction.x > 0.0 ? 0 : 1;
+
+	if (a.y >= a.z)
+		return direction.y > 0.0 ? 2 : 3;
+
+	return direction.z > 0.0 ? 4 : 5;
+}
+
+float calculate_shadow(vec3 fragPos)
+{
+	// the same lookup as the spot light's, into the face's layer
+	uint face = cubeFace(fragPos - point.lightPosRange.xyz);
+	vec4 lightSpacePos = point.faceViewProj[face] * vec4(fragPos, 1.0);
+	vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w;
+
+	if (projCoords.z > 1.0)
+		return 0.0;
+
+	// xy from [-1,1] to [0,1], depth already is [0,1]. taps past the face's edge clamp to it
+	vec2 uv = projCoords.xy * 0.5 + 0.5;
+	vec2 texel = 1.0 / vec2(textureSize(cubeMap, 0).xy);
+	float lit = 0.0;
+	for (int i = 0; i < tapCount(); i++)
+		lit += texture(cubeMap, vec4(uv + tapOffset(i) * texel, float(face), projCoords.z));
+
+	return 1.0 - lit / float(tapCount());
+}
+
+void main()
+{
+	Material mat = materials[inMaterialIndex];
+	vec3 toLight = point.lightPosRange.xyz - inFragPos;
+	vec3 lightDir = normalize(toLight);
+	vec3 normal = normalize(inFragNormal);
+
+	// fades out towards the light's range, past it the fragment isn't lit or shadowed
+	float falloff = clamp(1.0 - length(toLight) / point.lightPosRange.w, 0.0, 1.0);
+	float diff = max(dot(normal, lightDir), 0.0) * falloff * falloff;
+
+	vec3 ambientLight = mat.ambient * lightColor;
+	vec3 diffuseLight = mat.diffuse * lightColor * diff;
+
+	float shadow = falloff > 0.0 ? calculate_shadow(inFragPos) : 0.0;
+
+	fragColor = vec4(ambientLight + (1.0 - shadow) * diffuseLight, 1.0);
+}
@@ -0,0 +1,54 @@
+#version 460 core
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_multiview : enable
+
+// runs once per cube face, gl_ViewIndex is the face and the layer it renders to
+
+layout(location = 0) in vec4 aPos;
+layout(location = 1) in vec2 aTexcoord;
+layout(location = 2) in vec4 aNormal;
+layout(location = 3) in uint aObjectIndex; // per instance
+
+layout(set = 0, binding = 0) uniform Point
+{
+	mat4 faceViewProj[6]; // +x, -x, +y, -y, +z, -z
+	vec4 lightPosRange;	  // xyz = world space position, w = range
+} point;
+
+#include "../Global/object_table.glsl"
+
+const vec3 faceDirections[6] = vec3[](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
+
+// every view draws what was culled against the whole cube, this drops an object outside of the current face.
+// a face sees where its axis is the major one, so its side planes are the diagonals between its axis and the
+// other two
+bool outsideFace(Object object)
+{
+	vec3 center = (object.model * vec4(object.boundingSphere.xyz, 1.0)).xyz - point.lightPosRange.xyz;
+	float scale = max(length(object.model[0].xyz), max(length(object.model[1].xyz), length(object.model[2].xyz)));
+	float radius = object.boundingSphere.w * scale;
+
+	vec3 axis = faceDirections[gl_ViewIndex];
+	float forward = dot(center, axis);
+	vec3 side = center - forward * axis;
+
+	// |side| along each of the other two axes, the distance to a diagonal plane is their difference over sqrt(2)
+	vec3 across = abs(side);
+	float sideDistance = max(across.x, max(across.y, across.z)) - forward;
+
+	return sideDistance * 0.70710678 > radius || forward - radius > point.lightPosRange.w;
+}
+
+void main()
+{
+	Object object = objects[aObjectIndex];
+
+	// every vertex of a dropped object lands on the same point, its triangles have no area and aren't rasterized
+	if (outsideFace(object))
+	{
+		gl_Position = vec4(0.0);
+		return;
+	}
+
+	gl_Position = point.faceViewProj[gl_ViewIndex] * object.model * aPos;
+}
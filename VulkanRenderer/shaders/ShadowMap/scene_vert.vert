@@ -1,8 +1,10 @@
 #version 460 core
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec4 aPos;
 layout(location = 1) in vec2 aTexcoord;
 layout(location = 2) in vec4 aNormal;
+layout(location = 3) in uint aObjectIndex; // per instance
 
 layout(set = 0, binding = 0) uniform Scene
 {
@@ -12,11 +14,7 @@ layout(set = 0, binding = 0) uniform Scene
 	vec4 lightPos;
 } scene;
 
-layout (set = 1, binding = 0) uniform Mesh
-{
-	mat4 model;
-	mat4 normal;
-} mesh;
+#include "../Global/object_table.glsl"
 
 // output for fragment shader
 layout (location = 0) out vec3 outFragPos;
@@ -24,11 +22,13 @@ layout (location = 1) out vec3 outFragNormal;
 layout (location = 2) out vec3 outViewVec;
 layout (location = 3) out vec4 outLightSpacePos;
 layout (location = 4) out vec3 outLightPos;
+layout (location = 5) flat out uint outMaterialIndex;
 
 void main()
 {
-	vec4 worldPos = mesh.model * aPos;
-	vec4 worldNormal = mesh.normal * aNormal;
+	Object object = objects[aObjectIndex];
+	vec4 worldPos = object.model * aPos;
+	vec4 worldNormal = object.normal * aNormal;
 
 	vec4 sceneSpace = scene.proj * scene.view * worldPos;
 	outLightSpacePos = scene.lightViewProj * worldPos;
@@ -36,6 +36,7 @@ void main()
 	outFragPos = worldPos.xyz;
 	outFragNormal = worldNormal.xyz;
 	outLightPos = scene.lightPos.xyz;
+	outMaterialIndex = object.materialIndex;
 
 	gl_Position = sceneSpace;
 }
\ No newline at end of file
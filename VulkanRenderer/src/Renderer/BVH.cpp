@@ -0,0 +1,387 @@
+#include "BVH.h"
+#include <numeric>
+#include <utility>
+
+namespace
+{
+	const uint32_t SAH_BINS = 12;
+	const uint32_t MAX_LEAF_SIZE = 4;
+
+	// distance along the ray to the box, FLT_MAX on a miss. invDirection must be finite, see safeInverse
+	float intersectRayAABB(const glm::vec3& origin, const glm::vec3& invDirection, const AABB& box)
+	{
+		glm::vec3 t0 = (box.min - origin) * invDirection;
+		glm::vec3 t1 = (box.max - origin) * invDirection;
+
+		glm::vec3 tSmall = glm::min(t0, t1);
+		glm::vec3 tLarge = glm::max(t0, t1);
+
+		float tMin = glm::max(glm::max(tSmall.x, tSmall.y), glm::max(tSmall.z, 0.0f));
+		float tMax = glm::min(glm::min(tLarge.x, tLarge.y), tLarge.z);
+
+		return tMin <= tMax ? tMin : FLT_MAX;
+	}
+
+	// 1 / direction with the zero components replaced by a large finite value. an infinite one would turn
+	// a box face lying on the ray's origin into 0 * inf = NaN, and the min/max above would drop the slab
+	glm::vec3 safeInverse(const glm::vec3& direction)
+	{
+		glm::vec3 inverse;
+		for (int axis = 0; axis < 3; axis++)
+			inverse[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : 1e30f;
+
+		return inverse;
+	}
+
+	bool intersectSphereAABB(const glm::vec3& center, float radius, const AABB& box)
+	{
+		glm::vec3 closest = glm::clamp(center, box.min, box.max);
+		glm::vec3 delta = center - closest;
+		return glm::dot(delta, delta) <= radius * radius;
+	}
+}
+
+void AABB::grow(const glm::vec3& point)
+{
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+void AABB::grow(const AABB& other)
+{
+	min = glm::min(min, other.min);
+	max = glm::max(max, other.max);
+}
+
+float AABB::surfaceArea() const
+{
+	glm::vec3 e = max - min;
+	return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+AABB AABB::transform(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model)
+{
+	// Arvo's method, each axis of the matrix stretches the box by its min or max contribution
+	AABB result;
+	result.min = result.max = glm::vec3(model[3]);
+
+	for (int col = 0; col < 3; col++)
+	{
+		glm::vec3 a = glm::vec3(model[col]) * localMin[col];
+		glm::vec3 b = glm::vec3(model[col]) * localMax[col];
+		result.min += glm::min(a, b);
+		result.max += glm::max(a, b);
+	}
+
+	return result;
+}
+
+void BVH::build(const std::vector<AABB>& objectBounds)
+{
+	uint32_t objectCount = static_cast<uint32_t>(objectBounds.size());
+
+	bounds = objectBounds;
+	nodes.clear();
+	objectIndices.resize(objectCount);
+	std::iota(objectIndices.begin(), objectIndices.end(), 0);
+	leafOfObject.assign(objectCount, 0);
+
+	if (objectCount == 0)
+		return;
+
+	nodes.reserve(2 * objectCount - 1);
+
+	Node root = {};
+	root.count = objectCount;
+	nodes.push_back(root);
+
+	updateNodeBounds(0);
+	subdivide(0);
+}
+
+void BVH::updateNodeBounds(uint32_t nodeIndex)
+{
+	Node& node = nodes[nodeIndex];
+	node.bounds = AABB();
+
+	for (uint32_t i = node.first; i < node.first + node.count; i++)
+		node.bounds.grow(bounds[objectIndices[i]]);
+}
+
+void BVH::subdivide(uint32_t nodeIndex)
+{
+	// copy, pushing children may reallocate
+	Node node = nodes[nodeIndex];
+
+	auto makeLeaf = [&]()
+	{
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+			leafOfObject[objectIndices[i]] = nodeIndex;
+	};
+
+	if (node.count <= MAX_LEAF_SIZE)
+	{
+		makeLeaf();
+		return;
+	}
+
+	// split on object centers, so bin over the bounds of the centers rather than the node itself
+	AABB centerBounds;
+	for (uint32_t i = node.first; i < node.first + node.count; i++)
+		centerBounds.grow(bounds[objectIndices[i]].center());
+
+	int bestAxis = -1;
+	uint32_t bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centerBounds.max[axis] - centerBounds.min[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		AABB binBounds[SAH_BINS];
+		uint32_t binCounts[SAH_BINS] = {};
+		float scale = SAH_BINS / extent;
+
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			const AABB& box = bounds[objectIndices[i]];
+			uint32_t bin = glm::min(SAH_BINS - 1, static_cast<uint32_t>((box.center()[axis] - centerBounds.min[axis]) * scale));
+			binCounts[bin]++;
+			binBounds[bin].grow(box);
+		}
+
+		// sweep from both sides to get the cost of splitting after every bin
+		float leftArea[SAH_BINS - 1], rightArea[SAH_BINS - 1];
+		uint32_t leftCount[SAH_BINS - 1], rightCount[SAH_BINS - 1];
+		AABB leftBox, rightBox;
+		uint32_t leftSum = 0, rightSum = 0;
+
+		for (uint32_t i = 0; i < SAH_BINS - 1; i++)
+		{
+			leftSum += binCounts[i];
+			leftBox.grow(binBounds[i]);
+			leftCount[i] = leftSum;
+			leftArea[i] = leftBox.surfaceArea();
+
+			rightSum += binCounts[SAH_BINS - 1 - i];
+			rightBox.grow(binBounds[SAH_BINS - 1 - i]);
+			rightCount[SAH_BINS - 2 - i] = rightSum;
+			rightArea[SAH_BINS - 2 - i] = rightBox.surfaceArea();
+		}
+
+		for (uint32_t i = 0; i < SAH_BINS - 1; i++)
+		{
+			if (leftCount[i] == 0 || rightCount[i] == 0)
+				continue;
+
+			float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	// keep the node whole if no split is cheaper than testing everything in it
+	if (bestAxis == -1 || bestCost >= node.count * node.bounds.surfaceArea())
+	{
+		makeLeaf();
+		return;
+	}
+
+	// partition objects so the left child's come first
+	float scale = SAH_BINS / (centerBounds.max[bestAxis] - centerBounds.min[bestAxis]);
+	uint32_t i = node.first;
+	uint32_t j = node.first + node.count;
+
+	while (i < j)
+	{
+		float c = bounds[objectIndices[i]].center()[bestAxis];
+		uint32_t bin = glm::min(SAH_BINS - 1, static_cast<uint32_t>((c - centerBounds.min[bestAxis]) * scale));
+
+		if (bin <= bestSplit)
+			i++;
+		else
+			std::swap(objectIndices[i], objectIndices[--j]);
+	}
+
+	uint32_t leftCount = i - node.first;
+	uint32_t left = static_cast<uint32_t>(nodes.size());
+
+	Node leftChild = {}, rightChild = {};
+	leftChild.first = node.first;
+	leftChild.count = leftCount;
+	leftChild.parent = nodeIndex;
+	rightChild.first = i;
+	rightChild.count = node.count - leftCount;
+	rightChild.parent = nodeIndex;
+
+	nodes.push_back(leftChild);
+	nodes.push_back(rightChild);
+	nodes[nodeIndex].left = left;
+
+	updateNodeBounds(left);
+	updateNodeBounds(left + 1);
+	subdivide(left);
+	subdivide(left + 1);
+}
+
+void BVH::refit(uint32_t objectIndex, const AABB& objectBounds)
+{
+	if (nodes.empty())
+		return;
+
+	bounds[objectIndex] = objectBounds;
+
+	uint32_t nodeIndex = leafOfObject[objectIndex];
+	updateNodeBounds(nodeIndex);
+
+	// walk up to the root, each parent is the union of its children
+	while (nodeIndex != 0)
+	{
+		nodeIndex = nodes[nodeIndex].parent;
+
+		Node& node = nodes[nodeIndex];
+		node.bounds = nodes[node.left].bounds;
+		node.bounds.grow(nodes[node.left + 1].bounds);
+	}
+}
+
+void BVH::appendNodeObjects(const Node& node, std::vector<uint32_t>& results) const
+{
+	results.insert(results.end(), objectIndices.begin() + node.first, objectIndices.begin() + node.first + node.count);
+}
+
+void BVH::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const
+{
+	if (nodes.empty())
+		return;
+
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		FrustumResult test = frustum.classifyAABB(node.bounds.min, node.bounds.max);
+		if (test == FrustumResult::OUTSIDE)
+			continue;
+
+		// nothing below a fully visible node needs testing
+		if (test == FrustumResult::INSIDE)
+		{
+			appendNodeObjects(node, results);
+			continue;
+		}
+
+		if (node.isLeaf())
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				const AABB& box = bounds[objectIndices[i]];
+				if (frustum.intersectsAABB(box.min, box.max))
+					results.push_back(objectIndices[i]);
+			}
+		}
+
+		else
+		{
+			stack.push_back(node.left);
+			stack.push_back(node.left + 1);
+		}
+	}
+}
+
+void BVH::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const
+{
+	if (nodes.empty())
+		return;
+
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!intersectSphereAABB(center, radius, node.bounds))
+			continue;
+
+		if (node.isLeaf())
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (intersectSphereAABB(center, radius, bounds[objectIndices[i]]))
+					results.push_back(objectIndices[i]);
+			}
+		}
+
+		else
+		{
+			stack.push_back(node.left);
+			stack.push_back(node.left + 1);
+		}
+	}
+}
+
+int32_t BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float* hitDistance) const
+{
+	int32_t closestObject = -1;
+	float closest = FLT_MAX;
+
+	if (nodes.empty())
+		return closestObject;
+
+	glm::vec3 invDirection = safeInverse(direction);
+
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		// skip anything further away than the closest hit so far
+		if (intersectRayAABB(origin, invDirection, node.bounds) >= closest)
+			continue;
+
+		if (node.isLeaf())
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				float t = intersectRayAABB(origin, invDirection, bounds[objectIndices[i]]);
+				if (t < closest)
+				{
+					closest = t;
+					closestObject = static_cast<int32_t>(objectIndices[i]);
+				}
+			}
+		}
+
+		else
+		{
+			// visit the nearer child first so it can prune the other one
+			float tLeft = intersectRayAABB(origin, invDirection, nodes[node.left].bounds);
+			float tRight = intersectRayAABB(origin, invDirection, nodes[node.left + 1].bounds);
+
+			if (tLeft < tRight)
+			{
+				stack.push_back(node.left + 1);
+				stack.push_back(node.left);
+			}
+
+			else
+			{
+				stack.push_back(node.left);
+				stack.push_back(node.left + 1);
+			}
+		}
+	}
+
+	if (hitDistance && closestObject != -1)
+		*hitDistance = closest;
+
+	return closestObject;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cfloat>
+#include "Frustum.h"
+
+struct AABB
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	void grow(const glm::vec3& point);
+	void grow(const AABB& other);
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	float surfaceArea() const;
+
+	// bounds of a local space box after it's been transformed by a model matrix
+	static AABB transform(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& model);
+};
+
+// bounding volume hierarchy over scene objects, built with the surface area heuristic.
+// objects are referenced by index, so callers keep their own object arrays.
+// moving an object only refits the boxes above it, call build() again if the tree degrades badly
+class BVH
+{
+public:
+	void build(const std::vector<AABB>& objectBounds);
+	void refit(uint32_t objectIndex, const AABB& bounds);
+
+	// every query appends object indices to results
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const;
+	void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const;
+
+	// closest object whose box the ray hits, -1 if nothing was hit
+	int32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float* hitDistance = nullptr) const;
+
+	bool empty() const { return nodes.empty(); }
+
+private:
+	struct Node
+	{
+		AABB bounds;
+		uint32_t first = 0;   // every node covers objectIndices[first, first + count)
+		uint32_t count = 0;
+		uint32_t left = 0;    // children are left and left + 1, 0 for leaves since the root is never a child
+		uint32_t parent = 0;
+
+		bool isLeaf() const { return left == 0; }
+	};
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> objectIndices; // object indices, ordered so every node's objects are contiguous
+	std::vector<uint32_t> leafOfObject;  // leaf node holding each object, for refitting
+	std::vector<AABB> bounds;			 // per object, indexed by object index
+
+	void subdivide(uint32_t nodeIndex);
+	void updateNodeBounds(uint32_t nodeIndex);
+	void appendNodeObjects(const Node& node, std::vector<uint32_t>& results) const;
+};
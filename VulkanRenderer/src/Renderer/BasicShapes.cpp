@@ -66,6 +66,7 @@ namespace BasicShapes
 
 			box->vertexBuffer = ModelLoader::createMeshVertexBuffer(box->vertices);
 			box->indexBuffer = ModelLoader::createMeshIndexBuffer(box->indices);
+			box->computeBounds();
 
 			Texture* emptyTexture = TextureLoader::getEmptyTexture();
 
@@ -73,7 +74,7 @@ namespace BasicShapes
 
 			box->material->createDescriptorSet(emptyTexture);
 
-			box->createDescriptorSet();
+			box->createObjectEntry();
 		}
 
 		void createSphere()
@@ -99,13 +100,14 @@ namespace BasicShapes
 			plane->indices = { 0, 1, 2, 0, 2, 3 };
 			plane->vertexBuffer = ModelLoader::createMeshVertexBuffer(plane->vertices);
 			plane->indexBuffer = ModelLoader::createMeshIndexBuffer(plane->indices);
+			plane->computeBounds();
 
 			Texture* emptyTexture = TextureLoader::getEmptyTexture();
 
 			plane->material = new Material();
 
 			plane->material->createDescriptorSet(emptyTexture);
-			plane->createDescriptorSet();
+			plane->createObjectEntry();
 
 		}
 
@@ -134,17 +136,10 @@ namespace BasicShapes
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &shape::box->vertexBuffer.buffer, offsets);
 		vkCmdBindIndexBuffer(commandBuffer, shape::box->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-		// bind model uniform buffer
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-			1, 1, &shape::box->descriptorSet, 0, nullptr);
-
 		if (useMaterial)
-		{
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-				2, 1, &shape::box->material->descriptorSet, 0, nullptr);
-		}
+			shape::box->material->bind(commandBuffer, pipelineLayout);
 
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(shape::box->indices.size()), 1, 0, 0, 0);
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(shape::box->indices.size()), 1, 0, 0, shape::box->objectIndex);
 	}
 
 	void drawSphere(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial)
@@ -158,16 +153,10 @@ namespace BasicShapes
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &sphere->vertexBuffer.buffer, offsets);
 		vkCmdBindIndexBuffer(commandBuffer, sphere->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-			1, 1, &sphere->descriptorSet, 0, nullptr);
-
 		if (useMaterial)
-		{
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-				2, 1, &sphere->material->descriptorSet, 0, nullptr);
-		}
+			sphere->material->bind(commandBuffer, pipelineLayout);
 
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(sphere->indices.size()), 1, 0, 0, 0);
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(sphere->indices.size()), 1, 0, 0, sphere->objectIndex);
 	}
 
 	void drawTorus(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial)
@@ -180,17 +169,10 @@ namespace BasicShapes
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &torus->vertexBuffer.buffer, offsets);
 		vkCmdBindIndexBuffer(commandBuffer, torus->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-		// bind model uniform buffer
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-			1, 1, &torus->descriptorSet, 0, nullptr);
-
 		if (useMaterial)
-		{
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-				2, 1, &torus->material->descriptorSet, 0, nullptr);
-		}
+			torus->material->bind(commandBuffer, pipelineLayout);
 
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(torus->indices.size()), 1, 0, 0, 0);
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(torus->indices.size()), 1, 0, 0, torus->objectIndex);
 	}
 
 	void drawPlane(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial)
@@ -202,16 +184,10 @@ namespace BasicShapes
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &shape::plane->vertexBuffer.buffer, offsets);
 		vkCmdBindIndexBuffer(commandBuffer, shape::plane->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-			1, 1, &shape::plane->descriptorSet, 0, nullptr);
-
 		if (useMaterial)
-		{
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-				2, 1, &shape::plane->material->descriptorSet, 0, nullptr);
-		}
+			shape::plane->material->bind(commandBuffer, pipelineLayout);
 
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(shape::plane->indices.size()), 1, 0, 0, 0);
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(shape::plane->indices.size()), 1, 0, 0, shape::plane->objectIndex);
 	}
 	
 	void drawCone(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial)
@@ -224,16 +200,10 @@ namespace BasicShapes
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &cone->vertexBuffer.buffer, offsets);
 		vkCmdBindIndexBuffer(commandBuffer, cone->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-			1, 1, &cone->descriptorSet, 0, nullptr);
-
 		if (useMaterial)
-		{
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-				2, 1, &cone->material->descriptorSet, 0, nullptr);
-		}
+			cone->material->bind(commandBuffer, pipelineLayout);
 
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(cone->indices.size()), 1, 0, 0, 0);
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(cone->indices.size()), 1, 0, 0, cone->objectIndex);
 	}
 	
 	void drawMonkey(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial)
@@ -247,16 +217,10 @@ namespace BasicShapes
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &monkey->vertexBuffer.buffer, offsets);
 		vkCmdBindIndexBuffer(commandBuffer, monkey->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-			1, 1, &monkey->descriptorSet, 0, nullptr);
-
 		if (useMaterial)
-		{
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-				2, 1, &monkey->material->descriptorSet, 0, nullptr);
-		}
+			monkey->material->bind(commandBuffer, pipelineLayout);
 
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(monkey->indices.size()), 1, 0, 0, 0);
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(monkey->indices.size()), 1, 0, 0, monkey->objectIndex);
 	}
 	
 	void drawCylinder(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial)
@@ -270,16 +234,10 @@ namespace BasicShapes
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &cylinder->vertexBuffer.buffer, offsets);
 		vkCmdBindIndexBuffer(commandBuffer, cylinder->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-			1, 1, &cylinder->descriptorSet, 0, nullptr);
-
 		if (useMaterial)
-		{
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-				2, 1, &cylinder->material->descriptorSet, 0, nullptr);
-		}
+			cylinder->material->bind(commandBuffer, pipelineLayout);
 
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(cylinder->indices.size()), 1, 0, 0, 0);
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(cylinder->indices.size()), 1, 0, 0, cylinder->objectIndex);
 	}
 	
 
@@ -446,6 +404,7 @@ namespace BasicShapes
 
 		box.vertexBuffer = ModelLoader::createMeshVertexBuffer(box.vertices);
 		box.indexBuffer = ModelLoader::createMeshIndexBuffer(box.indices);
+		box.computeBounds();
 
 		box.material = new Material();
 		box.material->ubo.ambient = glm::vec3(0.1f);
@@ -453,7 +412,7 @@ namespace BasicShapes
 
 		box.material->createDescriptorSet(TextureLoader::getEmptyTexture());
 
-		box.createDescriptorSet();
+		box.createObjectEntry();
 
 		return box;
 	}
@@ -474,12 +433,13 @@ namespace BasicShapes
 		plane.indices = { 0, 1, 2, 0, 2, 3 };
 		plane.vertexBuffer = ModelLoader::createMeshVertexBuffer(plane.vertices);
 		plane.indexBuffer = ModelLoader::createMeshIndexBuffer(plane.indices);
+		plane.computeBounds();
 
 		plane.material = new Material();
 
 		plane.material->createDescriptorSet(TextureLoader::getEmptyTexture());
 
-		plane.createDescriptorSet();
+		plane.createObjectEntry();
 
 		return plane;
 	}
@@ -493,10 +453,11 @@ namespace BasicShapes
 		sphere.indices = sphereModel->indices;
 		sphere.vertexBuffer = ModelLoader::createMeshVertexBuffer(sphere.vertices);
 		sphere.indexBuffer = ModelLoader::createMeshIndexBuffer(sphere.indices);
+		sphere.computeBounds();
 
 		sphere.material = new Material();
 		sphere.material->createDescriptorSet(TextureLoader::getEmptyTexture());
-		sphere.createDescriptorSet();
+		sphere.createObjectEntry();
 
 		return sphere;
 	}
@@ -510,9 +471,10 @@ namespace BasicShapes
 		torus.indices = torusModel->indices;
 		torus.vertexBuffer = ModelLoader::createMeshVertexBuffer(torus.vertices);
 		torus.indexBuffer = ModelLoader::createMeshIndexBuffer(torus.indices);
+		torus.computeBounds();
 		torus.material = new Material();
 		torus.material->createDescriptorSet(TextureLoader::getEmptyTexture());
-		torus.createDescriptorSet();
+		torus.createObjectEntry();
 
 		return torus;
 	}
@@ -526,9 +488,10 @@ namespace BasicShapes
 		cone.indices = coneModel->indices;
 		cone.vertexBuffer = ModelLoader::createMeshVertexBuffer(cone.vertices);
 		cone.indexBuffer = ModelLoader::createMeshIndexBuffer(cone.indices);
+		cone.computeBounds();
 		cone.material = new Material();
 		cone.material->createDescriptorSet(TextureLoader::getEmptyTexture());
-		cone.createDescriptorSet();
+		cone.createObjectEntry();
 
 		return cone;
 	}
@@ -542,9 +505,10 @@ namespace BasicShapes
 		monkey.indices = monkeyModel->indices;
 		monkey.vertexBuffer = ModelLoader::createMeshVertexBuffer(monkey.vertices);
 		monkey.indexBuffer = ModelLoader::createMeshIndexBuffer(monkey.indices);
+		monkey.computeBounds();
 		monkey.material = new Material();
 		monkey.material->createDescriptorSet(TextureLoader::getEmptyTexture());
-		monkey.createDescriptorSet();
+		monkey.createObjectEntry();
 
 		return monkey;
 	}
@@ -558,9 +522,10 @@ namespace BasicShapes
 		cylinder.indices = cylinderModel->indices;
 		cylinder.vertexBuffer = ModelLoader::createMeshVertexBuffer(cylinder.vertices);
 		cylinder.indexBuffer = ModelLoader::createMeshIndexBuffer(cylinder.indices);
+		cylinder.computeBounds();
 		cylinder.material = new Material();
 		cylinder.material->createDescriptorSet(TextureLoader::getEmptyTexture());
-		cylinder.createDescriptorSet();
+		cylinder.createObjectEntry();
 
 		return cylinder;
 	}
@@ -4,7 +4,7 @@
 
 namespace BasicShapes
 {
-	// commands to simply draw a premade shape
+	// commands to simply draw a premade shape, the ObjectTable must already be bound at set 1
 	void drawBox(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial = false);
 	void drawSphere(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial = false);
 	void drawTorus(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial = false);
@@ -0,0 +1,261 @@
+#include "Descriptors.h"
+#include "HelperStructs.h"
+#include <algorithm>
+#include <string>
+
+// pool sizes per set, enough for the layouts used across the scenes. a layout that needs more than
+// a pool has left simply moves on to the next pool
+const std::pair<VkDescriptorType, uint32_t> POOL_RATIOS[] =
+{
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+	{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1 }
+};
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	if (currentPool == VK_NULL_HANDLE)
+		currentPool = grabPool();
+
+	VkDescriptorSetAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	allocInfo.descriptorPool = currentPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+
+	// the pool is full, move on to a fresh one and try once more
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		currentPool = grabPool();
+		allocInfo.descriptorPool = currentPool;
+		result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+	}
+
+	if (result != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate descriptor set");
+
+	return set;
+}
+
+void DescriptorAllocator::reset()
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	for (VkDescriptorPool pool : usedPools)
+	{
+		vkResetDescriptorPool(device, pool, 0);
+		freePools.push_back(pool);
+	}
+
+	usedPools.clear();
+	currentPool = VK_NULL_HANDLE;
+}
+
+void DescriptorAllocator::destroy()
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	for (VkDescriptorPool pool : usedPools)
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	for (VkDescriptorPool pool : freePools)
+		vkDestroyDescriptorPool(device, pool, nullptr);
+
+	usedPools.clear();
+	freePools.clear();
+	currentPool = VK_NULL_HANDLE;
+}
+
+VkDescriptorPool DescriptorAllocator::grabPool()
+{
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+
+	if (!freePools.empty())
+	{
+		pool = freePools.back();
+		freePools.pop_back();
+	}
+
+	else
+	{
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (const auto& ratio : POOL_RATIOS)
+			poolSizes.push_back({ ratio.first, ratio.second * setsPerPool });
+
+		VkDescriptorPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+		poolInfo.maxSets = setsPerPool;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+
+		if (vkCreateDescriptorPool(VulkanDevice::GetVulkanDevice()->GetLogicalDevice(), &poolInfo, nullptr, &pool) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create descriptor pool");
+
+		setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+	}
+
+	usedPools.push_back(pool);
+	return pool;
+}
+
+namespace Descriptors
+{
+	namespace priv
+	{
+		struct LayoutKey
+		{
+			std::vector<VkDescriptorSetLayoutBinding> bindings; // sorted by binding
+
+			bool operator==(const LayoutKey& other) const
+			{
+				if (bindings.size() != other.bindings.size())
+					return false;
+
+				for (size_t i = 0; i < bindings.size(); i++)
+				{
+					const VkDescriptorSetLayoutBinding& a = bindings[i];
+					const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+					if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount ||
+						a.stageFlags != b.stageFlags || a.pImmutableSamplers != b.pImmutableSamplers)
+						return false;
+				}
+
+				return true;
+			}
+		};
+
+		struct LayoutKeyHash
+		{
+			size_t operator()(const LayoutKey& key) const
+			{
+				size_t res = 0;
+				for (const VkDescriptorSetLayoutBinding& b : key.bindings)
+				{
+					std::hash_combine(res, b.binding);
+					std::hash_combine(res, static_cast<uint32_t>(b.descriptorType));
+					std::hash_combine(res, b.descriptorCount);
+					std::hash_combine(res, b.stageFlags);
+				}
+				return res;
+			}
+		};
+
+		static std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> layouts;
+		static std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSetLayoutBinding>> layoutBindings;
+
+		// a template and the number of DescriptorInfos it reads. layouts without bindings get no template
+		struct UpdateTemplate
+		{
+			VkDescriptorUpdateTemplate handle = VK_NULL_HANDLE;
+			size_t descriptorCount = 0;
+		};
+
+		static std::unordered_map<VkDescriptorSetLayout, UpdateTemplate> templates;
+		static DescriptorAllocator allocator;
+
+		UpdateTemplate createTemplate(VkDescriptorSetLayout layout)
+		{
+			auto found = layoutBindings.find(layout);
+			if (found == layoutBindings.end())
+				throw std::runtime_error("Descriptor set layout wasn't created through Descriptors::getLayout");
+
+			// descriptors are read from consecutive DescriptorInfos, in binding order
+			std::vector<VkDescriptorUpdateTemplateEntry> entries;
+			size_t offset = 0;
+			for (const VkDescriptorSetLayoutBinding& binding : found->second)
+			{
+				VkDescriptorUpdateTemplateEntry entry = {};
+				entry.dstBinding = binding.binding;
+				entry.dstArrayElement = 0;
+				entry.descriptorCount = binding.descriptorCount;
+				entry.descriptorType = binding.descriptorType;
+				entry.offset = offset;
+				entry.stride = sizeof(DescriptorInfo);
+				entries.push_back(entry);
+
+				offset += sizeof(DescriptorInfo) * binding.descriptorCount;
+			}
+
+			UpdateTemplate updateTemplate;
+			updateTemplate.descriptorCount = offset / sizeof(DescriptorInfo);
+			if (entries.empty())
+				return updateTemplate;
+
+			VkDescriptorUpdateTemplateCreateInfo templateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
+			templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+			templateInfo.pDescriptorUpdateEntries = entries.data();
+			templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+			templateInfo.descriptorSetLayout = layout;
+
+			if (vkCreateDescriptorUpdateTemplate(VulkanDevice::GetVulkanDevice()->GetLogicalDevice(), &templateInfo, nullptr, &updateTemplate.handle) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create descriptor update template");
+
+			return updateTemplate;
+		}
+	}
+}
+
+VkDescriptorSetLayout Descriptors::getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	priv::LayoutKey key = { bindings };
+	std::sort(key.bindings.begin(), key.bindings.end(),
+		[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+	auto found = priv::layouts.find(key);
+	if (found != priv::layouts.end())
+		return found->second;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+	layoutInfo.pBindings = key.bindings.data();
+
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(VulkanDevice::GetVulkanDevice()->GetLogicalDevice(), &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create descriptor set layout!");
+
+	priv::layoutBindings.emplace(layout, key.bindings);
+	priv::layouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkDescriptorSet Descriptors::allocate(VkDescriptorSetLayout layout)
+{
+	return priv::allocator.allocate(layout);
+}
+
+void Descriptors::write(VkDescriptorSet set, VkDescriptorSetLayout layout, const std::vector<DescriptorInfo>& infos)
+{
+	auto found = priv::templates.find(layout);
+	if (found == priv::templates.end())
+		found = priv::templates.emplace(layout, priv::createTemplate(layout)).first;
+
+	// the template reads exactly this many infos, fewer would read past the vector
+	if (infos.size() != found->second.descriptorCount)
+		throw std::runtime_error("Descriptors::write got " + std::to_string(infos.size()) + " descriptors, the layout has " +
+			std::to_string(found->second.descriptorCount));
+
+	// a layout without bindings has nothing to write
+	if (found->second.handle == VK_NULL_HANDLE)
+		return;
+
+	vkUpdateDescriptorSetWithTemplate(VulkanDevice::GetVulkanDevice()->GetLogicalDevice(), set, found->second.handle, infos.data());
+}
+
+void Descriptors::destroy()
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	for (auto& updateTemplate : priv::templates)
+		vkDestroyDescriptorUpdateTemplate(device, updateTemplate.second.handle, nullptr);
+	for (auto& layout : priv::layouts)
+		vkDestroyDescriptorSetLayout(device, layout.second, nullptr);
+
+	priv::templates.clear();
+	priv::layouts.clear();
+	priv::layoutBindings.clear();
+	priv::allocator.destroy();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+// one descriptor's worth of data for Descriptors::write(), either a buffer or an image
+union DescriptorInfo
+{
+	VkDescriptorBufferInfo buffer;
+	VkDescriptorImageInfo image;
+
+	DescriptorInfo(const VkDescriptorBufferInfo& bufferInfo) : buffer(bufferInfo) {}
+	DescriptorInfo(const VkDescriptorImageInfo& imageInfo) : image(imageInfo) {}
+	DescriptorInfo(VkBuffer buf, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE) : buffer({ buf, offset, range }) {}
+};
+
+// hands out descriptor sets from a list of pools instead of one pool sized for a single user. when a pool runs
+// out (VK_ERROR_OUT_OF_POOL_MEMORY) the next one is created, each twice the size of the last. sets are never freed
+// one by one, reset() returns all of them at once and keeps the pools around for reuse
+class DescriptorAllocator
+{
+public:
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+	// every set allocated so far becomes invalid
+	void reset();
+	void destroy();
+
+private:
+	const uint32_t MAX_SETS_PER_POOL = 4096;
+
+	VkDescriptorPool currentPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPool> usedPools, freePools;
+	uint32_t setsPerPool = 64;
+
+	VkDescriptorPool grabPool();
+};
+
+// renderer wide descriptor helpers
+// layouts are cached by their bindings, so asking for the same bindings twice returns the same layout. cached
+// layouts are owned here, don't destroy them. sets written through write() use a VkDescriptorUpdateTemplate
+// built once per layout, which fills every binding of a set with a single call
+namespace Descriptors
+{
+	VkDescriptorSetLayout getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+	// from a shared allocator, for sets that live as long as the scene (materials, tables)
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+	// infos holds one entry per descriptor, ordered by binding. the layout must come from getLayout()
+	void write(VkDescriptorSet set, VkDescriptorSetLayout layout, const std::vector<DescriptorInfo>& infos);
+
+	// every cached layout and template, and the shared allocator's sets
+	void destroy();
+}
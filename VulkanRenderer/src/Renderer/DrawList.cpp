@@ -0,0 +1,217 @@
+#include "DrawList.h"
+#include <stdexcept>
+#include <string>
+
+// command recorder
+void CommandRecorder::begin(VkCommandBuffer cmdBuffer)
+{
+	commandBuffer = cmdBuffer;
+	stats = DrawStats();
+	invalidate();
+}
+
+void CommandRecorder::invalidate()
+{
+	pipeline = VK_NULL_HANDLE;
+	setsLayout = VK_NULL_HANDLE;
+	indexBuffer = VK_NULL_HANDLE;
+
+	for (uint32_t i = 0; i < MAX_SETS; i++)
+		sets[i] = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; i++)
+		vertexBuffers[i] = VK_NULL_HANDLE;
+}
+
+void CommandRecorder::bindPipeline(VkPipeline newPipeline)
+{
+	if (newPipeline == pipeline)
+	{
+		stats.skippedBinds++;
+		return;
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, newPipeline);
+	pipeline = newPipeline;
+	stats.pipelineBinds++;
+}
+
+void CommandRecorder::bindDescriptorSet(VkPipelineLayout pipelineLayout, uint32_t setIndex, VkDescriptorSet set)
+{
+	if (pipelineLayout != setsLayout)
+	{
+		for (uint32_t i = 0; i < MAX_SETS; i++)
+			sets[i] = VK_NULL_HANDLE;
+		setsLayout = pipelineLayout;
+	}
+
+	else if (setIndex < MAX_SETS && sets[setIndex] == set)
+	{
+		stats.skippedBinds++;
+		return;
+	}
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, setIndex, 1, &set, 0, nullptr);
+	if (setIndex < MAX_SETS)
+		sets[setIndex] = set;
+	stats.descriptorSetBinds++;
+}
+
+void CommandRecorder::bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* buffers)
+{
+	static const VkDeviceSize offsets[MAX_VERTEX_BINDINGS] = {};
+
+	if (firstBinding + bindingCount > MAX_VERTEX_BINDINGS)
+		throw std::runtime_error("CommandRecorder only tracks 4 vertex buffer bindings");
+
+	// rebind only the range of bindings that actually changed
+	uint32_t first = bindingCount, last = 0;
+	for (uint32_t i = 0; i < bindingCount; i++)
+	{
+		if (vertexBuffers[firstBinding + i] != buffers[i])
+		{
+			first = glm::min(first, i);
+			last = i;
+		}
+	}
+
+	if (first == bindingCount)
+	{
+		stats.skippedBinds++;
+		return;
+	}
+
+	vkCmdBindVertexBuffers(commandBuffer, firstBinding + first, last - first + 1, buffers + first, offsets);
+	for (uint32_t i = first; i <= last; i++)
+		vertexBuffers[firstBinding + i] = buffers[i];
+	stats.vertexBufferBinds++;
+}
+
+void CommandRecorder::bindIndexBuffer(VkBuffer buffer, VkIndexType type)
+{
+	if (buffer == indexBuffer && type == indexType)
+	{
+		stats.skippedBinds++;
+		return;
+	}
+
+	vkCmdBindIndexBuffer(commandBuffer, buffer, 0, type);
+	indexBuffer = buffer;
+	indexType = type;
+	stats.indexBufferBinds++;
+}
+
+void CommandRecorder::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+	vkCmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+	stats.draws++;
+}
+
+void CommandRecorder::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+	vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+	stats.draws++;
+}
+
+void CommandRecorder::drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
+{
+	vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+	stats.draws++;
+}
+
+void CommandRecorder::drawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countOffset,
+	uint32_t maxDrawCount, uint32_t stride)
+{
+	vkCmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+	stats.draws++;
+}
+
+// draw list
+void DrawList::submit(uint32_t pass, const DrawItem& item, float depth)
+{
+	if (pass > 0xF)
+		throw std::runtime_error("draw list pass " + std::to_string(pass) + " doesn't fit the sort key");
+
+	uint64_t pipelineId = getId(pipelineIds, (uint64_t)item.pipeline, 0xFFF, "pipelines");
+	uint64_t materialId = getId(materialIds, (uint64_t)item.materialSet, 0xFFFF, "materials");
+	uint64_t meshId = getId(meshIds, (uint64_t)item.mesh->vertexBuffer.buffer, 0xFFFF, "meshes");
+	uint64_t depthBits = static_cast<uint64_t>(glm::clamp(depth, 0.0f, 1.0f) * 65535.0f);
+
+	uint64_t key = (uint64_t(pass) << 60) | (pipelineId << 48) | (materialId << 32) | (meshId << 16) | depthBits;
+
+	entries.push_back({ key, static_cast<uint32_t>(items.size()) });
+	items.push_back(item);
+}
+
+void DrawList::sort()
+{
+	if (entries.size() < 2)
+		return;
+
+	// least significant byte first, 8 passes of counting sort
+	scratch.resize(entries.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		uint32_t counts[256] = {};
+		for (const SortEntry& entry : entries)
+			counts[(entry.key >> shift) & 0xFF]++;
+
+		// every key has the same byte here, nothing to reorder. most passes end up here since
+		// the ids are small and the unused pass bits are all zero
+		if (counts[(entries[0].key >> shift) & 0xFF] == entries.size())
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t count = counts[i];
+			counts[i] = offset;
+			offset += count;
+		}
+
+		for (const SortEntry& entry : entries)
+			scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+
+		entries.swap(scratch);
+	}
+}
+
+void DrawList::record(CommandRecorder& recorder)
+{
+	for (const SortEntry& entry : entries)
+	{
+		const DrawItem& item = items[entry.itemIndex];
+
+		recorder.bindPipeline(item.pipeline);
+		if (item.materialSet != VK_NULL_HANDLE)
+			recorder.bindDescriptorSet(item.pipelineLayout, 2, item.materialSet);
+
+		recorder.bindVertexBuffers(0, 1, &item.mesh->vertexBuffer.buffer);
+		recorder.bindIndexBuffer(item.mesh->indexBuffer.buffer);
+
+		// instances read their matrices from consecutive table slots starting at objectIndex
+		recorder.drawIndexed(static_cast<uint32_t>(item.mesh->indices.size()), item.instanceCount, 0, 0, item.mesh->objectIndex);
+	}
+}
+
+void DrawList::clear()
+{
+	items.clear();
+	entries.clear();
+	pipelineIds.clear();
+	materialIds.clear();
+	meshIds.clear();
+}
+
+uint32_t DrawList::getId(std::unordered_map<uint64_t, uint32_t>& ids, uint64_t handle, uint32_t maxId, const char* name)
+{
+	auto found = ids.find(handle);
+	if (found != ids.end())
+		return found->second;
+
+	uint32_t id = static_cast<uint32_t>(ids.size());
+	if (id > maxId)
+		throw std::runtime_error(std::string("draw list has more ") + name + " than its sort key can number");
+
+	ids.emplace(handle, id);
+	return id;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "HelperStructs.h"
+
+// counters for everything recorded through a CommandRecorder since begin(), shown in the scenes' UI
+struct DrawStats
+{
+	uint32_t pipelineBinds = 0;
+	uint32_t descriptorSetBinds = 0;
+	uint32_t vertexBufferBinds = 0;
+	uint32_t indexBufferBinds = 0;
+	uint32_t draws = 0;
+	uint32_t skippedBinds = 0; // redundant binds that never reached the command buffer
+
+	DrawStats& operator+=(const DrawStats& other)
+	{
+		pipelineBinds += other.pipelineBinds;
+		descriptorSetBinds += other.descriptorSetBinds;
+		vertexBufferBinds += other.vertexBufferBinds;
+		indexBufferBinds += other.indexBufferBinds;
+		draws += other.draws;
+		skippedBinds += other.skippedBinds;
+		return *this;
+	}
+};
+
+// thin wrapper around a command buffer that remembers what's bound and drops binds that wouldn't change anything.
+// only graphics state is tracked. anything bound around the recorder (e.g. by ImGui) needs an invalidate() afterwards
+class CommandRecorder
+{
+public:
+	// start tracking a command buffer that was just begun, forgets all state and resets the stats
+	void begin(VkCommandBuffer commandBuffer);
+	void invalidate();
+
+	void bindPipeline(VkPipeline pipeline);
+
+	// sets bound with a different pipeline layout than the last one are always rebound, since the
+	// new layout may have disturbed them
+	void bindDescriptorSet(VkPipelineLayout pipelineLayout, uint32_t setIndex, VkDescriptorSet set);
+
+	// buffers are bound at offset 0, only the bindings that changed are rebound
+	void bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* buffers);
+	void bindIndexBuffer(VkBuffer buffer, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
+
+	void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+	void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+	void drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+	void drawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countOffset,
+		uint32_t maxDrawCount, uint32_t stride);
+
+	VkCommandBuffer getCommandBuffer() { return commandBuffer; }
+	const DrawStats& getStats() { return stats; }
+
+private:
+	static const uint32_t MAX_SETS = 4;
+	static const uint32_t MAX_VERTEX_BINDINGS = 4;
+
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout setsLayout = VK_NULL_HANDLE; // layout the tracked sets were bound with
+	VkDescriptorSet sets[MAX_SETS] = {};
+	VkBuffer vertexBuffers[MAX_VERTEX_BINDINGS] = {};
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+	DrawStats stats;
+};
+
+// one mesh draw. the ObjectTable (and the TextureTable on the bindless path) must already be bound,
+// the material's own texture set is bound at set 2 when it has one
+struct DrawItem
+{
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorSet materialSet = VK_NULL_HANDLE;
+	Mesh* mesh = nullptr;
+	uint32_t instanceCount = 1;
+};
+
+// collects draws with a 64 bit sort key and records them in key order, so draws sharing a pipeline, material
+// and mesh end up next to each other and the CommandRecorder can skip the binds between them.
+// key layout, most significant bits first:
+//   pass (4) | pipeline (12) | material (16) | mesh (16) | depth (16)
+// pipelines, materials and meshes are numbered in the order they're first submitted, depth sorts front to back.
+// submit throws once a pass or a number no longer fits its field, rather than letting keys collide
+class DrawList
+{
+public:
+	// depth is normalized to [0, 1], e.g. view distance divided by the far plane
+	void submit(uint32_t pass, const DrawItem& item, float depth);
+
+	// radix sort on the keys
+	void sort();
+	void record(CommandRecorder& recorder);
+	void clear();
+
+	size_t size() { return items.size(); }
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t itemIndex;
+	};
+
+	std::vector<DrawItem> items;
+	std::vector<SortEntry> entries, scratch;
+
+	// handle -> number used in the key
+	std::unordered_map<uint64_t, uint32_t> pipelineIds, materialIds, meshIds;
+
+	// maxId is the largest number the field holds, name is for the error
+	uint32_t getId(std::unordered_map<uint64_t, uint32_t>& ids, uint64_t handle, uint32_t maxId, const char* name);
+};
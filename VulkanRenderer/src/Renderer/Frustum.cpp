@@ -0,0 +1,189 @@
+#include "Frustum.h"
+
+// pick the widest instruction set the compiler was told it can use
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define FRUSTUM_SIMD_WIDTH 8
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define FRUSTUM_SIMD_WIDTH 4
+#else
+	#define FRUSTUM_SIMD_WIDTH 1
+#endif
+
+void SphereBoundsSoA::resize(size_t newCount)
+{
+	size_t padded = (newCount + 7) & ~size_t(7);
+	x.resize(padded, 0.0f);
+	y.resize(padded, 0.0f);
+	z.resize(padded, 0.0f);
+	radius.resize(padded, 0.0f);
+	count = newCount;
+}
+
+void SphereBoundsSoA::set(size_t index, const glm::vec4& localSphere, const glm::mat4& model)
+{
+	glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(localSphere), 1.0f));
+
+	// non uniform scales grow the sphere by the largest axis
+	float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+	x[index] = center.x;
+	y[index] = center.y;
+	z[index] = center.z;
+	radius[index] = localSphere.w * scale;
+}
+
+void Frustum::update(const glm::mat4& viewProj)
+{
+	// Gribb/Hartmann, glm matrices are column major so rows are gathered by hand
+	glm::vec4 row0 = glm::vec4(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+	glm::vec4 row1 = glm::vec4(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+	glm::vec4 row2 = glm::vec4(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+	glm::vec4 row3 = glm::vec4(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+	planes[0] = row3 + row0; // left
+	planes[1] = row3 - row0; // right
+	planes[2] = row3 + row1; // bottom
+	planes[3] = row3 - row1; // top
+	planes[4] = row2;		 // near, depth is [0, 1]
+	planes[5] = row3 - row2; // far
+
+	for (int i = 0; i < 6; i++)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+bool Frustum::intersectsSphere(const glm::vec4& sphere) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (glm::dot(glm::vec3(planes[i]), glm::vec3(sphere)) + planes[i].w < -sphere.w)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::intersectsAABB(const glm::vec3& aabbMin, const glm::vec3& aabbMax) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		// test the corner furthest along the plane's normal
+		glm::vec3 n = glm::vec3(planes[i]);
+		glm::vec3 positive = glm::vec3(n.x >= 0.0f ? aabbMax.x : aabbMin.x,
+									   n.y >= 0.0f ? aabbMax.y : aabbMin.y,
+									   n.z >= 0.0f ? aabbMax.z : aabbMin.z);
+
+		if (glm::dot(n, positive) + planes[i].w < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+FrustumResult Frustum::classifyAABB(const glm::vec3& aabbMin, const glm::vec3& aabbMax) const
+{
+	FrustumResult result = FrustumResult::INSIDE;
+
+	for (int i = 0; i < 6; i++)
+	{
+		// furthest corner along the normal decides if the box is outside, the nearest if it's fully inside
+		glm::vec3 n = glm::vec3(planes[i]);
+		glm::vec3 positive = glm::vec3(n.x >= 0.0f ? aabbMax.x : aabbMin.x,
+									   n.y >= 0.0f ? aabbMax.y : aabbMin.y,
+									   n.z >= 0.0f ? aabbMax.z : aabbMin.z);
+		glm::vec3 negative = glm::vec3(n.x >= 0.0f ? aabbMin.x : aabbMax.x,
+									   n.y >= 0.0f ? aabbMin.y : aabbMax.y,
+									   n.z >= 0.0f ? aabbMin.z : aabbMax.z);
+
+		if (glm::dot(n, positive) + planes[i].w < 0.0f)
+			return FrustumResult::OUTSIDE;
+
+		if (glm::dot(n, negative) + planes[i].w < 0.0f)
+			result = FrustumResult::INTERSECTS;
+	}
+
+	return result;
+}
+
+uint32_t Frustum::cullSpheres(const SphereBoundsSoA& bounds, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+	size_t count = bounds.count;
+
+#if FRUSTUM_SIMD_WIDTH == 8
+	__m256 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; p++)
+	{
+		px[p] = _mm256_set1_ps(planes[p].x);
+		py[p] = _mm256_set1_ps(planes[p].y);
+		pz[p] = _mm256_set1_ps(planes[p].z);
+		pw[p] = _mm256_set1_ps(planes[p].w);
+	}
+
+	for (size_t i = 0; i < count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&bounds.x[i]);
+		__m256 y = _mm256_loadu_ps(&bounds.y[i]);
+		__m256 z = _mm256_loadu_ps(&bounds.z[i]);
+		__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.radius[i]));
+
+		__m256 inside = _mm256_setzero_ps();
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], x), _mm256_mul_ps(py[p], y)),
+										_mm256_add_ps(_mm256_mul_ps(pz[p], z), pw[p]));
+			__m256 test = _mm256_cmp_ps(dist, negRadius, _CMP_GE_OQ);
+			inside = (p == 0) ? test : _mm256_and_ps(inside, test);
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		for (size_t lane = 0; lane < 8 && i + lane < count; lane++)
+		{
+			if (mask & (1 << lane))
+				visible.push_back(static_cast<uint32_t>(i + lane));
+		}
+	}
+#elif FRUSTUM_SIMD_WIDTH == 4
+	__m128 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; p++)
+	{
+		px[p] = _mm_set1_ps(planes[p].x);
+		py[p] = _mm_set1_ps(planes[p].y);
+		pz[p] = _mm_set1_ps(planes[p].z);
+		pw[p] = _mm_set1_ps(planes[p].w);
+	}
+
+	for (size_t i = 0; i < count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&bounds.x[i]);
+		__m128 y = _mm_loadu_ps(&bounds.y[i]);
+		__m128 z = _mm_loadu_ps(&bounds.z[i]);
+		__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+
+		__m128 inside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+									 _mm_add_ps(_mm_mul_ps(pz[p], z), pw[p]));
+			__m128 test = _mm_cmpge_ps(dist, negRadius);
+			inside = (p == 0) ? test : _mm_and_ps(inside, test);
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (size_t lane = 0; lane < 4 && i + lane < count; lane++)
+		{
+			if (mask & (1 << lane))
+				visible.push_back(static_cast<uint32_t>(i + lane));
+		}
+	}
+#else
+	for (size_t i = 0; i < count; i++)
+	{
+		if (intersectsSphere(glm::vec4(bounds.x[i], bounds.y[i], bounds.z[i], bounds.radius[i])))
+			visible.push_back(static_cast<uint32_t>(i));
+	}
+#endif
+
+	return static_cast<uint32_t>(visible.size());
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+// world space bounding spheres stored as a structure of arrays, so the culling loop can load
+// 4 (SSE) or 8 (AVX) spheres per register. arrays are padded to a multiple of 8
+struct SphereBoundsSoA
+{
+	std::vector<float> x, y, z, radius;
+	size_t count = 0;
+
+	void resize(size_t newCount);
+
+	// transform a local space sphere (xyz = center, w = radius) by a model matrix and store it
+	void set(size_t index, const glm::vec4& localSphere, const glm::mat4& model);
+};
+
+enum class FrustumResult
+{
+	OUTSIDE,
+	INTERSECTS,
+	INSIDE
+};
+
+class Frustum
+{
+public:
+	Frustum() = default;
+	Frustum(const glm::mat4& viewProj) { update(viewProj); }
+
+	// extract the 6 planes from a view projection matrix with [0, 1] depth
+	void update(const glm::mat4& viewProj);
+
+	bool intersectsSphere(const glm::vec4& sphere) const;
+	bool intersectsAABB(const glm::vec3& aabbMin, const glm::vec3& aabbMax) const;
+
+	// like intersectsAABB, but also reports boxes that are entirely inside so hierarchies can skip their children
+	FrustumResult classifyAABB(const glm::vec3& aabbMin, const glm::vec3& aabbMax) const;
+
+	// batch test, writes the indices of every sphere touching the frustum and returns how many there are
+	uint32_t cullSpheres(const SphereBoundsSoA& bounds, std::vector<uint32_t>& visible) const;
+
+	const glm::vec4* getPlanes() const { return planes; }
+
+private:
+	// left, right, bottom, top, near, far. normals point inwards and have unit length
+	glm::vec4 planes[6] = {};
+};
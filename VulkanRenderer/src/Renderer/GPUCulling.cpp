@@ -0,0 +1,632 @@
+#include "GPUCulling.h"
+#include "Loaders.h"
+#include "MaterialTable.h"
+#include <algorithm>
+
+namespace
+{
+	size_t hashGeometry(const Mesh* mesh)
+	{
+		size_t res = 0;
+		for (const ModelVertex& v : mesh->vertices)
+			std::hash_combine(res, v);
+
+		for (uint32_t i : mesh->indices)
+			std::hash_combine(res, i);
+
+		return res;
+	}
+}
+
+uint32_t GPUCuller::addObject(Mesh* mesh)
+{
+	return addInstances(mesh, { mesh->meshUBO.model }, { mesh->material });
+}
+
+uint32_t GPUCuller::addInstances(Mesh* mesh, const std::vector<glm::mat4>& transforms, const std::vector<Material*>& instanceMaterials)
+{
+	if (isBuilt)
+		throw std::runtime_error("GPUCuller: objects must be added before the culler is built");
+
+	if (instanceMaterials.size() != 1 && instanceMaterials.size() != transforms.size())
+		throw std::runtime_error("GPUCuller: pass either one material or one per instance");
+
+	uint32_t batchIndex = findBatch(mesh);
+	uint32_t firstObject = static_cast<uint32_t>(objects.size());
+
+	AABB local;
+	local.min = mesh->aabbMin;
+	local.max = mesh->aabbMax;
+
+	worldBounds.resize(objects.size() + transforms.size());
+
+	for (size_t i = 0; i < transforms.size(); i++)
+	{
+		Material* material = instanceMaterials.size() == 1 ? instanceMaterials[0] : instanceMaterials[i];
+
+		GPUObject object = {};
+		object.model = transforms[i];
+		object.normal = glm::transpose(glm::inverse(transforms[i]));
+		object.boundingSphere = mesh->boundingSphere;
+		object.batchIndex = batchIndex;
+		objects.push_back(object);
+		objectMaterials.push_back(findMaterial(material));
+		objectTransformVersions.push_back(0);
+
+		worldBounds.set(objects.size() - 1, object.boundingSphere, object.model);
+		localBounds.push_back(local);
+	}
+
+	batches[batchIndex].instanceCount += static_cast<uint32_t>(transforms.size());
+
+	return firstObject;
+}
+
+uint32_t GPUCuller::findBatch(Mesh* mesh)
+{
+	// the hash only narrows it down, a batch is reused only when its geometry is really the same
+	std::vector<uint32_t>& candidates = batchLookup[hashGeometry(mesh)];
+	for (uint32_t candidate : candidates)
+	{
+		const Batch& batch = batches[candidate];
+		if (batch.vertexCount != mesh->vertices.size() || batch.indexCount != mesh->indices.size())
+			continue;
+
+		if (std::equal(mesh->vertices.begin(), mesh->vertices.end(), vertices.begin() + batch.vertexOffset) &&
+			std::equal(mesh->indices.begin(), mesh->indices.end(), indices.begin() + batch.firstIndex))
+			return candidate;
+	}
+
+	// append unique geometry to the merged buffers
+	Batch newBatch = {};
+	newBatch.firstIndex = static_cast<uint32_t>(indices.size());
+	newBatch.indexCount = static_cast<uint32_t>(mesh->indices.size());
+	newBatch.vertexOffset = static_cast<int32_t>(vertices.size());
+	newBatch.vertexCount = static_cast<uint32_t>(mesh->vertices.size());
+
+	vertices.insert(vertices.end(), mesh->vertices.begin(), mesh->vertices.end());
+	indices.insert(indices.end(), mesh->indices.begin(), mesh->indices.end());
+
+	batches.push_back(newBatch);
+	candidates.push_back(static_cast<uint32_t>(batches.size() - 1));
+
+	return static_cast<uint32_t>(batches.size() - 1);
+}
+
+uint32_t GPUCuller::findMaterial(Material* material)
+{
+	// materials are shared between objects that point to the same one
+	auto found = materialLookup.find(material);
+	if (found != materialLookup.end())
+		return found->second;
+
+	materials.push_back(material);
+	materialLookup.emplace(material, static_cast<uint32_t>(materials.size() - 1));
+
+	return static_cast<uint32_t>(materials.size() - 1);
+}
+
+void GPUCuller::build(uint32_t numViews)
+{
+	if (objects.empty())
+		throw std::runtime_error("GPUCuller: nothing to build, no objects were added");
+
+	visibleObjects.resize(numViews);
+	drawVersion++;
+
+	std::vector<AABB> objectBounds(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+		objectBounds[i] = AABB::transform(localBounds[i].min, localBounds[i].max, objects[i].model);
+
+	bvh.build(objectBounds);
+
+	// a draw count with more than one draw needs multiDrawIndirect as well
+	drawIndirectCount = VulkanDevice::GetVulkanDevice()->IsDrawIndirectCountSupported() &&
+		VulkanDevice::GetVulkanDevice()->IsMultiDrawIndirectSupported();
+	setCullMode(cullMode);
+
+	createBuffers(numViews);
+	createDescriptorSets(numViews);
+	createCullPipelines();
+
+	isBuilt = true;
+}
+
+void GPUCuller::createBuffers(uint32_t numViews)
+{
+	vertexBuffer = ModelLoader::createMeshVertexBuffer(vertices);
+	indexBuffer = ModelLoader::createMeshIndexBuffer(indices);
+
+	// upload materials to the MaterialTable and point the objects at their slots
+	updateMaterials();
+
+	// nothing reads the object table yet, later edits are recorded into the frame by uploadEdits()
+	objectBuffer.bufferSize = sizeof(GPUObject) * objects.size();
+	HelperFunctions::createBuffer(objectBuffer.bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		objectBuffer.buffer, objectBuffer.bufferMemory);
+
+	objectBuffer.map();
+	memcpy(objectBuffer.mappedMemory, objects.data(), objectBuffer.bufferSize);
+	objectBuffer.unmap();
+
+	editedBegin = UINT32_MAX;
+	editedEnd = 0;
+
+	// every batch gets a slice of the instance buffer big enough for all of its instances,
+	// the culling shader only fills in how many of them are visible
+	std::vector<VkDrawIndexedIndirectCommand> drawTemplate(batches.size());
+	uint32_t firstInstance = 0;
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		drawTemplate[i].indexCount = batches[i].indexCount;
+		drawTemplate[i].instanceCount = 0;
+		drawTemplate[i].firstIndex = batches[i].firstIndex;
+		drawTemplate[i].vertexOffset = batches[i].vertexOffset;
+		drawTemplate[i].firstInstance = firstInstance;
+		firstInstance += batches[i].instanceCount;
+	}
+
+	drawTemplateBuffer.bufferSize = sizeof(VkDrawIndexedIndirectCommand) * drawTemplate.size();
+	HelperFunctions::createBuffer(drawTemplateBuffer.bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		drawTemplateBuffer.buffer, drawTemplateBuffer.bufferMemory);
+
+	drawTemplateBuffer.map();
+	memcpy(drawTemplateBuffer.mappedMemory, drawTemplate.data(), drawTemplateBuffer.bufferSize);
+	drawTemplateBuffer.unmap();
+
+	std::vector<uint32_t> identity(objects.size());
+	for (uint32_t i = 0; i < identity.size(); i++)
+		identity[i] = i;
+
+	identityBuffer.bufferSize = sizeof(uint32_t) * identity.size();
+	HelperFunctions::createBuffer(identityBuffer.bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		identityBuffer.buffer, identityBuffer.bufferMemory);
+
+	identityBuffer.map();
+	memcpy(identityBuffer.mappedMemory, identity.data(), identityBuffer.bufferSize);
+	identityBuffer.unmap();
+
+	// draw commands and instance indices are written and read on the GPU only
+	indirectBuffers.resize(numViews);
+	instanceBuffers.resize(numViews);
+
+	for (uint32_t i = 0; i < numViews; i++)
+	{
+		indirectBuffers[i].bufferSize = drawTemplateBuffer.bufferSize;
+		HelperFunctions::createBuffer(indirectBuffers[i].bufferSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indirectBuffers[i].buffer, indirectBuffers[i].bufferMemory);
+
+		instanceBuffers[i].bufferSize = identityBuffer.bufferSize;
+		HelperFunctions::createBuffer(instanceBuffers[i].bufferSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceBuffers[i].buffer, instanceBuffers[i].bufferMemory);
+	}
+
+	if (!drawIndirectCount)
+		return;
+
+	compactBuffers.resize(numViews);
+	countBuffers.resize(numViews);
+
+	for (uint32_t i = 0; i < numViews; i++)
+	{
+		compactBuffers[i].bufferSize = drawTemplateBuffer.bufferSize;
+		HelperFunctions::createBuffer(compactBuffers[i].bufferSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, compactBuffers[i].buffer, compactBuffers[i].bufferMemory);
+
+		countBuffers[i].bufferSize = sizeof(uint32_t);
+		HelperFunctions::createBuffer(countBuffers[i].bufferSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, countBuffers[i].buffer, countBuffers[i].bufferMemory);
+	}
+}
+
+void GPUCuller::createDescriptorSets(uint32_t numViews)
+{
+	// graphics layout
+	std::vector<VkDescriptorSetLayoutBinding> bindings =
+	{
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+	};
+	descriptorSetLayout = Descriptors::getLayout(bindings);
+
+	// compute layout
+	bindings.clear();
+	for (uint32_t i = 0; i < 3; i++)
+		bindings.push_back(HelperFunctions::initializers::descriptorSetLayoutBinding(i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT));
+	cullSetLayout = Descriptors::getLayout(bindings);
+
+	// allocate and write sets
+	descriptorSet = descriptorAllocator.allocate(descriptorSetLayout);
+	Descriptors::write(descriptorSet, descriptorSetLayout, { objectBuffer.buffer, MaterialTable::getBuffer() });
+
+	cullSets.resize(numViews);
+	for (uint32_t i = 0; i < numViews; i++)
+	{
+		cullSets[i] = descriptorAllocator.allocate(cullSetLayout);
+		Descriptors::write(cullSets[i], cullSetLayout, { objectBuffer.buffer, indirectBuffers[i].buffer, instanceBuffers[i].buffer });
+	}
+
+	if (!drawIndirectCount)
+		return;
+
+	// same three storage buffers, so the layout is shared with the cull sets
+	compactSetLayout = cullSetLayout;
+	compactSets.resize(numViews);
+	for (uint32_t i = 0; i < numViews; i++)
+	{
+		compactSets[i] = descriptorAllocator.allocate(compactSetLayout);
+		Descriptors::write(compactSets[i], compactSetLayout, { indirectBuffers[i].buffer, compactBuffers[i].buffer, countBuffers[i].buffer });
+	}
+}
+
+void GPUCuller::createCullPipelines()
+{
+	createComputePipeline("shaders/Global/cull_objects.spv", cullSetLayout, sizeof(CullPush), cullPipelineLayout, cullPipeline);
+
+	if (drawIndirectCount)
+		createComputePipeline("shaders/Global/compact_draws.spv", compactSetLayout, sizeof(CompactPush), compactPipelineLayout, compactPipeline);
+}
+
+void GPUCuller::createComputePipeline(const std::string& path, VkDescriptorSetLayout setLayout, uint32_t pushSize,
+	VkPipelineLayout& layout, VkPipeline& pipeline)
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	auto compShaderCode = HelperFunctions::readShaderFile(path);
+	VkShaderModule compShaderModule = HelperFunctions::CreateShaderModules(compShaderCode);
+
+	VkPushConstantRange push = {};
+	push.offset = 0;
+	push.size = pushSize;
+	push.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkPipelineLayoutCreateInfo layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(1, &setLayout, 1, &push);
+	if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create GPU culling pipeline layout");
+
+	VkComputePipelineCreateInfo pipelineInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+	pipelineInfo.stage = HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, compShaderModule);
+	pipelineInfo.layout = layout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create GPU culling pipeline");
+
+	vkDestroyShaderModule(device, compShaderModule, nullptr);
+}
+
+void GPUCuller::setCullMode(CullMode mode)
+{
+	// the GPU path draws every batch from one indirect buffer, each with its own firstInstance
+	if (!VulkanDevice::GetVulkanDevice()->IsMultiDrawIndirectSupported())
+		mode = CullMode::CPU;
+
+	if (mode != cullMode)
+		drawVersion++;
+
+	cullMode = mode;
+}
+
+void GPUCuller::setModelMatrix(uint32_t objectIndex, const glm::mat4& model)
+{
+	GPUObject& object = objects[objectIndex];
+	object.model = model;
+	object.normal = glm::transpose(glm::inverse(model));
+	worldBounds.set(objectIndex, object.boundingSphere, model);
+	objectTransformVersions[objectIndex] = ++transformVersion;
+	bvh.refit(objectIndex, AABB::transform(localBounds[objectIndex].min, localBounds[objectIndex].max, model));
+	markEdited(objectIndex);
+}
+
+void GPUCuller::markEdited(uint32_t objectIndex)
+{
+	editedBegin = glm::min(editedBegin, objectIndex);
+	editedEnd = glm::max(editedEnd, objectIndex + 1);
+}
+
+void GPUCuller::uploadEdits(VkCommandBuffer& commandBuffer)
+{
+	if (!isBuilt || editedBegin >= editedEnd)
+		return;
+
+	// frames in flight may still be reading the table
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	// the edits travel inside the command buffer, so every frame sees the table as it was when it was recorded
+	for (uint32_t first = editedBegin; first < editedEnd; first += MAX_UPDATE_OBJECTS)
+	{
+		uint32_t count = glm::min(MAX_UPDATE_OBJECTS, editedEnd - first);
+		vkCmdUpdateBuffer(commandBuffer, objectBuffer.buffer, sizeof(GPUObject) * first, sizeof(GPUObject) * count, &objects[first]);
+	}
+
+	VkBufferMemoryBarrier barrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = objectBuffer.buffer;
+	barrier.offset = sizeof(GPUObject) * editedBegin;
+	barrier.size = sizeof(GPUObject) * (editedEnd - editedBegin);
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	editedBegin = UINT32_MAX;
+	editedEnd = 0;
+}
+
+void GPUCuller::updateMaterials()
+{
+	for (Material* material : materials)
+		material->updateMaterial();
+
+	// a material that shared its slot moves to a new one when edited, only rewrite the objects that changed
+	for (uint32_t i = 0; i < getObjectCount(); i++)
+	{
+		uint32_t materialIndex = materials[objectMaterials[i]]->materialIndex;
+		if (objects[i].materialIndex != materialIndex)
+		{
+			objects[i].materialIndex = materialIndex;
+			markEdited(i);
+		}
+	}
+}
+
+int32_t GPUCuller::pick(const glm::vec3& origin, const glm::vec3& direction)
+{
+	return bvh.raycast(origin, direction);
+}
+
+void GPUCuller::queryObjectsInSphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results)
+{
+	bvh.querySphere(center, radius, results);
+}
+
+void GPUCuller::queryObjectsInFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& results)
+{
+	bvh.queryFrustum(Frustum(viewProj), results);
+}
+
+std::array<VkVertexInputBindingDescription, 2> GPUCuller::getBindingDescriptions()
+{
+	std::array<VkVertexInputBindingDescription, 2> bindDesc{};
+	bindDesc[0] = ModelVertex::getBindingDescription();
+
+	// one object index per instance
+	bindDesc[1].binding = 1;
+	bindDesc[1].stride = sizeof(uint32_t);
+	bindDesc[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	return bindDesc;
+}
+
+std::array<VkVertexInputAttributeDescription, 4> GPUCuller::getAttributeDescriptions()
+{
+	std::array<VkVertexInputAttributeDescription, 4> attrDesc{};
+	auto vertexAttributes = ModelVertex::getAttributeDescriptions();
+	std::copy(vertexAttributes.begin(), vertexAttributes.end(), attrDesc.begin());
+
+	attrDesc[3].binding = 1;
+	attrDesc[3].location = 3;
+	attrDesc[3].format = VK_FORMAT_R32_UINT;
+	attrDesc[3].offset = 0;
+
+	return attrDesc;
+}
+
+void GPUCuller::cull(VkCommandBuffer& commandBuffer, uint32_t viewIndex, const glm::mat4& viewProj)
+{
+	uploadEdits(commandBuffer);
+
+	if (cullMode == CullMode::CPU)
+	{
+		Frustum frustum(viewProj);
+
+		if (getObjectCount() >= bvhCullThreshold)
+		{
+			// the tree returns objects in node order, sort them so instances of a batch end up next to each other
+			culledObjects.clear();
+			bvh.queryFrustum(frustum, culledObjects);
+			std::sort(culledObjects.begin(), culledObjects.end());
+		}
+
+		else
+		{
+			frustum.cullSpheres(worldBounds, culledObjects);
+		}
+
+		// the recorded draws only go stale when the visible set actually changes
+		if (culledObjects != visibleObjects[viewIndex])
+		{
+			visibleObjects[viewIndex].swap(culledObjects);
+			drawVersion++;
+		}
+
+		return;
+	}
+
+	VkBuffer indirect = indirectBuffers[viewIndex].buffer;
+	VkBuffer instances = instanceBuffers[viewIndex].buffer;
+
+	// previous frames may still be reading this view's draw commands and instances
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	// reset every batch to zero instances, and the packed draws to none
+	VkBufferCopy copy = { 0, 0, drawTemplateBuffer.bufferSize };
+	vkCmdCopyBuffer(commandBuffer, drawTemplateBuffer.buffer, indirect, 1, &copy);
+
+	if (drawIndirectCount)
+		vkCmdFillBuffer(commandBuffer, countBuffers[viewIndex].buffer, 0, sizeof(uint32_t), 0);
+
+	VkBufferMemoryBarrier barriers[2] = {};
+	for (int i = 0; i < 2; i++)
+	{
+		barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].offset = 0;
+		barriers[i].size = VK_WHOLE_SIZE;
+		barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	}
+	barriers[0].buffer = indirect;
+	barriers[1].buffer = drawIndirectCount ? countBuffers[viewIndex].buffer : VK_NULL_HANDLE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, drawIndirectCount ? 2 : 1, barriers, 0, nullptr);
+
+	CullPush push = {};
+	Frustum frustum(viewProj);
+	for (int i = 0; i < 6; i++)
+		push.planes[i] = frustum.getPlanes()[i];
+	push.objectCount = getObjectCount();
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout,
+		0, 1, &cullSets[viewIndex], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPush), &push);
+
+	// 64 threads per work group, see cull_objects.comp
+	vkCmdDispatch(commandBuffer, (push.objectCount + 63) / 64, 1, 1);
+
+	if (drawIndirectCount)
+	{
+		// the instance counts must be final before the non-empty batches are packed
+		barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 1, barriers, 0, nullptr);
+
+		CompactPush compactPush = { getBatchCount() };
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compactPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compactPipelineLayout,
+			0, 1, &compactSets[viewIndex], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, compactPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CompactPush), &compactPush);
+
+		// 64 threads per work group, see compact_draws.comp
+		vkCmdDispatch(commandBuffer, (compactPush.batchCount + 63) / 64, 1, 1);
+
+		// the packed draws and their count are what the draw reads from now
+		indirect = compactBuffers[viewIndex].buffer;
+	}
+
+	// draw commands, instance indices and the draw count must be written before they are consumed
+	VkBufferMemoryBarrier drawBarriers[3] = { barriers[0], barriers[0], barriers[0] };
+	drawBarriers[0].buffer = indirect;
+	drawBarriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarriers[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	drawBarriers[1].buffer = instances;
+	drawBarriers[1].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarriers[1].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	drawBarriers[2].buffer = drawIndirectCount ? countBuffers[viewIndex].buffer : VK_NULL_HANDLE;
+	drawBarriers[2].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarriers[2].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr,
+		drawIndirectCount ? 3 : 2, drawBarriers, 0, nullptr);
+}
+
+void GPUCuller::draw(CommandRecorder& recorder, VkPipelineLayout pipelineLayout, uint32_t viewIndex, uint32_t setIndex,
+	uint32_t chunk, uint32_t chunkCount)
+{
+	// the CPU path draws straight out of the object table, so its instance stream is just 0..n
+	VkBuffer vertexBuffers[] = { vertexBuffer.buffer,
+		cullMode == CullMode::CPU ? identityBuffer.buffer : instanceBuffers[viewIndex].buffer };
+
+	// the shared vertex and index buffers stay bound across views, only the instance stream changes
+	recorder.bindVertexBuffers(0, 2, vertexBuffers);
+	recorder.bindIndexBuffer(indexBuffer.buffer);
+	recorder.bindDescriptorSet(pipelineLayout, setIndex, descriptorSet);
+
+	if (cullMode == CullMode::CPU)
+	{
+		// objects are added per batch, so consecutive visible objects of the same batch become one instanced draw
+		// a run crossing a chunk boundary is simply split in two
+		const std::vector<uint32_t>& visible = visibleObjects[viewIndex];
+		size_t i = visible.size() * chunk / chunkCount;
+		size_t end = visible.size() * (chunk + 1) / chunkCount;
+		while (i < end)
+		{
+			uint32_t first = visible[i];
+			uint32_t batchIndex = objects[first].batchIndex;
+			uint32_t count = 1;
+
+			while (i + count < end && visible[i + count] == first + count && objects[first + count].batchIndex == batchIndex)
+				count++;
+
+			const Batch& batch = batches[batchIndex];
+			recorder.drawIndexed(batch.indexCount, count, batch.firstIndex, batch.vertexOffset, first);
+			i += count;
+		}
+	}
+
+	else if (drawIndirectCount)
+	{
+		// the packed draws only have a total count, which can't be split between chunks
+		if (chunk == 0)
+		{
+			recorder.drawIndexedIndirectCount(compactBuffers[viewIndex].buffer, 0, countBuffers[viewIndex].buffer, 0,
+				getBatchCount(), sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+
+	else
+	{
+		// one command per batch, chunks take a range of batches
+		uint32_t firstBatch = getBatchCount() * chunk / chunkCount;
+		uint32_t batchCount = getBatchCount() * (chunk + 1) / chunkCount - firstBatch;
+
+		if (batchCount > 0)
+		{
+			recorder.drawIndexedIndirect(indirectBuffers[viewIndex].buffer, firstBatch * sizeof(VkDrawIndexedIndirectCommand),
+				batchCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+}
+
+void GPUCuller::destroy()
+{
+	if (!isBuilt)
+		return;
+
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	vertexBuffer.destroy();
+	indexBuffer.destroy();
+	objectBuffer.destroy();
+	drawTemplateBuffer.destroy();
+	identityBuffer.destroy();
+
+	for (size_t i = 0; i < indirectBuffers.size(); i++)
+	{
+		indirectBuffers[i].destroy();
+		instanceBuffers[i].destroy();
+	}
+
+	for (size_t i = 0; i < compactBuffers.size(); i++)
+	{
+		compactBuffers[i].destroy();
+		countBuffers[i].destroy();
+	}
+
+	vkDestroyPipeline(device, cullPipeline, nullptr);
+	vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+	vkDestroyPipeline(device, compactPipeline, nullptr);
+	vkDestroyPipelineLayout(device, compactPipelineLayout, nullptr);
+	descriptorAllocator.destroy(); // the layouts are cached by Descriptors
+
+	isBuilt = false;
+}
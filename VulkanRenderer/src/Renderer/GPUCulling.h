@@ -0,0 +1,206 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include "HelperStructs.h"
+#include "Frustum.h"
+#include "BVH.h"
+#include "Descriptors.h"
+#include "DrawList.h"
+
+// GPU driven rendering
+// every object is uploaded once into an object table, along with its bounds and the batch it belongs to.
+// a batch is one unique mesh inside a merged vertex/index buffer, so repeated meshes become instances of
+// the same batch. each frame a compute shader frustum culls the table, counts the visible instances of each
+// batch and writes their object indices into an instance buffer. a whole view is then drawn with a single
+// vkCmdDrawIndexedIndirect call holding one instanced draw per batch, no matter how many objects there are.
+// when the device supports drawIndirectCount a second pass packs the batches with visible instances together
+// and the view is drawn with vkCmdDrawIndexedIndirectCount instead, so empty batches cost nothing.
+//
+// graphics pipelines that draw through the culler take their vertex input from getBindingDescriptions()
+// and getAttributeDescriptions(): binding 0 is ModelVertex, binding 1 is an instance rate stream of object
+// indices read at location 3. getDescriptorSetLayout() is the layout of the set passed to draw():
+//   binding 0: object table   (readonly storage buffer, vertex stage), indexed with the object index
+//   binding 1: the global MaterialTable (readonly storage buffer, fragment stage), indexed with the object's material index
+//
+// small scenes can cull on the CPU instead (CullMode::CPU). the same bounds are tested with SIMD and
+// runs of visible instances are drawn with vkCmdDrawIndexed, which also makes the visible counts readable.
+// the CPU path and the picking/sphere queries go through a BVH once there are enough objects for it to pay off.
+// devices without multiDrawIndirect and drawIndirectFirstInstance always cull on the CPU
+
+// must match the Object struct in shaders/Global/object_table.glsl (std430)
+struct GPUObject
+{
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::mat4 normal = glm::mat4(1.0f);
+	glm::vec4 boundingSphere = glm::vec4(0.0f); // xyz = local space center, w = local space radius
+	uint32_t batchIndex = 0;
+	uint32_t materialIndex = 0; // slot in the MaterialTable
+	uint32_t pad0 = 0;
+	uint32_t pad1 = 0;
+};
+
+enum class CullMode
+{
+	GPU,
+	CPU
+};
+
+class GPUCuller
+{
+public:
+	// all objects must be added before build() is called
+	// meshes with identical geometry share the same batch, even when added separately
+	uint32_t addObject(Mesh* mesh);
+
+	// add many copies of one mesh, returns the object index of the first one. only the mesh's geometry is used,
+	// so a shared mesh such as BasicShapes::getSphere() works without creating buffers per copy.
+	// pass one material for all of them, or one per instance
+	uint32_t addInstances(Mesh* mesh, const std::vector<glm::mat4>& transforms, const std::vector<Material*>& instanceMaterials);
+
+	// create buffers, descriptors and the culling pipeline. each view (camera, light, etc.)
+	// gets its own draw commands so they can be culled independently
+	void build(uint32_t numViews = 1);
+	void destroy();
+
+	// edits reach the GPU with the next cull(), which records them into that frame's command buffer
+	void setModelMatrix(uint32_t objectIndex, const glm::mat4& model);
+
+	// bumped by every setModelMatrix(), the per object version is the one it had when that object last moved.
+	// lets anything built from the transforms, e.g. a cached shadow map, tell whether it's out of date
+	uint64_t getTransformVersion() { return transformVersion; }
+	uint64_t getTransformVersion(uint32_t objectIndex) { return objectTransformVersions[objectIndex]; }
+
+	// can be switched at any time, both paths are always built. stays on CPU when the device can't draw the GPU path
+	void setCullMode(CullMode mode);
+	CullMode getCullMode() { return cullMode; }
+
+	// the CPU path walks the BVH for any object count, not only past BVH_CULL_THRESHOLD. for testing the tree
+	// in scenes too small to reach it
+	void setAlwaysCullWithBVH(bool always) { bvhCullThreshold = always ? 0 : BVH_CULL_THRESHOLD; }
+	bool getAlwaysCullWithBVH() { return bvhCullThreshold == 0; }
+
+	// upload edited material parameters and refresh the objects' material indices
+	void updateMaterials();
+
+	// record frustum culling for a view. must be recorded outside of a render pass, and the first cull of a frame
+	// must come before anything else reads the object table
+	void cull(VkCommandBuffer& commandBuffer, uint32_t viewIndex, const glm::mat4& viewProj);
+
+	// record the draw for a view. must be recorded after cull() and inside a render pass.
+	// chunk and chunkCount split the draws into even parts that can be recorded on separate threads.
+	// a draw count covers the whole view, so on that path the first chunk records everything
+	void draw(CommandRecorder& recorder, VkPipelineLayout pipelineLayout, uint32_t viewIndex, uint32_t setIndex = 1,
+		uint32_t chunk = 0, uint32_t chunkCount = 1);
+
+	static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions();
+	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+
+	VkDescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout; }
+	uint32_t getObjectCount() { return static_cast<uint32_t>(objects.size()); }
+	uint32_t getBatchCount() { return static_cast<uint32_t>(batches.size()); }
+
+	// only known on the CPU path, the GPU path never reads its draw count back
+	uint32_t getVisibleCount(uint32_t viewIndex) { return static_cast<uint32_t>(visibleObjects[viewIndex].size()); }
+
+	// changes whenever draw() would record something different, e.g. a CPU cull with a new visible set.
+	// the GPU path only writes buffers, so its recorded draws stay valid until the culler is rebuilt
+	uint64_t getDrawVersion() { return drawVersion; }
+
+	// closest object hit by a world space ray, -1 for none
+	int32_t pick(const glm::vec3& origin, const glm::vec3& direction);
+
+	// objects whose bounds touch a sphere, e.g. everything a point light can reach
+	void queryObjectsInSphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results);
+
+	// objects whose bounds touch a frustum, e.g. the casters of a shadow map. appended in no particular order
+	void queryObjectsInFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& results);
+
+private:
+	struct Batch
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t vertexOffset;
+		uint32_t vertexCount;
+		uint32_t instanceCount; // every object using this batch, visible or not
+	};
+
+	struct CullPush
+	{
+		glm::vec4 planes[6];
+		uint32_t objectCount;
+	};
+
+	struct CompactPush
+	{
+		uint32_t batchCount;
+	};
+
+	// CPU side copies of everything uploaded in build()
+	std::unordered_map<size_t, std::vector<uint32_t>> batchLookup; // keyed by a hash of the mesh's vertices and indices, every batch with that hash
+	std::unordered_map<Material*, uint32_t> materialLookup;
+	std::vector<Batch> batches;
+	std::vector<ModelVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<GPUObject> objects;
+	std::vector<Material*> materials;		 // every distinct material used by the objects
+	std::vector<uint32_t> objectMaterials; // per object, index into materials
+	std::vector<uint64_t> objectTransformVersions;
+	uint64_t transformVersion = 0;
+
+	// CPU culling
+	CullMode cullMode = CullMode::GPU;
+	SphereBoundsSoA worldBounds;
+	std::vector<AABB> localBounds;
+	BVH bvh;
+	const uint32_t BVH_CULL_THRESHOLD = 64; // below this a linear SIMD sweep beats walking the tree
+	uint32_t bvhCullThreshold = BVH_CULL_THRESHOLD;
+	std::vector<std::vector<uint32_t>> visibleObjects; // one list per view
+	std::vector<uint32_t> culledObjects; // scratch list compared against the view's last visible set
+	uint64_t drawVersion = 0;
+
+	VulkanBuffer vertexBuffer, indexBuffer, objectBuffer;
+
+	// objects edited since the last upload. vkCmdUpdateBuffer takes at most 64KB at a time
+	uint32_t editedBegin = UINT32_MAX, editedEnd = 0;
+	const uint32_t MAX_UPDATE_OBJECTS = 65536 / sizeof(GPUObject);
+	VulkanBuffer drawTemplateBuffer; // one command per batch with no instances, copied over a view's draws before culling
+	VulkanBuffer identityBuffer;	 // object indices 0..n, the instance stream for the CPU path
+	std::vector<VulkanBuffer> indirectBuffers, instanceBuffers; // one of each per view
+
+	// draw count path, only created when the device supports it
+	bool drawIndirectCount = false;
+	std::vector<VulkanBuffer> compactBuffers, countBuffers; // non-empty draws packed together and how many there are, per view
+
+	DescriptorAllocator descriptorAllocator;
+
+	// graphics: object and material tables
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+	// compute: object table, draw commands and instance indices for each view
+	VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> cullSets;
+	VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline cullPipeline = VK_NULL_HANDLE;
+
+	// compute: draw commands, packed draw commands and the draw count for each view
+	VkDescriptorSetLayout compactSetLayout = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> compactSets;
+	VkPipelineLayout compactPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline compactPipeline = VK_NULL_HANDLE;
+
+	bool isBuilt = false;
+
+	uint32_t findBatch(Mesh* mesh);
+	uint32_t findMaterial(Material* material);
+
+	void markEdited(uint32_t objectIndex);
+	void uploadEdits(VkCommandBuffer& commandBuffer);
+
+	void createBuffers(uint32_t numViews);
+	void createDescriptorSets(uint32_t numViews);
+	void createCullPipelines();
+	void createComputePipeline(const std::string& path, VkDescriptorSetLayout setLayout, uint32_t pushSize,
+		VkPipelineLayout& layout, VkPipeline& pipeline);
+};
@@ -126,6 +126,15 @@ namespace HelperFunctions
 			writeDescriptor.pImageInfo = imageInfo;
 			return writeDescriptor;
 		}
+		VkDescriptorSetLayoutBinding descriptorSetLayoutBinding(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stageFlags, uint32_t descriptorCount)
+		{
+			VkDescriptorSetLayoutBinding layoutBinding = {};
+			layoutBinding.binding = binding;
+			layoutBinding.descriptorType = type;
+			layoutBinding.descriptorCount = descriptorCount;
+			layoutBinding.stageFlags = stageFlags;
+			return layoutBinding;
+		}
 	}
 
 	VkCommandBuffer beginSingleTimeCommands(const VkCommandPool& commandPool)
@@ -158,15 +167,27 @@ namespace HelperFunctions
 		vkFreeCommandBuffers(VulkanDevice::GetVulkanDevice()->GetLogicalDevice(), commandPool, 1, &cmdBuffer);
 	}
 
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory,
+		const std::vector<uint32_t>& queueFamilies)
 	{
 		VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
 
+		std::set<uint32_t> uniqueFamilies(queueFamilies.begin(), queueFamilies.end());
+		std::vector<uint32_t> families(uniqueFamilies.begin(), uniqueFamilies.end());
+
 		VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
 		bufferInfo.size = size;
 		bufferInfo.usage = usage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // buffers can be shared between queue families just like images
 
+		// concurrent sharing spares ownership transfers between the queues, at some cost on some hardware
+		if (families.size() > 1)
+		{
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+			bufferInfo.pQueueFamilyIndices = families.data();
+		}
+
 		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
 			throw std::runtime_error("Failed to create vertex buffer");
 
@@ -419,7 +440,7 @@ namespace HelperFunctions
 
 	}
 
-	void createImageView(VkImage& image, VkImageView& imageView, VkFormat format, VkImageAspectFlags aspectFlags, VkImageViewType viewType, uint32_t mipLevels)
+	void createImageView(VkImage& image, VkImageView& imageView, VkFormat format, VkImageAspectFlags aspectFlags, VkImageViewType viewType, uint32_t mipLevels, uint32_t layerCount)
 	{
 		VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
 
@@ -431,13 +452,14 @@ namespace HelperFunctions
 		viewInfo.subresourceRange.baseMipLevel = 0;
 		viewInfo.subresourceRange.levelCount = mipLevels;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
-		viewInfo.subresourceRange.layerCount = 1;
+		viewInfo.subresourceRange.layerCount = layerCount;
 
 		if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS)
 			throw std::runtime_error("Failed to create image view");
 	}
 
-	void createSampler(VkSampler& sampler, VkFilter filter, VkSamplerAddressMode addrMode, VkBool32 enableAnisotropy, float maxAnisotropy, float minLod, int32_t mipLevels, VkBorderColor borderColor)
+	void createSampler(VkSampler& sampler, VkFilter filter, VkSamplerAddressMode addrMode, VkBool32 enableAnisotropy, float maxAnisotropy, float minLod, int32_t mipLevels, VkBorderColor borderColor,
+		VkCompareOp compareOp)
 	{
 		static VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
 
@@ -451,8 +473,8 @@ namespace HelperFunctions
 		samplerInfo.maxAnisotropy = maxAnisotropy;
 		samplerInfo.borderColor = borderColor;
 		samplerInfo.unnormalizedCoordinates = VK_FALSE;
-		samplerInfo.compareEnable = VK_FALSE;
-		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+		samplerInfo.compareEnable = compareOp != VK_COMPARE_OP_NEVER ? VK_TRUE : VK_FALSE;
+		samplerInfo.compareOp = compareOp != VK_COMPARE_OP_NEVER ? compareOp : VK_COMPARE_OP_ALWAYS;
 		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 		samplerInfo.minLod = minLod;
 		samplerInfo.maxLod = static_cast<float>(mipLevels);
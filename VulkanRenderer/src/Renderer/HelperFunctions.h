@@ -49,6 +49,7 @@ namespace HelperFunctions
 
 		VkWriteDescriptorSet writeDescriptorSet(VkDescriptorSet& dstSet, const VkDescriptorBufferInfo* bufferInfo, uint32_t dstBinding = 0, VkDescriptorType bufferType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, const VkBufferView* bufferView = nullptr);
 		VkWriteDescriptorSet writeDescriptorSet(VkDescriptorSet& dstSet, const VkDescriptorImageInfo* imageInfo, uint32_t dstBinding = 0);
+		VkDescriptorSetLayoutBinding descriptorSetLayoutBinding(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stageFlags, uint32_t descriptorCount = 1);
 	}
 
 	// commands
@@ -56,7 +57,9 @@ namespace HelperFunctions
 	void endSingleTimeCommands(VkCommandBuffer cmdBuffer, VkQueue queue, const VkCommandPool& commandPool);
 
 	// buffers
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	// a buffer used on more than one of queueFamilies is shared concurrently, otherwise it's owned by one family at a time
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory,
+		const std::vector<uint32_t>& queueFamilies = {});
 	void copyBuffer(const VkCommandPool& commandPool, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkQueue queue);
 	void copyBufferToImage(const VkCommandPool& commandPool, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t depth);
 
@@ -64,8 +67,11 @@ namespace HelperFunctions
 	void transitionImageLayout(VkImage image, VkFormat format, uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout, const VkCommandPool& commandPool, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
 	void createImage(uint32_t width, uint32_t height, uint32_t depth, uint32_t mipLevels, VkSampleCountFlagBits sampleCount, VkImageType imageType, VkFormat format, VkImageTiling tiling, 
 		VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& memory);
-	void createImageView(VkImage& image, VkImageView& imageView, VkFormat format, VkImageAspectFlags aspectFlags, VkImageViewType viewType, uint32_t mipLevels);
-	void createSampler(VkSampler& sampler, VkFilter filter, VkSamplerAddressMode addrMode, VkBool32 enableAnisotropy = VK_FALSE, float maxAnisotropy = 0.0f, float minLod = 0.0f, int32_t mipLevels = 1, VkBorderColor borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE);
+	void createImageView(VkImage& image, VkImageView& imageView, VkFormat format, VkImageAspectFlags aspectFlags, VkImageViewType viewType, uint32_t mipLevels, uint32_t layerCount = 1);
+	// a compare op other than VK_COMPARE_OP_NEVER makes a comparison sampler, for sampler2DShadow. with a linear filter
+	// every lookup compares 2x2 texels and blends the results
+	void createSampler(VkSampler& sampler, VkFilter filter, VkSamplerAddressMode addrMode, VkBool32 enableAnisotropy = VK_FALSE, float maxAnisotropy = 0.0f, float minLod = 0.0f, int32_t mipLevels = 1, VkBorderColor borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+		VkCompareOp compareOp = VK_COMPARE_OP_NEVER);
 	void generateImageMipmaps(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipLevels, const VkCommandPool& commandPool);
 
 	// pipeline
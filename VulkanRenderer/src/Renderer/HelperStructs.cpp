@@ -1,4 +1,9 @@
 #include "HelperStructs.h"
+#include "ObjectTable.h"
+#include "MaterialTable.h"
+#include "TextureTable.h"
+#include "Descriptors.h"
+#include "DrawList.h"
 
 // pipelines
 
@@ -255,6 +260,12 @@ void Texture::destroyTexture()
 	}
 	if (sampler != VK_NULL_HANDLE)
 		vkDestroySampler(device, sampler, nullptr);
+
+	if (tableIndex != UINT32_MAX)
+	{
+		TextureTable::release(tableIndex);
+		tableIndex = UINT32_MAX;
+	}
 }
 
 // material
@@ -299,17 +310,19 @@ void Material::destroy()
 	//delete roughnessTex;
 	//delete sheenTex;
 
-	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
-	vkDestroyBuffer(device, uniformBuffer.buffer, nullptr);
-	vkFreeMemory(device, uniformBuffer.bufferMemory, nullptr);
-	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	// the set and its layout belong to Descriptors, and are freed along with the scene
+	descriptorSet = VK_NULL_HANDLE;
+	descriptorSetLayout = VK_NULL_HANDLE;
+
+	if (materialIndex != UINT32_MAX)
+	{
+		MaterialTable::release(materialIndex);
+		materialIndex = UINT32_MAX;
+	}
 }
 
 void Material::createDescriptorSet(Texture* emptyTexture)
 {
-	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
-
 	std::vector<Texture*> textures = {
 		ambientTex,
 		diffuseTex,
@@ -326,445 +339,368 @@ void Material::createDescriptorSet(Texture* emptyTexture)
 	};
 	size_t numTextures = textures.size();
 
-	VkDescriptorPoolSize poolSizes[2] = {};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = 1;
-	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = static_cast<uint32_t>(textures.size());
+	// bindless, the shaders find the textures through the material's table entry
+	if (TextureTable::isEnabled())
+	{
+		for (size_t i = 0; i < numTextures; i++)
+			ubo.textureIndices[i] = TextureTable::registerTexture(textures[i]);
 
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.maxSets = 1;
-	poolInfo.poolSizeCount = 2;
-	poolInfo.pPoolSizes = poolSizes;
+		updateMaterial();
+		return;
+	}
 
-	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create descriptor pool");
+	// parameters live in the MaterialTable, this set only holds textures
+	updateMaterial();
 
 	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	std::vector<DescriptorInfo> infos;
 
-	VkDescriptorSetLayoutBinding textureBinding = {}, dataBinding = {};
-	dataBinding.binding = 0;
-	dataBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	dataBinding.descriptorCount = 1;
-	dataBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	dataBinding.pImmutableSamplers = nullptr;
-	bindings.push_back(dataBinding);
-
-	// combined image samplers for textures
+	// combined image samplers for textures. the binding follows the slot rather than the texture's own type,
+	// a texture loaded for one slot and reused in another would otherwise take the same binding twice
 	for (size_t i = 0; i < numTextures; i++)
 	{
 		if (textures[i])
 		{
-			textureBinding.binding = (uint32_t)textures[i]->type;
-			textureBinding.descriptorCount = 1;
-			textureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			textureBinding.pImmutableSamplers = nullptr;
-			textureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-			bindings.push_back(textureBinding);
-		}
-	}
-
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-	layoutInfo.pBindings = bindings.data();
-
-	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create descriptor set layout!");
-
-	VkDeviceSize bufferSize = sizeof(ubo);
-	HelperFunctions::createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		uniformBuffer.buffer, uniformBuffer.bufferMemory);
-
-	vkMapMemory(device, uniformBuffer.bufferMemory, 0, bufferSize, 0, &uniformBuffer.mappedMemory);
-	memcpy(uniformBuffer.mappedMemory, &ubo, size_t(bufferSize));
-	vkUnmapMemory(device, uniformBuffer.bufferMemory);
-
-
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.pSetLayouts = &descriptorSetLayout;
-	allocInfo.descriptorSetCount = 1;
-	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create material descriptor set");
-
-	// fill image descriptors and create write descriptors
-	VkDescriptorBufferInfo bufferInfo = {};
-	bufferInfo.buffer = uniformBuffer.buffer;
-	bufferInfo.offset = 0;
-	bufferInfo.range = sizeof(ubo);
-
-	std::vector<VkWriteDescriptorSet> writes;
-
-	VkWriteDescriptorSet uboWrite = {};
-	uboWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	uboWrite.dstSet = descriptorSet;
-	uboWrite.dstBinding = 0;
-	uboWrite.dstArrayElement = 0;
-	uboWrite.descriptorCount = 1;
-	uboWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboWrite.pBufferInfo = &bufferInfo;
-	writes.push_back(uboWrite);
+			uint32_t binding = static_cast<uint32_t>(i) + 1; // TextureType starts at 1
+			bindings.push_back(HelperFunctions::initializers::descriptorSetLayoutBinding(binding,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT));
 
-	for (size_t i = 0; i < numTextures; i++)
-	{
-		VkWriteDescriptorSet textureWrite = {};
-		if (textures[i])
-		{
-			textureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			textureWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			textureWrite.descriptorCount = 1;
-			textureWrite.dstSet = descriptorSet;
-			textureWrite.dstBinding = (uint32_t)textures[i]->type;
 			if (textures[i]->image != VK_NULL_HANDLE)
-				textureWrite.pImageInfo = &textures[i]->textureDescriptor;
+				infos.push_back(textures[i]->textureDescriptor);
 			else
-				textureWrite.pImageInfo = &emptyTexture->textureDescriptor;
-
-			writes.push_back(textureWrite);
+				infos.push_back(emptyTexture->textureDescriptor);
 		}
 	}
 
-	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
-}
+	// materials with the same texture slots share a layout, and sets come from the shared allocator
+	// instead of a pool per material
+	descriptorSetLayout = Descriptors::getLayout(bindings);
+	if (descriptorSet == VK_NULL_HANDLE)
+		descriptorSet = Descriptors::allocate(descriptorSetLayout);
 
-void Material::updateMaterial()
-{
-	uniformBuffer.map();
-	memcpy(uniformBuffer.mappedMemory, &ubo, sizeof(ubo));
-	uniformBuffer.unmap();
+	Descriptors::write(descriptorSet, descriptorSetLayout, infos);
 }
 
-void Mesh::createDescriptorSet()
+void Material::bind(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex)
 {
-	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
-	
-	VkDescriptorPoolSize poolSize = {};
-	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSize.descriptorCount = 1;
-
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.maxSets = 1;
-	poolInfo.poolSizeCount = 1;
-	poolInfo.pPoolSizes = &poolSize;
-
-	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create descriptor pool");
-
-	VkDescriptorSetLayoutBinding binding = {};
-	binding.binding = 0;
-	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	binding.descriptorCount = 1;
-	binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	binding.pImmutableSamplers = nullptr;
-		
-
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = 1;
-	layoutInfo.pBindings = &binding;
-
-	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create descriptor set layout!");
-
-	VkDeviceSize bufferSize = sizeof(meshUBO);
-	HelperFunctions::createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		uniformBuffer.buffer, uniformBuffer.bufferMemory);
-
-	vkMapMemory(device, uniformBuffer.bufferMemory, 0, bufferSize, 0, &uniformBuffer.mappedMemory);
-	memcpy(uniformBuffer.mappedMemory, &meshUBO, size_t(bufferSize));
-	vkUnmapMemory(device, uniformBuffer.bufferMemory);
-
-
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.pSetLayouts = &descriptorSetLayout;
-	allocInfo.descriptorSetCount = 1;
-	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create material descriptor set");
-
-	// fill image descriptors and create write descriptors
-	VkDescriptorBufferInfo bufferInfo = {};
-	bufferInfo.buffer = uniformBuffer.buffer;
-	bufferInfo.offset = 0;
-	bufferInfo.range = sizeof(meshUBO);
-
-	VkWriteDescriptorSet uboWrite = {};
-	uboWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	uboWrite.dstSet = descriptorSet;
-	uboWrite.dstBinding = 0;
-	uboWrite.dstArrayElement = 0;
-	uboWrite.descriptorCount = 1;
-	uboWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboWrite.pBufferInfo = &bufferInfo;
-
-	vkUpdateDescriptorSets(device, 1, &uboWrite, 0, nullptr);
-}
-
-void Mesh::setModelMatrix(glm::mat4 m)
-{
-	meshUBO.model = m;
-	meshUBO.normal = glm::transpose(glm::inverse(meshUBO.model));
-	uniformBuffer.map();
-	memcpy(uniformBuffer.mappedMemory, &meshUBO, sizeof(meshUBO));
-	uniformBuffer.unmap();
-}
-
-void Mesh::setMaterialColorWithValue(ColorType colorType, glm::vec3 color)
-{
-	switch (colorType)
+	if (descriptorSet != VK_NULL_HANDLE)
 	{
-	case ColorType::AMBIENT:
-		material->ubo.ambient = color;
-		break;
-
-	case ColorType::DIFFUSE:
-		material->ubo.diffuse = color;
-		break;
-
-	case ColorType::SPECULAR:
-		material->ubo.specular = color;
-		break;
-
-	case ColorType::TRANSMITTANCE:
-		material->ubo.transmittance = color;
-		break;
-
-	case ColorType::EMISSION:
-		material->ubo.emission = color;
-		break;
-
-	default:
-		break;
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+			setIndex, 1, &descriptorSet, 0, nullptr);
 	}
+}
 
-	material->updateMaterial();
+void Material::updateMaterial()
+{
+	if (materialIndex == UINT32_MAX)
+		materialIndex = MaterialTable::acquire(ubo);
+	else
+		materialIndex = MaterialTable::update(materialIndex, ubo);
 }
 
-void Mesh::setMaterialWithPreset(MaterialPresets preset)
+void Material::setPreset(MaterialPresets preset)
 {
 	switch (preset)
 	{
 #pragma region MINERALS
 	case MaterialPresets::EMERALD:
-		material->ubo.ambient = glm::vec3(0.0215f, 0.1745f, 0.0215f);
-		material->ubo.diffuse = glm::vec3(0.07568f, 0.61424f, 0.07568f);
-		material->ubo.specular = glm::vec3(0.633f, 0.727811f, 0.633f);
-		material->ubo.shininess = 76.8f;
-		material->ubo.dissolve = 0.55f;
+		ubo.ambient = glm::vec3(0.0215f, 0.1745f, 0.0215f);
+		ubo.diffuse = glm::vec3(0.07568f, 0.61424f, 0.07568f);
+		ubo.specular = glm::vec3(0.633f, 0.727811f, 0.633f);
+		ubo.shininess = 76.8f;
+		ubo.dissolve = 0.55f;
 		break;
 
 	case MaterialPresets::RUBY:
-		material->ubo.ambient = glm::vec3(0.1745f, 0.01175f, 0.01175f);
-		material->ubo.diffuse = glm::vec3(0.61424f, 0.04136f, 0.04136f);
-		material->ubo.specular = glm::vec3(0.727811f, 0.626959f, 0.626959f);
-		material->ubo.shininess = 76.8f;
-		material->ubo.dissolve = 0.55f;
+		ubo.ambient = glm::vec3(0.1745f, 0.01175f, 0.01175f);
+		ubo.diffuse = glm::vec3(0.61424f, 0.04136f, 0.04136f);
+		ubo.specular = glm::vec3(0.727811f, 0.626959f, 0.626959f);
+		ubo.shininess = 76.8f;
+		ubo.dissolve = 0.55f;
 		break;
 
 
 	case MaterialPresets::TURQUOISE:
-		material->ubo.ambient = glm::vec3(0.1f, 0.18725f, 0.1745f);
-		material->ubo.diffuse = glm::vec3(0.396f, 0.74151f, 0.69102f);
-		material->ubo.specular = glm::vec3(0.297254f, 0.30829f, 0.306678f);
-		material->ubo.shininess = 12.8f;
-		material->ubo.dissolve = 0.8f;
+		ubo.ambient = glm::vec3(0.1f, 0.18725f, 0.1745f);
+		ubo.diffuse = glm::vec3(0.396f, 0.74151f, 0.69102f);
+		ubo.specular = glm::vec3(0.297254f, 0.30829f, 0.306678f);
+		ubo.shininess = 12.8f;
+		ubo.dissolve = 0.8f;
 		break;
 
 	case MaterialPresets::JADE:
-		material->ubo.ambient = glm::vec3(0.135f, 0.2225f, 0.1575f);
-		material->ubo.diffuse = glm::vec3(0.54f, 0.89f, 0.63f);
-		material->ubo.specular = glm::vec3(0.316228f, 0.316228f, 0.316228f);
-		material->ubo.shininess = 12.8f;
-		material->ubo.dissolve = 0.95f;
+		ubo.ambient = glm::vec3(0.135f, 0.2225f, 0.1575f);
+		ubo.diffuse = glm::vec3(0.54f, 0.89f, 0.63f);
+		ubo.specular = glm::vec3(0.316228f, 0.316228f, 0.316228f);
+		ubo.shininess = 12.8f;
+		ubo.dissolve = 0.95f;
 		break;
 
 	case MaterialPresets::PEARL:
-		material->ubo.ambient = glm::vec3(0.25f, 0.20725f, 0.20725f);
-		material->ubo.diffuse = glm::vec3(1.0f, 0.829f, 0.829f);
-		material->ubo.specular = glm::vec3(0.296648f, 0.296648f, 0.296648f);
-		material->ubo.shininess = 11.264f;
-		material->ubo.dissolve = 0.922f;
+		ubo.ambient = glm::vec3(0.25f, 0.20725f, 0.20725f);
+		ubo.diffuse = glm::vec3(1.0f, 0.829f, 0.829f);
+		ubo.specular = glm::vec3(0.296648f, 0.296648f, 0.296648f);
+		ubo.shininess = 11.264f;
+		ubo.dissolve = 0.922f;
 		break;
 
 	case MaterialPresets::OBSIDIAN:
-		material->ubo.ambient = glm::vec3(0.05375f, 0.05f, 0.06625f);
-		material->ubo.diffuse = glm::vec3(0.18275f, 0.17f, 0.22525f);
-		material->ubo.specular = glm::vec3(0.332741f, 0.328634f, 0.346435f);
-		material->ubo.shininess = 38.4f;
-		material->ubo.dissolve = 0.82f;
+		ubo.ambient = glm::vec3(0.05375f, 0.05f, 0.06625f);
+		ubo.diffuse = glm::vec3(0.18275f, 0.17f, 0.22525f);
+		ubo.specular = glm::vec3(0.332741f, 0.328634f, 0.346435f);
+		ubo.shininess = 38.4f;
+		ubo.dissolve = 0.82f;
 		break;
 #pragma endregion
 
 #pragma region METALS
 	case MaterialPresets::BRASS:
-		material->ubo.ambient = glm::vec3(0.329412f, 0.223529f, 0.027451f);
-		material->ubo.diffuse = glm::vec3(0.780392f, 0.568627f, 0.113725f);
-		material->ubo.specular = glm::vec3(0.992157f, 0.941176f, 0.807843f);
-		material->ubo.shininess = 27.8974f;
+		ubo.ambient = glm::vec3(0.329412f, 0.223529f, 0.027451f);
+		ubo.diffuse = glm::vec3(0.780392f, 0.568627f, 0.113725f);
+		ubo.specular = glm::vec3(0.992157f, 0.941176f, 0.807843f);
+		ubo.shininess = 27.8974f;
 		break;
 
 	case MaterialPresets::BRONZE:
-		material->ubo.ambient = glm::vec3(0.2125f, 0.1275f, 0.054f);
-		material->ubo.diffuse = glm::vec3(0.714f, 0.4284f, 0.18144f);
-		material->ubo.specular = glm::vec3(0.393548f, 0.271906f, 0.166721f);
-		material->ubo.shininess = 25.6f;
+		ubo.ambient = glm::vec3(0.2125f, 0.1275f, 0.054f);
+		ubo.diffuse = glm::vec3(0.714f, 0.4284f, 0.18144f);
+		ubo.specular = glm::vec3(0.393548f, 0.271906f, 0.166721f);
+		ubo.shininess = 25.6f;
 		break;
 
 	case MaterialPresets::POLISHED_BRONZE:
-		material->ubo.ambient = glm::vec3(0.25f, 0.148f, 0.06475f);
-		material->ubo.diffuse = glm::vec3(0.4f, 0.2368f, 0.1036f);
-		material->ubo.specular = glm::vec3(0.774597f, 0.458561f, 0.200621f);
-		material->ubo.shininess = 76.8f;
+		ubo.ambient = glm::vec3(0.25f, 0.148f, 0.06475f);
+		ubo.diffuse = glm::vec3(0.4f, 0.2368f, 0.1036f);
+		ubo.specular = glm::vec3(0.774597f, 0.458561f, 0.200621f);
+		ubo.shininess = 76.8f;
 		break;
 
 	case MaterialPresets::CHROME:
-		material->ubo.ambient = glm::vec3(0.25f, 0.25f, 0.25f);
-		material->ubo.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
-		material->ubo.specular = glm::vec3(0.774597f, 0.774597f, 0.774597f);
-		material->ubo.shininess = 76.8f;
+		ubo.ambient = glm::vec3(0.25f, 0.25f, 0.25f);
+		ubo.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+		ubo.specular = glm::vec3(0.774597f, 0.774597f, 0.774597f);
+		ubo.shininess = 76.8f;
 		break;
 
 	case MaterialPresets::COPPER:
-		material->ubo.ambient = glm::vec3(0.19125f, 0.0735f, 0.0225f);
-		material->ubo.diffuse = glm::vec3(0.7038f, 0.27048f, 0.0828f);
-		material->ubo.specular = glm::vec3(0.256777f, 0.137622f, 0.086014f);
-		material->ubo.shininess = 12.8f;
+		ubo.ambient = glm::vec3(0.19125f, 0.0735f, 0.0225f);
+		ubo.diffuse = glm::vec3(0.7038f, 0.27048f, 0.0828f);
+		ubo.specular = glm::vec3(0.256777f, 0.137622f, 0.086014f);
+		ubo.shininess = 12.8f;
 		break;
 
 	case MaterialPresets::POLISHED_COPPER:
-		material->ubo.ambient = glm::vec3(0.2295f, 0.08825f, 0.0275f);
-		material->ubo.diffuse = glm::vec3(0.5508f, 0.2118f, 0.066f);
-		material->ubo.specular = glm::vec3(0.580594f, 0.223257f, 0.0695701f);
-		material->ubo.shininess = 51.2f;
+		ubo.ambient = glm::vec3(0.2295f, 0.08825f, 0.0275f);
+		ubo.diffuse = glm::vec3(0.5508f, 0.2118f, 0.066f);
+		ubo.specular = glm::vec3(0.580594f, 0.223257f, 0.0695701f);
+		ubo.shininess = 51.2f;
 		break;
 
 	case MaterialPresets::GOLD:
-		material->ubo.ambient = glm::vec3(0.24725f, 0.1995f, 0.0745f);
-		material->ubo.diffuse = glm::vec3(0.75164f, 0.60648f, 0.22648f);
-		material->ubo.specular = glm::vec3(0.628281f, 0.555802f, 0.366065f);
-		material->ubo.shininess = 51.2f;
+		ubo.ambient = glm::vec3(0.24725f, 0.1995f, 0.0745f);
+		ubo.diffuse = glm::vec3(0.75164f, 0.60648f, 0.22648f);
+		ubo.specular = glm::vec3(0.628281f, 0.555802f, 0.366065f);
+		ubo.shininess = 51.2f;
 		break;
 
 	case MaterialPresets::POLISHED_GOLD:
-		material->ubo.ambient = glm::vec3(0.24725f, 0.2245f, 0.0645f);
-		material->ubo.diffuse = glm::vec3(0.34615f, 0.3143f, 0.0903f);
-		material->ubo.specular = glm::vec3(0.797357f, 0.723991f, 0.208006f);
-		material->ubo.shininess = 83.2f;
+		ubo.ambient = glm::vec3(0.24725f, 0.2245f, 0.0645f);
+		ubo.diffuse = glm::vec3(0.34615f, 0.3143f, 0.0903f);
+		ubo.specular = glm::vec3(0.797357f, 0.723991f, 0.208006f);
+		ubo.shininess = 83.2f;
 		break;
 
 	case MaterialPresets::SILVER:
-		material->ubo.ambient = glm::vec3(0.19225f, 0.19225f, 0.19225f);
-		material->ubo.diffuse = glm::vec3(0.50754f, 0.50754f, 0.50754f);
-		material->ubo.specular = glm::vec3(0.508273f, 0.508273f, 0.508273f);
-		material->ubo.shininess = 51.2f;
+		ubo.ambient = glm::vec3(0.19225f, 0.19225f, 0.19225f);
+		ubo.diffuse = glm::vec3(0.50754f, 0.50754f, 0.50754f);
+		ubo.specular = glm::vec3(0.508273f, 0.508273f, 0.508273f);
+		ubo.shininess = 51.2f;
 		break;
 
 	case MaterialPresets::POLISHED_SILVER:
-		material->ubo.ambient = glm::vec3(0.23125f, 0.23125f, 0.23125f);
-		material->ubo.diffuse = glm::vec3(0.2775f, 0.2775f, 0.2775f);
-		material->ubo.specular = glm::vec3(0.773911f, 0.773911f, 0.773911f);
-		material->ubo.shininess = 89.6f;
+		ubo.ambient = glm::vec3(0.23125f, 0.23125f, 0.23125f);
+		ubo.diffuse = glm::vec3(0.2775f, 0.2775f, 0.2775f);
+		ubo.specular = glm::vec3(0.773911f, 0.773911f, 0.773911f);
+		ubo.shininess = 89.6f;
 		break;
 #pragma endregion
 
 #pragma region PLASTICS
 	case MaterialPresets::BLACK_PLASTIC:
-		material->ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
-		material->ubo.diffuse = glm::vec3(0.01f, 0.01f, 0.01f);
-		material->ubo.specular = glm::vec3(0.50f, 0.50f, 0.50f);
-		material->ubo.shininess = 32.0f;
+		ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+		ubo.diffuse = glm::vec3(0.01f, 0.01f, 0.01f);
+		ubo.specular = glm::vec3(0.50f, 0.50f, 0.50f);
+		ubo.shininess = 32.0f;
 		break;
 
 	case MaterialPresets::WHITE_PLASTIC:
-		material->ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
-		material->ubo.diffuse = glm::vec3(0.55f, 0.55f, 0.55f);
-		material->ubo.specular = glm::vec3(0.70f, 0.70f, 0.70f);
-		material->ubo.shininess = 32.0f;
+		ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+		ubo.diffuse = glm::vec3(0.55f, 0.55f, 0.55f);
+		ubo.specular = glm::vec3(0.70f, 0.70f, 0.70f);
+		ubo.shininess = 32.0f;
 		break;
 
 	case MaterialPresets::RED_PLASTIC:
-		material->ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
-		material->ubo.diffuse = glm::vec3(0.5f, 0.0f, 0.0f);
-		material->ubo.specular = glm::vec3(0.7f, 0.6f, 0.6f);
-		material->ubo.shininess = 32.0f;
+		ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+		ubo.diffuse = glm::vec3(0.5f, 0.0f, 0.0f);
+		ubo.specular = glm::vec3(0.7f, 0.6f, 0.6f);
+		ubo.shininess = 32.0f;
 		break;
 
 	case MaterialPresets::YELLOW_PLASTIC:
-		material->ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
-		material->ubo.diffuse = glm::vec3(0.5f, 0.5f, 0.0f);
-		material->ubo.specular = glm::vec3(0.60f, 0.60f, 0.50f);
-		material->ubo.shininess = 32.0f;
+		ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+		ubo.diffuse = glm::vec3(0.5f, 0.5f, 0.0f);
+		ubo.specular = glm::vec3(0.60f, 0.60f, 0.50f);
+		ubo.shininess = 32.0f;
 		break;
 
 	case MaterialPresets::GREEN_PLASTIC:
-		material->ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
-		material->ubo.diffuse = glm::vec3(0.1f, 0.35f, 0.1f);
-		material->ubo.specular = glm::vec3(0.45f, 0.55f, 0.45f);
-		material->ubo.shininess = 32.0f;
+		ubo.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+		ubo.diffuse = glm::vec3(0.1f, 0.35f, 0.1f);
+		ubo.specular = glm::vec3(0.45f, 0.55f, 0.45f);
+		ubo.shininess = 32.0f;
 		break;
 
 	case MaterialPresets::CYAN_PLASTIC:
-		material->ubo.ambient = glm::vec3(0.0f, 0.1f, 0.06f);
-		material->ubo.diffuse = glm::vec3(0.0f, 0.50980392f, 0.50980392f);
-		material->ubo.specular = glm::vec3(0.50196078f, 0.50196078f, 0.50196078f);
-		material->ubo.shininess = 32.0f;
+		ubo.ambient = glm::vec3(0.0f, 0.1f, 0.06f);
+		ubo.diffuse = glm::vec3(0.0f, 0.50980392f, 0.50980392f);
+		ubo.specular = glm::vec3(0.50196078f, 0.50196078f, 0.50196078f);
+		ubo.shininess = 32.0f;
 		break;
 #pragma endregion
 
 #pragma region RUBBER
 	case MaterialPresets::BLACK_RUBBER:
-		material->ubo.ambient = glm::vec3(0.02f, 0.02f, 0.02f);
-		material->ubo.diffuse = glm::vec3(0.01f, 0.01f, 0.01f);
-		material->ubo.specular = glm::vec3(0.4f, 0.4f, 0.4f);
-		material->ubo.shininess = 10.0f;
+		ubo.ambient = glm::vec3(0.02f, 0.02f, 0.02f);
+		ubo.diffuse = glm::vec3(0.01f, 0.01f, 0.01f);
+		ubo.specular = glm::vec3(0.4f, 0.4f, 0.4f);
+		ubo.shininess = 10.0f;
 		break;
 
 	case MaterialPresets::WHITE_RUBBER:
-		material->ubo.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
-		material->ubo.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-		material->ubo.specular = glm::vec3(0.7f, 0.7f, 0.7f);
-		material->ubo.shininess = 10.0f;
+		ubo.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+		ubo.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+		ubo.specular = glm::vec3(0.7f, 0.7f, 0.7f);
+		ubo.shininess = 10.0f;
 		break;
 
 	case MaterialPresets::RED_RUBBER:
-		material->ubo.ambient = glm::vec3(0.05f, 0.0f, 0.0f);
-		material->ubo.diffuse = glm::vec3(0.5f, 0.4f, 0.4f);
-		material->ubo.specular = glm::vec3(0.7f, 0.04f, 0.04f);
-		material->ubo.shininess = 10.0f;
+		ubo.ambient = glm::vec3(0.05f, 0.0f, 0.0f);
+		ubo.diffuse = glm::vec3(0.5f, 0.4f, 0.4f);
+		ubo.specular = glm::vec3(0.7f, 0.04f, 0.04f);
+		ubo.shininess = 10.0f;
 		break;
 
 	case MaterialPresets::YELLOW_RUBBER:
-		material->ubo.ambient = glm::vec3(0.329412f, 0.223529f, 0.027451f);
-		material->ubo.diffuse = glm::vec3(0.780392f, 0.568627f, 0.113725f);
-		material->ubo.specular = glm::vec3(0.992157f, 0.941176f, 0.807843f);
-		material->ubo.shininess = 10.0f;
+		ubo.ambient = glm::vec3(0.329412f, 0.223529f, 0.027451f);
+		ubo.diffuse = glm::vec3(0.780392f, 0.568627f, 0.113725f);
+		ubo.specular = glm::vec3(0.992157f, 0.941176f, 0.807843f);
+		ubo.shininess = 10.0f;
 		break;
 
 	case MaterialPresets::GREEN_RUBBER:
-		material->ubo.ambient = glm::vec3(0.0f, 0.05f, 0.0f);
-		material->ubo.diffuse = glm::vec3(0.4f, 0.5f, 0.4f);
-		material->ubo.specular = glm::vec3(0.04f, 0.7f, 0.04f);
-		material->ubo.shininess = 10.0f;
+		ubo.ambient = glm::vec3(0.0f, 0.05f, 0.0f);
+		ubo.diffuse = glm::vec3(0.4f, 0.5f, 0.4f);
+		ubo.specular = glm::vec3(0.04f, 0.7f, 0.04f);
+		ubo.shininess = 10.0f;
 		break;
 
 	case MaterialPresets::CYAN_RUBBER:
-		material->ubo.ambient = glm::vec3(0.0f, 0.05f, 0.05f);
-		material->ubo.diffuse = glm::vec3(0.4f, 0.5f, 0.5f);
-		material->ubo.specular = glm::vec3(0.04f, 0.7f, 0.7f);
-		material->ubo.shininess = 10.0f;
+		ubo.ambient = glm::vec3(0.0f, 0.05f, 0.05f);
+		ubo.diffuse = glm::vec3(0.4f, 0.5f, 0.5f);
+		ubo.specular = glm::vec3(0.04f, 0.7f, 0.7f);
+		ubo.shininess = 10.0f;
 		break;
 #pragma endregion
 
 	default:
 		break;
 	}
+}
+
+void Mesh::createObjectEntry()
+{
+	objectIndex = ObjectTable::allocate();
+	updateObjectEntry();
+}
+
+void Mesh::updateObjectEntry()
+{
+	if (objectIndex == UINT32_MAX)
+		return;
+
+	ObjectTable::ObjectData data = {};
+	data.model = meshUBO.model;
+	data.normal = meshUBO.normal;
+	data.materialIndex = (material && material->materialIndex != UINT32_MAX) ? material->materialIndex : 0;
+	ObjectTable::update(objectIndex, data);
+}
+
+void Mesh::computeBounds()
+{
+	if (vertices.empty())
+		return;
+
+	aabbMin = aabbMax = glm::vec3(vertices[0].position);
+	for (const ModelVertex& v : vertices)
+	{
+		aabbMin = glm::min(aabbMin, glm::vec3(v.position));
+		aabbMax = glm::max(aabbMax, glm::vec3(v.position));
+	}
+
+	// sphere centered on the AABB, tighter than the AABB's half diagonal for most meshes
+	glm::vec3 center = (aabbMin + aabbMax) * 0.5f;
+	float radius = 0.0f;
+	for (const ModelVertex& v : vertices)
+		radius = glm::max(radius, glm::length(glm::vec3(v.position) - center));
+
+	boundingSphere = glm::vec4(center, radius);
+}
+
+void Mesh::setModelMatrix(glm::mat4 m)
+{
+	meshUBO.model = m;
+	meshUBO.normal = glm::transpose(glm::inverse(meshUBO.model));
+	updateObjectEntry();
+}
+
+void Mesh::setMaterialColorWithValue(ColorType colorType, glm::vec3 color)
+{
+	switch (colorType)
+	{
+	case ColorType::AMBIENT:
+		material->ubo.ambient = color;
+		break;
+
+	case ColorType::DIFFUSE:
+		material->ubo.diffuse = color;
+		break;
 
+	case ColorType::SPECULAR:
+		material->ubo.specular = color;
+		break;
+
+	case ColorType::TRANSMITTANCE:
+		material->ubo.transmittance = color;
+		break;
+
+	case ColorType::EMISSION:
+		material->ubo.emission = color;
+		break;
+
+	default:
+		break;
+	}
+
+	material->updateMaterial();
+	updateObjectEntry(); // the material may have moved to its own table slot
+}
+
+void Mesh::setMaterialWithPreset(MaterialPresets preset)
+{
+	material->setPreset(preset);
 	material->updateMaterial();
+	updateObjectEntry(); // the material may have moved to its own table slot
 }
 
 void Mesh::setMaterialValue(MaterialValueType valueType, float value)
@@ -816,6 +752,7 @@ void Mesh::setMaterialValue(MaterialValueType valueType, float value)
 	}
 
 	material->updateMaterial();
+	updateObjectEntry(); // the material may have moved to its own table slot
 }
 
 void Mesh::draw(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial,
@@ -827,18 +764,12 @@ void Mesh::draw(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout,
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, offsets);
 	vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-	// bind model uniform buffer
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-		1, 1, &descriptorSet, 0, nullptr);
-
 	if (useMaterial)
-	{
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
-			2, 1, &material->descriptorSet, 0, nullptr);
-	}
+		material->bind(commandBuffer, pipelineLayout);
 
+	// instances read their matrices from consecutive table slots starting at objectIndex
 	vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 
-		instanceCount, firstIndex, vertOffset, firstInstanceIndex);
+		instanceCount, firstIndex, vertOffset, objectIndex + firstInstanceIndex);
 }
 // mesh
 void Mesh::destroyMesh()
@@ -847,14 +778,15 @@ void Mesh::destroyMesh()
 
 	vkDestroyBuffer(device, vertexBuffer.buffer, nullptr);
 	vkDestroyBuffer(device, indexBuffer.buffer, nullptr);
-	vkDestroyBuffer(device, uniformBuffer.buffer, nullptr);
 
 	vkFreeMemory(device, vertexBuffer.bufferMemory, nullptr);
 	vkFreeMemory(device, indexBuffer.bufferMemory, nullptr);
-	vkFreeMemory(device, uniformBuffer.bufferMemory, nullptr);
 
-	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	if (objectIndex != UINT32_MAX)
+	{
+		ObjectTable::release(objectIndex);
+		objectIndex = UINT32_MAX;
+	}
 }
 
 // model
@@ -880,9 +812,31 @@ void Model::destroyModel()
 
 void Model::draw(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout, bool useMaterial)
 {
+	ObjectTable::bind(commandBuffer, pipelineLayout);
+
+	// one texture set for every mesh, instead of a set per material
+	if (useMaterial && TextureTable::isEnabled())
+		TextureTable::bind(commandBuffer, pipelineLayout);
+
 	for (size_t i = 0; i < meshes.size(); i++)
 	{
 		meshes[i]->draw(commandBuffer, pipelineLayout, useMaterial);
 	}
 }
 
+void Model::submit(DrawList& drawList, VkPipeline pipeline, VkPipelineLayout pipelineLayout, bool useMaterial,
+	glm::vec3 viewPosition, float farPlane, uint32_t pass)
+{
+	for (Mesh* mesh : meshes)
+	{
+		DrawItem item;
+		item.pipeline = pipeline;
+		item.pipelineLayout = pipelineLayout;
+		item.materialSet = useMaterial ? mesh->material->descriptorSet : VK_NULL_HANDLE;
+		item.mesh = mesh;
+
+		glm::vec3 center = glm::vec3(mesh->meshUBO.model * glm::vec4(glm::vec3(mesh->boundingSphere), 1.0f));
+		drawList.submit(pass, item, glm::distance(center, viewPosition) / farPlane);
+	}
+}
+
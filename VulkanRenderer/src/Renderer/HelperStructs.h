@@ -144,13 +144,6 @@ struct FontVertex
 	bool operator==(const FontVertex& other) const;
 };
 
-struct Particle
-{
-	glm::vec4 position;
-	glm::vec4 velocity;
-	glm::vec4 color;
-};
-
 enum class TextureType
 {
 	NONE = -1,
@@ -179,6 +172,7 @@ struct Texture
 	uint32_t mipLevels = 0;
 	uint32_t layerCount = 0;	
 	TextureType type;
+	uint32_t tableIndex = UINT32_MAX; // slot in the TextureTable, only used with descriptor indexing
 
 	Texture();
 	Texture(TextureType textureType);
@@ -190,13 +184,16 @@ struct Texture
 	void destroyTexture();
 };
 
+enum class MaterialPresets;
+
 // extended to include PBR values
 struct Material 
 {
 	Material();
 	std::string name;
 
-	struct
+	// parameter block, stored in the shared MaterialTable rather than a buffer per material
+	struct Parameters
 	{
 		alignas(16)glm::vec3 ambient = glm::vec3(0.1f);
 		alignas(16)glm::vec3 diffuse = glm::vec3(0.5f);
@@ -217,8 +214,16 @@ struct Material
 		float anisotropy_rotation = 0.0f;  // anisor. [0, 1] default 0
 		float pad0 = 0.0f;
 		int dummy = 0;					   // Suppress padding warning.
+
+		// TextureTable slot of each texture, indexed with TextureType - 1. 0 is the empty texture
+		uint32_t textureIndices[12] = {};
+
+		bool operator==(const Parameters& other) const;
 	} ubo;
 
+	// slot in the MaterialTable, shaders look the parameters up with it
+	uint32_t materialIndex = UINT32_MAX;
+
 	// textures								 // MTL values (see tiny_obj_loader.h)
 	Texture* ambientTex = nullptr;			 // map_Ka
 	Texture* diffuseTex = nullptr;			 // map_Kd
@@ -233,15 +238,24 @@ struct Material
 	Texture* roughnessTex = nullptr;		 // map_Pr
 	Texture* sheenTex = nullptr;			 // map_Ps
 
+	// textures on the non bindless path, from the Descriptors layout cache and allocator
 	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
 	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
-	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
-	VulkanBuffer uniformBuffer = {};
 
 	void destroy();
 
+	// with descriptor indexing the textures are registered in the TextureTable and no set is created
 	void createDescriptorSet(Texture* emptyTexture);
+
+	// bind the texture set, a no-op on the bindless path where the TextureTable is bound once per pass instead
+	void bind(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex = 2);
+
+	// upload ubo to the MaterialTable. materialIndex can change when the material shared its slot
+	// with an identical one, so anything holding the old index needs refreshing afterwards
 	void updateMaterial();
+
+	// only sets the values, call updateMaterial() afterwards to upload them
+	void setPreset(MaterialPresets preset);
 };
 
 enum class ColorType
@@ -285,20 +299,26 @@ struct Mesh
 	VulkanBuffer vertexBuffer, indexBuffer;
 	Material* material;
 
+	// local space bounds, filled by computeBounds() when the mesh is loaded
+	glm::vec3 aabbMin = glm::vec3(0.0f);
+	glm::vec3 aabbMax = glm::vec3(0.0f);
+	glm::vec4 boundingSphere = glm::vec4(0.0f); // xyz = center, w = radius
+
 	struct
 	{
 		glm::mat4 model = glm::mat4(1.0f);
 		glm::mat4 normal = glm::mat4(1.0f);
 	} meshUBO;
 
-	VulkanBuffer uniformBuffer;
-	VkDescriptorSetLayout descriptorSetLayout;
-	VkDescriptorSet descriptorSet;
-	VkDescriptorPool descriptorPool;
+	// slot in the shared ObjectTable holding meshUBO, passed to shaders as firstInstance
+	uint32_t objectIndex = UINT32_MAX;
 
-	void createDescriptorSet();
+	void createObjectEntry();
+	void updateObjectEntry(); // after changing the matrices or the material
+	void computeBounds();
 	void destroyMesh();
 
+	// the ObjectTable must already be bound at set 1, see ObjectTable::bind()
 	void draw(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, bool useMaterial = false, 
 		int instanceCount = 1, int firstIndex = 0, int vertOffset = 0, int firstInstanceIndex = 0);
 	void setModelMatrix(glm::mat4 m);
@@ -307,6 +327,8 @@ struct Mesh
 	void setMaterialValue(MaterialValueType valueType, float value);
 };
 
+class DrawList;
+
 struct Model
 {
 	Model() { emptyMaterial = new Material(); };
@@ -324,6 +346,11 @@ struct Model
 
 	void destroyModel();
 	void draw(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout, bool useMaterial = false);
+
+	// queue every mesh on a draw list instead of drawing right away. depth is the distance from
+	// viewPosition to the mesh's bounds over farPlane
+	void submit(DrawList& drawList, VkPipeline pipeline, VkPipelineLayout pipelineLayout, bool useMaterial,
+		glm::vec3 viewPosition, float farPlane, uint32_t pass = 0);
 };
 
 // hash functions
@@ -361,6 +388,33 @@ namespace std
 		}
 	};
 
+	template<> struct hash<Material::Parameters>
+	{
+		size_t operator()(Material::Parameters const& p) const
+		{
+			size_t res = 0;
+			hash_combine(res, p.ambient);
+			hash_combine(res, p.diffuse);
+			hash_combine(res, p.specular);
+			hash_combine(res, p.transmittance);
+			hash_combine(res, p.emission);
+			hash_combine(res, p.shininess);
+			hash_combine(res, p.ior);
+			hash_combine(res, p.dissolve);
+			hash_combine(res, p.illum);
+			hash_combine(res, p.roughness);
+			hash_combine(res, p.metallic);
+			hash_combine(res, p.sheen);
+			hash_combine(res, p.clearcoat_thickness);
+			hash_combine(res, p.clearcoat_roughness);
+			hash_combine(res, p.anisotropy);
+			hash_combine(res, p.anisotropy_rotation);
+			for (uint32_t index : p.textureIndices)
+				hash_combine(res, index);
+			return res;
+		}
+	};
+
 	template<> struct hash<Material>
 	{
 		size_t operator()(Material const& mat) const
@@ -1,4 +1,5 @@
 #include "Light.h"
+#include <algorithm>
 
 #pragma region BASE
 Light::Light()
@@ -91,19 +92,92 @@ DirectionalLight::DirectionalLight()
 	type = LightType::DIRECTIONAL;
 }
 
-DirectionalLight::DirectionalLight(float size, glm::vec3 target, glm::vec3 col)
+DirectionalLight::DirectionalLight(glm::vec3 direction, glm::vec3 col)
 {
 	type = LightType::DIRECTIONAL;
-	proj = glm::ortho(-size, size, -size, size);
-	proj[1][1] *= -1;
-	view = glm::lookAt(glm::vec3(distance), target, worldUp);
+	this->direction = glm::normalize(direction);
 	color = col;
 }
+
 DirectionalLight::~DirectionalLight()
 {
 }
 
+void DirectionalLight::setDirection(glm::vec3 dir)
+{
+	direction = glm::normalize(dir);
+}
+
+glm::mat4 DirectionalLight::getLightView()
+{
+	// only rotates, so cascades snapped to texels in light space stay snapped however the camera moves
+	glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : worldUp;
+	return glm::lookAt(glm::vec3(0.0f), direction, up);
+}
+
+std::vector<ShadowCascade> DirectionalLight::computeCascades(const glm::mat4& cameraView, float fovY, float aspect, float nearPlane, float farPlane,
+	uint32_t cascadeCount, uint32_t resolution, float lambda, float casterDistance)
+{
+	float tanY = std::tan(fovY * 0.5f);
+	float tanX = tanY * aspect;
+
+	std::vector<ShadowCascade> cascades(cascadeCount);
+	float sliceNear = nearPlane;
+
+	for (uint32_t i = 0; i < cascadeCount; i++)
+	{
+		// practical split scheme, logarithmic splits spend the resolution evenly in screen space but leave the
+		// first cascades tiny, uniform ones waste it far away
+		float p = float(i + 1) / float(cascadeCount);
+		float logSplit = nearPlane * std::pow(farPlane / nearPlane, p);
+		float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+		float sliceFar = lambda * logSplit + (1.0f - lambda) * uniformSplit;
 
+		cascades[i].viewProj = fitSlice(cameraView, tanX, tanY, sliceNear, sliceFar, resolution, casterDistance);
+		cascades[i].splitDepth = sliceFar;
+		sliceNear = sliceFar;
+	}
+
+	// the whole frustum, snapping doesn't matter for culling
+	casterViewProj = fitSlice(cameraView, tanX, tanY, nearPlane, farPlane, 0, casterDistance);
+
+	return cascades;
+}
+
+glm::mat4 DirectionalLight::fitSlice(const glm::mat4& cameraView, float tanX, float tanY, float sliceNear, float sliceFar, uint32_t resolution,
+	float casterDistance)
+{
+	// the slice is symmetric around the view axis, so the sphere's center and radius don't depend on where the
+	// camera looks. the camera looks down -z
+	float centerDepth = 0.5f * (sliceNear + sliceFar);
+	float radius = 0.0f;
+	for (float depth : { sliceNear, sliceFar })
+	{
+		glm::vec3 corner = glm::vec3(depth * tanX, depth * tanY, depth - centerDepth);
+		radius = std::max(radius, glm::length(corner));
+	}
+
+	// floating point noise would still change the texel size now and then
+	radius = std::ceil(radius * 16.0f) / 16.0f;
+
+	glm::mat4 lightView = getLightView();
+	glm::vec3 center = glm::vec3(lightView * glm::inverse(cameraView) * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+
+	// move in whole texels, so the texels cover the same world space from frame to frame
+	if (resolution > 0)
+	{
+		float texelSize = 2.0f * radius / float(resolution);
+		center.x = std::floor(center.x / texelSize) * texelSize;
+		center.y = std::floor(center.y / texelSize) * texelSize;
+	}
+
+	// the light looks down -z as well
+	glm::mat4 proj = glm::ortho(center.x - radius, center.x + radius, center.y - radius, center.y + radius,
+		-center.z - radius - casterDistance, -center.z + radius);
+	proj[1][1] *= -1;
+
+	return proj * lightView;
+}
 #pragma endregion
 
 #pragma region POINTLIGHT
@@ -113,10 +187,11 @@ PointLight::PointLight()
 	type = LightType::POINT;
 }
 
-PointLight::PointLight(glm::vec3 position, glm::vec3 col)
+PointLight::PointLight(glm::vec3 position, glm::vec3 col, float range)
 {
 	type = LightType::POINT;
 	this->position = position;
+	this->range = range;
 	color = col;
 }
 
@@ -124,6 +199,42 @@ PointLight::~PointLight()
 {
 }
 
+void PointLight::setRange(float r)
+{
+	range = std::max(r, 0.1f);
+}
+
+std::vector<glm::mat4> PointLight::computeFaceViewProjs(float nearPlane)
+{
+	std::vector<glm::mat4> faces(6);
+	for (uint32_t i = 0; i < 6; i++)
+		faces[i] = faceViewProj(position, i, nearPlane, range);
+
+	return faces;
+}
+
+glm::mat4 PointLight::faceViewProj(const glm::vec3& position, uint32_t face, float nearPlane, float farPlane)
+{
+	// the ups of a cube map's faces, so a face's texels line up with the layer a sampler would pick
+	const glm::vec3 directions[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	const glm::vec3 ups[6] = { { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 } };
+
+	glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, farPlane);
+	proj[1][1] *= -1;
+
+	return proj * glm::lookAt(position, position + directions[face], ups[face]);
+}
+
+glm::mat4 PointLight::getCasterViewProj()
+{
+	// looks down -z from the sphere's front, through to its back
+	glm::mat4 view = glm::lookAt(position + glm::vec3(0.0f, 0.0f, range), position, worldUp);
+	glm::mat4 proj = glm::ortho(-range, range, -range, range, 0.0f, 2.0f * range);
+	proj[1][1] *= -1;
+
+	return proj * view;
+}
+
 #pragma endregion
 
 #pragma region AREALIGHT
@@ -1,6 +1,7 @@
 #pragma once
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include <vector>
 
 class Light
 {
@@ -57,29 +58,69 @@ private:
 	float farPlane = 100.0f;
 };
 
+// one slice of the camera frustum and the light's view projection covering it
+struct ShadowCascade
+{
+	glm::mat4 viewProj = glm::mat4(1.0f);
+	float splitDepth = 0.0f; // view space distance the slice ends at
+};
+
 class DirectionalLight : public Light
 {
 public:
 	DirectionalLight();
-	DirectionalLight(float size = 10.0f, glm::vec3 target = glm::vec3(0.0f), glm::vec3 col = glm::vec3(1.0f));
+	DirectionalLight(glm::vec3 direction, glm::vec3 col = glm::vec3(1.0f));
 	virtual ~DirectionalLight();
 
+	// direction the light travels in
+	glm::vec3 getDirection() { return direction; }
+	void setDirection(glm::vec3 dir);
+
+	// splits the camera frustum between nearPlane and farPlane into cascades, lambda blends uniform (0) and
+	// logarithmic (1) split distances. each cascade covers the bounding sphere of its slice, so its size doesn't
+	// change as the camera turns, and only moves by whole texels of a resolution sized map, so its edges don't
+	// shimmer as the camera moves. casterDistance moves the near planes towards the light to keep casters
+	// outside of the slice
+	std::vector<ShadowCascade> computeCascades(const glm::mat4& cameraView, float fovY, float aspect, float nearPlane, float farPlane,
+		uint32_t cascadeCount, uint32_t resolution, float lambda = 0.9f, float casterDistance = 50.0f);
+
+	// covers every cascade of the last computeCascades(), to cull shadow casters for all of them at once
+	glm::mat4 getCasterViewProj() { return casterViewProj; }
+
 private:
-	glm::mat4 proj = glm::mat4(1.0f);
-	glm::mat4 view = glm::mat4(1.0f);
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	glm::mat4 casterViewProj = glm::mat4(1.0f);
 
-	float distance = 10000.0f;
+	glm::mat4 getLightView();
+	glm::mat4 fitSlice(const glm::mat4& cameraView, float tanX, float tanY, float sliceNear, float sliceFar, uint32_t resolution,
+		float casterDistance);
 };
 
 class PointLight : public Light
 {
 public:
 	PointLight();
-	PointLight(glm::vec3 position, glm::vec3 col = glm::vec3(1.0f));
+	PointLight(glm::vec3 position, glm::vec3 col = glm::vec3(1.0f), float range = 25.0f);
 	virtual ~PointLight();
 
 	glm::vec3 getLightPos() { return position; }
+
+	// how far the light reaches, also the far plane of its shadow
+	float getRange() { return range; }
+	void setRange(float r);
+
+	// view projections of the six cube faces, in cube map order: +x, -x, +y, -y, +z, -z. each is a 90 degree
+	// perspective, so together they see every direction around the light
+	std::vector<glm::mat4> computeFaceViewProjs(float nearPlane = 0.05f);
+
+	// one of those faces, for a light at position. shared with the shadow atlas' point light tiles
+	static glm::mat4 faceViewProj(const glm::vec3& position, uint32_t face, float nearPlane, float farPlane);
+
+	// a box around the light's sphere, to cull shadow casters for every face at once
+	glm::mat4 getCasterViewProj();
+
 private:
+	float range = 25.0f;
 };
 
 struct AreaLight : public Light
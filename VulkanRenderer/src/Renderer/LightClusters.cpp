@@ -0,0 +1,215 @@
+#include "LightClusters.h"
+#include <cfloat>
+
+void LightClusters::build(uint32_t maxLights)
+{
+	if (maxLights == 0)
+		throw std::runtime_error("LightClusters: can't build for zero lights");
+
+	this->maxLights = maxLights;
+	lightCount = 0;
+
+	createBuffers();
+	createDescriptorSets();
+	createCullPipeline();
+
+	isBuilt = true;
+}
+
+void LightClusters::createBuffers()
+{
+	// parameters, lights and bounds are written on the CPU and stay mapped
+	paramsBuffer.bufferSize = sizeof(ClusterParams);
+	HelperFunctions::createBuffer(paramsBuffer.bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		paramsBuffer.buffer, paramsBuffer.bufferMemory);
+	paramsBuffer.map();
+
+	lightBuffer.bufferSize = sizeof(GPULight) * maxLights;
+	HelperFunctions::createBuffer(lightBuffer.bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		lightBuffer.buffer, lightBuffer.bufferMemory);
+	lightBuffer.map();
+
+	boundsBuffer.bufferSize = sizeof(ClusterBounds) * CLUSTER_COUNT;
+	HelperFunctions::createBuffer(boundsBuffer.bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		boundsBuffer.buffer, boundsBuffer.bufferMemory);
+	boundsBuffer.map();
+
+	clusterBuffer.bufferSize = sizeof(uint32_t) * (MAX_LIGHTS_PER_CLUSTER + 1) * CLUSTER_COUNT;
+	HelperFunctions::createBuffer(clusterBuffer.bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, clusterBuffer.buffer, clusterBuffer.bufferMemory);
+}
+
+void LightClusters::createDescriptorSets()
+{
+	// graphics layout
+	std::vector<VkDescriptorSetLayoutBinding> bindings =
+	{
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+	};
+	descriptorSetLayout = Descriptors::getLayout(bindings);
+
+	// compute layout
+	bindings.clear();
+	for (uint32_t i = 0; i < 3; i++)
+		bindings.push_back(HelperFunctions::initializers::descriptorSetLayoutBinding(i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT));
+	cullSetLayout = Descriptors::getLayout(bindings);
+
+	descriptorSet = descriptorAllocator.allocate(descriptorSetLayout);
+	Descriptors::write(descriptorSet, descriptorSetLayout, { paramsBuffer.buffer, lightBuffer.buffer, clusterBuffer.buffer });
+
+	cullSet = descriptorAllocator.allocate(cullSetLayout);
+	Descriptors::write(cullSet, cullSetLayout, { lightBuffer.buffer, boundsBuffer.buffer, clusterBuffer.buffer });
+}
+
+void LightClusters::createCullPipeline()
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	auto compShaderCode = HelperFunctions::readShaderFile("shaders/Global/cluster_lights.spv");
+	VkShaderModule compShaderModule = HelperFunctions::CreateShaderModules(compShaderCode);
+
+	VkPushConstantRange push = {};
+	push.offset = 0;
+	push.size = sizeof(CullPush);
+	push.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkPipelineLayoutCreateInfo layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(1, &cullSetLayout, 1, &push);
+	if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create light culling pipeline layout");
+
+	VkComputePipelineCreateInfo pipelineInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+	pipelineInfo.stage = HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, compShaderModule);
+	pipelineInfo.layout = cullPipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &cullPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create light culling pipeline");
+
+	vkDestroyShaderModule(device, compShaderModule, nullptr);
+}
+
+void LightClusters::setProjection(const glm::mat4& proj, float nearPlane, float farPlane, VkExtent2D extent)
+{
+	// tiles are whole pixels, the last row and column may reach past the screen
+	glm::vec2 tileSize = glm::vec2(float((extent.width + TILES_X - 1) / TILES_X), float((extent.height + TILES_Y - 1) / TILES_Y));
+	float logRange = std::log(farPlane / nearPlane);
+
+	ClusterParams params = {};
+	params.gridSize = glm::uvec4(TILES_X, TILES_Y, SLICES, MAX_LIGHTS_PER_CLUSTER);
+	params.sliceParams = glm::vec4(tileSize, SLICES / logRange, -(SLICES * std::log(nearPlane)) / logRange);
+	params.depthRange = glm::vec4(nearPlane, farPlane, 0.0f, 0.0f);
+	memcpy(paramsBuffer.mappedMemory, &params, sizeof(ClusterParams));
+
+	// each tile's corners are rays from the camera, cut at the near and far depth of each slice
+	glm::mat4 invProj = glm::inverse(proj);
+	ClusterBounds* bounds = static_cast<ClusterBounds*>(boundsBuffer.mappedMemory);
+
+	for (uint32_t z = 0; z < SLICES; z++)
+	{
+		float sliceNear = nearPlane * std::pow(farPlane / nearPlane, float(z) / SLICES);
+		float sliceFar = nearPlane * std::pow(farPlane / nearPlane, float(z + 1) / SLICES);
+
+		for (uint32_t y = 0; y < TILES_Y; y++)
+		{
+			for (uint32_t x = 0; x < TILES_X; x++)
+			{
+				glm::vec3 minPoint = glm::vec3(FLT_MAX), maxPoint = glm::vec3(-FLT_MAX);
+
+				for (uint32_t corner = 0; corner < 4; corner++)
+				{
+					glm::vec2 pixel = glm::vec2(float(x + (corner & 1)), float(y + (corner >> 1))) * tileSize;
+					glm::vec2 ndc = pixel / glm::vec2(float(extent.width), float(extent.height)) * 2.0f - 1.0f;
+
+					glm::vec4 farPoint = invProj * glm::vec4(ndc, 1.0f, 1.0f);
+					glm::vec3 ray = glm::vec3(farPoint) / farPoint.w;
+
+					// the camera looks down -z
+					for (float depth : { sliceNear, sliceFar })
+					{
+						glm::vec3 point = ray * (depth / -ray.z);
+						minPoint = glm::min(minPoint, point);
+						maxPoint = glm::max(maxPoint, point);
+					}
+				}
+
+				uint32_t cluster = x + y * TILES_X + z * TILES_X * TILES_Y;
+				bounds[cluster].minPoint = glm::vec4(minPoint, 0.0f);
+				bounds[cluster].maxPoint = glm::vec4(maxPoint, 0.0f);
+			}
+		}
+	}
+}
+
+void LightClusters::setLights(const std::vector<GPULight>& lights)
+{
+	if (lights.size() > maxLights)
+		throw std::runtime_error("LightClusters: more lights than the clusters were built for");
+
+	memcpy(lightBuffer.mappedMemory, lights.data(), sizeof(GPULight) * lights.size());
+	lightCount = static_cast<uint32_t>(lights.size());
+}
+
+void LightClusters::setLight(uint32_t index, const GPULight& light)
+{
+	static_cast<GPULight*>(lightBuffer.mappedMemory)[index] = light;
+}
+
+void LightClusters::cull(VkCommandBuffer commandBuffer, const glm::mat4& view, bool synchronize)
+{
+	if (synchronize)
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	CullPush push = {};
+	push.view = view;
+	push.lightCount = lightCount;
+	push.clusterCount = CLUSTER_COUNT;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPush), &push);
+
+	// one thread per cluster, 64 per work group, see cluster_lights.comp
+	vkCmdDispatch(commandBuffer, (CLUSTER_COUNT + 63) / 64, 1, 1);
+
+	if (synchronize)
+	{
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = clusterBuffer.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+}
+
+void LightClusters::destroy()
+{
+	if (!isBuilt)
+		return;
+
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	paramsBuffer.destroy();
+	lightBuffer.destroy();
+	boundsBuffer.destroy();
+	clusterBuffer.destroy();
+
+	vkDestroyPipeline(device, cullPipeline, nullptr);
+	vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+	descriptorAllocator.destroy(); // the layouts are cached by Descriptors
+
+	isBuilt = false;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include "HelperStructs.h"
+#include "Descriptors.h"
+
+// clustered light culling
+// the view frustum is split into clusters: screen space tiles, each cut into depth slices that get exponentially
+// thicker with distance. every frame a compute shader tests every light's sphere against every cluster's view space
+// bounds and writes the lights touching a cluster into its list. shading finds a pixel's cluster from its screen
+// position and view depth and only loops over that list, so the cost of a pixel depends on the lights around it
+// rather than on how many there are in total. the clusters don't depend on the depth buffer, so culling can run
+// before anything is drawn.
+//
+// getDescriptorSetLayout() is the layout of getDescriptorSet():
+//   binding 0: cluster parameters (uniform buffer, fragment stage), the grid and how to find a pixel's cluster in it
+//   binding 1: lights (readonly storage buffer, vertex and fragment stage)
+//   binding 2: cluster lists (readonly storage buffer, fragment stage), per cluster a light count followed by its light indices
+
+// must match the Light struct in the shaders (std430)
+struct GPULight
+{
+	glm::vec4 positionRadius = glm::vec4(0.0f); // xyz = world space position, w = radius
+	glm::vec4 colorIntensity = glm::vec4(1.0f); // rgb = color, a = intensity
+};
+
+class LightClusters
+{
+public:
+	// create buffers, descriptors and the culling pipeline for up to maxLights lights
+	void build(uint32_t maxLights);
+	void destroy();
+
+	// the cluster bounds follow the projection, call again whenever it or the extent changes
+	void setProjection(const glm::mat4& proj, float nearPlane, float farPlane, VkExtent2D extent);
+
+	// the light buffer stays mapped, so edits are a single memcpy. only the first getLightCount() lights are culled
+	void setLights(const std::vector<GPULight>& lights);
+	void setLight(uint32_t index, const GPULight& light);
+	void setLightCount(uint32_t count) { lightCount = std::min(count, maxLights); }
+	uint32_t getLightCount() { return lightCount; }
+	uint32_t getMaxLights() { return maxLights; }
+
+	// record the culling dispatch for a camera. must be recorded outside of a render pass, and the cluster buffer
+	// needs a barrier before the fragment stage reads it. scenes without a RenderGraph can synchronize, which
+	// waits for the last frame's fragment shaders to stop reading the lists and makes them visible to the next ones
+	void cull(VkCommandBuffer commandBuffer, const glm::mat4& view, bool synchronize = false);
+
+	VkDescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout; }
+	VkDescriptorSet getDescriptorSet() { return descriptorSet; }
+
+	// written by cull()
+	VkBuffer getClusterBuffer() { return clusterBuffer.buffer; }
+
+private:
+	const uint32_t TILES_X = 16, TILES_Y = 9, SLICES = 24;
+	const uint32_t CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+
+	// lights past this in one cluster are dropped. must match cluster_lights.comp
+	const uint32_t MAX_LIGHTS_PER_CLUSTER = 255;
+
+	// must match the ClusterParams block in the shaders (std140)
+	struct ClusterParams
+	{
+		glm::uvec4 gridSize;	// tiles x, tiles y, slices, lights per cluster
+		glm::vec4 sliceParams;	// xy = tile size in pixels, z = slice scale, w = slice bias
+		glm::vec4 depthRange;	// x = near plane, y = far plane
+	};
+
+	struct ClusterBounds
+	{
+		glm::vec4 minPoint; // view space
+		glm::vec4 maxPoint;
+	};
+
+	struct CullPush
+	{
+		glm::mat4 view;
+		uint32_t lightCount;
+		uint32_t clusterCount;
+	};
+
+	uint32_t maxLights = 0, lightCount = 0;
+
+	VulkanBuffer paramsBuffer, lightBuffer, boundsBuffer;
+	VulkanBuffer clusterBuffer; // written and read on the GPU only
+
+	DescriptorAllocator descriptorAllocator;
+
+	// graphics: parameters, lights and cluster lists
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+	// compute: lights, cluster bounds and cluster lists
+	VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet cullSet = VK_NULL_HANDLE;
+	VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline cullPipeline = VK_NULL_HANDLE;
+
+	bool isBuilt = false;
+
+	void createBuffers();
+	void createDescriptorSets();
+	void createCullPipeline();
+};
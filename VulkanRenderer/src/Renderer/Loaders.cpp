@@ -15,6 +15,7 @@
 */
 
 #include "Loaders.h"
+#include "TextureTable.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
@@ -242,6 +243,7 @@ Model* ModelLoader::loadModel(std::string folder, std::string file)
 
 			newMesh->vertexBuffer = createMeshVertexBuffer(newMesh->vertices);
 			newMesh->indexBuffer = createMeshIndexBuffer(newMesh->indices);
+			newMesh->computeBounds();
 
 			if (materials.size() > 0)
 				newMesh->material = materials[shape.mesh.material_ids[0]];
@@ -252,7 +254,7 @@ Model* ModelLoader::loadModel(std::string folder, std::string file)
 				newMesh->material->createDescriptorSet(emptyTexture);
 			}
 
-			newMesh->createDescriptorSet();
+			newMesh->createObjectEntry();
 			meshes.push_back(newMesh);
 		}
 		
@@ -490,6 +492,10 @@ Texture* TextureLoader::loadTexture(std::string folder, std::string name, Textur
 	tex->textureDescriptor.sampler = tex->sampler;
 	tex->textureDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	tex->textureDescriptor.imageView = tex->imageView;
+
+	if (TextureTable::isEnabled())
+		TextureTable::registerTexture(tex);
+
 	return tex;
 }
 
@@ -0,0 +1,152 @@
+#include "MaterialTable.h"
+
+namespace MaterialTable
+{
+	namespace priv
+	{
+		static VulkanBuffer buffer;
+		static VkDeviceSize atomSize = 1;
+
+		// CPU copy of every slot, to compare against when deduplicating
+		static std::vector<Material::Parameters> entries;
+		static std::vector<uint32_t> refCounts;
+		static std::vector<uint32_t> freeSlots;
+		static std::unordered_map<size_t, uint32_t> lookup; // parameter hash -> slot
+
+		void create()
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(VulkanDevice::GetVulkanDevice()->GetPhysicalDevice(), &properties);
+			atomSize = properties.limits.nonCoherentAtomSize;
+
+			// not coherent, writes are flushed per entry instead
+			buffer.bufferSize = sizeof(Material::Parameters) * MAX_MATERIALS;
+			HelperFunctions::createBuffer(buffer.bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, buffer.buffer, buffer.bufferMemory);
+			buffer.map();
+		}
+
+		void write(uint32_t index, const Material::Parameters& params)
+		{
+			entries[index] = params;
+			memcpy(static_cast<Material::Parameters*>(buffer.mappedMemory) + index, &params, sizeof(params));
+
+			// flush ranges have to be aligned to the atom size
+			VkDeviceSize start = sizeof(Material::Parameters) * index;
+			VkDeviceSize end = start + sizeof(Material::Parameters);
+			start -= start % atomSize;
+			end = glm::min(((end + atomSize - 1) / atomSize) * atomSize, buffer.bufferSize);
+			buffer.flush(end - start, start);
+		}
+
+		uint32_t allocate()
+		{
+			if (!freeSlots.empty())
+			{
+				uint32_t index = freeSlots.back();
+				freeSlots.pop_back();
+				return index;
+			}
+
+			if (entries.size() == MAX_MATERIALS)
+				throw std::runtime_error("Material table is full, raise MaterialTable::MAX_MATERIALS");
+
+			entries.emplace_back();
+			refCounts.push_back(0);
+			return static_cast<uint32_t>(entries.size() - 1);
+		}
+
+		// drop the lookup entry if it points at this slot
+		void forget(uint32_t index)
+		{
+			auto found = lookup.find(std::hash<Material::Parameters>()(entries[index]));
+			if (found != lookup.end() && found->second == index)
+				lookup.erase(found);
+		}
+	}
+}
+
+bool Material::Parameters::operator==(const Parameters& other) const
+{
+	return ambient == other.ambient && diffuse == other.diffuse && specular == other.specular &&
+		transmittance == other.transmittance && emission == other.emission &&
+		shininess == other.shininess && ior == other.ior && dissolve == other.dissolve && illum == other.illum &&
+		roughness == other.roughness && metallic == other.metallic && sheen == other.sheen &&
+		clearcoat_thickness == other.clearcoat_thickness && clearcoat_roughness == other.clearcoat_roughness &&
+		anisotropy == other.anisotropy && anisotropy_rotation == other.anisotropy_rotation &&
+		memcmp(textureIndices, other.textureIndices, sizeof(textureIndices)) == 0;
+}
+
+uint32_t MaterialTable::acquire(const Material::Parameters& params)
+{
+	if (priv::buffer.buffer == VK_NULL_HANDLE)
+		priv::create();
+
+	size_t key = std::hash<Material::Parameters>()(params);
+	auto found = priv::lookup.find(key);
+	if (found != priv::lookup.end() && priv::entries[found->second] == params)
+	{
+		priv::refCounts[found->second]++;
+		return found->second;
+	}
+
+	uint32_t index = priv::allocate();
+	priv::refCounts[index] = 1;
+	priv::write(index, params);
+
+	// on a hash collision the existing slot keeps the lookup entry
+	if (found == priv::lookup.end())
+		priv::lookup.emplace(key, index);
+
+	return index;
+}
+
+void MaterialTable::release(uint32_t index)
+{
+	if (priv::buffer.buffer == VK_NULL_HANDLE || --priv::refCounts[index] > 0)
+		return;
+
+	priv::forget(index);
+	priv::freeSlots.push_back(index);
+}
+
+uint32_t MaterialTable::update(uint32_t index, const Material::Parameters& params)
+{
+	if (priv::entries[index] == params)
+		return index;
+
+	if (priv::refCounts[index] > 1)
+	{
+		priv::refCounts[index]--;
+		return acquire(params);
+	}
+
+	// sole owner, rewrite in place. editors call this every frame a slider moves,
+	// so the slot isn't merged with an identical one here to keep its index stable
+	priv::forget(index);
+	priv::write(index, params);
+	priv::lookup.emplace(std::hash<Material::Parameters>()(params), index);
+
+	return index;
+}
+
+VkBuffer MaterialTable::getBuffer()
+{
+	if (priv::buffer.buffer == VK_NULL_HANDLE)
+		priv::create();
+
+	return priv::buffer.buffer;
+}
+
+void MaterialTable::destroy()
+{
+	if (priv::buffer.buffer == VK_NULL_HANDLE)
+		return;
+
+	priv::buffer.destroy();
+	priv::buffer = VulkanBuffer();
+	priv::entries.clear();
+	priv::refCounts.clear();
+	priv::freeSlots.clear();
+	priv::lookup.clear();
+}
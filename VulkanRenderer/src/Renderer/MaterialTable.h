@@ -0,0 +1,28 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "HelperStructs.h"
+
+// every material's parameter block packed into one storage buffer, shaders index it with Material::materialIndex.
+// identical parameter blocks share a slot, so e.g. the same preset on many meshes is only stored once.
+// the buffer stays mapped and only the entries that were written get flushed.
+//
+//   layout(set = 1, binding = 1) readonly buffer MaterialTable { Material materials[]; };
+//
+// shaders get the block and the Material struct from shaders/Global/material_table.glsl
+//
+// the table is bound through the ObjectTable's set, see ObjectTable.h
+namespace MaterialTable
+{
+	const uint32_t MAX_MATERIALS = 4096;
+
+	// slot holding these parameters, shared with any identical entry
+	uint32_t acquire(const Material::Parameters& params);
+	void release(uint32_t index);
+
+	// write new parameters for a slot. a slot that's shared with other materials is left alone and the
+	// parameters move to a slot of their own instead, so the returned index may differ from the one passed in
+	uint32_t update(uint32_t index, const Material::Parameters& params);
+
+	VkBuffer getBuffer();
+	void destroy();
+}
@@ -0,0 +1,107 @@
+#include "ObjectTable.h"
+#include "HelperStructs.h"
+#include "MaterialTable.h"
+#include "Descriptors.h"
+
+namespace ObjectTable
+{
+	namespace priv
+	{
+		static VulkanBuffer buffer;
+		static VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+		static VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+		static uint32_t objectCount = 0;
+		static std::vector<uint32_t> freeSlots; // released by destroyed meshes, reused before growing
+
+		void create()
+		{
+			// the whole table is allocated up front and stays mapped. growing it would mean rewriting a
+			// descriptor set that prerecorded command buffers still reference
+			buffer.bufferSize = sizeof(ObjectData) * MAX_OBJECTS;
+			HelperFunctions::createBuffer(buffer.bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				buffer.buffer, buffer.bufferMemory);
+			buffer.map();
+
+			std::vector<VkDescriptorSetLayoutBinding> bindings =
+			{
+				HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+				HelperFunctions::initializers::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			};
+
+			descriptorSetLayout = Descriptors::getLayout(bindings);
+			descriptorSet = Descriptors::allocate(descriptorSetLayout);
+			Descriptors::write(descriptorSet, descriptorSetLayout, { buffer.buffer, MaterialTable::getBuffer() });
+		}
+	}
+}
+
+uint32_t ObjectTable::allocate()
+{
+	if (priv::descriptorSet == VK_NULL_HANDLE)
+		priv::create();
+
+	uint32_t index;
+	if (!priv::freeSlots.empty())
+	{
+		index = priv::freeSlots.back();
+		priv::freeSlots.pop_back();
+	}
+
+	else
+	{
+		if (priv::objectCount == MAX_OBJECTS)
+			throw std::runtime_error("Object table is full, raise ObjectTable::MAX_OBJECTS");
+
+		index = priv::objectCount++;
+	}
+
+	update(index, ObjectData());
+	return index;
+}
+
+void ObjectTable::release(uint32_t index)
+{
+	if (priv::descriptorSet != VK_NULL_HANDLE)
+		priv::freeSlots.push_back(index);
+}
+
+void ObjectTable::update(uint32_t index, const ObjectData& data)
+{
+	memcpy(static_cast<ObjectData*>(priv::buffer.mappedMemory) + index, &data, sizeof(ObjectData));
+}
+
+void ObjectTable::bind(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex)
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+		setIndex, 1, &priv::descriptorSet, 0, nullptr);
+}
+
+VkDescriptorSet ObjectTable::getDescriptorSet()
+{
+	return priv::descriptorSet;
+}
+
+VkDescriptorSetLayout ObjectTable::getDescriptorSetLayout()
+{
+	if (priv::descriptorSetLayout == VK_NULL_HANDLE)
+		priv::create();
+
+	return priv::descriptorSetLayout;
+}
+
+void ObjectTable::destroy()
+{
+	if (priv::descriptorSet == VK_NULL_HANDLE)
+		return;
+
+	// the set and layout are freed by Descriptors::destroy()
+	priv::buffer.destroy();
+	priv::buffer = VulkanBuffer();
+
+	priv::descriptorSetLayout = VK_NULL_HANDLE;
+	priv::descriptorSet = VK_NULL_HANDLE;
+	priv::objectCount = 0;
+	priv::freeSlots.clear();
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+// one storage buffer holding the model and normal matrices of every mesh, shared by all of them through a single
+// descriptor set. meshes take a slot when they're created and draw with firstInstance set to it, so vertex shaders
+// read their matrices with objects[gl_InstanceIndex]. bind the set once per pass instead of once per mesh.
+// the same set also exposes the MaterialTable, indexed with the object's materialIndex
+//
+//   layout(set = 1, binding = 0) readonly buffer ObjectTable { ObjectData objects[]; };
+//   layout(set = 1, binding = 1) readonly buffer MaterialTable { Material materials[]; };
+//   struct ObjectData { mat4 model; mat4 normal; uint materialIndex; };
+namespace ObjectTable
+{
+	const uint32_t MAX_OBJECTS = 16384;
+
+	struct ObjectData
+	{
+		glm::mat4 model = glm::mat4(1.0f);
+		glm::mat4 normal = glm::mat4(1.0f);
+		uint32_t materialIndex = 0;
+		uint32_t pad0 = 0, pad1 = 0, pad2 = 0; // std430 rounds the struct up to 16 bytes
+	};
+
+	// the table is created on the first allocation
+	uint32_t allocate();
+	void release(uint32_t index);
+	void update(uint32_t index, const ObjectData& data);
+
+	void bind(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex = 1);
+	VkDescriptorSet getDescriptorSet();
+	VkDescriptorSetLayout getDescriptorSetLayout();
+
+	void destroy();
+}
@@ -0,0 +1,182 @@
+#include "ParallelRecorder.h"
+
+void ParallelRecorder::beginFrame(uint32_t frameIndex, uint64_t contentVersion)
+{
+	if (frameIndex >= frames.size())
+	{
+		frames.resize(frameIndex + 1);
+		for (FrameCommands& frame : frames)
+			frame.threads.resize(threads.getThreadCount() + 1);
+	}
+
+	currentFrame = frameIndex;
+	passIndex = 0;
+
+	FrameCommands& frame = frames[currentFrame];
+
+	// the calling thread records the UI, which changes every frame
+	resetPool(frame.threads.back());
+
+	reusing = enabled && !frame.dirty && frame.contentVersion == contentVersion;
+	if (reusing)
+		return;
+
+	for (uint32_t i = 0; i < threads.getThreadCount(); i++)
+		resetPool(frame.threads[i]);
+
+	frame.passes.clear();
+	frame.stats = DrawStats();
+	frame.contentVersion = contentVersion;
+	frame.dirty = false;
+}
+
+void ParallelRecorder::markDirty()
+{
+	for (FrameCommands& frame : frames)
+		frame.dirty = true;
+}
+
+void ParallelRecorder::recordRenderPass(VkCommandBuffer primary, const VkRenderPassBeginInfo& beginInfo, CommandRecorder& inlineRecorder,
+	uint32_t jobCount, const PassJob& job, const std::function<void(VkCommandBuffer)>& mainThreadJob)
+{
+	recordSubpass(primary, beginInfo, 0, 1, inlineRecorder, jobCount, job, mainThreadJob);
+}
+
+void ParallelRecorder::recordSubpass(VkCommandBuffer primary, const VkRenderPassBeginInfo& beginInfo, uint32_t subpass, uint32_t subpassCount,
+	CommandRecorder& inlineRecorder, uint32_t jobCount, const PassJob& job, const std::function<void(VkCommandBuffer)>& mainThreadJob)
+{
+	if (!enabled)
+	{
+		if (subpass == 0)
+			vkCmdBeginRenderPass(primary, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		else
+			vkCmdNextSubpass(primary, VK_SUBPASS_CONTENTS_INLINE);
+
+		job(inlineRecorder, 0, 1);
+		if (mainThreadJob)
+			mainThreadJob(primary);
+
+		if (subpass == subpassCount - 1)
+			vkCmdEndRenderPass(primary);
+		return;
+	}
+
+	FrameCommands& frame = frames[currentFrame];
+
+	if (!reusing)
+	{
+		std::vector<VkCommandBuffer> secondaries(jobCount);
+		if (jobRecorders.size() < jobCount)
+			jobRecorders.resize(jobCount);
+
+		threads.run(jobCount, [&](uint32_t jobIndex, uint32_t threadIndex)
+			{
+				VkCommandBuffer commandBuffer = beginSecondary(threadIndex, beginInfo, subpass, false);
+
+				jobRecorders[jobIndex].begin(commandBuffer);
+				job(jobRecorders[jobIndex], jobIndex, jobCount);
+
+				vkEndCommandBuffer(commandBuffer);
+				secondaries[jobIndex] = commandBuffer;
+			});
+
+		for (uint32_t i = 0; i < jobCount; i++)
+			frame.stats += jobRecorders[i].getStats();
+
+		frame.passes.push_back(secondaries);
+	}
+
+	std::vector<VkCommandBuffer> secondaries = frame.passes[passIndex++];
+
+	if (mainThreadJob)
+	{
+		VkCommandBuffer commandBuffer = beginSecondary(threads.getThreadCount(), beginInfo, subpass, true);
+		mainThreadJob(commandBuffer);
+		vkEndCommandBuffer(commandBuffer);
+		secondaries.push_back(commandBuffer);
+	}
+
+	if (subpass == 0)
+		vkCmdBeginRenderPass(primary, &beginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	else
+		vkCmdNextSubpass(primary, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+	vkCmdExecuteCommands(primary, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+
+	if (subpass == subpassCount - 1)
+		vkCmdEndRenderPass(primary);
+}
+
+void ParallelRecorder::destroy()
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	for (FrameCommands& frame : frames)
+	{
+		for (ThreadCommands& commands : frame.threads)
+		{
+			if (commands.pool != VK_NULL_HANDLE)
+				vkDestroyCommandPool(device, commands.pool, nullptr);
+		}
+	}
+
+	frames.clear();
+}
+
+void ParallelRecorder::resetPool(ThreadCommands& commands)
+{
+	if (commands.pool != VK_NULL_HANDLE)
+		vkResetCommandPool(VulkanDevice::GetVulkanDevice()->GetLogicalDevice(), commands.pool, 0);
+
+	commands.usedCount = 0;
+}
+
+VkCommandBuffer ParallelRecorder::beginSecondary(uint32_t threadIndex, const VkRenderPassBeginInfo& beginInfo, uint32_t subpass, bool oneTimeSubmit)
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+	ThreadCommands& commands = frames[currentFrame].threads[threadIndex];
+
+	// buffers are only ever reset along with their pool
+	if (commands.pool == VK_NULL_HANDLE)
+	{
+		VkCommandPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+		poolInfo.queueFamilyIndex = VulkanDevice::GetVulkanDevice()->GetFamilyIndices().graphicsFamily.value();
+		poolInfo.flags = oneTimeSubmit ? VK_COMMAND_POOL_CREATE_TRANSIENT_BIT : 0;
+
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commands.pool) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create command pool");
+	}
+
+	if (commands.usedCount == commands.buffers.size())
+	{
+		VkCommandBufferAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		allocInfo.commandPool = commands.pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate secondary command buffer");
+
+		commands.buffers.push_back(commandBuffer);
+	}
+
+	VkCommandBuffer commandBuffer = commands.buffers[commands.usedCount++];
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+	inheritanceInfo.renderPass = beginInfo.renderPass;
+	inheritanceInfo.subpass = subpass;
+	inheritanceInfo.framebuffer = beginInfo.framebuffer;
+
+	// cached passes are executed by several primaries over time, just never by two pending ones at once
+	VkCommandBufferBeginInfo secondaryBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	secondaryBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	if (oneTimeSubmit)
+		secondaryBeginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &secondaryBeginInfo) != VK_SUCCESS)
+		throw std::runtime_error("Failed to begin recording secondary command buffer");
+
+	return commandBuffer;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "DrawList.h"
+#include "ThreadPool.h"
+
+// records render passes from several threads. a pass is split into jobs, each job records a secondary command
+// buffer on a worker thread and the primary runs them in job order with vkCmdExecuteCommands.
+// a command pool may only be used by one thread at a time, so every thread gets its own pool per frame. a frame's
+// pools are reset wholesale with vkResetCommandPool when it's re-recorded, instead of resetting buffers one by one.
+// when disabled, passes record inline on the primary exactly like before, which keeps serial recording one toggle away.
+// the workers' secondaries are kept per frame and executed again as long as nothing structural changed, so a static
+// scene only re-records its (tiny) primary and the UI. the caller passes a version of everything the passes record
+// (e.g. GPUCuller::getDrawVersion()) and calls markDirty() for anything else, like new pipelines or a resize
+class ParallelRecorder
+{
+public:
+	// recorder is begun on the job's secondary (or the primary when disabled). jobs split their draws with
+	// the job index, e.g. GPUCuller::draw(..., job, jobCount)
+	using PassJob = std::function<void(CommandRecorder& recorder, uint32_t job, uint32_t jobCount)>;
+
+	// the previous submission of frameIndex must have finished. the frame's passes are re-recorded when
+	// contentVersion differs from the one they were recorded with or markDirty() was called since
+	void beginFrame(uint32_t frameIndex, uint64_t contentVersion = 0);
+	void markDirty();
+
+	// whether this frame's passes are the ones recorded in an earlier frame
+	bool isReusingFrame() { return reusing; }
+
+	// begins the render pass on primary, records its contents and ends it. jobCount jobs record on the workers
+	// (a single call when disabled), then mainThreadJob records after them on the calling thread, for ImGui which
+	// isn't thread safe
+	void recordRenderPass(VkCommandBuffer primary, const VkRenderPassBeginInfo& beginInfo, CommandRecorder& inlineRecorder,
+		uint32_t jobCount, const PassJob& job, const std::function<void(VkCommandBuffer)>& mainThreadJob = nullptr);
+
+	// the same for one subpass of a render pass with several. the first subpass begins the render pass, the
+	// others move on to their subpass and the last one ends it
+	void recordSubpass(VkCommandBuffer primary, const VkRenderPassBeginInfo& beginInfo, uint32_t subpass, uint32_t subpassCount,
+		CommandRecorder& inlineRecorder, uint32_t jobCount, const PassJob& job, const std::function<void(VkCommandBuffer)>& mainThreadJob = nullptr);
+
+	// summed over every secondary the current frame executes
+	const DrawStats& getStats() { return frames[currentFrame].stats; }
+
+	uint32_t getThreadCount() { return threads.getThreadCount(); }
+	bool isEnabled() { return enabled; }
+	void setEnabled(bool enable) { enabled = enable; markDirty(); }
+
+	void destroy();
+
+private:
+	struct ThreadCommands
+	{
+		VkCommandPool pool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> buffers;
+		uint32_t usedCount = 0;
+	};
+
+	ThreadPool threads;
+	bool enabled = true;
+
+	struct FrameCommands
+	{
+		// one per worker, plus the calling thread's at the back. only the calling thread's pool is reset
+		// every frame, the workers' pools hold the cached passes
+		std::vector<ThreadCommands> threads;
+
+		// the workers' secondaries of each recordRenderPass() call, in call order
+		std::vector<std::vector<VkCommandBuffer>> passes;
+		DrawStats stats;
+
+		uint64_t contentVersion = 0;
+		bool dirty = true;
+	};
+
+	std::vector<FrameCommands> frames;
+	uint32_t currentFrame = 0;
+	uint32_t passIndex = 0;
+	bool reusing = false;
+
+	std::vector<CommandRecorder> jobRecorders;
+
+	void resetPool(ThreadCommands& commands);
+	VkCommandBuffer beginSecondary(uint32_t threadIndex, const VkRenderPassBeginInfo& beginInfo, uint32_t subpass, bool oneTimeSubmit);
+};
@@ -0,0 +1,482 @@
+#include "ParticleSystem.h"
+#include <algorithm>
+#include <cstddef>
+
+void ParticleSystem::build(uint32_t maxParticles)
+{
+	if (maxParticles == 0)
+		throw std::runtime_error("ParticleSystem: can't build a pool of zero particles");
+
+	// whole work groups, which also keeps the second copy's offset aligned for its descriptors
+	this->maxParticles = (maxParticles + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+
+	// as many cells as slots keeps collisions between cells rare. whole groups, for the prefix sum
+	cellCount = this->maxParticles;
+	needsReset = true;
+	current = 0;
+	spawnRemainders.assign(emitters.size(), 0.0f);
+
+	createBuffers();
+	createDescriptorSets();
+	createPipelines();
+	createSyncObjects();
+
+	isBuilt = true;
+}
+
+uint32_t ParticleSystem::addEmitter(const ParticleEmitter& emitter)
+{
+	if (emitters.size() >= MAX_EMITTERS)
+		throw std::runtime_error("ParticleSystem: too many emitters");
+
+	emitters.push_back(emitter);
+	spawnRemainders.push_back(0.0f);
+	return static_cast<uint32_t>(emitters.size() - 1);
+}
+
+void ParticleSystem::setBounds(const glm::vec3& center, const glm::vec3& halfExtent, float restitution)
+{
+	boundsCenter = center;
+	boundsExtent = halfExtent;
+	this->restitution = restitution;
+}
+
+void ParticleSystem::setInteraction(float radius, float stiffness)
+{
+	interactionRadius = std::max(radius, 0.0f);
+	this->stiffness = stiffness;
+}
+
+void ParticleSystem::createBuffers()
+{
+	VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	auto families = VulkanDevice::GetVulkanDevice()->GetFamilyIndices();
+
+	// what the draw reads is shared with the graphics family, the rest stays on the compute family
+	std::vector<uint32_t> shared = { families.computeFamily.value(), families.graphicsFamily.value() };
+
+	positionBuffer.bufferSize = sizeof(glm::vec4) * maxParticles * COPIES;
+	HelperFunctions::createBuffer(positionBuffer.bufferSize, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		positionBuffer.buffer, positionBuffer.bufferMemory, shared);
+
+	velocityBuffer.bufferSize = sizeof(glm::vec4) * maxParticles;
+	HelperFunctions::createBuffer(velocityBuffer.bufferSize, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		velocityBuffer.buffer, velocityBuffer.bufferMemory);
+
+	colorBuffer.bufferSize = sizeof(uint32_t) * maxParticles;
+	HelperFunctions::createBuffer(colorBuffer.bufferSize, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		colorBuffer.buffer, colorBuffer.bufferMemory, shared);
+
+	deadBuffer.bufferSize = sizeof(uint32_t) * maxParticles;
+	HelperFunctions::createBuffer(deadBuffer.bufferSize, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		deadBuffer.buffer, deadBuffer.bufferMemory);
+
+	aliveBuffer.bufferSize = sizeof(uint32_t) * maxParticles * COPIES;
+	HelperFunctions::createBuffer(aliveBuffer.bufferSize, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		aliveBuffer.buffer, aliveBuffer.bufferMemory, shared);
+
+	counterBuffer.bufferSize = sizeof(Counters);
+	HelperFunctions::createBuffer(counterBuffer.bufferSize, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		counterBuffer.buffer, counterBuffer.bufferMemory);
+
+	indirectBuffer.bufferSize = sizeof(IndirectArgs);
+	HelperFunctions::createBuffer(indirectBuffer.bufferSize, storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indirectBuffer.buffer, indirectBuffer.bufferMemory, shared);
+
+	emitterBuffer.bufferSize = sizeof(GPUEmitter) * MAX_EMITTERS;
+	HelperFunctions::createBuffer(emitterBuffer.bufferSize, storage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, emitterBuffer.buffer, emitterBuffer.bufferMemory);
+
+	// cleared at the start of every update that builds the grid
+	cellBuffer.bufferSize = sizeof(glm::uvec2) * cellCount;
+	HelperFunctions::createBuffer(cellBuffer.bufferSize, storage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, cellBuffer.buffer, cellBuffer.bufferMemory);
+
+	groupSumBuffer.bufferSize = sizeof(uint32_t) * (cellCount / GROUP_SIZE);
+	HelperFunctions::createBuffer(groupSumBuffer.bufferSize, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		groupSumBuffer.buffer, groupSumBuffer.bufferMemory);
+
+	sortBuffer.bufferSize = sizeof(glm::uvec2) * maxParticles;
+	HelperFunctions::createBuffer(sortBuffer.bufferSize, storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		sortBuffer.buffer, sortBuffer.bufferMemory);
+}
+
+void ParticleSystem::createDescriptorSets()
+{
+	// graphics layout
+	descriptorSetLayout = Descriptors::getLayout({
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT) });
+
+	// compute layout
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	for (uint32_t i = 0; i < 11; i++)
+		bindings.push_back(HelperFunctions::initializers::descriptorSetLayoutBinding(i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT));
+	updateSetLayout = Descriptors::getLayout(bindings);
+
+	// each graphics set sees one copy of the positions and alive list
+	VkDeviceSize positionRange = sizeof(glm::vec4) * maxParticles, aliveRange = sizeof(uint32_t) * maxParticles;
+	for (uint32_t copy = 0; copy < COPIES; copy++)
+	{
+		descriptorSets[copy] = descriptorAllocator.allocate(descriptorSetLayout);
+		Descriptors::write(descriptorSets[copy], descriptorSetLayout, { DescriptorInfo(positionBuffer.buffer, positionRange * copy, positionRange),
+			colorBuffer.buffer, DescriptorInfo(aliveBuffer.buffer, aliveRange * copy, aliveRange) });
+	}
+
+	updateSet = descriptorAllocator.allocate(updateSetLayout);
+	Descriptors::write(updateSet, updateSetLayout, { positionBuffer.buffer, velocityBuffer.buffer, colorBuffer.buffer, deadBuffer.buffer,
+		aliveBuffer.buffer, counterBuffer.buffer, indirectBuffer.buffer, emitterBuffer.buffer, cellBuffer.buffer, groupSumBuffer.buffer, sortBuffer.buffer });
+}
+
+void ParticleSystem::createPipelines()
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	VkPushConstantRange push = {};
+	push.offset = 0;
+	push.size = sizeof(UpdatePush);
+	push.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkPipelineLayoutCreateInfo layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(1, &updateSetLayout, 1, &push);
+	if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &updatePipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create particle pipeline layout");
+
+	// the single thread stages share a shader, as do the prefix sum's passes. the phase picks what they do
+	uint32_t phases[3] = { 0, 1, 2 };
+	VkSpecializationMapEntry phaseEntry = { 0, 0, sizeof(uint32_t) };
+	VkSpecializationInfo phaseSpecializations[3];
+	for (uint32_t i = 0; i < 3; i++)
+		phaseSpecializations[i] = { 1, &phaseEntry, sizeof(uint32_t), &phases[i] };
+
+	resetPipeline = createPipeline("shaders/Global/particle_reset.spv");
+	beginPipeline = createPipeline("shaders/Global/particle_args.spv", &phaseSpecializations[0]);
+	emitPipeline = createPipeline("shaders/Global/particle_emit.spv");
+	simulatePipeline = createPipeline("shaders/Global/particle_simulate.spv");
+	endPipeline = createPipeline("shaders/Global/particle_args.spv", &phaseSpecializations[1]);
+
+	countPipeline = createPipeline("shaders/Global/particle_grid_count.spv");
+	for (uint32_t i = 0; i < 3; i++)
+		scanPipelines[i] = createPipeline("shaders/Global/particle_grid_scan.spv", &phaseSpecializations[i]);
+	scatterPipeline = createPipeline("shaders/Global/particle_grid_scatter.spv");
+}
+
+void ParticleSystem::createSyncObjects()
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	VkCommandPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = VulkanDevice::GetVulkanDevice()->GetFamilyIndices().computeFamily.value();
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create particle command pool");
+
+	VkCommandBufferAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = COPIES;
+
+	if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate particle command buffers");
+
+	VkSemaphoreCreateInfo semaphoreInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	VkFenceCreateInfo fenceInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for (uint32_t copy = 0; copy < COPIES; copy++)
+	{
+		if (vkCreateFence(device, &fenceInfo, nullptr, &fences[copy]) != VK_SUCCESS ||
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &simulatedSemaphores[copy]) != VK_SUCCESS ||
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &drawnSemaphores[copy]) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create particle sync objects");
+
+		drawPending[copy] = false;
+		timestampsWritten[copy] = false;
+	}
+
+	// not every compute only family can write timestamps
+	VulkanDevice* vulkanDevice = VulkanDevice::GetVulkanDevice();
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(vulkanDevice->GetPhysicalDevice(), &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(vulkanDevice->GetPhysicalDevice(), &familyCount, families.data());
+	timestampsSupported = families[poolInfo.queueFamilyIndex].timestampValidBits > 0;
+
+	if (timestampsSupported)
+	{
+		VkQueryPoolCreateInfo queryInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = 3 * COPIES;
+
+		if (vkCreateQueryPool(device, &queryInfo, nullptr, &timestampPool) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create particle timestamp query pool");
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(vulkanDevice->GetPhysicalDevice(), &properties);
+		timestampPeriod = properties.limits.timestampPeriod;
+	}
+}
+
+VkPipeline ParticleSystem::createPipeline(const char* path, const VkSpecializationInfo* specialization)
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	auto compShaderCode = HelperFunctions::readShaderFile(path);
+	VkShaderModule compShaderModule = HelperFunctions::CreateShaderModules(compShaderCode);
+
+	VkComputePipelineCreateInfo pipelineInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+	pipelineInfo.stage = HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, compShaderModule);
+	pipelineInfo.stage.pSpecializationInfo = specialization;
+	pipelineInfo.layout = updatePipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create particle pipeline");
+
+	vkDestroyShaderModule(device, compShaderModule, nullptr);
+	return pipeline;
+}
+
+void ParticleSystem::computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+{
+	VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = dstAccess;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void ParticleSystem::update(float dt)
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	// reset starts over from the first alive list, the update then writes the second
+	uint32_t source = needsReset ? 0 : current;
+	uint32_t target = 1 - source;
+
+	// the update that last wrote this copy has to be done with its command buffer
+	VkCommandBuffer commandBuffer = commandBuffers[target];
+	vkWaitForFences(device, 1, &fences[target], VK_TRUE, UINT64_MAX);
+	vkResetFences(device, 1, &fences[target]);
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	// the fence says the copy's last update has finished
+	if (timestampsWritten[target])
+	{
+		uint64_t timestamps[3];
+		if (vkGetQueryPoolResults(device, timestampPool, target * 3, 3, sizeof(timestamps), timestamps, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			gridTime = float(timestamps[1] - timestamps[0]) * timestampPeriod * 1e-6f;
+			simulateTime = float(timestamps[2] - timestamps[1]) * timestampPeriod * 1e-6f;
+		}
+	}
+
+	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("Failed to begin recording particle command buffer");
+
+	// the last update's counters, velocities and dead list, and its emit still reading the emitters
+	VkMemoryBarrier lastUpdate = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	lastUpdate.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	lastUpdate.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		0, 1, &lastUpdate, 0, nullptr, 0, nullptr);
+
+	// whole particles only, the rest is carried over so low rates still spawn at high frame rates. each
+	// emitter's spawns follow the previous emitter's
+	std::vector<GPUEmitter> gpuEmitters(emitters.size());
+	uint32_t requested = 0;
+
+	for (size_t i = 0; i < emitters.size(); i++)
+	{
+		const ParticleEmitter& emitter = emitters[i];
+		float owed = emitter.rate * dt + spawnRemainders[i];
+		uint32_t spawns = static_cast<uint32_t>(std::max(owed, 0.0f));
+		spawnRemainders[i] = owed - float(spawns);
+
+		gpuEmitters[i].positionSpread = glm::vec4(emitter.position, emitter.spread);
+		gpuEmitters[i].direction = glm::vec4(glm::normalize(emitter.direction), 0.0f);
+		gpuEmitters[i].color = emitter.color;
+		gpuEmitters[i].speedLifetime = glm::vec4(emitter.minSpeed, emitter.maxSpeed, emitter.minLifetime, emitter.maxLifetime);
+		gpuEmitters[i].spawns = glm::uvec4(requested, spawns, 0, 0);
+		requested += spawns;
+	}
+
+	bool buildGrid = interactionRadius > 0.0f;
+
+	if (!gpuEmitters.empty())
+		vkCmdUpdateBuffer(commandBuffer, emitterBuffer.buffer, 0, sizeof(GPUEmitter) * gpuEmitters.size(), gpuEmitters.data());
+
+	// every cell starts empty
+	if (buildGrid)
+		vkCmdFillBuffer(commandBuffer, cellBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+	if (!gpuEmitters.empty() || buildGrid)
+	{
+		VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	UpdatePush push = {};
+	push.gravity = glm::vec4(gravity, 0.0f);
+	push.boundsCenter = glm::vec4(boundsCenter, restitution);
+	push.boundsExtent = glm::vec4(boundsExtent, 0.0f);
+	push.dt = dt;
+	push.requested = requested;
+	push.emitterCount = static_cast<uint32_t>(emitters.size());
+	push.maxParticles = maxParticles;
+	push.seed = frame++;
+	push.current = source;
+	push.cellCount = cellCount;
+	push.interactionRadius = interactionRadius;
+	push.stiffness = stiffness;
+
+	// every stage shares the layout, so the set and constants stay bound across pipelines
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, updatePipelineLayout, 0, 1, &updateSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, updatePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(UpdatePush), &push);
+
+	VkAccessFlags readWrite = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	if (needsReset)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, resetPipeline);
+		vkCmdDispatch(commandBuffer, (maxParticles + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+		computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readWrite);
+		needsReset = false;
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, beginPipeline);
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+	computeBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | readWrite);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, emitPipeline);
+	vkCmdDispatchIndirect(commandBuffer, indirectBuffer.buffer, offsetof(IndirectArgs, emit));
+	computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readWrite);
+
+	if (timestampsSupported)
+	{
+		vkCmdResetQueryPool(commandBuffer, timestampPool, target * 3, 3);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampPool, target * 3);
+	}
+
+	// counting sort of the particles simulate sees, by the cell their position hashes to
+	if (buildGrid)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, countPipeline);
+		vkCmdDispatchIndirect(commandBuffer, indirectBuffer.buffer, offsetof(IndirectArgs, simulate));
+		computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readWrite);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scanPipelines[0]);
+		vkCmdDispatch(commandBuffer, cellCount / GROUP_SIZE, 1, 1);
+		computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readWrite);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scanPipelines[1]);
+		vkCmdDispatch(commandBuffer, 1, 1, 1);
+		computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readWrite);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scanPipelines[2]);
+		vkCmdDispatch(commandBuffer, cellCount / GROUP_SIZE, 1, 1);
+		computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readWrite);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scatterPipeline);
+		vkCmdDispatchIndirect(commandBuffer, indirectBuffer.buffer, offsetof(IndirectArgs, simulate));
+		computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readWrite);
+	}
+
+	if (timestampsSupported)
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampPool, target * 3 + 1);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulatePipeline);
+	vkCmdDispatchIndirect(commandBuffer, indirectBuffer.buffer, offsetof(IndirectArgs, simulate));
+	computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readWrite);
+
+	if (timestampsSupported)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampPool, target * 3 + 2);
+		timestampsWritten[target] = true;
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, endPipeline);
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to record particle command buffer");
+
+	// the semaphores carry the writes over to the graphics queue, no barrier into the draw is needed. only the
+	// frame that drew this copy last is waited on, the one drawing the other copy keeps running
+	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.waitSemaphoreCount = drawPending[target] ? 1 : 0;
+	submitInfo.pWaitSemaphores = &drawnSemaphores[target];
+	submitInfo.pWaitDstStageMask = &waitStage;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &simulatedSemaphores[target];
+
+	if (vkQueueSubmit(VulkanDevice::GetVulkanDevice()->GetQueues().computeQueue, 1, &submitInfo, fences[target]) != VK_SUCCESS)
+		throw std::runtime_error("Failed to submit particle update");
+
+	drawPending[target] = true;
+	current = target;
+}
+
+void ParticleSystem::draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex)
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, setIndex, 1, &descriptorSets[current], 0, nullptr);
+	vkCmdDrawIndirect(commandBuffer, indirectBuffer.buffer, offsetof(IndirectArgs, draw) + sizeof(VkDrawIndirectCommand) * current,
+		1, sizeof(VkDrawIndirectCommand));
+}
+
+void ParticleSystem::destroy()
+{
+	if (!isBuilt)
+		return;
+
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	// the last updates may still be running when the device isn't idle
+	vkWaitForFences(device, COPIES, fences, VK_TRUE, UINT64_MAX);
+
+	for (uint32_t copy = 0; copy < COPIES; copy++)
+	{
+		vkDestroyFence(device, fences[copy], nullptr);
+		vkDestroySemaphore(device, simulatedSemaphores[copy], nullptr);
+		vkDestroySemaphore(device, drawnSemaphores[copy], nullptr);
+	}
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	vkDestroyQueryPool(device, timestampPool, nullptr);
+	timestampPool = VK_NULL_HANDLE;
+
+	positionBuffer.destroy();
+	velocityBuffer.destroy();
+	colorBuffer.destroy();
+	deadBuffer.destroy();
+	aliveBuffer.destroy();
+	counterBuffer.destroy();
+	indirectBuffer.destroy();
+	emitterBuffer.destroy();
+	cellBuffer.destroy();
+	groupSumBuffer.destroy();
+	sortBuffer.destroy();
+
+	for (VkPipeline pipeline : { resetPipeline, beginPipeline, emitPipeline, simulatePipeline, endPipeline, countPipeline, scatterPipeline,
+		scanPipelines[0], scanPipelines[1], scanPipelines[2] })
+		vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, updatePipelineLayout, nullptr);
+	descriptorAllocator.destroy(); // the layouts are cached by Descriptors
+
+	isBuilt = false;
+}
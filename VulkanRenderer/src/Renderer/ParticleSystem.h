@@ -0,0 +1,206 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "HelperStructs.h"
+#include "Descriptors.h"
+
+// GPU particles
+// particles live in a fixed pool of slots. a slot is either on the dead list or on one of two alive lists, and
+// only compute shaders move them between lists, so the CPU never knows or waits for how many are alive. every
+// update():
+//   1. a single thread clamps what the emitters ask for to the dead slots left and writes the dispatch sizes
+//   2. emit pops a dead slot per new particle, fills it in from its emitter and appends it to the alive list
+//   3. simulate ages and moves every alive particle. survivors are appended to the other alive list, which
+//      compacts it, expired particles push their slot back onto the dead list
+//   4. a single thread writes the number of survivors into the draw and makes their list the current one
+// emit and simulate are dispatched indirectly and the particles are drawn with vkCmdDrawIndirect, so the work
+// follows the live particles rather than the pool's size.
+//
+// with setInteraction(), particles closer than a radius push each other apart. between emit and simulate a spatial
+// hash grid of cells the size of the radius is built: every live particle counts itself into the cell its
+// position hashes to, a prefix sum over the counts gives each cell its start, and a scatter sorts the particles
+// by cell. simulate then only looks through the 27 cells around a particle, at most 64 candidates of them, so
+// the interactions cost O(n * k) instead of O(n^2).
+//
+// a particle's fields live in arrays of their own, indexed by its slot, so each stage only reads what it uses:
+//   positions: vec4, xyz = world space position, w = fraction of its life gone. two copies, one per alive list
+//   velocities: vec4, xyz = world space velocity, w = 1 / lifetime in seconds. compute only
+//   colors: RGBA8, written once when the particle is emitted
+// simulate reads the positions of the current list and writes the other's, so an update never writes what the
+// last frame draws. updates run on the compute queue and overlap the previous frame's rendering, only waiting
+// for the frame that drew the same copy two updates ago.
+//
+// getDescriptorSetLayout() is the layout of getDescriptorSet(), for the pipeline draw() is recorded with:
+//   binding 0: positions (readonly storage buffer, vertex stage), the copy of the list being drawn
+//   binding 1: colors (readonly storage buffer, vertex stage), a uint per slot, unpackUnorm4x8() it
+//   binding 2: alive list (readonly storage buffer, vertex stage), gl_VertexIndex is the entry of a live particle
+// draw() has no vertex input, each vertex is one particle, meant to be drawn as a point list
+
+// spawns particles at a rate, see ParticleSystem::addEmitter()
+struct ParticleEmitter
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	float rate = 1000.0f;							  // particles per second
+	glm::vec3 direction = glm::vec3(0.0f, 1.0f, 0.0f);
+	float spread = 0.3f;							  // half angle of the cone particles leave in, in radians
+	glm::vec4 color = glm::vec4(1.0f);
+	float minSpeed = 1.0f, maxSpeed = 2.0f;
+	float minLifetime = 1.0f, maxLifetime = 2.0f;	  // in seconds
+};
+
+class ParticleSystem
+{
+public:
+	// emitters are sent with every update()
+	static const uint32_t MAX_EMITTERS = 16;
+
+	// create buffers, descriptors and the compute pipelines for a pool of at least maxParticles. every slot starts
+	// dead
+	void build(uint32_t maxParticles);
+	void destroy();
+
+	uint32_t addEmitter(const ParticleEmitter& emitter);
+	ParticleEmitter& getEmitter(uint32_t index) { return emitters[index]; }
+	uint32_t getEmitterCount() { return static_cast<uint32_t>(emitters.size()); }
+
+	// constant acceleration, and the box particles bounce inside of
+	void setGravity(const glm::vec3& acceleration) { gravity = acceleration; }
+	void setBounds(const glm::vec3& center, const glm::vec3& halfExtent, float restitution = 0.5f);
+
+	// particles closer than radius are pushed apart by stiffness times how much they overlap. a radius of 0
+	// turns interactions and the grid they need off
+	void setInteraction(float radius, float stiffness);
+
+	// kills every particle with the next update()
+	void reset() { needsReset = true; }
+
+	// submit emission and simulation for dt seconds to the compute queue. exactly one submit has to draw() its
+	// result, waiting on getSimulatedSemaphore() and signaling getDrawnSemaphore()
+	void update(float dt);
+
+	// record the draw of every live particle from the last update(). must be recorded inside a render pass, with
+	// a pipeline whose layout has getDescriptorSetLayout() at setIndex bound
+	void draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex = 0);
+
+	// wait on it before the draw reads the particles, e.g. at the draw indirect and vertex shader stages
+	VkSemaphore getSimulatedSemaphore() { return simulatedSemaphores[current]; }
+	// signal it from the draw's submit, the update that writes the same copy again waits on it
+	VkSemaphore getDrawnSemaphore() { return drawnSemaphores[current]; }
+
+	VkDescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout; }
+	VkDescriptorSet getDescriptorSet() { return descriptorSets[current]; }
+	uint32_t getMaxParticles() { return maxParticles; }
+
+	// GPU time in milliseconds the grid build and the simulation took, a couple of updates ago
+	float getGridTime() { return gridTime; }
+	float getSimulateTime() { return simulateTime; }
+
+private:
+	// threads per work group, must match the particle shaders
+	const uint32_t GROUP_SIZE = 256;
+
+	// a copy of the positions and alive list, written by one update and drawn by the next frame
+	static const uint32_t COPIES = 2;
+
+	// must match the Emitter struct in the shaders (std430)
+	struct GPUEmitter
+	{
+		glm::vec4 positionSpread;	// xyz = position, w = cone half angle
+		glm::vec4 direction;		// xyz = normalized direction
+		glm::vec4 color;
+		glm::vec4 speedLifetime;	// min speed, max speed, min lifetime, max lifetime
+		glm::uvec4 spawns;			// x = first spawn of this emitter this update, y = spawn count
+	};
+
+	// must match the Counters block in the shaders
+	struct Counters
+	{
+		int32_t deadCount;
+		uint32_t aliveCount[COPIES];
+		uint32_t emitCount;	 // spawns this update, after clamping to the dead slots
+		uint32_t simulateCount;
+		uint32_t pad0, pad1, pad2;
+	};
+
+	// must match the indirect block in the shaders
+	struct IndirectArgs
+	{
+		VkDispatchIndirectCommand emit;
+		VkDispatchIndirectCommand simulate;
+		VkDrawIndirectCommand draw[COPIES]; // one per alive list, the frame drawing one overlaps the update writing the other
+	};
+
+	struct UpdatePush
+	{
+		glm::vec4 gravity;		// xyz = acceleration
+		glm::vec4 boundsCenter; // xyz = center, w = restitution
+		glm::vec4 boundsExtent; // xyz = half extent
+		float dt;
+		uint32_t requested;		// spawns every emitter asks for together
+		uint32_t emitterCount;
+		uint32_t maxParticles;
+		uint32_t seed;
+		uint32_t current;		// alive list holding last update's survivors
+		uint32_t cellCount;		// cells in the hash grid
+		float interactionRadius;
+		float stiffness;
+	};
+
+	uint32_t maxParticles = 0;
+	std::vector<ParticleEmitter> emitters;
+	std::vector<float> spawnRemainders; // per emitter, the fraction of a particle owed from the last update
+	glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+	glm::vec3 boundsCenter = glm::vec3(0.0f), boundsExtent = glm::vec3(100.0f);
+	float restitution = 0.5f;
+	float interactionRadius = 0.0f, stiffness = 0.0f;
+	uint32_t cellCount = 0;
+	uint32_t frame = 0;
+	uint32_t current = 0;	// alive list and position copy the last update wrote, what draw() reads
+	bool needsReset = true;
+
+	// written and read on the GPU only, except the emitters which are updated inside the command buffer. the
+	// positions and alive lists hold both copies back to back, the second starting at maxParticles
+	VulkanBuffer positionBuffer, velocityBuffer, colorBuffer, deadBuffer, aliveBuffer, counterBuffer, indirectBuffer, emitterBuffer;
+
+	// the hash grid: per cell its count and start, the prefix sum's per group totals, and per alive entry its rank
+	// in its cell and the slot sorted into its place
+	VulkanBuffer cellBuffer, groupSumBuffer, sortBuffer;
+
+	DescriptorAllocator descriptorAllocator;
+
+	// graphics: positions, colors and alive list, one set per copy
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSets[COPIES] = {};
+
+	// compute: every buffer, shared by all the stages
+	VkDescriptorSetLayout updateSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet updateSet = VK_NULL_HANDLE;
+	VkPipelineLayout updatePipelineLayout = VK_NULL_HANDLE;
+	VkPipeline resetPipeline = VK_NULL_HANDLE, beginPipeline = VK_NULL_HANDLE, emitPipeline = VK_NULL_HANDLE;
+	VkPipeline simulatePipeline = VK_NULL_HANDLE, endPipeline = VK_NULL_HANDLE;
+	VkPipeline countPipeline = VK_NULL_HANDLE, scatterPipeline = VK_NULL_HANDLE;
+	VkPipeline scanPipelines[3] = {}; // prefix sum over the cells: scan each group, scan the group totals, add them back
+
+	// per copy, so an update is recorded while the other copy's may still run
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffers[COPIES] = {};
+	VkFence fences[COPIES] = {};
+	VkSemaphore simulatedSemaphores[COPIES] = {}, drawnSemaphores[COPIES] = {};
+	bool drawPending[COPIES] = {}; // a frame was told to signal the copy's drawn semaphore
+
+	// start, grid built and simulated per copy, read back once the copy's fence is waited on again
+	VkQueryPool timestampPool = VK_NULL_HANDLE;
+	bool timestampsSupported = false, timestampsWritten[COPIES] = {};
+	float timestampPeriod = 1.0f; // nanoseconds per tick
+	float gridTime = 0.0f, simulateTime = 0.0f;
+
+	bool isBuilt = false;
+
+	void createBuffers();
+	void createDescriptorSets();
+	void createPipelines();
+	void createSyncObjects();
+	VkPipeline createPipeline(const char* path, const VkSpecializationInfo* specialization = nullptr);
+
+	// makes one stage's writes visible to the next
+	void computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess);
+};
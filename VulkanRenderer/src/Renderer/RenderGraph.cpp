@@ -0,0 +1,1090 @@
+#include "RenderGraph.h"
+#include <algorithm>
+
+static bool isDepthFormat(VkFormat format)
+{
+	return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT ||
+		format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+static bool hasStencil(VkFormat format)
+{
+	return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+static VkImageAspectFlags getAspect(VkFormat format)
+{
+	if (!isDepthFormat(format))
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+
+	return hasStencil(format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+// declarations
+uint32_t RenderGraph::createImage(const std::string& name, VkFormat format, VkExtent2D extent, VkSampleCountFlagBits samples, uint32_t layers)
+{
+	uint32_t index = addResource(name, ResourceType::IMAGE);
+	resources[index].format = format;
+	resources[index].extent = extent;
+	resources[index].samples = samples;
+	resources[index].layers = std::max(layers, 1u);
+	return index;
+}
+
+uint32_t RenderGraph::importSwapChain(const VulkanSwapChain& swapChain)
+{
+	uint32_t index = addResource("Swap Chain", ResourceType::SWAPCHAIN);
+	resources[index].format = swapChain.swapChainImageFormat;
+	resources[index].extent = swapChain.swapChainDimensions;
+	resources[index].images = swapChain.swapChainImages;
+	resources[index].views = swapChain.swapChainImageViews;
+	return index;
+}
+
+uint32_t RenderGraph::importBuffer(const std::string& name, VkBuffer buffer)
+{
+	uint32_t index = addResource(name, ResourceType::BUFFER);
+	resources[index].buffer = buffer;
+	return index;
+}
+
+uint32_t RenderGraph::addGraphicsPass(const std::string& name, const PassCallback& callback)
+{
+	return addPass(name, false, callback);
+}
+
+uint32_t RenderGraph::addComputePass(const std::string& name, const PassCallback& callback)
+{
+	return addPass(name, true, callback);
+}
+
+void RenderGraph::setRunCondition(uint32_t pass, const Condition& condition)
+{
+	passes[pass].runCondition = condition;
+}
+
+void RenderGraph::setViewCount(uint32_t pass, uint32_t viewCount)
+{
+	if (passes[pass].isCompute)
+		throw std::runtime_error("Compute pass " + passes[pass].name + " can't use multiview");
+
+	// one bit per view in the view mask
+	if (viewCount == 0 || viewCount > 32)
+		throw std::runtime_error("Pass " + passes[pass].name + " needs between 1 and 32 views");
+
+	passes[pass].viewCount = viewCount;
+}
+
+void RenderGraph::writeColor(uint32_t pass, uint32_t image, std::optional<VkClearValue> clear)
+{
+	// blending reads the attachment too
+	addAccess(pass, { image, AccessType::COLOR, true, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+		VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, clear });
+}
+
+void RenderGraph::writeDepth(uint32_t pass, uint32_t image, std::optional<VkClearValue> clear)
+{
+	addAccess(pass, { image, AccessType::DEPTH, true, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, clear });
+}
+
+void RenderGraph::writeStencil(uint32_t pass, uint32_t image)
+{
+	if (!hasStencil(resources[image].format))
+		throw std::runtime_error("Render graph image " + resources[image].name + " has no stencil to write");
+
+	addAccess(pass, { image, AccessType::DEPTH, true, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR,
+		VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL });
+}
+
+void RenderGraph::writeResolve(uint32_t pass, uint32_t image)
+{
+	addAccess(pass, { image, AccessType::RESOLVE, true, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+}
+
+void RenderGraph::readTexture(uint32_t pass, uint32_t image, VkPipelineStageFlags2KHR stages, const Condition& condition)
+{
+	addAccess(pass, { image, AccessType::TEXTURE, false, stages, VK_ACCESS_2_SHADER_READ_BIT_KHR,
+		getReadLayout(image), std::nullopt, condition });
+}
+
+void RenderGraph::readAttachment(uint32_t pass, uint32_t image)
+{
+	addAccess(pass, { image, AccessType::INPUT, false, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_INPUT_ATTACHMENT_READ_BIT_KHR,
+		getReadLayout(image) });
+}
+
+void RenderGraph::readBuffer(uint32_t pass, uint32_t buffer, VkPipelineStageFlags2KHR stages, VkAccessFlags2KHR access)
+{
+	addAccess(pass, { buffer, AccessType::BUFFER, false, stages, access, VK_IMAGE_LAYOUT_UNDEFINED });
+}
+
+void RenderGraph::writeBuffer(uint32_t pass, uint32_t buffer, VkPipelineStageFlags2KHR stages, VkAccessFlags2KHR access)
+{
+	addAccess(pass, { buffer, AccessType::BUFFER, true, stages, access, VK_IMAGE_LAYOUT_UNDEFINED });
+}
+
+VkImageLayout RenderGraph::getReadLayout(uint32_t image)
+{
+	// input attachments take the layout of a depth/stencil use in the same subpass, see compile()
+	for (const Pass& pass : passes)
+	{
+		for (const Access& access : pass.accesses)
+		{
+			if (access.resource == image && access.type == AccessType::INPUT)
+				return access.layout;
+		}
+	}
+
+	return isDepthFormat(resources[image].format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+uint32_t RenderGraph::addResource(const std::string& name, ResourceType type)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.type = type;
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, bool isCompute, const PassCallback& callback)
+{
+	Pass pass = {};
+	pass.name = name;
+	pass.isCompute = isCompute;
+	pass.callback = callback;
+	passes.push_back(pass);
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void RenderGraph::addAccess(uint32_t pass, const Access& access)
+{
+	if (passes[pass].isCompute && access.type != AccessType::TEXTURE && access.type != AccessType::BUFFER)
+		throw std::runtime_error("Compute pass " + passes[pass].name + " can't use attachments");
+
+	passes[pass].accesses.push_back(access);
+
+	Resource& resource = resources[access.resource];
+	resource.firstPass = std::min(resource.firstPass, pass);
+	resource.lastPass = std::max(resource.lastPass, pass);
+}
+
+// whether a pass after the given one depends on the resource's contents, by reading it or loading it as an attachment
+bool RenderGraph::isReadAfter(uint32_t pass, uint32_t resource)
+{
+	for (uint32_t i = pass + 1; i < passes.size(); i++)
+	{
+		for (const Access& access : passes[i].accesses)
+		{
+			if (access.resource != resource)
+				continue;
+
+			bool loads = (access.type == AccessType::COLOR || access.type == AccessType::DEPTH) && !access.clear.has_value();
+			if (!access.isWrite || loads)
+				return true;
+
+			// fully overwritten, nothing later can see the old contents
+			if (access.type != AccessType::BUFFER)
+				return false;
+		}
+	}
+
+	return false;
+}
+
+bool RenderGraph::isAttachment(AccessType type)
+{
+	return type == AccessType::COLOR || type == AccessType::DEPTH || type == AccessType::RESOLVE || type == AccessType::INPUT;
+}
+
+// the last pass in the same render pass as the given one
+uint32_t RenderGraph::getLastSubpass(uint32_t pass)
+{
+	uint32_t first = passes[pass].firstSubpass;
+	return first + passes[first].subpassCount - 1;
+}
+
+// compilation
+void RenderGraph::compile()
+{
+	for (Resource& resource : resources)
+	{
+		if (resource.type == ResourceType::IMAGE && resource.firstPass == UINT32_MAX)
+			throw std::runtime_error("Render graph image " + resource.name + " is never used");
+	}
+
+	// an attachment can only have one layout within a subpass. depth read as an input attachment while the subpass
+	// also tests it (writeStencil) takes the depth/stencil layout, whose depth aspect is read only
+	for (Pass& pass : passes)
+	{
+		for (Access& input : pass.accesses)
+		{
+			if (input.type != AccessType::INPUT)
+				continue;
+
+			for (const Access& access : pass.accesses)
+			{
+				if (access.type == AccessType::DEPTH && access.resource == input.resource)
+					input.layout = access.layout;
+			}
+		}
+	}
+
+	// whatever a skippable pass writes has to survive the frames it's skipped in
+	for (const Pass& pass : passes)
+	{
+		if (!pass.runCondition)
+			continue;
+
+		for (const Access& access : pass.accesses)
+		{
+			if (!access.isWrite || resources[access.resource].type != ResourceType::IMAGE)
+				continue;
+
+			// the layout the image was left in is only known after the pass ran once, a clear doesn't care
+			if (!access.clear.has_value())
+				throw std::runtime_error("Pass " + pass.name + " has a run condition, so it has to clear " + resources[access.resource].name);
+
+			resources[access.resource].isPersistent = true;
+		}
+	}
+
+	mergeSubpasses();
+	createImages();
+
+	for (uint32_t i = 0; i < passes.size(); i++)
+	{
+		if (!passes[i].isCompute && passes[i].firstSubpass == i)
+			createRenderPass(i);
+	}
+
+	needsCulling = true;
+	cullPasses();
+}
+
+void RenderGraph::mergeSubpasses()
+{
+	for (uint32_t i = 0; i < passes.size(); i++)
+	{
+		Pass& pass = passes[i];
+		pass.firstSubpass = i;
+		pass.subpass = 0;
+		pass.subpassCount = 1;
+
+		bool readsAttachments = std::any_of(pass.accesses.begin(), pass.accesses.end(),
+			[](const Access& access) { return access.type == AccessType::INPUT; });
+
+		if (!readsAttachments)
+			continue;
+
+		if (i == 0 || passes[i - 1].isCompute)
+			throw std::runtime_error("Pass " + pass.name + " reads input attachments without a graphics pass before it");
+
+		// merged passes run together
+		if (pass.runCondition || passes[i - 1].runCondition)
+			throw std::runtime_error("Pass " + pass.name + " can't share a render pass with a pass that has a run condition");
+
+		// subpasses of one render pass either all use multiview or none do
+		if ((pass.viewCount > 1) != (passes[i - 1].viewCount > 1))
+			throw std::runtime_error("Pass " + pass.name + " can't share a render pass with a pass of a different view count");
+
+		pass.firstSubpass = passes[i - 1].firstSubpass;
+		pass.subpass = passes[i - 1].subpass + 1;
+		passes[pass.firstSubpass].subpassCount++;
+	}
+}
+
+void RenderGraph::createImages()
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	std::vector<uint32_t> images;
+	std::vector<VkMemoryRequirements> requirements(resources.size());
+
+	for (uint32_t i = 0; i < resources.size(); i++)
+	{
+		Resource& resource = resources[i];
+		if (resource.type != ResourceType::IMAGE)
+			continue;
+
+		for (const Pass& pass : passes)
+		{
+			for (const Access& access : pass.accesses)
+			{
+				if (access.resource != i)
+					continue;
+
+				if (access.type == AccessType::COLOR || access.type == AccessType::RESOLVE)
+					resource.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+				else if (access.type == AccessType::DEPTH)
+					resource.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+				else if (access.type == AccessType::INPUT)
+					resource.usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+				else if (access.type == AccessType::TEXTURE)
+					resource.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+			}
+		}
+
+		// attachments that never outlive their render pass, e.g. multisampled targets that are resolved right away
+		// or a g-buffer read by the next subpass
+		bool outlivesRenderPass = isReadAfter(getLastSubpass(resource.firstPass), i);
+		if (!outlivesRenderPass && (resource.usage & VK_IMAGE_USAGE_SAMPLED_BIT) == 0)
+			resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+		VkImageCreateInfo imageInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { resource.extent.width, resource.extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = resource.layers;
+		imageInfo.format = resource.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = resource.usage;
+		imageInfo.samples = resource.samples;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		// memory is bound once every image's requirements are known
+		if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create render graph image " + resource.name);
+
+		vkGetImageMemoryRequirements(device, resource.image, &requirements[i]);
+		requiredMemory += requirements[i].size;
+		images.push_back(i);
+	}
+
+	// largest first, each image goes into the first block whose images are all dead by the time it's first used
+	// (or not yet alive when it's last used). every image is bound at offset 0, which satisfies any alignment.
+	// transient images get blocks of their own, which can be lazily allocated
+	std::sort(images.begin(), images.end(), [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+
+	struct Block
+	{
+		VkDeviceSize size;
+		uint32_t memoryTypeBits;
+		bool isTransient;
+		std::vector<uint32_t> images;
+	};
+	std::vector<Block> blocks;
+
+	for (uint32_t image : images)
+	{
+		const Resource& resource = resources[image];
+		bool isTransient = (resource.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+		Block* found = nullptr;
+
+		for (Block& block : blocks)
+		{
+			if ((block.memoryTypeBits & requirements[image].memoryTypeBits) == 0 || block.isTransient != isTransient)
+				continue;
+
+			bool overlaps = false;
+			for (uint32_t other : block.images)
+			{
+				if (resource.firstPass <= resources[other].lastPass && resources[other].firstPass <= resource.lastPass)
+					overlaps = true;
+				if (resource.isPersistent || resources[other].isPersistent)
+					overlaps = true;
+			}
+
+			if (!overlaps)
+			{
+				found = &block;
+				break;
+			}
+		}
+
+		if (found == nullptr)
+		{
+			blocks.push_back({ 0, requirements[image].memoryTypeBits, isTransient, {} });
+			found = &blocks.back();
+		}
+
+		found->size = std::max(found->size, requirements[image].size);
+		found->memoryTypeBits &= requirements[image].memoryTypeBits;
+		found->images.push_back(image);
+	}
+
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(VulkanDevice::GetVulkanDevice()->GetPhysicalDevice(), &memProperties);
+
+	for (const Block& block : blocks)
+	{
+		// desktop GPUs have no lazily allocated memory, there transient images just get device local memory
+		uint32_t typeIndex = UINT32_MAX;
+		bool isLazy = false;
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+		{
+			VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+			if ((block.memoryTypeBits & (1 << i)) == 0 || (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == 0)
+				continue;
+
+			bool lazy = (flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+			if (lazy && !block.isTransient)
+				continue;
+
+			if (typeIndex == UINT32_MAX || (lazy && !isLazy))
+			{
+				typeIndex = i;
+				isLazy = lazy;
+			}
+		}
+
+		if (typeIndex == UINT32_MAX)
+			throw std::runtime_error("No device local memory for render graph images");
+
+		VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+		allocInfo.allocationSize = block.size;
+		allocInfo.memoryTypeIndex = typeIndex;
+
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate render graph memory");
+
+		allocatedMemory += block.size;
+		if (isLazy)
+			lazilyAllocatedMemory += block.size;
+
+		for (uint32_t image : block.images)
+		{
+			Resource& resource = resources[image];
+			resource.memoryBlock = static_cast<uint32_t>(memoryBlocks.size());
+
+			if (vkBindImageMemory(device, resource.image, memory, 0) != VK_SUCCESS)
+				throw std::runtime_error("Failed to bind render graph image memory");
+
+			// layered images are attached with every layer, multiview picks a layer per view
+			VkImageViewType viewType = resource.layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+			HelperFunctions::createImageView(resource.image, resource.view, resource.format, getAspect(resource.format), viewType, 1, resource.layers);
+
+			// only one aspect can be sampled or read as an input attachment at a time
+			resource.sampledView = resource.view;
+			if (hasStencil(resource.format) && (resource.usage & (VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT)))
+				HelperFunctions::createImageView(resource.image, resource.sampledView, resource.format, VK_IMAGE_ASPECT_DEPTH_BIT, viewType, 1, resource.layers);
+		}
+
+		memoryBlocks.push_back(memory);
+	}
+}
+
+void RenderGraph::createRenderPass(uint32_t firstPass)
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+	Pass& pass = passes[firstPass];
+	uint32_t lastPass = firstPass + pass.subpassCount - 1;
+
+	struct SubpassReferences
+	{
+		std::vector<VkAttachmentReference> colors, resolves, inputs;
+		VkAttachmentReference depth = {};
+		bool hasDepth = false;
+		std::vector<uint32_t> used, preserved;
+	};
+	std::vector<SubpassReferences> references(pass.subpassCount);
+
+	std::vector<VkAttachmentDescription> attachments;
+	std::vector<uint32_t> attachmentResources;
+	std::vector<VkSubpassDependency> dependencies;
+
+	// the subpasses each attachment is used in, and its latest use, for the dependencies between subpasses
+	std::vector<uint32_t> firstUse, lastUse;
+	std::vector<const Access*> lastAccess;
+
+	// views of every attachment, the swap chain's are filled in per image below
+	std::vector<VkImageView> views;
+	uint32_t swapChainAttachment = UINT32_MAX, swapChainResource = UINT32_MAX;
+
+	for (uint32_t subpass = 0; subpass < pass.subpassCount; subpass++)
+	{
+		for (const Access& access : passes[firstPass + subpass].accesses)
+		{
+			if (!isAttachment(access.type))
+				continue;
+
+			const Resource& resource = resources[access.resource];
+			uint32_t attachmentIndex = static_cast<uint32_t>(
+				std::find(attachmentResources.begin(), attachmentResources.end(), access.resource) - attachmentResources.begin());
+
+			if (attachmentIndex == attachments.size())
+			{
+				if (attachments.empty())
+					pass.extent = resource.extent;
+				else if (resource.extent.width != pass.extent.width || resource.extent.height != pass.extent.height)
+					throw std::runtime_error("Attachments of pass " + pass.name + " differ in size");
+
+				if (resource.type == ResourceType::IMAGE && resource.layers < passes[firstPass + subpass].viewCount)
+					throw std::runtime_error("Attachment " + resource.name + " has fewer layers than pass " + pass.name + " has views");
+
+				// contents nobody wrote yet are never loaded, and contents nobody reads after the render pass are never stored
+				bool writtenBefore = resource.type != ResourceType::IMAGE || resource.firstPass < firstPass;
+				bool stored = resource.type != ResourceType::IMAGE || isReadAfter(lastPass, access.resource);
+
+				VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				if (access.clear.has_value())
+					loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				else if (access.type != AccessType::RESOLVE && writtenBefore)
+					loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+				VkAttachmentStoreOp storeOp = stored ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+				// the graph's barriers move attachments into the layout of their first subpass
+				VkAttachmentDescription description = {};
+				description.format = resource.format;
+				description.samples = resource.samples;
+				description.loadOp = loadOp;
+				description.storeOp = storeOp;
+				description.stencilLoadOp = hasStencil(resource.format) ? loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				description.stencilStoreOp = hasStencil(resource.format) ? storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				description.initialLayout = access.layout;
+				description.finalLayout = access.layout;
+				attachments.push_back(description);
+				attachmentResources.push_back(access.resource);
+
+				firstUse.push_back(subpass);
+				lastUse.push_back(subpass);
+				lastAccess.push_back(nullptr);
+
+				VkClearValue clearValue = {};
+				pass.clearValues.push_back(access.clear.value_or(clearValue));
+
+				if (resource.type == ResourceType::SWAPCHAIN)
+				{
+					swapChainAttachment = attachmentIndex;
+					swapChainResource = access.resource;
+				}
+				views.push_back(resource.view);
+			}
+
+			// between subpasses the render pass does the layout transitions itself
+			attachments[attachmentIndex].finalLayout = access.layout;
+
+			VkAttachmentReference reference = { attachmentIndex, access.layout };
+			SubpassReferences& subpassReferences = references[subpass];
+			if (access.type == AccessType::COLOR)
+				subpassReferences.colors.push_back(reference);
+			else if (access.type == AccessType::RESOLVE)
+				subpassReferences.resolves.push_back(reference);
+			else if (access.type == AccessType::INPUT)
+				subpassReferences.inputs.push_back(reference);
+			else
+			{
+				subpassReferences.depth = reference;
+				subpassReferences.hasDepth = true;
+			}
+			subpassReferences.used.push_back(attachmentIndex);
+
+			// an earlier subpass's use has to finish first, but only at the same pixel
+			const Access* previous = lastAccess[attachmentIndex];
+			if (previous != nullptr && lastUse[attachmentIndex] != subpass)
+			{
+				uint32_t srcSubpass = lastUse[attachmentIndex];
+				auto dependency = std::find_if(dependencies.begin(), dependencies.end(),
+					[&](const VkSubpassDependency& d) { return d.srcSubpass == srcSubpass && d.dstSubpass == subpass; });
+
+				if (dependency == dependencies.end())
+				{
+					dependencies.push_back({ srcSubpass, subpass, 0, 0, 0, 0, VK_DEPENDENCY_BY_REGION_BIT });
+					dependency = dependencies.end() - 1;
+				}
+
+				// every stage and access bit used here has the same value in both versions
+				dependency->srcStageMask |= static_cast<VkPipelineStageFlags>(previous->stages);
+				dependency->dstStageMask |= static_cast<VkPipelineStageFlags>(access.stages);
+				dependency->srcAccessMask |= previous->isWrite ? static_cast<VkAccessFlags>(previous->access) : 0;
+				dependency->dstAccessMask |= static_cast<VkAccessFlags>(access.access);
+			}
+
+			lastAccess[attachmentIndex] = &access;
+			lastUse[attachmentIndex] = subpass;
+		}
+	}
+
+	std::vector<VkSubpassDescription> subpasses(pass.subpassCount);
+
+	for (uint32_t subpass = 0; subpass < pass.subpassCount; subpass++)
+	{
+		SubpassReferences& subpassReferences = references[subpass];
+		const std::string& name = passes[firstPass + subpass].name;
+
+		if (!subpassReferences.resolves.empty() && (subpassReferences.colors.empty() || subpassReferences.resolves.size() > 1))
+			throw std::runtime_error("Pass " + name + " must resolve exactly its first color attachment");
+
+		// resolve references run parallel to the color references
+		while (!subpassReferences.resolves.empty() && subpassReferences.resolves.size() < subpassReferences.colors.size())
+			subpassReferences.resolves.push_back({ VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+
+		// attachments used before and after this subpass have to survive it
+		for (uint32_t i = 0; i < attachments.size(); i++)
+		{
+			bool used = std::find(subpassReferences.used.begin(), subpassReferences.used.end(), i) != subpassReferences.used.end();
+			if (!used && firstUse[i] < subpass && subpass < lastUse[i])
+				subpassReferences.preserved.push_back(i);
+		}
+
+		VkSubpassDescription& description = subpasses[subpass];
+		description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		description.colorAttachmentCount = static_cast<uint32_t>(subpassReferences.colors.size());
+		description.pColorAttachments = subpassReferences.colors.data();
+		description.pResolveAttachments = subpassReferences.resolves.empty() ? nullptr : subpassReferences.resolves.data();
+		description.pDepthStencilAttachment = subpassReferences.hasDepth ? &subpassReferences.depth : nullptr;
+		description.inputAttachmentCount = static_cast<uint32_t>(subpassReferences.inputs.size());
+		description.pInputAttachments = subpassReferences.inputs.data();
+		description.preserveAttachmentCount = static_cast<uint32_t>(subpassReferences.preserved.size());
+		description.pPreserveAttachments = subpassReferences.preserved.data();
+	}
+
+	VkRenderPassCreateInfo renderPassInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
+	renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+	renderPassInfo.pSubpasses = subpasses.data();
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
+
+	// every subpass broadcasts its draws to the first viewCount layers of its attachments
+	std::vector<uint32_t> viewMasks(pass.subpassCount);
+	for (uint32_t subpass = 0; subpass < pass.subpassCount; subpass++)
+		viewMasks[subpass] = static_cast<uint32_t>((uint64_t(1) << passes[firstPass + subpass].viewCount) - 1);
+
+	VkRenderPassMultiviewCreateInfo multiviewInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO };
+	multiviewInfo.subpassCount = pass.subpassCount;
+	multiviewInfo.pViewMasks = viewMasks.data();
+	if (pass.viewCount > 1)
+		renderPassInfo.pNext = &multiviewInfo;
+
+	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create render pass for " + pass.name);
+
+	for (uint32_t i = firstPass + 1; i <= lastPass; i++)
+		passes[i].renderPass = pass.renderPass;
+
+	VkFramebufferCreateInfo framebufferInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+	framebufferInfo.renderPass = pass.renderPass;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+	framebufferInfo.pAttachments = views.data();
+	framebufferInfo.width = pass.extent.width;
+	framebufferInfo.height = pass.extent.height;
+	framebufferInfo.layers = 1;
+
+	// passes drawing to the swap chain need a framebuffer per swap chain image
+	size_t framebufferCount = swapChainResource == UINT32_MAX ? 1 : resources[swapChainResource].views.size();
+	pass.framebuffers.resize(framebufferCount);
+
+	for (size_t i = 0; i < framebufferCount; i++)
+	{
+		if (swapChainResource != UINT32_MAX)
+			views[swapChainAttachment] = resources[swapChainResource].views[i];
+
+		if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &pass.framebuffers[i]) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create framebuffer for " + pass.name);
+	}
+}
+
+// culling and barriers
+bool RenderGraph::cullPasses()
+{
+	bool conditionsChanged = false;
+	for (Pass& pass : passes)
+	{
+		if (pass.runCondition)
+		{
+			bool enabled = pass.runCondition();
+			conditionsChanged |= enabled != pass.runEnabled;
+			pass.runEnabled = enabled;
+		}
+
+		for (Access& access : pass.accesses)
+		{
+			if (!access.condition)
+				continue;
+
+			bool enabled = access.condition();
+			conditionsChanged |= enabled != access.isEnabled;
+			access.isEnabled = enabled;
+		}
+	}
+
+	if (!conditionsChanged && !needsCulling)
+		return false;
+
+	needsCulling = false;
+
+	// walk backwards from the passes writing imported resources. a pass is live when a later live pass
+	// depends on something it writes. merged passes share a render pass, so they're culled together
+	std::vector<bool> needed(resources.size(), false);
+	bool liveChanged = false;
+
+	for (int32_t last = static_cast<int32_t>(passes.size()) - 1; last >= 0;)
+	{
+		int32_t first = static_cast<int32_t>(passes[last].firstSubpass);
+
+		bool live = false;
+		for (int32_t i = first; i <= last; i++)
+		{
+			for (const Access& access : passes[i].accesses)
+			{
+				if (access.isWrite && (resources[access.resource].type != ResourceType::IMAGE || needed[access.resource]))
+					live = true;
+			}
+		}
+
+		// a skipped pass's readers get what it wrote in an earlier frame, nothing written before it this frame
+		// (passes with a run condition are never merged)
+		if (!passes[first].runEnabled)
+		{
+			for (const Access& access : passes[first].accesses)
+			{
+				if (access.isWrite)
+					needed[access.resource] = false;
+			}
+			live = false;
+		}
+
+		for (int32_t i = last; i >= first; i--)
+		{
+			Pass& pass = passes[i];
+
+			for (const Access& access : pass.accesses)
+			{
+				if (!live || !access.isEnabled)
+					continue;
+
+				// cleared or resolved attachments don't depend on earlier writers, loaded ones do
+				bool overwrites = access.type == AccessType::RESOLVE || access.clear.has_value();
+				if (access.isWrite && overwrites)
+					needed[access.resource] = false;
+				else
+					needed[access.resource] = true;
+			}
+
+			liveChanged |= live != pass.live;
+			pass.live = live;
+		}
+
+		last = first - 1;
+	}
+
+	buildBarriers();
+	return liveChanged;
+}
+
+void RenderGraph::buildBarriers()
+{
+	// a frame's first access to a resource waits on the previous frame's last one, so run through the frame
+	// once to find where everything ends up, then again from there to record the barriers
+	std::vector<SyncState> states(resources.size()), blockStates(memoryBlocks.size());
+	simulate(states, blockStates, false);
+	simulate(states, blockStates, true);
+}
+
+void RenderGraph::simulate(std::vector<SyncState>& states, std::vector<SyncState>& blockStates, bool record)
+{
+	for (SyncState& state : states)
+		state.touched = false;
+
+	for (Pass& pass : passes)
+		pass.barriers.barriers.clear();
+
+	// the render pass each attachment was last used in. within one, subpass dependencies take the place of barriers
+	std::vector<uint32_t> renderPasses(resources.size(), UINT32_MAX);
+
+	for (Pass& pass : passes)
+	{
+		if (!pass.live)
+			continue;
+
+		for (const Access& access : pass.accesses)
+		{
+			if (!access.isEnabled)
+				continue;
+
+			const Resource& resource = resources[access.resource];
+			SyncState& state = states[access.resource];
+
+			bool insideRenderPass = isAttachment(access.type) && renderPasses[access.resource] == pass.firstSubpass;
+			if (isAttachment(access.type))
+				renderPasses[access.resource] = pass.firstSubpass;
+
+			// graph images and the swap chain start every frame with discarded contents. graph images wait for
+			// the last use of their memory, which is another image's when it's aliased. swap chain images only
+			// wait for the acquire semaphore, which is waited on at color attachment output. persistent images
+			// carry their state over from the last frame
+			if (!state.touched && resource.type == ResourceType::IMAGE && !resource.isPersistent)
+			{
+				const SyncState& block = blockStates[resource.memoryBlock];
+				state = SyncState();
+				state.writeStages = block.writeStages | block.readStages;
+				state.writeAccess = block.writeAccess;
+			}
+			else if (!state.touched && resource.type == ResourceType::SWAPCHAIN)
+			{
+				state = SyncState();
+				state.writeStages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
+			}
+			state.touched = true;
+
+			BarrierBatch::Barrier barrier = { access.resource, 0, access.stages, 0, access.access, state.layout, access.layout };
+
+			// cleared anyway, and right after compile() the image isn't in the layout the last frame left it in
+			if (resource.isPersistent && access.isWrite && access.clear.has_value())
+				barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			bool layoutChange = resource.type != ResourceType::BUFFER && access.layout != state.layout;
+			bool needsBarrier = false;
+
+			if (access.isWrite)
+			{
+				// write after write and write after read
+				barrier.srcStages = state.writeStages | state.readStages;
+				barrier.srcAccess = state.writeAccess;
+				needsBarrier = layoutChange || barrier.srcStages != 0;
+
+				state.writeStages = access.stages;
+				state.writeAccess = access.access;
+				state.readStages = 0;
+				state.visibleStages = 0;
+			}
+			else if (layoutChange)
+			{
+				// the transition is a write of its own, later readers only have to wait for these stages
+				barrier.srcStages = state.writeStages | state.readStages;
+				barrier.srcAccess = state.writeAccess;
+				needsBarrier = true;
+
+				state.writeStages = access.stages;
+				state.writeAccess = 0;
+				state.readStages = access.stages;
+				state.visibleStages = access.stages;
+			}
+			else
+			{
+				// read after write, unless an earlier barrier already made the write visible to these stages
+				if ((access.stages & ~state.visibleStages) != 0 && state.writeStages != 0)
+				{
+					barrier.srcStages = state.writeStages;
+					barrier.srcAccess = state.writeAccess;
+					needsBarrier = true;
+					state.visibleStages |= access.stages;
+				}
+
+				state.readStages |= access.stages;
+			}
+
+			state.layout = access.layout;
+
+			if (resource.type == ResourceType::IMAGE)
+				blockStates[resource.memoryBlock] = state;
+
+			// a later subpass's barriers go before the render pass begins
+			if (record && needsBarrier && !insideRenderPass)
+				passes[pass.firstSubpass].barriers.barriers.push_back(barrier);
+		}
+	}
+
+	if (record)
+	{
+		finalBarriers.barriers.clear();
+
+		for (uint32_t i = 0; i < resources.size(); i++)
+		{
+			const SyncState& state = states[i];
+			if (resources[i].type != ResourceType::SWAPCHAIN || !state.touched)
+				continue;
+
+			finalBarriers.barriers.push_back({ i, state.writeStages | state.readStages, VK_PIPELINE_STAGE_2_NONE_KHR,
+				state.writeAccess, VK_ACCESS_2_NONE_KHR, state.layout, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR });
+		}
+	}
+}
+
+// execution
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	for (Pass& pass : passes)
+	{
+		if (!pass.live)
+			continue;
+
+		recordBarriers(commandBuffer, pass.barriers, imageIndex);
+
+		PassContext context = {};
+		context.commandBuffer = commandBuffer;
+		context.imageIndex = imageIndex;
+
+		if (!pass.isCompute)
+		{
+			const Pass& first = passes[pass.firstSubpass];
+
+			context.beginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+			context.beginInfo.renderPass = first.renderPass;
+			context.beginInfo.framebuffer = first.framebuffers.size() > 1 ? first.framebuffers[imageIndex] : first.framebuffers[0];
+			context.beginInfo.renderArea.offset = { 0, 0 };
+			context.beginInfo.renderArea.extent = first.extent;
+			context.beginInfo.clearValueCount = static_cast<uint32_t>(first.clearValues.size());
+			context.beginInfo.pClearValues = first.clearValues.data();
+			context.subpass = pass.subpass;
+			context.subpassCount = first.subpassCount;
+		}
+
+		pass.callback(context);
+	}
+
+	recordBarriers(commandBuffer, finalBarriers, imageIndex);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch, uint32_t imageIndex)
+{
+	if (batch.barriers.empty())
+		return;
+
+	std::vector<VkImageMemoryBarrier2KHR> imageBarriers;
+	std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers;
+
+	for (const BarrierBatch::Barrier& barrier : batch.barriers)
+	{
+		const Resource& resource = resources[barrier.resource];
+
+		if (resource.type == ResourceType::BUFFER)
+		{
+			VkBufferMemoryBarrier2KHR bufferBarrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR };
+			bufferBarrier.srcStageMask = barrier.srcStages;
+			bufferBarrier.srcAccessMask = barrier.srcAccess;
+			bufferBarrier.dstStageMask = barrier.dstStages;
+			bufferBarrier.dstAccessMask = barrier.dstAccess;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = resource.buffer;
+			bufferBarrier.offset = 0;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(bufferBarrier);
+			continue;
+		}
+
+		VkImageMemoryBarrier2KHR imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+		imageBarrier.srcStageMask = barrier.srcStages;
+		imageBarrier.srcAccessMask = barrier.srcAccess;
+		imageBarrier.dstStageMask = barrier.dstStages;
+		imageBarrier.dstAccessMask = barrier.dstAccess;
+		imageBarrier.oldLayout = barrier.oldLayout;
+		imageBarrier.newLayout = barrier.newLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = getImage(barrier.resource, imageIndex);
+		imageBarrier.subresourceRange = { getAspect(resource.format), 0, 1, 0, VK_REMAINING_ARRAY_LAYERS };
+		imageBarriers.push_back(imageBarrier);
+	}
+
+	// an extension function, so it isn't exported by the loader
+	static PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2 = VulkanDevice::GetVulkanDevice()->IsSynchronization2Supported() ?
+		reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(VulkanDevice::GetVulkanDevice()->GetLogicalDevice(), "vkCmdPipelineBarrier2KHR")) :
+		nullptr;
+
+	if (cmdPipelineBarrier2 != nullptr)
+	{
+		VkDependencyInfoKHR dependencyInfo = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+		dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+		dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+		dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+		dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+
+		cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		return;
+	}
+
+	// without synchronization2 the batch becomes one vkCmdPipelineBarrier with the union of the stages. every
+	// stage and access bit the graph uses has the same value in both versions
+	VkPipelineStageFlags srcStages = 0, dstStages = 0;
+	std::vector<VkImageMemoryBarrier> legacyImageBarriers;
+	std::vector<VkBufferMemoryBarrier> legacyBufferBarriers;
+
+	for (const VkImageMemoryBarrier2KHR& barrier : imageBarriers)
+	{
+		srcStages |= static_cast<VkPipelineStageFlags>(barrier.srcStageMask);
+		dstStages |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+
+		VkImageMemoryBarrier legacy = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		legacy.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+		legacy.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+		legacy.oldLayout = barrier.oldLayout;
+		legacy.newLayout = barrier.newLayout;
+		legacy.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		legacy.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		legacy.image = barrier.image;
+		legacy.subresourceRange = barrier.subresourceRange;
+		legacyImageBarriers.push_back(legacy);
+	}
+
+	for (const VkBufferMemoryBarrier2KHR& barrier : bufferBarriers)
+	{
+		srcStages |= static_cast<VkPipelineStageFlags>(barrier.srcStageMask);
+		dstStages |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+
+		VkBufferMemoryBarrier legacy = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+		legacy.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+		legacy.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+		legacy.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		legacy.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		legacy.buffer = barrier.buffer;
+		legacy.offset = 0;
+		legacy.size = VK_WHOLE_SIZE;
+		legacyBufferBarriers.push_back(legacy);
+	}
+
+	// the legacy masks can't be empty
+	if (srcStages == 0)
+		srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	if (dstStages == 0)
+		dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr,
+		static_cast<uint32_t>(legacyBufferBarriers.size()), legacyBufferBarriers.data(),
+		static_cast<uint32_t>(legacyImageBarriers.size()), legacyImageBarriers.data());
+}
+
+VkImage RenderGraph::getImage(uint32_t resource, uint32_t imageIndex)
+{
+	return resources[resource].type == ResourceType::SWAPCHAIN ? resources[resource].images[imageIndex] : resources[resource].image;
+}
+
+void RenderGraph::destroy()
+{
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	for (uint32_t i = 0; i < passes.size(); i++)
+	{
+		Pass& pass = passes[i];
+		for (VkFramebuffer framebuffer : pass.framebuffers)
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+
+		// merged passes share the first one's render pass
+		if (pass.renderPass != VK_NULL_HANDLE && pass.firstSubpass == i)
+			vkDestroyRenderPass(device, pass.renderPass, nullptr);
+	}
+
+	for (Resource& resource : resources)
+	{
+		if (resource.type != ResourceType::IMAGE)
+			continue;
+
+		if (resource.sampledView != resource.view)
+			vkDestroyImageView(device, resource.sampledView, nullptr);
+		if (resource.view != VK_NULL_HANDLE)
+			vkDestroyImageView(device, resource.view, nullptr);
+		if (resource.image != VK_NULL_HANDLE)
+			vkDestroyImage(device, resource.image, nullptr);
+	}
+
+	for (VkDeviceMemory memory : memoryBlocks)
+		vkFreeMemory(device, memory, nullptr);
+
+	resources.clear();
+	passes.clear();
+	memoryBlocks.clear();
+	finalBarriers.barriers.clear();
+	allocatedMemory = 0;
+	requiredMemory = 0;
+	lazilyAllocatedMemory = 0;
+	needsCulling = true;
+}
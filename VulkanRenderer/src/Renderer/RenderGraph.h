@@ -0,0 +1,221 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <optional>
+#include "HelperStructs.h"
+
+// a frame described as passes and the resources they read and write, instead of hand made render passes,
+// framebuffers and subpass dependencies. passes are declared once in execution order, then compile() creates
+// everything the declarations need:
+//   - graph owned images (createImage) with the usage flags their accesses require. images whose lifetimes
+//     (first to last declared pass using them) don't overlap share one VkDeviceMemory block
+//   - a VkRenderPass and framebuffer(s) per graphics pass. attachments stay in their pass layout for the whole
+//     render pass, so render passes carry no external dependencies and only change layouts between merged subpasses
+//   - between passes, one vkCmdPipelineBarrier2KHR with every layout transition and memory dependency the next pass
+//     needs. read after read in the same layout needs nothing, so most sampled reads cost no barrier at all.
+//     without VK_KHR_synchronization2 the same batch goes through a single vkCmdPipelineBarrier
+// passes are culled when nothing that reaches an imported resource (e.g. the swap chain) depends on them. reads
+// can be conditional, so a pass whose only consumer is e.g. a hidden UI image drops out until it's shown again.
+// a pass reading input attachments becomes the next subpass of the previous pass's render pass instead of a render
+// pass of its own. subpass dependencies replace the barriers, and images that never leave that render pass stay
+// transient in lazily allocated memory, so on tiled GPUs they never leave tile memory
+class RenderGraph
+{
+public:
+	struct PassContext
+	{
+		VkCommandBuffer commandBuffer;
+		uint32_t imageIndex;
+
+		// graphics passes only. the pass begins and ends it itself, with vkCmdBeginRenderPass or
+		// ParallelRecorder::recordRenderPass. passes merged into one render pass share the begin info, the first
+		// subpass begins it, the others move on with vkCmdNextSubpass and the last one ends it
+		VkRenderPassBeginInfo beginInfo;
+		uint32_t subpass;
+		uint32_t subpassCount;
+	};
+
+	using PassCallback = std::function<void(const PassContext& context)>;
+	using Condition = std::function<bool()>;
+
+	// resources. images are recreated by compile(), imported resources belong to the caller. images with more than
+	// one layer are sampled as 2D arrays
+	uint32_t createImage(const std::string& name, VkFormat format, VkExtent2D extent, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT,
+		uint32_t layers = 1);
+	uint32_t importSwapChain(const VulkanSwapChain& swapChain);
+	uint32_t importBuffer(const std::string& name, VkBuffer buffer);
+
+	// passes run in the order they are added
+	uint32_t addGraphicsPass(const std::string& name, const PassCallback& callback);
+	uint32_t addComputePass(const std::string& name, const PassCallback& callback);
+
+	// the pass only runs while the condition is true. unlike a culled pass, a skipped pass's images keep what it
+	// wrote last, e.g. a shadow map that's only redrawn when something moved, so they never share memory. the
+	// condition must be true the first frame after compile(), the images are undefined until the pass ran once
+	void setRunCondition(uint32_t pass, const Condition& condition);
+
+	// draws of a graphics pass run once per view with multiview, view i rendering to layer i of every attachment.
+	// shaders pick the view's matrices with gl_ViewIndex, e.g. one pass for all shadow cascades
+	void setViewCount(uint32_t pass, uint32_t viewCount);
+
+	// attachments, in the order of the pass's attachment indices. without a clear value the previous contents are loaded
+	void writeColor(uint32_t pass, uint32_t image, std::optional<VkClearValue> clear = std::nullopt);
+	void writeDepth(uint32_t pass, uint32_t image, std::optional<VkClearValue> clear = std::nullopt);
+
+	// depth/stencil attachment that is only depth tested but has its stencil written, e.g. to mark light volumes.
+	// its depth can still be read with readAttachment in the same pass. the previous contents are loaded
+	void writeStencil(uint32_t pass, uint32_t image);
+
+	// multisample resolve target of the pass's first color attachment
+	void writeResolve(uint32_t pass, uint32_t image);
+
+	// sampled in the given stages. a read whose condition is false this frame doesn't count, so it neither keeps the
+	// writer alive nor gets a barrier
+	void readTexture(uint32_t pass, uint32_t image, VkPipelineStageFlags2KHR stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR,
+		const Condition& condition = nullptr);
+
+	// reads the attachment written at the same pixel by an earlier subpass. the pass is merged into the render pass
+	// of the graphics pass added right before it
+	void readAttachment(uint32_t pass, uint32_t image);
+
+	void readBuffer(uint32_t pass, uint32_t buffer, VkPipelineStageFlags2KHR stages, VkAccessFlags2KHR access);
+	void writeBuffer(uint32_t pass, uint32_t buffer, VkPipelineStageFlags2KHR stages, VkAccessFlags2KHR access);
+
+	void compile();
+
+	// re-evaluates the read conditions and culls passes. call once a frame before execute(). returns true when the
+	// set of executed passes changed, which invalidates anything cached from the previous set (see ParallelRecorder)
+	bool cullPasses();
+
+	// records the live passes with their barriers, then moves imported images to their final layout
+	void execute(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+	// destroys everything compile() created and forgets the declarations
+	void destroy();
+
+	VkRenderPass getRenderPass(uint32_t pass) { return passes[pass].renderPass; }
+	uint32_t getSubpass(uint32_t pass) { return passes[pass].subpass; }
+	VkImageView getImageView(uint32_t image) { return resources[image].sampledView; } // depth only for depth/stencil images
+	bool isPassLive(uint32_t pass) { return passes[pass].live; }
+
+	// layout an image is sampled or read as an input attachment in, for descriptor writes
+	VkImageLayout getReadLayout(uint32_t image);
+
+	// device memory of all graph images, and what it would be without aliasing. lazily allocated memory is part
+	// of the allocated memory, though it's only backed when the driver has to spill tile memory
+	VkDeviceSize getAllocatedMemory() { return allocatedMemory; }
+	VkDeviceSize getRequiredMemory() { return requiredMemory; }
+	VkDeviceSize getLazilyAllocatedMemory() { return lazilyAllocatedMemory; }
+
+private:
+	enum class ResourceType { IMAGE, SWAPCHAIN, BUFFER };
+
+	struct Resource
+	{
+		std::string name;
+		ResourceType type;
+
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = {};
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+		uint32_t layers = 1;
+		VkImageUsageFlags usage = 0;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;		  // every aspect, for attachments
+		VkImageView sampledView = VK_NULL_HANDLE; // depth only for depth/stencil formats, otherwise the same view
+		VkBuffer buffer = VK_NULL_HANDLE;
+
+		// swap chain images and views, indexed by image index
+		std::vector<VkImage> images;
+		std::vector<VkImageView> views;
+
+		// declared lifetime, used for aliasing. persistent images live across frames and are never aliased
+		uint32_t firstPass = UINT32_MAX, lastPass = 0;
+		uint32_t memoryBlock = UINT32_MAX;
+		bool isPersistent = false;
+	};
+
+	enum class AccessType { COLOR, DEPTH, RESOLVE, INPUT, TEXTURE, BUFFER };
+
+	struct Access
+	{
+		uint32_t resource;
+		AccessType type;
+		bool isWrite;
+		VkPipelineStageFlags2KHR stages;
+		VkAccessFlags2KHR access;
+		VkImageLayout layout;
+		std::optional<VkClearValue> clear;
+		Condition condition;
+		bool isEnabled = true; // condition as of the last cullPasses()
+	};
+
+	// every barrier a live pass needs before it runs
+	struct BarrierBatch
+	{
+		struct Barrier
+		{
+			uint32_t resource;
+			VkPipelineStageFlags2KHR srcStages, dstStages;
+			VkAccessFlags2KHR srcAccess, dstAccess;
+			VkImageLayout oldLayout, newLayout;
+		};
+		std::vector<Barrier> barriers;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		bool isCompute;
+		PassCallback callback;
+		std::vector<Access> accesses;
+		uint32_t viewCount = 1; // multiview when more than one
+		Condition runCondition;
+		bool runEnabled = true; // run condition as of the last cullPasses()
+
+		// merged passes share the render pass, its framebuffers and clear values belong to the first of them
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		uint32_t firstSubpass = 0; // index of the pass that begins the render pass
+		uint32_t subpass = 0, subpassCount = 1;
+		std::vector<VkFramebuffer> framebuffers; // one per swap chain image when it renders to the swap chain
+		std::vector<VkClearValue> clearValues;
+		VkExtent2D extent = {};
+
+		bool live = true;
+		BarrierBatch barriers;
+	};
+
+	// synchronization state of a resource (or an aliased memory block) while building the barriers
+	struct SyncState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2KHR writeStages = 0, readStages = 0, visibleStages = 0;
+		VkAccessFlags2KHR writeAccess = 0;
+		bool touched = false;
+	};
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<VkDeviceMemory> memoryBlocks;
+	BarrierBatch finalBarriers; // imported images to their final layout
+	VkDeviceSize allocatedMemory = 0, requiredMemory = 0, lazilyAllocatedMemory = 0;
+	bool needsCulling = true;
+
+	uint32_t addResource(const std::string& name, ResourceType type);
+	uint32_t addPass(const std::string& name, bool isCompute, const PassCallback& callback);
+	void addAccess(uint32_t pass, const Access& access);
+
+	bool isReadAfter(uint32_t pass, uint32_t resource);
+	bool isAttachment(AccessType type);
+	uint32_t getLastSubpass(uint32_t pass);
+
+	void mergeSubpasses();
+	void createImages();
+	void createRenderPass(uint32_t firstPass);
+	void buildBarriers();
+	void simulate(std::vector<SyncState>& states, std::vector<SyncState>& blockStates, bool record);
+	void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch, uint32_t imageIndex);
+
+	VkImage getImage(uint32_t resource, uint32_t imageIndex);
+};
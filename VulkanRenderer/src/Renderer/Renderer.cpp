@@ -223,6 +223,10 @@ void Renderer::RunApp()
             
             if (returnValues == VulkanReturnValues::VK_SWAPCHAIN_OUT_OF_DATE)
                 RecreateSwapChain();
+
+            // only frames that were submitted count towards recycling texture slots
+            else if (returnValues == VulkanReturnValues::VK_FUNCTION_SUCCESS)
+                TextureTable::endFrame();
         }
     }
 
@@ -0,0 +1,297 @@
+#include "ShadowAtlas.h"
+#include "Light.h"
+#include <algorithm>
+
+namespace
+{
+	// every other bit of a Morton index, the x or y of its cell
+	uint32_t compactBits(uint32_t v)
+	{
+		v &= 0x55555555;
+		v = (v | (v >> 1)) & 0x33333333;
+		v = (v | (v >> 2)) & 0x0f0f0f0f;
+		v = (v | (v >> 4)) & 0x00ff00ff;
+		v = (v | (v >> 8)) & 0x0000ffff;
+		return v;
+	}
+
+	uint32_t nextPowerOfTwo(uint32_t v)
+	{
+		uint32_t p = 1;
+		while (p < v)
+			p <<= 1;
+		return p;
+	}
+}
+
+void ShadowAtlas::build(uint32_t maxLights)
+{
+	if (maxLights == 0)
+		throw std::runtime_error("ShadowAtlas: can't build for zero lights");
+
+	this->maxLights = maxLights;
+	shadowedLights = 0;
+	tiles.clear();
+	lightTiles.assign(maxLights, { 0, 0 });
+
+	tileBuffer.bufferSize = sizeof(ShadowTile) * MAX_TILES;
+	HelperFunctions::createBuffer(tileBuffer.bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		tileBuffer.buffer, tileBuffer.bufferMemory);
+
+	lightBuffer.bufferSize = sizeof(LightTiles) * maxLights;
+	HelperFunctions::createBuffer(lightBuffer.bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		lightBuffer.buffer, lightBuffer.bufferMemory);
+
+	// no light has a shadow until the first allocate(). nothing reads the table yet, so it's written directly
+	lightBuffer.map();
+	memset(lightBuffer.mappedMemory, 0, lightBuffer.bufferSize);
+	lightBuffer.unmap();
+
+	// compares filtered over 2x2 texels where the format allows it. reads past a tile's edge are clamped in the shader
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(VulkanDevice::GetVulkanDevice()->GetPhysicalDevice(), getFormat(), &properties);
+	VkFilter filter = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	HelperFunctions::createSampler(sampler, filter, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE, 1.0f, 0.0f, 1,
+		VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings =
+	{
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+	};
+	descriptorSetLayout = Descriptors::getLayout(bindings);
+	descriptorSet = descriptorAllocator.allocate(descriptorSetLayout);
+
+	isBuilt = true;
+}
+
+void ShadowAtlas::setImage(VkImageView view, VkImageLayout layout)
+{
+	imageView = view;
+	imageLayout = layout;
+	writeDescriptorSet();
+}
+
+void ShadowAtlas::writeDescriptorSet()
+{
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = imageLayout;
+
+	Descriptors::write(descriptorSet, descriptorSetLayout, { imageInfo, tileBuffer.buffer, lightBuffer.buffer });
+}
+
+bool ShadowAtlas::allocate(VkCommandBuffer commandBuffer, const ShadowRequest* requests, uint32_t requestCount, const glm::vec3& cameraPosition,
+	float fovY, float screenHeight)
+{
+	struct Candidate
+	{
+		uint32_t request;
+		float priority;
+		uint32_t size;
+		uint32_t faces;
+	};
+
+	// what each light asks for on its own: the pixels its sphere covers on screen, vertically, times its
+	// importance. a camera inside the sphere sees it cover the whole screen
+	std::vector<Candidate> candidates;
+	float tanHalfFov = std::tan(fovY * 0.5f);
+
+	for (uint32_t i = 0; i < requestCount; i++)
+	{
+		const ShadowRequest& request = requests[i];
+		if (request.lightIndex >= maxLights)
+			throw std::runtime_error("ShadowAtlas: light index past the light table");
+
+		float distance = std::max(glm::length(request.position - cameraPosition), request.range);
+		float coverage = request.range / (distance * tanHalfFov);
+		float priority = coverage * request.importance;
+
+		if (priority <= 0.0f)
+			continue;
+
+		uint32_t size = nextPowerOfTwo(static_cast<uint32_t>(priority * screenHeight));
+		size = std::clamp(size, MIN_TILE_SIZE, MAX_TILE_SIZE);
+		candidates.push_back({ i, priority, size, request.spotAngle > 0.0f ? 1u : 6u });
+	}
+
+	std::sort(candidates.begin(), candidates.end(),
+		[](const Candidate& a, const Candidate& b) { return a.priority > b.priority; });
+
+	// the tile buffer and the views drawing it have a fixed size
+	uint32_t tileCount = 0;
+	for (uint32_t i = 0; i < candidates.size(); i++)
+	{
+		if (tileCount + candidates[i].faces > MAX_TILES)
+		{
+			candidates.resize(i);
+			break;
+		}
+
+		tileCount += candidates[i].faces;
+	}
+
+	// in cells of the smallest tile size
+	auto cellsOf = [this](const Candidate& candidate)
+		{
+			uint32_t side = candidate.size / MIN_TILE_SIZE;
+			return candidate.faces * side * side;
+		};
+
+	uint32_t usedCells = 0;
+	for (const Candidate& candidate : candidates)
+		usedCells += cellsOf(candidate);
+
+	// over budget, the least important lights halve their resolution first, once they're all at the smallest
+	// size the least important one loses its shadow
+	while (usedCells > CELLS_PER_SIDE * CELLS_PER_SIDE)
+	{
+		auto shrinkable = std::find_if(candidates.rbegin(), candidates.rend(),
+			[this](const Candidate& candidate) { return candidate.size > MIN_TILE_SIZE; });
+
+		if (shrinkable != candidates.rend())
+		{
+			usedCells -= cellsOf(*shrinkable);
+			shrinkable->size /= 2;
+			usedCells += cellsOf(*shrinkable);
+		}
+
+		else
+		{
+			usedCells -= cellsOf(candidates.back());
+			candidates.pop_back();
+		}
+	}
+
+	// biggest first, every tile then starts on a Morton index that's a multiple of its own cell count, which is
+	// a square in the atlas. equal sizes keep their priority order
+	std::stable_sort(candidates.begin(), candidates.end(),
+		[](const Candidate& a, const Candidate& b) { return a.size > b.size; });
+
+	std::vector<ShadowTile> newTiles;
+	std::vector<LightTiles> newLightTiles(maxLights, { 0, 0 });
+	uint32_t cell = 0;
+
+	for (const Candidate& candidate : candidates)
+	{
+		const ShadowRequest& request = requests[candidate.request];
+		uint32_t side = candidate.size / MIN_TILE_SIZE;
+
+		newLightTiles[request.lightIndex] = { static_cast<int32_t>(newTiles.size()), static_cast<int32_t>(candidate.faces) };
+
+		for (uint32_t face = 0; face < candidate.faces; face++)
+		{
+			glm::vec2 offset = glm::vec2(float(compactBits(cell)), float(compactBits(cell >> 1))) / float(CELLS_PER_SIDE);
+
+			ShadowTile tile;
+			tile.viewProj = computeViewProj(request, face);
+			tile.rect = glm::vec4(offset, glm::vec2(float(side) / float(CELLS_PER_SIDE)));
+			newTiles.push_back(tile);
+
+			cell += side * side;
+		}
+	}
+
+	// the tiles stay the same as long as the lights and their sizes do
+	bool changed = newTiles.size() != tiles.size() ||
+		memcmp(newTiles.data(), tiles.data(), sizeof(ShadowTile) * tiles.size()) != 0 ||
+		memcmp(newLightTiles.data(), lightTiles.data(), sizeof(LightTiles) * maxLights) != 0;
+
+	if (!changed)
+		return false;
+
+	tiles.swap(newTiles);
+	lightTiles.swap(newLightTiles);
+	shadowedLights = static_cast<uint32_t>(candidates.size());
+
+	uploadTables(commandBuffer);
+
+	return true;
+}
+
+void ShadowAtlas::uploadTables(VkCommandBuffer commandBuffer)
+{
+	// frames in flight may still be reading the old tables
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	// vkCmdUpdateBuffer takes at most 64KB at a time
+	auto update = [commandBuffer](VkBuffer buffer, const void* data, VkDeviceSize size)
+		{
+			for (VkDeviceSize offset = 0; offset < size; offset += 65536)
+			{
+				VkDeviceSize chunk = std::min<VkDeviceSize>(65536, size - offset);
+				vkCmdUpdateBuffer(commandBuffer, buffer, offset, chunk, static_cast<const char*>(data) + offset);
+			}
+		};
+
+	update(tileBuffer.buffer, tiles.data(), sizeof(ShadowTile) * tiles.size());
+	update(lightBuffer.buffer, lightTiles.data(), sizeof(LightTiles) * maxLights);
+
+	VkBufferMemoryBarrier barriers[2] = {};
+	for (int i = 0; i < 2; i++)
+	{
+		barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].offset = 0;
+		barriers[i].size = VK_WHOLE_SIZE;
+	}
+	barriers[0].buffer = tileBuffer.buffer;
+	barriers[1].buffer = lightBuffer.buffer;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0, 0, nullptr, 2, barriers, 0, nullptr);
+}
+
+glm::mat4 ShadowAtlas::computeViewProj(const ShadowRequest& request, uint32_t face)
+{
+	// same faces and order as a cube map: +x, -x, +y, -y, +z, -z. the shaders pick the face by the major axis
+	if (request.spotAngle <= 0.0f)
+		return PointLight::faceViewProj(request.position, face, NEAR_PLANE, request.range);
+
+	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+	if (std::abs(glm::normalize(request.direction).y) > 0.99f)
+		up = glm::vec3(0.0f, 0.0f, 1.0f);
+
+	glm::mat4 view = glm::lookAt(request.position, request.position + request.direction, up);
+	glm::mat4 proj = glm::perspective(request.spotAngle, 1.0f, NEAR_PLANE, request.range);
+	proj[1][1] *= -1;
+
+	return proj * view;
+}
+
+VkViewport ShadowAtlas::getViewport(uint32_t tile)
+{
+	glm::vec4 rect = tiles[tile].rect * float(ATLAS_SIZE);
+	return { rect.x, rect.y, rect.z, rect.w, 0.0f, 1.0f };
+}
+
+VkRect2D ShadowAtlas::getScissor(uint32_t tile)
+{
+	glm::vec4 rect = tiles[tile].rect * float(ATLAS_SIZE);
+	return { { int32_t(rect.x), int32_t(rect.y) }, { uint32_t(rect.z), uint32_t(rect.w) } };
+}
+
+void ShadowAtlas::destroy()
+{
+	if (!isBuilt)
+		return;
+
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	tileBuffer.destroy();
+	lightBuffer.destroy();
+	vkDestroySampler(device, sampler, nullptr);
+	descriptorAllocator.destroy(); // the layout is cached by Descriptors
+
+	imageView = VK_NULL_HANDLE;
+	isBuilt = false;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "HelperStructs.h"
+#include "Descriptors.h"
+
+// shadow atlas
+// shadow maps for many lights packed into one depth texture of a fixed size, which is the memory shadows get no
+// matter how many lights ask for one. allocate() sizes every light's shadow by how tall its sphere is on screen
+// times its importance, rounded to a power of two. while they don't fit, the least important lights give up
+// resolution first and then their shadows. tiles are placed biggest first along a Morton curve, which packs
+// power of two squares without gaps. a spot light gets one tile, a point light six, one per cube face.
+//
+// every tile is drawn in one pass, each with its own viewport and scissor. shaders find a light's tiles through
+// the light table, a point light's fragment picks the face its direction from the light points through.
+//
+// getDescriptorSetLayout() is the layout of getDescriptorSet():
+//   binding 0: the atlas (comparison sampler, fragment stage), set with setImage()
+//   binding 1: tiles (readonly storage buffer, fragment stage), see ShadowTile
+//   binding 2: light table (readonly storage buffer, fragment stage), per light its first tile and tile count
+
+// a light that wants a shadow, see allocate()
+struct ShadowRequest
+{
+	uint32_t lightIndex = 0;			// entry in the light table
+	glm::vec3 position = glm::vec3(0.0f);
+	float range = 1.0f;					// the shadow's far plane, e.g. the light's radius
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f); // spot lights only
+	float spotAngle = 0.0f;				// full cone angle in radians, 0 for a point light
+	float importance = 1.0f;			// scales the resolution its screen size asks for, e.g. its intensity
+};
+
+// must match the ShadowTile struct in the shaders (std430)
+struct ShadowTile
+{
+	glm::mat4 viewProj = glm::mat4(1.0f);
+	glm::vec4 rect = glm::vec4(0.0f); // xy = offset, zw = size, in atlas uv
+};
+
+class ShadowAtlas
+{
+public:
+	// tiles are drawn through views of their own, e.g. one culler view each
+	static const uint32_t MAX_TILES = 64;
+
+	// create the buffers and descriptors for a light table of maxLights entries
+	void build(uint32_t maxLights);
+	void destroy();
+
+	// the atlas image belongs to whoever draws it, e.g. a RenderGraph. write it again whenever it's recreated
+	void setImage(VkImageView view, VkImageLayout layout);
+
+	// size and pack the shadows of the requests for a camera. returns true when the tiles changed, the atlas then
+	// has to be drawn again. tiles only move when a light's size does, which small camera moves rarely change.
+	// new tables are recorded into commandBuffer, outside of a render pass, since frames in flight still read the old ones
+	bool allocate(VkCommandBuffer commandBuffer, const ShadowRequest* requests, uint32_t requestCount, const glm::vec3& cameraPosition,
+		float fovY, float screenHeight);
+
+	uint32_t getTileCount() { return static_cast<uint32_t>(tiles.size()); }
+	uint32_t getShadowedLightCount() { return shadowedLights; }
+	const glm::mat4& getViewProj(uint32_t tile) { return tiles[tile].viewProj; }
+	VkViewport getViewport(uint32_t tile);
+	VkRect2D getScissor(uint32_t tile);
+
+	VkExtent2D getExtent() { return { ATLAS_SIZE, ATLAS_SIZE }; }
+	VkFormat getFormat() { return VK_FORMAT_D32_SFLOAT; }
+
+	VkDescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout; }
+	VkDescriptorSet getDescriptorSet() { return descriptorSet; }
+
+private:
+	// 64 MB at 32 bits, room for 64 of the smallest tiles per side
+	const uint32_t ATLAS_SIZE = 4096;
+	const uint32_t MIN_TILE_SIZE = 64, MAX_TILE_SIZE = 1024;
+	const uint32_t CELLS_PER_SIDE = ATLAS_SIZE / MIN_TILE_SIZE;
+	const float NEAR_PLANE = 0.05f;
+
+	// must match the light table in the shaders
+	struct LightTiles
+	{
+		int32_t firstTile;
+		int32_t tileCount; // 0 for no shadow, 1 for a spot light, 6 for a point light
+	};
+
+	uint32_t maxLights = 0, shadowedLights = 0;
+	std::vector<ShadowTile> tiles;
+	std::vector<LightTiles> lightTiles;
+
+	VulkanBuffer tileBuffer, lightBuffer; // filled once in build(), then updated through the frame's command buffer
+	VkSampler sampler = VK_NULL_HANDLE;
+
+	DescriptorAllocator descriptorAllocator;
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkImageView imageView = VK_NULL_HANDLE;
+	VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	bool isBuilt = false;
+
+	void writeDescriptorSet();
+	void uploadTables(VkCommandBuffer commandBuffer);
+
+	// view projection of a spot light, or of one of a point light's cube faces
+	glm::mat4 computeViewProj(const ShadowRequest& request, uint32_t face);
+};
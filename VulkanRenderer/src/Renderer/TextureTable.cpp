@@ -0,0 +1,196 @@
+#include "TextureTable.h"
+#include "Loaders.h"
+
+namespace TextureTable
+{
+	namespace priv
+	{
+		static VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		static VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+		static VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+		static uint32_t capacity = 0;
+		static uint32_t textureCount = 0;
+		static std::vector<uint32_t> freeSlots;
+
+		// released slots and the frame they were released in, oldest first
+		static uint64_t frame = 0;
+		static std::vector<std::pair<uint32_t, uint64_t>> retiredSlots;
+
+		void write(uint32_t index, Texture* texture)
+		{
+			VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+			write.dstSet = descriptorSet;
+			write.dstBinding = 0;
+			write.dstArrayElement = index;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			write.pImageInfo = &texture->textureDescriptor;
+
+			vkUpdateDescriptorSets(VulkanDevice::GetVulkanDevice()->GetLogicalDevice(), 1, &write, 0, nullptr);
+			texture->tableIndex = index;
+		}
+
+		void create()
+		{
+			if (!isEnabled())
+				throw std::runtime_error("TextureTable requires descriptor indexing");
+
+			VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+			VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES };
+			VkPhysicalDeviceProperties2 properties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+			properties.pNext = &indexingProperties;
+			vkGetPhysicalDeviceProperties2(VulkanDevice::GetVulkanDevice()->GetPhysicalDevice(), &properties);
+
+			capacity = glm::min(MAX_TEXTURES, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages);
+			capacity = glm::min(capacity, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+			capacity = glm::min(capacity, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers);
+			capacity = glm::min(capacity, indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers);
+
+			VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity };
+
+			VkDescriptorPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+			poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+			poolInfo.maxSets = 1;
+			poolInfo.poolSizeCount = 1;
+			poolInfo.pPoolSizes = &poolSize;
+
+			if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create texture table descriptor pool");
+
+			VkDescriptorSetLayoutBinding binding = {};
+			binding.binding = 0;
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			binding.descriptorCount = capacity;
+			binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+			// unused slots may stay unwritten, and textures can be added while the set is bound in recorded command buffers.
+			// update after bind alone only covers command buffers that haven't been submitted yet, unused while pending
+			// also allows writing slots that in flight frames don't read, which is every newly registered one
+			VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+				VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+			VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+			bindingFlagsInfo.bindingCount = 1;
+			bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+			VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+			layoutInfo.pNext = &bindingFlagsInfo;
+			layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+			layoutInfo.bindingCount = 1;
+			layoutInfo.pBindings = &binding;
+
+			if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create texture table descriptor set layout");
+
+			VkDescriptorSetAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+			allocInfo.descriptorPool = descriptorPool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &descriptorSetLayout;
+
+			if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+				throw std::runtime_error("Failed to allocate texture table descriptor set");
+
+			// slot 0 is the fallback for materials missing a texture
+			write(0, TextureLoader::getEmptyTexture());
+			textureCount = 1;
+		}
+	}
+}
+
+bool TextureTable::isEnabled()
+{
+	return VulkanDevice::GetVulkanDevice()->IsDescriptorIndexingSupported();
+}
+
+uint32_t TextureTable::registerTexture(Texture* texture)
+{
+	if (priv::descriptorSet == VK_NULL_HANDLE)
+		priv::create();
+
+	// textures that never got an image read the empty texture
+	if (texture == nullptr || texture->image == VK_NULL_HANDLE)
+		return 0;
+
+	if (texture->tableIndex != UINT32_MAX)
+		return texture->tableIndex;
+
+	uint32_t index;
+	if (!priv::freeSlots.empty())
+	{
+		index = priv::freeSlots.back();
+		priv::freeSlots.pop_back();
+	}
+
+	else
+	{
+		if (priv::textureCount == priv::capacity)
+			throw std::runtime_error("Texture table is full");
+
+		index = priv::textureCount++;
+	}
+
+	priv::write(index, texture);
+	return index;
+}
+
+void TextureTable::release(uint32_t index)
+{
+	// slot 0 belongs to the empty texture for the lifetime of the table.
+	// frames in flight may still sample the slot, so its descriptor can't be overwritten yet
+	if (priv::descriptorSet != VK_NULL_HANDLE && index != 0)
+		priv::retiredSlots.push_back({ index, priv::frame });
+}
+
+void TextureTable::endFrame()
+{
+	priv::frame++;
+
+	size_t retired = 0;
+	while (retired < priv::retiredSlots.size() && priv::frame - priv::retiredSlots[retired].second >= FRAMES_IN_FLIGHT)
+	{
+		priv::freeSlots.push_back(priv::retiredSlots[retired].first);
+		retired++;
+	}
+
+	priv::retiredSlots.erase(priv::retiredSlots.begin(), priv::retiredSlots.begin() + retired);
+}
+
+void TextureTable::bind(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex)
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+		setIndex, 1, &priv::descriptorSet, 0, nullptr);
+}
+
+VkDescriptorSet TextureTable::getDescriptorSet()
+{
+	return priv::descriptorSet;
+}
+
+VkDescriptorSetLayout TextureTable::getDescriptorSetLayout()
+{
+	if (priv::descriptorSetLayout == VK_NULL_HANDLE)
+		priv::create();
+
+	return priv::descriptorSetLayout;
+}
+
+void TextureTable::destroy()
+{
+	if (priv::descriptorSet == VK_NULL_HANDLE)
+		return;
+
+	VkDevice device = VulkanDevice::GetVulkanDevice()->GetLogicalDevice();
+
+	vkDestroyDescriptorSetLayout(device, priv::descriptorSetLayout, nullptr);
+	vkDestroyDescriptorPool(device, priv::descriptorPool, nullptr);
+
+	priv::descriptorPool = VK_NULL_HANDLE;
+	priv::descriptorSetLayout = VK_NULL_HANDLE;
+	priv::descriptorSet = VK_NULL_HANDLE;
+	priv::capacity = 0;
+	priv::textureCount = 0;
+	priv::freeSlots.clear();
+	priv::retiredSlots.clear();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "HelperStructs.h"
+
+// bindless textures. when the device supports descriptor indexing every texture the TextureLoader creates is
+// written into one large, partially bound array of combined image samplers, and materials store the array index
+// of each of their textures in their MaterialTable entry instead of owning a descriptor set. the set is bound once
+// per pass and stays valid while new textures are added, since it's created with update after bind and
+// update unused while pending. a released slot is only handed out again once every frame in flight that could
+// still read it has finished, see endFrame().
+// slot 0 always holds the empty texture, so a material without a certain texture still samples something valid
+//
+//   layout(set = 2, binding = 0) uniform sampler2D textures[];
+//   texture(textures[nonuniformEXT(material.textureIndices[type])], uv)
+//
+// without descriptor indexing, materials fall back to a descriptor set of their own (see Material::createDescriptorSet)
+namespace TextureTable
+{
+	const uint32_t MAX_TEXTURES = 4096; // clamped to the device's update after bind limits
+	const uint32_t FRAMES_IN_FLIGHT = 3; // VulkanScene::MAX_FRAMES_IN_FLIGHT
+
+	bool isEnabled();
+
+	// returns the texture's slot, registering it the first time
+	uint32_t registerTexture(Texture* texture);
+	void release(uint32_t index);
+
+	// call once per submitted frame. slots released FRAMES_IN_FLIGHT frames ago are free to reuse,
+	// every frame that might have read them has waited on its fence since
+	void endFrame();
+
+	void bind(VkCommandBuffer& commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex = 2);
+	VkDescriptorSet getDescriptorSet();
+	VkDescriptorSetLayout getDescriptorSetLayout();
+
+	void destroy();
+}
@@ -0,0 +1,64 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		uint32_t cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (uint32_t i = 0; i < threadCount; i++)
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::run(uint32_t count, const std::function<void(uint32_t, uint32_t)>& job)
+{
+	if (count == 0)
+		return;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	currentJob = &job;
+	jobCount = count;
+	nextJob = 0;
+	finishedJobs = 0;
+
+	wake.notify_all();
+	done.wait(lock, [this]() { return finishedJobs == jobCount; });
+
+	currentJob = nullptr;
+}
+
+void ThreadPool::workerLoop(uint32_t threadIndex)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true)
+	{
+		wake.wait(lock, [this]() { return stopping || (currentJob != nullptr && nextJob < jobCount); });
+		if (stopping)
+			return;
+
+		uint32_t jobIndex = nextJob++;
+		const std::function<void(uint32_t, uint32_t)>* job = currentJob;
+
+		lock.unlock();
+		(*job)(jobIndex, threadIndex);
+		lock.lock();
+
+		if (++finishedJobs == jobCount)
+			done.notify_one();
+	}
+}
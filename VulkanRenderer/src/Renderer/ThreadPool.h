@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// fixed set of worker threads for parallel loops. run() hands out job indices to the workers and blocks until every
+// job has finished, so jobs can freely reference the caller's locals
+class ThreadPool
+{
+public:
+	// 0 picks one worker per core, leaving a core for the main thread
+	ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	uint32_t getThreadCount() { return static_cast<uint32_t>(workers.size()); }
+
+	// calls job(jobIndex, threadIndex) once per job index. threadIndex is in [0, getThreadCount()) and
+	// jobs sharing a thread index never run at the same time
+	void run(uint32_t jobCount, const std::function<void(uint32_t, uint32_t)>& job);
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+
+	const std::function<void(uint32_t, uint32_t)>* currentJob = nullptr;
+	uint32_t jobCount = 0, nextJob = 0, finishedJobs = 0;
+	bool stopping = false;
+
+	void workerLoop(uint32_t threadIndex);
+};
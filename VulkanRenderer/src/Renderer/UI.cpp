@@ -2,7 +2,7 @@
 #include "Renderer.h"
 
 UI::UI(const VkCommandPool& commandPool, const VulkanSwapChain& swapChain, const VkRenderPass& renderPass, 
-	const VulkanGraphicsPipeline& graphicsPipeline, VkSampleCountFlagBits counts)
+	const VulkanGraphicsPipeline& graphicsPipeline, VkSampleCountFlagBits counts, uint32_t subpass)
 	: commandPool(commandPool), renderPass(renderPass), graphicsPipeline(graphicsPipeline)
 {
 	VulkanDevice* vkDevice = VulkanDevice::GetVulkanDevice();
@@ -50,7 +50,7 @@ UI::UI(const VkCommandPool& commandPool, const VulkanSwapChain& swapChain, const
 		vkDevice->GetQueues().renderQueue,
 		nullptr,
 		descriptorPool,
-		0,
+		subpass,
 		2,
 		static_cast<uint32_t>(swapChain.swapChainImages.size()),
 		counts,
@@ -244,6 +244,15 @@ void UI::DisplayFPS()
 	ImGui::Text("FPS: %2f", io.Framerate);
 }
 
+void UI::DisplayDrawStats(const DrawStats& stats)
+{
+	ImGui::Text("Draws: %u", stats.draws);
+	ImGui::Text("Pipeline binds: %u", stats.pipelineBinds);
+	ImGui::Text("Descriptor set binds: %u", stats.descriptorSetBinds);
+	ImGui::Text("Vertex / index buffer binds: %u / %u", stats.vertexBufferBinds, stats.indexBufferBinds);
+	ImGui::Text("Redundant binds skipped: %u", stats.skippedBinds);
+}
+
 bool UI::DrawSliderFloat(const char* name, float* value, float minValue, float maxValue)
 {
 	return ImGui::SliderFloat(name, value, minValue, maxValue);
@@ -289,6 +298,11 @@ void UI::SetMouseCapture(bool capture)
 	io.WantCaptureMouse = capture;
 }
 
+bool UI::IsMouseOverUI()
+{
+	return ImGui::IsWindowHovered(ImGuiHoveredFlags_AnyWindow);
+}
+
 void UI::SetKeyboardCapture(bool capture)
 {
 	ImGuiIO& io = ImGui::GetIO();
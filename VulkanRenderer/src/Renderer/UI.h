@@ -7,6 +7,7 @@
 #include "vendor/imgui_impl_vulkan.h"
 
 #include "HelperStructs.h"
+#include "DrawList.h"
 #include "glm/glm.hpp"
 #include <unordered_map>
 
@@ -14,7 +15,7 @@ class UI
 {
 public:
 	UI(const VkCommandPool& commandPool, const VulkanSwapChain& swapChain, const VkRenderPass& renderPass, 
-		const VulkanGraphicsPipeline& graphicsPipeline, VkSampleCountFlagBits counts = HelperFunctions::getMaximumSampleCount());
+		const VulkanGraphicsPipeline& graphicsPipeline, VkSampleCountFlagBits counts = HelperFunctions::getMaximumSampleCount(), uint32_t subpass = 0);
 	~UI();
 
 	void NewUIFrame();
@@ -41,6 +42,7 @@ public:
 
 	void ShowDemoWindow();
 	void DisplayFPS();
+	void DisplayDrawStats(const DrawStats& stats);
 
 	bool DrawSliderFloat(const char* name, float* value, float minValue, float maxValue);
 	bool DrawSliderVec2(const char* name, glm::vec2* values, float minValue, float maxValue);
@@ -52,6 +54,7 @@ public:
 	void EndTreeNode();
 
 	void SetMouseCapture(bool capture);
+	bool IsMouseOverUI();
 	void SetKeyboardCapture(bool capture);
 	void SetTextCapture(bool capture);
 	void AddMouseButtonEvent(int button, bool pressed);
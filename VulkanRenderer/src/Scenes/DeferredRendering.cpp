@@ -8,22 +8,24 @@ DeferredRendering::DeferredRendering(const std::string sceneName, const VulkanSw
 	srand(unsigned int(time(NULL)));
 	CreateSyncObjects();
 
-	// create offscreen pipeline
+	// the graph imports the cluster buffer and creates the g-buffer the composition descriptors point at
+	lightClusters.build(MAX_LIGHTS);
+	shadowAtlas.build(MAX_LIGHTS);
+	CreateRenderGraph(swapChain);
 	CreateOffscreenPipelineResources(swapChain);
-	CreateOffscreenRenderPass(swapChain);
-	CreateOffscreenFramebuffers(swapChain);
-	CreateOffscreenPipeline(swapChain);
-
-	
-	// create composition pipeline
 	CreateCompositionPipelineResources(swapChain);
-	CreateCompositionRenderPass(swapChain);
-	CreateCompositionFramebuffers(swapChain);
-	CreateCompositionPipeline(swapChain);
 
-	CreateCommandBuffers();
+	// scene objects fill the uniform buffers and the culler, whose layout the offscreen pipeline needs
 	CreateSceneObjects(swapChain);
-	ui = new UI(commandPool, swapChain, renderPass, compositionPipeline, VK_SAMPLE_COUNT_1_BIT);
+
+	CreateOffscreenPipeline(swapChain);
+	CreateCompositionPipeline(swapChain);
+	CreateLightVolumePipelines(swapChain);
+	CreateShadowAtlasPipeline();
+
+	CreateCommandBuffers(swapChain);
+	ui = new UI(commandPool, swapChain, renderGraph.getRenderPass(compositionPass), compositionPipeline, VK_SAMPLE_COUNT_1_BIT,
+		renderGraph.getSubpass(compositionPass));
 
 }
 
@@ -39,35 +41,42 @@ void DeferredRendering::RecreateScene(const VulkanSwapChain& swapChain)
 	DestroyScene(true);
 	delete ui;
 
+	CreateRenderGraph(swapChain);
+	lightClusters.setProjection(proj, NEAR_PLANE, FAR_PLANE, swapChain.swapChainDimensions);
+
 	// create offscreen pipeline
 	CreateOffscreenPipelineResources(swapChain);
-	CreateOffscreenRenderPass(swapChain);
-	CreateOffscreenFramebuffers(swapChain);
 	CreateOffscreenPipeline(swapChain);
 
 	// create composition pipeline
 	CreateCompositionPipelineResources(swapChain);
-	CreateCompositionRenderPass(swapChain);
-	CreateCompositionFramebuffers(swapChain);
 	CreateCompositionPipeline(swapChain);
+	CreateLightVolumePipelines(swapChain);
+	CreateShadowAtlasPipeline();
 
-	CreateCommandBuffers();
-	ui = new UI(commandPool, swapChain, renderPass, compositionPipeline, VK_SAMPLE_COUNT_1_BIT);
+	CreateCommandBuffers(swapChain);
+	ui = new UI(commandPool, swapChain, renderGraph.getRenderPass(compositionPass), compositionPipeline, VK_SAMPLE_COUNT_1_BIT,
+		renderGraph.getSubpass(compositionPass));
 }
 
 void DeferredRendering::DestroyScene(bool isRecreation)
 {
-	vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
+	// the cached passes reference the pipelines and framebuffers destroyed here
+	parallelRecorder.markDirty();
+
 	offscreenPipeline.destroyGraphicsPipeline(logicalDevice);
 	compositionPipeline.destroyGraphicsPipeline(logicalDevice);
+	vkDestroyPipeline(logicalDevice, ambientPipeline, nullptr);
+	vkDestroyPipeline(logicalDevice, stencilPipeline, nullptr);
+	vkDestroyPipeline(logicalDevice, lightVolumePipeline, nullptr);
+	vkDestroyPipeline(logicalDevice, atlasPipeline, nullptr);
+	vkDestroyPipelineLayout(logicalDevice, atlasPipelineLayout, nullptr);
 
-	colorTexture.destroyTexture();
-	normalTexture.destroyTexture();
-	positionTexture.destroyTexture();
-	vkDestroySampler(logicalDevice, textureSampler, nullptr);
+	renderGraph.destroy();
 
 	uint32_t size = static_cast<uint32_t>(commandBuffersList.size());
 	vkFreeCommandBuffers(logicalDevice, commandPool, size, commandBuffersList.data());
+	vkDestroyQueryPool(logicalDevice, timestampPool, nullptr);
 
 	if (!isRecreation)
 	{
@@ -78,10 +87,11 @@ void DeferredRendering::DestroyScene(bool isRecreation)
 			vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
 		}
 
-		for (int i = 0; i < 100; i++)
-			spheres[i].destroyMesh();
-
 		plane.destroyMesh();
+		culler.destroy();
+		lightClusters.destroy();
+		shadowAtlas.destroy();
+		parallelRecorder.destroy();
 	}
 }
 
@@ -89,7 +99,7 @@ void DeferredRendering::CreateSceneObjects(const VulkanSwapChain& swapChain)
 {
 	sceneCamera = Camera::GetCamera();
 	VkExtent2D dim = swapChain.swapChainDimensions;
-	proj = glm::perspective(glm::radians(45.0f), float(dim.width) / float(dim.height), 0.1f, 1000.0f);
+	proj = glm::perspective(glm::radians(FIELD_OF_VIEW), float(dim.width) / float(dim.height), NEAR_PLANE, FAR_PLANE);
 	proj[1][1] *= -1;
 	deferredUBO.viewProj = proj * sceneCamera->GetViewMatrix();
 
@@ -99,6 +109,9 @@ void DeferredRendering::CreateSceneObjects(const VulkanSwapChain& swapChain)
 
 	glm::mat4 scale = glm::scale(glm::vec3(0.25f));
 	glm::mat4 model = glm::mat4(1.0f);
+	std::vector<glm::mat4> sphereTransforms(100);
+	std::vector<Material*> materials(100);
+	std::vector<GPULight> lights(MAX_LIGHTS);
 
 	// 100 lights, positioned at -5 through 4 on x and z axes, so 10 each row
 	int row = -5, col = -5;
@@ -119,30 +132,60 @@ void DeferredRendering::CreateSceneObjects(const VulkanSwapChain& swapChain)
 		float radius = 3.0f;
 		float intensity = 1.0f;
 
-		compositionUBO.lights[i] = { position, color, radius, intensity };
+		lights[i].positionRadius = glm::vec4(glm::vec3(position), radius);
+		lights[i].colorIntensity = glm::vec4(glm::vec3(color), intensity);
 
 		position.y = -0.75f;
-		model = glm::translate(glm::vec3(position)) * scale;
-		spheres[i] = BasicShapes::createSphere();
-		spheres[i].setModelMatrix(model);
+		sphereTransforms[i] = glm::translate(glm::vec3(position)) * scale;
 
 		int material = rand() % 28;
-		spheres[i].setMaterialWithPreset((MaterialPresets)material);
+		sphereMaterials[i].setPreset((MaterialPresets)material);
+		materials[i] = &sphereMaterials[i];
 
 		col++;
 	}
 
-	for (int i = 0; i < 3; i++)
+	// the rest are small lights scattered just above the plane
+	for (uint32_t i = 100; i < MAX_LIGHTS; i++)
 	{
-		compositionPipeline.uniformBuffers[i].map();
-		memcpy(compositionPipeline.uniformBuffers[i].mappedMemory, &compositionUBO, sizeof(compositionUBO));
-		compositionPipeline.uniformBuffers[i].unmap();
+		float x = float(rand() % 1000) / 100.0f - 5.5f;
+		float z = float(rand() % 1000) / 100.0f - 5.0f;
+		float radius = float(rand() % 100) / 400.0f + 0.5f;
+
+		float r = float(rand() % 255) / 255.0f;
+		float g = float(rand() % 255) / 255.0f;
+		float b = float(rand() % 255) / 255.0f;
+
+		lights[i].positionRadius = glm::vec4(x, -0.9f, z, radius);
+		lights[i].colorIntensity = glm::vec4(r, g, b, 0.5f);
 	}
-	
+
+	lightClusters.setLights(lights);
+	lightClusters.setLightCount(1024);
+
+	// every light can ask for a shadow, brighter ones ask for more resolution
+	shadowRequests.resize(MAX_LIGHTS);
+	for (uint32_t i = 0; i < MAX_LIGHTS; i++)
+	{
+		glm::vec4 color = lights[i].colorIntensity;
+		shadowRequests[i].lightIndex = i;
+		shadowRequests[i].position = glm::vec3(lights[i].positionRadius);
+		shadowRequests[i].range = lights[i].positionRadius.w;
+		shadowRequests[i].importance = color.a * std::max(color.r, std::max(color.g, color.b));
+	}
+	lightClusters.setProjection(proj, NEAR_PLANE, FAR_PLANE, dim);
+
 	plane = BasicShapes::createPlane();
 	plane.setMaterialWithPreset(MaterialPresets::BLACK_PLASTIC);
 	model = glm::translate(glm::vec3(-0.5f, -1.0f, 0.0f)) * glm::scale(glm::vec3(10.0f));
 	plane.setModelMatrix(model);
+
+	// the spheres only need their own materials, they're all instances of the shared sphere mesh
+	culler.addObject(&plane);
+	culler.addInstances(BasicShapes::getSphere(), sphereTransforms, materials);
+
+	// the camera, then one view per atlas tile
+	culler.build(1 + ShadowAtlas::MAX_TILES);
 }
 
 void DeferredRendering::CreateSyncObjects()
@@ -166,9 +209,9 @@ void DeferredRendering::CreateSyncObjects()
 	}
 }
 
-void DeferredRendering::CreateCommandBuffers()
+void DeferredRendering::CreateCommandBuffers(const VulkanSwapChain& swapChain)
 {
-	commandBuffersList.resize(compositionPipeline.framebuffers.size());
+	commandBuffersList.resize(swapChain.swapChainImages.size());
 
 	VkCommandBufferAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
 	allocInfo.commandPool = commandPool;
@@ -177,6 +220,19 @@ void DeferredRendering::CreateCommandBuffers()
 
 	if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffersList.data()) != VK_SUCCESS)
 		throw std::runtime_error("Failed to allocate command buffers");
+
+	VkQueryPoolCreateInfo queryInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+	queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryInfo.queryCount = 2 * static_cast<uint32_t>(commandBuffersList.size());
+
+	if (vkCreateQueryPool(logicalDevice, &queryInfo, nullptr, &timestampPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create timestamp query pool");
+
+	timestampsWritten.assign(commandBuffersList.size(), false);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(VulkanDevice::GetVulkanDevice()->GetPhysicalDevice(), &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
 }
 
 // DRAWING AND PRESENTATION
@@ -266,12 +322,7 @@ VulkanReturnValues DeferredRendering::PresentScene(const VulkanSwapChain& swapCh
 
 void DeferredRendering::DrawScene(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout, bool useMaterial)
 {
-	plane.draw(commandBuffer, pipelineLayout, useMaterial);
-
-	for (int i = 0; i < 100; i++)
-	{
-		spheres[i].draw(commandBuffer, pipelineLayout, useMaterial);
-	}
+	culler.draw(recorder, pipelineLayout, 0);
 }
 
 
@@ -281,7 +332,16 @@ void DeferredRendering::Update(uint32_t index)
 
 	offscreenPipeline.uniformBuffers[0].map();
 	memcpy(offscreenPipeline.uniformBuffers[0].mappedMemory, &deferredUBO, sizeof(deferredUBO));
-	offscreenPipeline.uniformBuffers[0].unmap();	
+	offscreenPipeline.uniformBuffers[0].unmap();
+
+	// the composition pass rebuilds positions from depth, light volumes are drawn with the camera
+	compositionUBO.invViewProj = glm::inverse(deferredUBO.viewProj);
+	compositionUBO.viewProj = deferredUBO.viewProj;
+	compositionUBO.screenSize = glm::vec4(compositionPipeline.viewport.width, compositionPipeline.viewport.height, 0.0f, 0.0f);
+
+	compositionPipeline.uniformBuffers[index].map();
+	memcpy(compositionPipeline.uniformBuffers[index].mappedMemory, &compositionUBO, sizeof(compositionUBO));
+	compositionPipeline.uniformBuffers[index].unmap();
 }
 
 // record a command buffer every frame
@@ -289,125 +349,145 @@ void DeferredRendering::RecordCommandBuffer(uint32_t index)
 {
 
 	VkCommandBufferBeginInfo cmdBI = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-	VkRenderPassBeginInfo rpBI = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
-
-	VkClearValue clearValues[4];
-	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-	clearValues[1].depthStencil = { 1.0f, 0 };
-	clearValues[2].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-	clearValues[3].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-
-	VkDeviceSize offsets[] = { 0 };
 
 	if (vkBeginCommandBuffer(commandBuffersList[index], &cmdBI) != VK_SUCCESS)
 		throw std::runtime_error("Failed to begin recording command buffer");
 
-	// render G-Buffer textures offscreen
+	// the last frame rendered to this image has finished, its fence was waited on before recording
+	if (timestampsWritten[index])
 	{
-		rpBI.renderPass = renderPass;
-		rpBI.framebuffer = offscreenPipeline.framebuffers[index];
-		rpBI.renderArea.extent = offscreenPipeline.scissors.extent;
-		rpBI.clearValueCount = 4;
-		rpBI.pClearValues = clearValues;
-
-		vkCmdBeginRenderPass(commandBuffersList[index], &rpBI, VK_SUBPASS_CONTENTS_INLINE);
+		uint64_t timestamps[2];
+		if (vkGetQueryPoolResults(logicalDevice, timestampPool, index * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			gpuFrameTime = float(timestamps[1] - timestamps[0]) * timestampPeriod * 1e-6f;
+	}
 
-		vkCmdSetViewport(commandBuffersList[index], 0, 1, &offscreenPipeline.viewport);
-		vkCmdSetScissor(commandBuffersList[index], 0, 1, &offscreenPipeline.scissors);
+	vkCmdResetQueryPool(commandBuffersList[index], timestampPool, index * 2, 2);
+	vkCmdWriteTimestamp(commandBuffersList[index], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, index * 2);
 
-		vkCmdBindPipeline(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipeline.pipeline);
-		vkCmdBindDescriptorSets(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipeline.pipelineLayout,
-			0, 1, &offscreenPipeline.descriptorSets[0], 0, nullptr);
+	recorder.begin(commandBuffersList[index]);
 
-		
+	// cull against the camera before any pass reads the draw commands
+	culler.cull(commandBuffersList[index], 0, deferredUBO.viewProj);
+	UpdateShadowAtlas(commandBuffersList[index]);
 
-		DrawScene(commandBuffersList[index], offscreenPipeline.pipelineLayout, true);
+	// the recorder caches passes in the order they're recorded, so it can't reuse them across a change of live passes
+	if (renderGraph.cullPasses())
+		parallelRecorder.markDirty();
 
-		vkCmdEndRenderPass(commandBuffersList[index]);
-	}
+	// the passes recorded for this image last time are reused unless the culled draws changed
+	parallelRecorder.beginFrame(index, culler.getDrawVersion());
 
-	// compose the final scene
-	{
-		rpBI.renderPass = renderPass;
-		rpBI.framebuffer = compositionPipeline.framebuffers[index];
-		rpBI.renderArea.extent = compositionPipeline.scissors.extent;
-		rpBI.clearValueCount = 1;
-		rpBI.pClearValues = clearValues;
+	// the shadow atlas when it changed, light culling, then the g-buffer pass and composition
+	renderGraph.execute(commandBuffersList[index], index);
 
-		vkCmdBeginRenderPass(commandBuffersList[index], &rpBI, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdWriteTimestamp(commandBuffersList[index], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, index * 2 + 1);
+	timestampsWritten[index] = true;
 
-		vkCmdSetViewport(commandBuffersList[index], 0, 1, &compositionPipeline.viewport);
-		vkCmdSetScissor(commandBuffersList[index], 0, 1, &compositionPipeline.scissors);
+	if (vkEndCommandBuffer(commandBuffersList[index]) != VK_SUCCESS)
+		throw std::runtime_error("Failed to record command buffer");
 
-		vkCmdBindPipeline(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, compositionPipeline.pipeline);
-		vkCmdBindDescriptorSets(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, compositionPipeline.pipelineLayout,
-			0, 1, &compositionPipeline.descriptorSets[index], 0, nullptr);
+}
 
+void DeferredRendering::UpdateShadowAtlas(VkCommandBuffer commandBuffer)
+{
+	uint32_t requestCount = castShadows ? lightClusters.getLightCount() : 0;
+	bool tilesChanged = shadowAtlas.allocate(commandBuffer, shadowRequests.data(), requestCount, sceneCamera->GetCameraPosition(),
+		glm::radians(FIELD_OF_VIEW), compositionPipeline.viewport.height);
 
-		vkCmdDraw(commandBuffersList[index], 3, 1, 0, 0);
+	// the atlas pass records a viewport and view per tile
+	if (tilesChanged)
+		parallelRecorder.markDirty();
 
-		DrawUI(index);
+	uint64_t transformVersion = culler.getTransformVersion();
+	isAtlasDirty = tilesChanged || !isAtlasValid || transformVersion != atlasTransformVersion;
+	atlasTransformVersion = transformVersion;
 
-		vkCmdEndRenderPass(commandBuffersList[index]);
+	// a skipped atlas pass needs no culling
+	if (isAtlasDirty)
+	{
+		for (uint32_t tile = 0; tile < shadowAtlas.getTileCount(); tile++)
+			culler.cull(commandBuffer, 1 + tile, shadowAtlas.getViewProj(tile));
 	}
-
-	if (vkEndCommandBuffer(commandBuffersList[index]) != VK_SUCCESS)
-		throw std::runtime_error("Failed to record command buffer");
-
 }
 
-void DeferredRendering::DrawUI(uint32_t index)
+void DeferredRendering::DrawUI(VkCommandBuffer commandBuffer, uint32_t index)
 {
 	ui->NewUIFrame();
 	{
 		ui->NewWindow("Application");
 		{
 			ui->DisplayFPS();
+
+			// serial recording goes through the scene's recorder, the worker threads through their own
+			DrawStats stats = recorder.getStats();
+			stats += parallelRecorder.getStats();
+			ui->DisplayDrawStats(stats);
+
+			bool multithreaded = parallelRecorder.isEnabled();
+			if (ui->DrawCheckBox("Multithreaded Recording", &multithreaded))
+				parallelRecorder.setEnabled(multithreaded);
+
+			if (multithreaded)
+				ui->DrawUIText(parallelRecorder.isReusingFrame() ? "Scene passes: reused" : "Scene passes: re-recorded");
+
 			glm::vec3 camPos = sceneCamera->GetCameraPosition();
 			ui->DrawUITextVec3("Camera Position", camPos);
 		}
 		ui->EndWindow();
 
-		static int textureChoice = 0;
-		ui->NewWindow("G Buffer Textures");
+		ui->NewWindow("G Buffer");
 		{
-			if (ImGui::BeginMenu("Texture"))
-			{
-				if (ImGui::MenuItem("Colors"))
-					textureChoice = 0;
+			std::string memory = "Render target memory: " + std::to_string(renderGraph.getAllocatedMemory() >> 20) + " MB (" +
+				std::to_string(renderGraph.getLazilyAllocatedMemory() >> 20) + " MB lazily allocated, " +
+				std::to_string(renderGraph.getRequiredMemory() >> 20) + " MB unaliased)";
+			ui->DrawUIText(memory.c_str());
 
-				else if (ImGui::MenuItem("Normals"))
-					textureChoice = 1;
-				
-				else if (ImGui::MenuItem("Positions"))
-					textureChoice = 2;
+			std::string frameTime = "GPU frame time: " + std::to_string(gpuFrameTime) + " ms";
+			ui->DrawUIText(frameTime.c_str());
 
-				ImGui::EndMenu();
+			// the light volumes are drawn with one instance per light, recorded into the cached composition subpass
+			int lightCount = static_cast<int>(lightClusters.getLightCount());
+			if (ImGui::SliderInt("Lights", &lightCount, 100, static_cast<int>(lightClusters.getMaxLights())))
+			{
+				lightClusters.setLightCount(static_cast<uint32_t>(lightCount));
+				parallelRecorder.markDirty();
 			}
 
-			switch (textureChoice)
-			{
-				case 0:
-					ui->DrawImage("Colors", colorTexture, &colorTexture.sampler, glm::vec2(320, 180)); // 1280x720 divided by 4 to keep aspect ratio
-					break;
+			ui->DrawCheckBox("Light Shadows", &castShadows);
 
-				case 1:
-					ui->DrawImage("Normals", normalTexture, &normalTexture.sampler, glm::vec2(320, 180));
-					break;
+			std::string shadows = "Shadowed lights: " + std::to_string(shadowAtlas.getShadowedLightCount()) + " (" +
+				std::to_string(shadowAtlas.getTileCount()) + " atlas tiles, " + (renderGraph.isPassLive(shadowAtlasPass) ? "drawn)" : "skipped)");
+			ui->DrawUIText(shadows.c_str());
 
-				case 2:
-					ui->DrawImage("Positions", positionTexture, &positionTexture.sampler, glm::vec2(320, 180));
-					break;
+			bool lightVolumes = lightingMode == LIGHT_VOLUMES;
+			if (ui->DrawCheckBox("Stencil Light Volumes", &lightVolumes))
+			{
+				lightingMode = lightVolumes ? LIGHT_VOLUMES : CLUSTERED;
+				parallelRecorder.markDirty();
+			}
+
+			// the push constant is recorded into the cached composition subpass
+			const char* views[] = { "Lit", "Colors", "Normals", "Positions", "Lights Per Cluster" };
+			if (ImGui::BeginMenu(views[gBufferView]))
+			{
+				for (int32_t i = 0; i < 5; i++)
+				{
+					if (ImGui::MenuItem(views[i]) && gBufferView != i)
+					{
+						gBufferView = i;
+						parallelRecorder.markDirty();
+					}
+				}
 
-				default:
-					break;
+				ImGui::EndMenu();
 			}
 		}
 		ui->EndWindow();
 	}
 	ui->EndFrame();
 	
-	ui->RenderFrame(commandBuffersList[index], index);
+	ui->RenderFrame(commandBuffer, index);
 }
 
 // INPUT
@@ -469,61 +549,153 @@ void DeferredRendering::HandleMouseInput(uint32_t buttons, const int x, const in
 }
 
 
-// OFFSCREEN PIPELINE GENERATION
+// RENDER GRAPH
 
-void DeferredRendering::CreateOffscreenPipelineResources(const VulkanSwapChain& swapChain)
+void DeferredRendering::CreateRenderGraph(const VulkanSwapChain& swapChain)
 {
 	VkExtent2D dim = swapChain.swapChainDimensions;
-	
-	// g-buffer textures
-	{
-		// color
-		HelperFunctions::createImage(dim.width, dim.height, 1, 1,
-			VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			colorTexture.image, colorTexture.imageMemory);
-
-		HelperFunctions::createImageView(colorTexture.image, colorTexture.imageView,
-			VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D, 1);
-
-		HelperFunctions::createSampler(colorTexture.sampler, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-
-		// depth
-		HelperFunctions::createImage(dim.width, dim.height, 1, 1,
-			VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TYPE_2D, VK_FORMAT_D16_UNORM, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			offscreenPipeline.depthStencilBuffer, offscreenPipeline.depthStencilBufferMemory);
 
-		HelperFunctions::createImageView(offscreenPipeline.depthStencilBuffer, offscreenPipeline.depthStencilBufferView,
-			VK_FORMAT_D16_UNORM, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, 1);
-
-		HelperFunctions::createSampler(textureSampler, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-
-		offscreenPipeline.isDepthBufferEmpty = false;
-
-		// normals
-		HelperFunctions::createImage(dim.width, dim.height, 1, 1,
-			VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			normalTexture.image, normalTexture.imageMemory);
-
-		HelperFunctions::createImageView(normalTexture.image, normalTexture.imageView,
-			VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D, 1);
+	VkClearValue black = {};
+	black.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	VkClearValue farDepth = {};
+	farDepth.depthStencil = { 1.0f, 0 };
+
+	// 12 bytes per pixel. positions aren't stored, the composition pass rebuilds them from depth, so depth gets the
+	// precision they need. normals are octahedral encoded into two channels
+	colorImage = renderGraph.createImage("Color", VK_FORMAT_R8G8B8A8_UNORM, dim);
+	normalImage = renderGraph.createImage("Normal", VK_FORMAT_R16G16_SFLOAT, dim);
+	// light volumes need a stencil, one of these two is always supported
+	std::vector<VkFormat> depthFormats = { VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT };
+	VkFormat depthFormat = VulkanDevice::GetVulkanDevice()->findSupportedFormats(depthFormats, VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	depthImage = renderGraph.createImage("Depth", depthFormat, dim);
+	shadowAtlasImage = renderGraph.createImage("Shadow Atlas", shadowAtlas.getFormat(), shadowAtlas.getExtent());
+	uint32_t swapChainImage = renderGraph.importSwapChain(swapChain);
+	clusterBuffer = renderGraph.importBuffer("Light Clusters", lightClusters.getClusterBuffer());
+
+	// a new atlas image, nothing drawn into it yet
+	isAtlasValid = false;
+
+	// every shadowed light's tiles in one pass, each tile drawn with its own viewport and view
+	shadowAtlasPass = renderGraph.addGraphicsPass("Shadow Atlas", [this](const RenderGraph::PassContext& context)
+		{
+			isAtlasValid = true;
+
+			// the culled draws of every tile are split evenly over the worker threads
+			parallelRecorder.recordRenderPass(context.commandBuffer, context.beginInfo, recorder, parallelRecorder.getThreadCount(),
+				[&](CommandRecorder& passRecorder, uint32_t job, uint32_t jobCount)
+				{
+					VkCommandBuffer commandBuffer = passRecorder.getCommandBuffer();
+					passRecorder.bindPipeline(atlasPipeline);
+
+					for (uint32_t tile = 0; tile < shadowAtlas.getTileCount(); tile++)
+					{
+						VkViewport viewport = shadowAtlas.getViewport(tile);
+						VkRect2D scissor = shadowAtlas.getScissor(tile);
+						vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+						vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+						vkCmdPushConstants(commandBuffer, atlasPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4),
+							&shadowAtlas.getViewProj(tile));
+
+						culler.draw(passRecorder, atlasPipelineLayout, 1 + tile, 0, job, jobCount);
+					}
+				});
+		});
+
+	renderGraph.writeDepth(shadowAtlasPass, shadowAtlasImage, farDepth);
+	renderGraph.setRunCondition(shadowAtlasPass, [this]() { return isAtlasDirty; });
+
+	// sort the lights into clusters. they only depend on the camera, so this runs before anything is drawn
+	lightCullingPass = renderGraph.addComputePass("Light Culling", [this](const RenderGraph::PassContext& context)
+		{
+			// the light volumes don't read the clusters
+			if (lightingMode == CLUSTERED)
+				lightClusters.cull(context.commandBuffer, sceneCamera->GetViewMatrix());
+		});
 
-		HelperFunctions::createSampler(normalTexture.sampler, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	renderGraph.writeBuffer(lightCullingPass, clusterBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_WRITE_BIT_KHR);
 
-		// positions
-		HelperFunctions::createImage(dim.width, dim.height, 1, 1,
-			VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			positionTexture.image, positionTexture.imageMemory);
+	// render the G-Buffer, first subpass
+	geometryPass = renderGraph.addGraphicsPass("G-Buffer", [this](const RenderGraph::PassContext& context)
+		{
+			// the culled draws are split evenly over the worker threads
+			parallelRecorder.recordSubpass(context.commandBuffer, context.beginInfo, context.subpass, context.subpassCount, recorder,
+				parallelRecorder.getThreadCount(),
+				[&](CommandRecorder& passRecorder, uint32_t job, uint32_t jobCount)
+				{
+					VkCommandBuffer commandBuffer = passRecorder.getCommandBuffer();
+					vkCmdSetViewport(commandBuffer, 0, 1, &offscreenPipeline.viewport);
+					vkCmdSetScissor(commandBuffer, 0, 1, &offscreenPipeline.scissors);
+
+					passRecorder.bindPipeline(offscreenPipeline.pipeline);
+					passRecorder.bindDescriptorSet(offscreenPipeline.pipelineLayout, 0, offscreenPipeline.descriptorSets[0]);
+
+					culler.draw(passRecorder, offscreenPipeline.pipelineLayout, 0, 1, job, jobCount);
+				});
+		});
+
+	// same order as the fragment shader outputs
+	renderGraph.writeColor(geometryPass, colorImage, black);
+	renderGraph.writeColor(geometryPass, normalImage, black);
+	renderGraph.writeDepth(geometryPass, depthImage, farDepth);
+
+	// compose the final scene, second subpass
+	compositionPass = renderGraph.addGraphicsPass("Composition", [this](const RenderGraph::PassContext& context)
+		{
+			uint32_t index = context.imageIndex;
+
+			parallelRecorder.recordSubpass(context.commandBuffer, context.beginInfo, context.subpass, context.subpassCount, recorder, 1,
+				[&](CommandRecorder& passRecorder, uint32_t job, uint32_t jobCount)
+				{
+					VkCommandBuffer commandBuffer = passRecorder.getCommandBuffer();
+					vkCmdSetViewport(commandBuffer, 0, 1, &compositionPipeline.viewport);
+					vkCmdSetScissor(commandBuffer, 0, 1, &compositionPipeline.scissors);
+
+					passRecorder.bindPipeline(lightingMode == CLUSTERED ? compositionPipeline.pipeline : ambientPipeline);
+					passRecorder.bindDescriptorSet(compositionPipeline.pipelineLayout, 0, compositionPipeline.descriptorSets[index]);
+					passRecorder.bindDescriptorSet(compositionPipeline.pipelineLayout, 1, lightClusters.getDescriptorSet());
+					passRecorder.bindDescriptorSet(compositionPipeline.pipelineLayout, 2, shadowAtlas.getDescriptorSet());
+					vkCmdPushConstants(commandBuffer, compositionPipeline.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(int32_t), &gBufferView);
+
+					passRecorder.draw(3, 1, 0, 0);
+
+					if (lightingMode == LIGHT_VOLUMES && gBufferView == LIT)
+					{
+						// one sphere per light, first marking where the surface is inside, then shading those pixels
+						Mesh* sphere = BasicShapes::getSphere();
+						uint32_t indexCount = static_cast<uint32_t>(sphere->indices.size());
+
+						passRecorder.bindVertexBuffers(0, 1, &sphere->vertexBuffer.buffer);
+						passRecorder.bindIndexBuffer(sphere->indexBuffer.buffer);
+
+						passRecorder.bindPipeline(stencilPipeline);
+						passRecorder.drawIndexed(indexCount, lightClusters.getLightCount(), 0, 0, 0);
+
+						passRecorder.bindPipeline(lightVolumePipeline);
+						passRecorder.drawIndexed(indexCount, lightClusters.getLightCount(), 0, 0, 0);
+					}
+				},
+				[&](VkCommandBuffer commandBuffer) { DrawUI(commandBuffer, index); });
+		});
+
+	// same pixel reads, which make the composition pass a subpass of the g-buffer's render pass
+	renderGraph.readAttachment(compositionPass, colorImage);
+	renderGraph.readAttachment(compositionPass, normalImage);
+	renderGraph.readAttachment(compositionPass, depthImage);
+	renderGraph.writeStencil(compositionPass, depthImage);
+	renderGraph.readBuffer(compositionPass, clusterBuffer, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_READ_BIT_KHR);
+	renderGraph.readTexture(compositionPass, shadowAtlasImage);
+	renderGraph.writeColor(compositionPass, swapChainImage, black);
+
+	renderGraph.compile();
+	shadowAtlas.setImage(renderGraph.getImageView(shadowAtlasImage), renderGraph.getReadLayout(shadowAtlasImage));
+}
 
-		HelperFunctions::createImageView(positionTexture.image, positionTexture.imageView,
-			VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D, 1);
 
-		HelperFunctions::createSampler(positionTexture.sampler, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-	}
+// OFFSCREEN PIPELINE GENERATION
 
+void DeferredRendering::CreateOffscreenPipelineResources(const VulkanSwapChain& swapChain)
+{
 	// uniform buffer
 	{
 		offscreenPipeline.uniformBuffers.resize(1);
@@ -574,139 +746,15 @@ void DeferredRendering::CreateOffscreenPipelineResources(const VulkanSwapChain&
 	}
 }
 
-void DeferredRendering::CreateOffscreenRenderPass(const VulkanSwapChain& swapChain)
-{
-	VkAttachmentDescription colorDesc = {}, depthDesc = {}, normalDesc = {}, posDesc = {};
-	// color
-	colorDesc.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorDesc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	colorDesc.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-	colorDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-	// depth
-	depthDesc.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthDesc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	depthDesc.format = VK_FORMAT_D16_UNORM;
-	depthDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	depthDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-	// normals
-	normalDesc.samples = VK_SAMPLE_COUNT_1_BIT;
-	normalDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	normalDesc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	normalDesc.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-	normalDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	normalDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	normalDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	normalDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-	// positions
-	posDesc.samples = VK_SAMPLE_COUNT_1_BIT;
-	posDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	posDesc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	posDesc.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-	posDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	posDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	posDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	posDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-	VkAttachmentReference colorRef = {}, depthRef = {}, normalRef = {}, posRef = {};
-
-	colorRef.attachment = 0;
-	colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	depthRef.attachment = 1;
-	depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	normalRef.attachment = 2;
-	normalRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	posRef.attachment = 3;
-	posRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-
-	std::array<VkAttachmentReference, 3> colorAttachmentReferences;
-	colorAttachmentReferences[0] = colorRef;
-	colorAttachmentReferences[1] = normalRef;
-	colorAttachmentReferences[2] = posRef;
-
-	std::array<VkAttachmentDescription, 4> attachments;
-	attachments[0] = colorDesc;
-	attachments[1] = depthDesc;
-	attachments[2] = normalDesc;
-	attachments[3] = posDesc;
-
-	VkSubpassDescription subpassDesc = {};
-	subpassDesc.colorAttachmentCount = 3;
-	subpassDesc.pColorAttachments = colorAttachmentReferences.data();
-	subpassDesc.pDepthStencilAttachment = &depthRef;
-	subpassDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-
-	std::array<VkSubpassDependency,2> dependencies;
-	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[0].dstSubpass = 0;
-	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	dependencies[1].srcSubpass = 0;
-	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-	// mine
-	/*
-	// wait for composition pipeline to finish reading from g-buffer textures
-	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[0].dstSubpass = 0;
-	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	dependencies[0].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-	dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	// after rendering g-buffer, transition images to readable layout
-	dependencies[1].srcSubpass = 0;
-	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[1].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-	*/
-	
-
-	VkRenderPassCreateInfo rpCreateInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
-	rpCreateInfo.attachmentCount = 4;
-	rpCreateInfo.pAttachments = attachments.data();
-	rpCreateInfo.dependencyCount = 2;
-	rpCreateInfo.pDependencies = dependencies.data();
-	rpCreateInfo.subpassCount = 1;
-	rpCreateInfo.pSubpasses = &subpassDesc;
-
-	if (vkCreateRenderPass(logicalDevice, &rpCreateInfo, nullptr, &renderPass) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create offscreen render pass");
-}
-
 void DeferredRendering::CreateOffscreenPipeline(const VulkanSwapChain& swapChain)
 {
 	VkExtent2D dim = swapChain.swapChainDimensions;
 
-	VkVertexInputBindingDescription bindings = ModelVertex::getBindingDescription();
-	std::array<VkVertexInputAttributeDescription, 3> attributes = ModelVertex::getAttributeDescriptions();
+	// vertices plus the culler's per instance object indices
+	std::array<VkVertexInputBindingDescription, 2> bindings = GPUCuller::getBindingDescriptions();
+	std::array<VkVertexInputAttributeDescription, 4> attributes = GPUCuller::getAttributeDescriptions();
 	
-	VkPipelineColorBlendAttachmentState attachmentStates[3] = {};
+	VkPipelineColorBlendAttachmentState attachmentStates[2] = {};
 	{
 		attachmentStates[0].blendEnable = VK_TRUE;
 		attachmentStates[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -718,15 +766,14 @@ void DeferredRendering::CreateOffscreenPipeline(const VulkanSwapChain& swapChain
 		attachmentStates[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 
 		attachmentStates[1] = attachmentStates[0];
-		attachmentStates[2] = attachmentStates[0];
 	}
 
 	VkDynamicState states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
 	auto dynamicState = HelperFunctions::initializers::pipelineDynamicStateCreateInfo(2, states);
 	auto inputAssemblyState = HelperFunctions::initializers::pipelineInputAssemblyStateCreateInfo();
-	auto vertexInputState = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo(1, bindings, 3, attributes.data());
-	auto colorBlendState = HelperFunctions::initializers::pipelineColorBlendStateCreateInfo(3, *attachmentStates);
+	auto vertexInputState = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo(2, bindings[0], 4, attributes.data());
+	auto colorBlendState = HelperFunctions::initializers::pipelineColorBlendStateCreateInfo(2, *attachmentStates);
 	auto multisampleState = HelperFunctions::initializers::pipelineMultisampleStateCreateInfo();
 	auto depthStencilState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
 	auto rasterizerState = HelperFunctions::initializers::pipelineRasterizationStateCreateInfo();
@@ -755,9 +802,8 @@ void DeferredRendering::CreateOffscreenPipeline(const VulkanSwapChain& swapChain
 		HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragModule),
 	};
 
-	Mesh* box = BasicShapes::getBox();
-	VkDescriptorSetLayout layouts[] = { offscreenPipeline.descriptorSetLayout, box->descriptorSetLayout, box->material->descriptorSetLayout };
-	auto layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(3, layouts);
+	VkDescriptorSetLayout layouts[] = { offscreenPipeline.descriptorSetLayout, culler.getDescriptorSetLayout() };
+	auto layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(2, layouts);
 	if (vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &offscreenPipeline.pipelineLayout) != VK_SUCCESS)
 		throw std::runtime_error("failed to create offscreen pipeline layout");
 
@@ -773,8 +819,8 @@ void DeferredRendering::CreateOffscreenPipeline(const VulkanSwapChain& swapChain
 	info.stageCount = 2;
 	info.pStages = shaderStages;
 	info.layout = offscreenPipeline.pipelineLayout;
-	info.renderPass = renderPass;
-	info.subpass = 0;
+	info.renderPass = renderGraph.getRenderPass(geometryPass);
+	info.subpass = renderGraph.getSubpass(geometryPass);
 
 	if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &info, nullptr, &offscreenPipeline.pipeline) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create offscreen graphics pipeline");
@@ -783,29 +829,6 @@ void DeferredRendering::CreateOffscreenPipeline(const VulkanSwapChain& swapChain
 	vkDestroyShaderModule(logicalDevice, fragModule, nullptr);
 }
 
-void DeferredRendering::CreateOffscreenFramebuffers(const VulkanSwapChain& swapChain)
-{
-	VkExtent2D dim = swapChain.swapChainDimensions;
-	VkImageView attachments[] = { colorTexture.imageView, offscreenPipeline.depthStencilBufferView, normalTexture.imageView, positionTexture.imageView };
-
-	VkFramebufferCreateInfo fbInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
-	fbInfo.attachmentCount = 4;
-	fbInfo.pAttachments = attachments;
-	fbInfo.layers = 1;
-	fbInfo.width = dim.width;
-	fbInfo.height = dim.height;
-	fbInfo.renderPass = renderPass;
-
-	size_t numImages = swapChain.swapChainImages.size();
-	offscreenPipeline.framebuffers.resize(numImages);
-	for (int i = 0; i < numImages; i++)
-	{
-		if (vkCreateFramebuffer(logicalDevice, &fbInfo, nullptr, &offscreenPipeline.framebuffers[i]) != VK_SUCCESS)
-			throw std::runtime_error("failed to create one or more framebuffers");
-	}
-}
-
-
 // COMPOSITION PIPELINE GENERATION
 
 void DeferredRendering::CreateCompositionPipelineResources(const VulkanSwapChain& swapChain)
@@ -829,13 +852,13 @@ void DeferredRendering::CreateCompositionPipelineResources(const VulkanSwapChain
 		VkDescriptorPoolSize poolSizes[2] = 
 		{
 			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,9}
+			{VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,9}
 		};
 
 		VkDescriptorPoolCreateInfo poolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
 		poolCreateInfo.poolSizeCount = 2;
 		poolCreateInfo.pPoolSizes = poolSizes;
-		poolCreateInfo.maxSets = 12; // 1 uniform buffer + 3 textures PER frame = 12 total sets
+		poolCreateInfo.maxSets = 12; // 1 uniform buffer + 3 input attachments PER frame = 12 total sets
 		if (vkCreateDescriptorPool(logicalDevice, &poolCreateInfo, nullptr, &compositionPipeline.descriptorPool) != VK_SUCCESS)
 			throw std::runtime_error("failed to create composition pipeline descriptor pool");
 
@@ -843,19 +866,19 @@ void DeferredRendering::CreateCompositionPipelineResources(const VulkanSwapChain
 		VkDescriptorSetLayoutBinding bindings[4] = {};
 		
 		bindings[0].binding = 0;
-		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
 		bindings[0].descriptorCount = 1;
 		bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 		bindings[0].pImmutableSamplers = nullptr;
 		
 		bindings[1].binding = 1;
-		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
 		bindings[1].descriptorCount = 1;
 		bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 		bindings[1].pImmutableSamplers = nullptr;
 		
 		bindings[2].binding = 2;
-		bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
 		bindings[2].descriptorCount = 1;
 		bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 		bindings[2].pImmutableSamplers = nullptr;
@@ -863,7 +886,7 @@ void DeferredRendering::CreateCompositionPipelineResources(const VulkanSwapChain
 		bindings[3].binding = 3;
 		bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		bindings[3].descriptorCount = 1;
-		bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		bindings[3].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 		bindings[3].pImmutableSamplers = nullptr;
 
 		VkDescriptorSetLayoutCreateInfo layoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
@@ -887,18 +910,17 @@ void DeferredRendering::CreateCompositionPipelineResources(const VulkanSwapChain
 		bufferInfo.offset = 0;
 		bufferInfo.range = sizeof(compositionUBO);
 
+		// input attachments are read at the fragment's own pixel, without a sampler
 		VkDescriptorImageInfo imagesInfo[3] = {};
-		imagesInfo[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imagesInfo[0].imageView = colorTexture.imageView;
-		imagesInfo[0].sampler = colorTexture.sampler;
+		imagesInfo[0].imageLayout = renderGraph.getReadLayout(colorImage);
+		imagesInfo[0].imageView = renderGraph.getImageView(colorImage);
 
-		imagesInfo[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imagesInfo[1].imageView = normalTexture.imageView;
-		imagesInfo[1].sampler = normalTexture.sampler;
+		imagesInfo[1].imageLayout = renderGraph.getReadLayout(normalImage);
+		imagesInfo[1].imageView = renderGraph.getImageView(normalImage);
 
-		imagesInfo[2].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imagesInfo[2].imageView = positionTexture.imageView;
-		imagesInfo[2].sampler = positionTexture.sampler;
+		// depth only view, in the read only depth layout
+		imagesInfo[2].imageLayout = renderGraph.getReadLayout(depthImage);
+		imagesInfo[2].imageView = renderGraph.getImageView(depthImage);
 		
 		VkWriteDescriptorSet writes[4] = {};
 
@@ -906,21 +928,21 @@ void DeferredRendering::CreateCompositionPipelineResources(const VulkanSwapChain
 		{
 			// image writes
 			writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
 			writes[0].descriptorCount = 1;
 			writes[0].dstBinding = 0;
 			writes[0].dstSet = compositionPipeline.descriptorSets[i];
 			writes[0].pImageInfo = &imagesInfo[0];
 
 			writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
 			writes[1].descriptorCount = 1;
 			writes[1].dstBinding = 1;
 			writes[1].dstSet = compositionPipeline.descriptorSets[i];
 			writes[1].pImageInfo = &imagesInfo[1];
 
 			writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			writes[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[2].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
 			writes[2].descriptorCount = 1;
 			writes[2].dstBinding = 2;
 			writes[2].dstSet = compositionPipeline.descriptorSets[i];
@@ -943,51 +965,6 @@ void DeferredRendering::CreateCompositionPipelineResources(const VulkanSwapChain
 	}
 }
 
-void DeferredRendering::CreateCompositionRenderPass(const VulkanSwapChain& swapChain)
-{
-	VkAttachmentDescription attachment = {};
-	attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-	attachment.format = swapChain.swapChainImageFormat;
-	attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-	VkAttachmentReference reference = {};
-	reference.attachment = 0;
-	reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpassDesc = {};
-	subpassDesc.colorAttachmentCount = 1;
-	subpassDesc.pColorAttachments = &reference;
-	subpassDesc.pDepthStencilAttachment = nullptr;
-
-	VkSubpassDependency dependency;
-	
-	// wait for previous frame to finish
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependency.dependencyFlags = 0;
-
-	VkRenderPassCreateInfo rpCreateInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
-	rpCreateInfo.attachmentCount = 1;
-	rpCreateInfo.pAttachments = &attachment;
-	rpCreateInfo.dependencyCount = 1;
-	rpCreateInfo.pDependencies = &dependency;
-	rpCreateInfo.subpassCount = 1;
-	rpCreateInfo.pSubpasses = &subpassDesc;
-	
-	if (vkCreateRenderPass(logicalDevice, &rpCreateInfo, nullptr, &renderPass) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create composition render pass");
-
-}
-
 void DeferredRendering::CreateCompositionPipeline(const VulkanSwapChain& swapChain)
 {
 	VkExtent2D dim = swapChain.swapChainDimensions;
@@ -1009,7 +986,7 @@ void DeferredRendering::CreateCompositionPipeline(const VulkanSwapChain& swapCha
 	auto vertexInputState = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo();
 	auto colorBlendState = HelperFunctions::initializers::pipelineColorBlendStateCreateInfo(1, blendAttachmentState);
 	auto multisampleState = HelperFunctions::initializers::pipelineMultisampleStateCreateInfo();
-	auto depthStencilState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+	auto depthStencilState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_FALSE, VK_FALSE); // the depth is read only here
 	auto rasterizerState = HelperFunctions::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_FRONT_BIT);
 	auto viewportState = HelperFunctions::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
 
@@ -1036,7 +1013,15 @@ void DeferredRendering::CreateCompositionPipeline(const VulkanSwapChain& swapCha
 		HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragModule),
 	};
 
-	auto layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(1, &compositionPipeline.descriptorSetLayout);
+	// which g-buffer view to output
+	VkPushConstantRange push = {};
+	push.offset = 0;
+	push.size = sizeof(int32_t);
+	push.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayout layouts[] = { compositionPipeline.descriptorSetLayout, lightClusters.getDescriptorSetLayout(),
+		shadowAtlas.getDescriptorSetLayout() };
+	auto layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(3, layouts, 1, &push);
 	if (vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &compositionPipeline.pipelineLayout) != VK_SUCCESS)
 		throw std::runtime_error("failed to create composition pipeline layout");
 
@@ -1052,39 +1037,181 @@ void DeferredRendering::CreateCompositionPipeline(const VulkanSwapChain& swapCha
 	pipelineInfo.stageCount = 2;
 	pipelineInfo.pStages = shaderStages;
 	pipelineInfo.layout = compositionPipeline.pipelineLayout;
-	pipelineInfo.renderPass = renderPass;
-	pipelineInfo.subpass = 0;
+	pipelineInfo.renderPass = renderGraph.getRenderPass(compositionPass);
+	pipelineInfo.subpass = renderGraph.getSubpass(compositionPass);
 
 	if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &compositionPipeline.pipeline) != VK_SUCCESS)
 		throw std::runtime_error("failed to create composition pipeline");
 
+	// the same shader without the clustered lights, for the light volumes to add onto.
+	// CLUSTERED_LIGHTS is constant 2, the shadow filter keeps its defaults
+	VkBool32 clusteredLights = VK_FALSE;
+	VkSpecializationMapEntry entry = { 2, 0, sizeof(VkBool32) };
+	VkSpecializationInfo specialization = { 1, &entry, sizeof(VkBool32), &clusteredLights };
+	shaderStages[1].pSpecializationInfo = &specialization;
+
+	if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &ambientPipeline) != VK_SUCCESS)
+		throw std::runtime_error("failed to create ambient pipeline");
+
 	vkDestroyShaderModule(logicalDevice, vertModule, nullptr);
 	vkDestroyShaderModule(logicalDevice, fragModule, nullptr);
 }
 
-void DeferredRendering::CreateCompositionFramebuffers(const VulkanSwapChain& swapChain)
+// LIGHT VOLUME PIPELINES
+
+void DeferredRendering::CreateLightVolumePipelines(const VulkanSwapChain& swapChain)
 {
-	size_t numImages = swapChain.swapChainImages.size();
-	compositionPipeline.framebuffers.resize(numImages);
-	VkExtent2D dim = swapChain.swapChainDimensions;
+	// both draw the sphere instanced over the lights in the composition subpass, with the composition layout
+	VkVertexInputBindingDescription binding = ModelVertex::getBindingDescription();
+	std::array<VkVertexInputAttributeDescription, 3> attributes = ModelVertex::getAttributeDescriptions();
 
-	VkFramebufferCreateInfo fbInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
-	fbInfo.attachmentCount = 1;
-	fbInfo.width = dim.width;
-	fbInfo.height = dim.height;
-	fbInfo.layers = 1;
-	fbInfo.renderPass = renderPass;
-	
-	for (size_t i = 0; i < numImages; i++)
+	// the stencil pass writes no color, the light pass adds its light onto the ambient term
+	VkPipelineColorBlendAttachmentState blendAttachmentState = {};
+	blendAttachmentState.blendEnable = VK_TRUE;
+	blendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	blendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+	blendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+	blendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+
+	VkDynamicState states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	auto dynamicState = HelperFunctions::initializers::pipelineDynamicStateCreateInfo(2, states);
+	auto inputAssemblyState = HelperFunctions::initializers::pipelineInputAssemblyStateCreateInfo();
+	auto vertexInputState = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo(1, binding, 3, attributes.data());
+	auto colorBlendState = HelperFunctions::initializers::pipelineColorBlendStateCreateInfo(1, blendAttachmentState);
+	auto multisampleState = HelperFunctions::initializers::pipelineMultisampleStateCreateInfo();
+	auto viewportState = HelperFunctions::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
+	viewportState.pViewports = &compositionPipeline.viewport;
+	viewportState.pScissors = &compositionPipeline.scissors;
+
+	// two sided stencil, counting the faces behind the surface. a front face behind it decrements and a back face
+	// increments, so only a surface inside the sphere is left with a count. every light counts into the same
+	// stencil, the light shader rejects the pixels that are inside another light's sphere but not its own
+	auto stencilDepthState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL);
+	stencilDepthState.stencilTestEnable = VK_TRUE;
+	stencilDepthState.front = { VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_DECREMENT_AND_WRAP, VK_COMPARE_OP_ALWAYS, 0xff, 0xff, 0 };
+	stencilDepthState.back = { VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_INCREMENT_AND_WRAP, VK_COMPARE_OP_ALWAYS, 0xff, 0xff, 0 };
+	auto stencilRasterizerState = HelperFunctions::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE);
+
+	// back faces only, so the camera can be inside a light, and each pixel is shaded once per light
+	auto lightDepthState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_FALSE, VK_FALSE);
+	lightDepthState.stencilTestEnable = VK_TRUE;
+	lightDepthState.front = { VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_NOT_EQUAL, 0xff, 0, 0 };
+	lightDepthState.back = lightDepthState.front;
+	auto lightRasterizerState = HelperFunctions::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_FRONT_BIT);
+
+	auto vertCode = HelperFunctions::readShaderFile(SHADERPATH"DeferredRendering/light_volume_vert.spv");
+	VkShaderModule vertModule = HelperFunctions::CreateShaderModules(vertCode);
+
+	auto fragCode = HelperFunctions::readShaderFile(SHADERPATH"DeferredRendering/light_volume_frag.spv");
+	VkShaderModule fragModule = HelperFunctions::CreateShaderModules(fragCode);
+
+	// the mesh's faces sit inside its bounding sphere, scale it up a little so they cover the light's whole radius
+	float volumeScale = 1.1f / BasicShapes::getSphere()->boundingSphere.w;
+	VkSpecializationMapEntry entry = { 0, 0, sizeof(float) };
+	VkSpecializationInfo specialization = { 1, &entry, sizeof(float), &volumeScale };
+
+	VkPipelineShaderStageCreateInfo shaderStages[] =
 	{
-		fbInfo.pAttachments = &swapChain.swapChainImageViews[i];
-		if (vkCreateFramebuffer(logicalDevice, &fbInfo, nullptr, &compositionPipeline.framebuffers[i]) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create one of more framebuffers");
-	}
+		HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertModule),
+		HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragModule),
+	};
+	shaderStages[0].pSpecializationInfo = &specialization;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+	pipelineInfo.pInputAssemblyState = &inputAssemblyState;
+	pipelineInfo.pVertexInputState = &vertexInputState;
+	pipelineInfo.pColorBlendState = &colorBlendState;
+	pipelineInfo.pMultisampleState = &multisampleState;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.layout = compositionPipeline.pipelineLayout;
+	pipelineInfo.renderPass = renderGraph.getRenderPass(compositionPass);
+	pipelineInfo.subpass = renderGraph.getSubpass(compositionPass);
+
+	pipelineInfo.pDepthStencilState = &lightDepthState;
+	pipelineInfo.pRasterizationState = &lightRasterizerState;
+	pipelineInfo.stageCount = 2;
+
+	if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &lightVolumePipeline) != VK_SUCCESS)
+		throw std::runtime_error("failed to create light volume pipeline");
+
+	// the stencil pass has no fragment shader
+	blendAttachmentState.blendEnable = VK_FALSE;
+	blendAttachmentState.colorWriteMask = 0;
+	pipelineInfo.pDepthStencilState = &stencilDepthState;
+	pipelineInfo.pRasterizationState = &stencilRasterizerState;
+	pipelineInfo.stageCount = 1;
+
+	if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &stencilPipeline) != VK_SUCCESS)
+		throw std::runtime_error("failed to create light volume stencil pipeline");
+
+	vkDestroyShaderModule(logicalDevice, vertModule, nullptr);
+	vkDestroyShaderModule(logicalDevice, fragModule, nullptr);
 }
 
+// SHADOW ATLAS PIPELINE
+
+void DeferredRendering::CreateShadowAtlasPipeline()
+{
+	// vertices plus the culler's per instance object indices, no color attachments
+	std::array<VkVertexInputBindingDescription, 2> bindings = GPUCuller::getBindingDescriptions();
+	std::array<VkVertexInputAttributeDescription, 4> attributes = GPUCuller::getAttributeDescriptions();
+	VkPipelineColorBlendAttachmentState blendAttachmentState = {};
+
+	// every tile sets its own viewport
+	VkDynamicState states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	auto dynamicState = HelperFunctions::initializers::pipelineDynamicStateCreateInfo(2, states);
+	auto inputAssemblyState = HelperFunctions::initializers::pipelineInputAssemblyStateCreateInfo();
+	auto vertexInputState = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo(2, bindings[0], 4, attributes.data());
+	auto colorBlendState = HelperFunctions::initializers::pipelineColorBlendStateCreateInfo(0, blendAttachmentState);
+	auto multisampleState = HelperFunctions::initializers::pipelineMultisampleStateCreateInfo();
+	auto depthStencilState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+	auto viewportState = HelperFunctions::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
 
+	// the plane is one sided and the cube faces see the spheres from inside, so nothing is culled
+	auto rasterizerState = HelperFunctions::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE);
+	rasterizerState.depthBiasEnable = VK_TRUE;
+	rasterizerState.depthBiasConstantFactor = depthBiasConstant;
+	rasterizerState.depthBiasSlopeFactor = depthBiasSlope;
 
+	auto vertCode = HelperFunctions::readShaderFile(SHADERPATH"DeferredRendering/atlas_shadow_vert.spv");
+	VkShaderModule vertModule = HelperFunctions::CreateShaderModules(vertCode);
+	VkPipelineShaderStageCreateInfo shaderStage = HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertModule);
 
+	// the tile's view projection
+	VkPushConstantRange push = {};
+	push.offset = 0;
+	push.size = sizeof(glm::mat4);
+	push.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+	VkDescriptorSetLayout layout = culler.getDescriptorSetLayout();
+	auto layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(1, &layout, 1, &push);
+	if (vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &atlasPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("failed to create shadow atlas pipeline layout");
 
+	VkGraphicsPipelineCreateInfo info = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+	info.pInputAssemblyState = &inputAssemblyState;
+	info.pVertexInputState = &vertexInputState;
+	info.pColorBlendState = &colorBlendState;
+	info.pDepthStencilState = &depthStencilState;
+	info.pMultisampleState = &multisampleState;
+	info.pDynamicState = &dynamicState;
+	info.pRasterizationState = &rasterizerState;
+	info.pViewportState = &viewportState;
+	info.stageCount = 1;
+	info.pStages = &shaderStage;
+	info.layout = atlasPipelineLayout;
+	info.renderPass = renderGraph.getRenderPass(shadowAtlasPass);
+	info.subpass = renderGraph.getSubpass(shadowAtlasPass);
+
+	if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &info, nullptr, &atlasPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create shadow atlas pipeline");
+
+	vkDestroyShaderModule(logicalDevice, vertModule, nullptr);
+}
@@ -2,12 +2,12 @@
 #include "VulkanScene.h"
 #include <random>
 #include "Renderer/UI.h"
+#include "Renderer/GPUCulling.h"
+#include "Renderer/ParallelRecorder.h"
+#include "Renderer/RenderGraph.h"
+#include "Renderer/LightClusters.h"
+#include "Renderer/ShadowAtlas.h"
 
-/* TO DO
-* since render pass was removed from graphics pipeline helper struct,
-* we need to refactor code so both pipelines share the same render pass
-* need to use multiple subpasses?
-*/
 class DeferredRendering : public VulkanScene
 {
 public:
@@ -22,15 +22,54 @@ private:
 	// offscreen pipeline renders the scene to G-buffer textures
 	// composition pipeline renders to a full screen quad to display the scene
 	VulkanGraphicsPipeline offscreenPipeline, compositionPipeline;
-	VkRenderPass renderPass;
+
+	// owns the g-buffer and the render pass both passes are subpasses of. the composition subpass reads the
+	// g-buffer as input attachments, so it's transient and never written out to memory
+	RenderGraph renderGraph;
+	uint32_t shadowAtlasPass, lightCullingPass, geometryPass, compositionPass;
+	uint32_t shadowAtlasImage, colorImage, normalImage, depthImage, clusterBuffer;
+
+	// the composition pass only shades with the lights in each pixel's cluster
+	LightClusters lightClusters;
+	const uint32_t MAX_LIGHTS = 4096;
+	const float NEAR_PLANE = 0.1f, FAR_PLANE = 1000.0f, FIELD_OF_VIEW = 45.0f;
+
+	// the lights closest to or largest on screen cast shadows, packed into one atlas. every tile has its own
+	// culler view after the camera's. the atlas is only drawn again when its tiles or the objects move
+	ShadowAtlas shadowAtlas;
+	std::vector<ShadowRequest> shadowRequests; // one per light, in light order
+	bool castShadows = true;
+	bool isAtlasValid = false, isAtlasDirty = false;
+	uint64_t atlasTransformVersion = 0;
+	VkPipelineLayout atlasPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline atlasPipeline = VK_NULL_HANDLE;
+	float depthBiasConstant = 1.25f, depthBiasSlope = 1.75f;
+
+	// or, with light volumes, the composition pass only draws the ambient term over the whole screen. every
+	// light's sphere then marks the stencil where the g-buffer's surface lies inside it, and is shaded only there
+	enum LightingMode { CLUSTERED = 0, LIGHT_VOLUMES = 1 };
+	int32_t lightingMode = CLUSTERED;
+	VkPipeline ambientPipeline = VK_NULL_HANDLE, stencilPipeline = VK_NULL_HANDLE, lightVolumePipeline = VK_NULL_HANDLE;
+
+	// start and end of every frame on the GPU, two queries per swap chain image, to compare the lighting modes
+	VkQueryPool timestampPool = VK_NULL_HANDLE;
+	std::vector<bool> timestampsWritten;
+	float timestampPeriod = 1.0f; // nanoseconds per tick
+	float gpuFrameTime = 0.0f;	  // milliseconds
 
 	Camera* sceneCamera = nullptr;
 	glm::mat4 proj;
-	Mesh spheres[100], plane;
+	Mesh plane;
+	Material sphereMaterials[100]; // the spheres are culler instances, only their materials live here
+	GPUCuller culler;
+
+	// records each pass into secondary command buffers on worker threads
+	ParallelRecorder parallelRecorder;
 
-	// g-buffer textures
-	Texture colorTexture, normalTexture, positionTexture;
-	VkSampler textureSampler;
+	// what the composition subpass outputs: the lit scene or one of the g-buffer attachments. the g-buffer can't
+	// be sampled by the UI anymore, so the composition shader displays it instead
+	enum GBufferView { LIT = 0, COLORS = 1, NORMALS = 2, POSITIONS = 3, LIGHT_COUNTS = 4 };
+	int32_t gBufferView = LIT;
 
 	struct
 	{
@@ -39,17 +78,12 @@ private:
 		glm::mat4 normalMats[100];
 	} deferredUBO;
 
-	struct SceneLight
-	{
-		glm::vec4 position;
-		glm::vec4 color;
-		float radius;
-		float intensity;
-	};
-
+	// updated every frame
 	struct
 	{
-		SceneLight lights[100];
+		glm::mat4 invViewProj;
+		glm::mat4 viewProj;
+		glm::vec4 screenSize;
 	} compositionUBO;
 
 	UI* ui = nullptr;
@@ -61,23 +95,29 @@ private:
 	virtual void RecreateScene(const VulkanSwapChain& swapChain) override;
 	virtual void DestroyScene(bool isRecreation) override;
 
+	// declares the shadow atlas, light culling, both passes and the g-buffer they share, then compiles the graph
+	void CreateRenderGraph(const VulkanSwapChain& swapChain);
+
 	// deferred pipeline creation
 	void CreateOffscreenPipelineResources(const VulkanSwapChain& swapChain);
-	void CreateOffscreenRenderPass(const VulkanSwapChain& swapChain);
 	void CreateOffscreenPipeline(const VulkanSwapChain& swapChain);
-	void CreateOffscreenFramebuffers(const VulkanSwapChain& swapChain);
 
 	// composition pipeline creation
 	void CreateCompositionPipelineResources(const VulkanSwapChain& swapChain);
-	void CreateCompositionRenderPass(const VulkanSwapChain& swapChain);
 	void CreateCompositionPipeline(const VulkanSwapChain& swapChain);
-	void CreateCompositionFramebuffers(const VulkanSwapChain& swapChain);
+	void CreateLightVolumePipelines(const VulkanSwapChain& swapChain);
+
+	// depth only, one tile at a time
+	void CreateShadowAtlasPipeline();
+
+	// resize and repack the atlas for the camera, cull the tiles when it has to be drawn
+	void UpdateShadowAtlas(VkCommandBuffer commandBuffer);
 
 	void CreateSceneObjects(const VulkanSwapChain& swapChain);
 	void CreateSyncObjects();
-	void CreateCommandBuffers();
+	void CreateCommandBuffers(const VulkanSwapChain& swapChain);
 
 	void Update(uint32_t index);
 	void RecordCommandBuffer(uint32_t index);
-	void DrawUI(uint32_t index);
+	void DrawUI(VkCommandBuffer commandBuffer, uint32_t index);
 };
\ No newline at end of file
@@ -17,7 +17,7 @@ MaterialScene::MaterialScene(std::string name, const VulkanSwapChain& swapChain)
 
 	CreateCommandBuffers();
 
-	ui = new UI(commandPool, swapChain, renderPass, graphicsPipeline);
+	ui = new UI(commandPool, swapChain, renderPass, graphicsPipeline, HelperFunctions::getMaximumSampleCount(), 1);
 }
 
 MaterialScene::~MaterialScene()
@@ -39,7 +39,7 @@ void MaterialScene::RecreateScene(const VulkanSwapChain& swapChain)
 
 	CreateCommandBuffers();
 
-	ui = new UI(commandPool, swapChain, renderPass, graphicsPipeline);
+	ui = new UI(commandPool, swapChain, renderPass, graphicsPipeline, HelperFunctions::getMaximumSampleCount(), 1);
 }
 
 void MaterialScene::RecordScene()
@@ -127,16 +127,15 @@ VulkanReturnValues MaterialScene::PresentScene(const VulkanSwapChain& swapChain)
 
 void MaterialScene::DrawScene(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout, bool useMaterial)
 {
-	for (int i = 0; i < objects.size(); i++)
-	{
-		objects[i].draw(commandBuffer, pipelineLayout, useMaterial);
-	}
+	culler.draw(recorder, pipelineLayout, 0);
 }
 
 void MaterialScene::DestroyScene(bool isRecreation)
 {
 	vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
 	graphicsPipeline.destroyGraphicsPipeline(logicalDevice);
+	vkDestroyPipeline(logicalDevice, depthPipeline, nullptr);
+	descriptorAllocator.reset();
 	msaaTex.destroyTexture();
 
 	uint32_t size = static_cast<uint32_t>(commandBuffersList.size());
@@ -153,10 +152,8 @@ void MaterialScene::DestroyScene(bool isRecreation)
 			vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
 		}
 
-		for (int i = 0; i < objects.size(); i++)
-		{
-			objects[i].destroyMesh();
-		}
+		culler.destroy();
+		lightClusters.destroy();
 	}
 }
 
@@ -229,11 +226,36 @@ void MaterialScene::HandleMouseInput(uint32_t buttons, const int x, const int y,
 		ui->SetMouseCapture(true);
 		ui->AddMouseButtonEvent(0, (buttons & SDL_BUTTON_LMASK) != 0);
 		ui->AddMouseWheelEvent(mouseWheelX, mouseWheelY);
+
+		// only pick on the click itself, and never through a UI window
+		bool leftPressed = (buttons & SDL_BUTTON_LMASK) != 0;
+		if (leftPressed && !wasLeftPressed && !ui->IsMouseOverUI())
+			PickObject();
+
+		wasLeftPressed = leftPressed;
 	}
 
 	
 }
 
+void MaterialScene::PickObject()
+{
+	// renderer passes relative motion to HandleMouseInput, so ask SDL for the cursor position
+	int mouseX, mouseY;
+	SDL_GetMouseState(&mouseX, &mouseY);
+
+	// projection is already flipped for vulkan, so window y maps straight to NDC y
+	glm::vec2 ndc = glm::vec2(mouseX / graphicsPipeline.viewport.width, mouseY / graphicsPipeline.viewport.height) * 2.0f - 1.0f;
+	glm::mat4 invViewProj = glm::inverse(uboScene.proj * uboScene.view);
+
+	glm::vec4 nearPoint = invViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+	glm::vec4 farPoint = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+	glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+	glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+	selectedObject = culler.pick(origin, direction);
+}
+
 void MaterialScene::CreateRenderPass(const VulkanSwapChain& swapChain)
 {
 	
@@ -287,26 +309,34 @@ void MaterialScene::CreateRenderPass(const VulkanSwapChain& swapChain)
 	colorResolveReference.attachment = 2;
 	colorResolveReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-	VkSubpassDescription subpass;
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.flags = 0;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentReference;
-	subpass.inputAttachmentCount = 0;
-	subpass.pInputAttachments = nullptr;
-	subpass.preserveAttachmentCount = 0;
-	subpass.pPreserveAttachments = nullptr;
-	subpass.pDepthStencilAttachment = &depthAttachmentReference;
-	subpass.pResolveAttachments = &colorResolveReference;
-
-	VkSubpassDependency dependency;
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependency.dependencyFlags = 0;
+	// depth pre-pass, no color
+	VkSubpassDescription subpasses[2] = {};
+	subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[0].pDepthStencilAttachment = &depthAttachmentReference;
+
+	// shading, tests against the pre-pass depth
+	subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[1].colorAttachmentCount = 1;
+	subpasses[1].pColorAttachments = &colorAttachmentReference;
+	subpasses[1].pDepthStencilAttachment = &depthAttachmentReference;
+	subpasses[1].pResolveAttachments = &colorResolveReference;
+
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dependencyFlags = 0;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = 1;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
 	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment, colorResolve };
 
@@ -316,10 +346,10 @@ void MaterialScene::CreateRenderPass(const VulkanSwapChain& swapChain)
 	renderPassInfo.flags = 0;
 	renderPassInfo.attachmentCount = 3;
 	renderPassInfo.pAttachments = attachments;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
+	renderPassInfo.subpassCount = 2;
+	renderPassInfo.pSubpasses = subpasses;
+	renderPassInfo.dependencyCount = 2;
+	renderPassInfo.pDependencies = dependencies;
 
 	if (vkCreateRenderPass(logicalDevice, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create render pass");
@@ -331,20 +361,8 @@ void MaterialScene::CreateDescriptorSets(const VulkanSwapChain& swapChain)
 	uint32_t descriptorCount = static_cast<uint32_t>(swapChain.swapChainImages.size());
 
 	// create descriptor sets for UBO
-	VkDescriptorSetLayoutBinding uboBinding = {};
-	uboBinding.binding = 0;
-	uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboBinding.descriptorCount = 1;
-	uboBinding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
-	uboBinding.pImmutableSamplers = nullptr;
-
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = 1;
-	layoutInfo.pBindings = &uboBinding;
-
-	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &graphicsPipeline.descriptorSetLayout) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create descriptor set layout!");
+	graphicsPipeline.descriptorSetLayout = Descriptors::getLayout({
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS) });
 
 	VkDeviceSize bufferSize = sizeof(uboScene);
 	graphicsPipeline.uniformBuffers.resize(descriptorCount);
@@ -359,51 +377,14 @@ void MaterialScene::CreateDescriptorSets(const VulkanSwapChain& swapChain)
 		vkUnmapMemory(logicalDevice, graphicsPipeline.uniformBuffers[i].bufferMemory);
 	}
 
-	// allocate a descriptor set for each frame
-	VkDescriptorPoolSize poolSizes[2] = {};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = descriptorCount;
-
-	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = descriptorCount;
-
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = 2;
-	poolInfo.pPoolSizes = poolSizes;
-	poolInfo.maxSets = 2 * descriptorCount;
-
-	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &graphicsPipeline.descriptorPool) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create descriptor pool");
-	graphicsPipeline.isDescriptorPoolEmpty = false;
-	
-	std::vector<VkDescriptorSetLayout> layout(descriptorCount, graphicsPipeline.descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = graphicsPipeline.descriptorPool;
-	allocInfo.descriptorSetCount = descriptorCount;
-	allocInfo.pSetLayouts = layout.data();
+	// allocate a descriptor set for each frame from the scene's allocator
 	graphicsPipeline.descriptorSets.resize(descriptorCount);
 
-	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, graphicsPipeline.descriptorSets.data()) != VK_SUCCESS)
-		throw std::runtime_error("Failed to allocate descriptor sets");
-
 	for (size_t i = 0; i < descriptorCount; i++)
 	{
-		VkDescriptorBufferInfo bufferInfo = {};
-		bufferInfo.buffer = graphicsPipeline.uniformBuffers[i].buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(uboScene);
-
-		VkWriteDescriptorSet descriptorWrite = {};
-		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrite.dstSet = graphicsPipeline.descriptorSets[i];
-		descriptorWrite.dstBinding = 0;
-		descriptorWrite.dstArrayElement = 0;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrite.pBufferInfo = &bufferInfo;
-		vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, nullptr);
+		graphicsPipeline.descriptorSets[i] = descriptorAllocator.allocate(graphicsPipeline.descriptorSetLayout);
+		Descriptors::write(graphicsPipeline.descriptorSets[i], graphicsPipeline.descriptorSetLayout,
+			{ DescriptorInfo(graphicsPipeline.uniformBuffers[i].buffer, 0, sizeof(uboScene)) });
 	}
 }
 
@@ -472,9 +453,10 @@ void MaterialScene::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	VkExtent2D dim = swapChain.swapChainDimensions;
 
 #pragma region SETUP
-	VkVertexInputBindingDescription bindingDescription = ModelVertex::getBindingDescription();
-	std::array<VkVertexInputAttributeDescription, 3> attributeDescription = ModelVertex::getAttributeDescriptions();
-	VkPipelineVertexInputStateCreateInfo vertexInputState = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo(1, bindingDescription, 3, attributeDescription.data());
+	// vertices plus the culler's per instance object indices
+	std::array<VkVertexInputBindingDescription, 2> bindingDescription = GPUCuller::getBindingDescriptions();
+	std::array<VkVertexInputAttributeDescription, 4> attributeDescription = GPUCuller::getAttributeDescriptions();
+	VkPipelineVertexInputStateCreateInfo vertexInputState = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo(2, bindingDescription[0], 4, attributeDescription.data());
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = HelperFunctions::initializers::pipelineInputAssemblyStateCreateInfo();
 	VkPipelineRasterizationStateCreateInfo rasterizerState = HelperFunctions::initializers::pipelineRasterizationStateCreateInfo();
@@ -494,7 +476,8 @@ void MaterialScene::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	colorBlendingAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
 	VkPipelineColorBlendStateCreateInfo colorBlendState = HelperFunctions::initializers::pipelineColorBlendStateCreateInfo(1, colorBlendingAttachment);
-	VkPipelineDepthStencilStateCreateInfo depthStencilState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+	// the pre-pass already wrote the closest depth, so shading only needs to match it
+	VkPipelineDepthStencilStateCreateInfo depthStencilState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_FALSE, VK_COMPARE_OP_EQUAL);
 
 
 	// viewport
@@ -512,7 +495,7 @@ void MaterialScene::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	viewportState.pScissors = &graphicsPipeline.scissors;
 	
 
-	VkDescriptorSetLayout setLayouts[] = { graphicsPipeline.descriptorSetLayout, objects[0].descriptorSetLayout, objects[0].material->descriptorSetLayout};
+	VkDescriptorSetLayout setLayouts[] = { graphicsPipeline.descriptorSetLayout, culler.getDescriptorSetLayout(), lightClusters.getDescriptorSetLayout() };
 	VkPipelineLayoutCreateInfo layoutInfo = {};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	layoutInfo.pushConstantRangeCount = 0;
@@ -552,7 +535,7 @@ void MaterialScene::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	pipelineInfo.basePipelineIndex = -1;
 	pipelineInfo.renderPass = renderPass;
 	pipelineInfo.layout = graphicsPipeline.pipelineLayout;
-	pipelineInfo.subpass = 0;
+	pipelineInfo.subpass = 1;
 	pipelineInfo.pViewportState = &viewportState;
 	pipelineInfo.stageCount = 2;
 	pipelineInfo.pStages = shaderStages;
@@ -560,6 +543,19 @@ void MaterialScene::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &graphicsPipeline.pipeline) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create graphics pipeline");
 
+	// the depth pre-pass: same vertex shader, no fragment shader and nothing to blend
+	VkPipelineColorBlendStateCreateInfo depthColorBlendState = HelperFunctions::initializers::pipelineColorBlendStateCreateInfo(0, colorBlendingAttachment);
+	VkPipelineDepthStencilStateCreateInfo depthPrePassState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+	multisampleState.sampleShadingEnable = VK_FALSE;
+
+	pipelineInfo.pColorBlendState = &depthColorBlendState;
+	pipelineInfo.pDepthStencilState = &depthPrePassState;
+	pipelineInfo.subpass = 0;
+	pipelineInfo.stageCount = 1;
+
+	if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &depthPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pre-pass pipeline");
+
 	vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
 	vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
 #pragma endregion
@@ -592,13 +588,16 @@ void MaterialScene::CreateSyncObjects(const VulkanSwapChain& swapChain)
 
 void MaterialScene::CreateObjects()
 {
-	objects.resize(28);
+	// one sphere per preset, all drawn as instances of the shared sphere mesh
+	materials.resize(28);
+	std::vector<glm::mat4> transforms(28);
+	std::vector<Material*> sphereMaterials(28);
 	int row = 0, col = 0;
 
 	for (int i = 0; i < 28; i++)
 	{	
-		objects[i] = BasicShapes::createSphere();
-		objects[i].setMaterialWithPreset(static_cast<MaterialPresets>(i));
+		materials[i].setPreset(static_cast<MaterialPresets>(i));
+		sphereMaterials[i] = &materials[i];
 
 		// move to the next row
 		if (i != 0 && i % 9 == 0)
@@ -609,10 +608,36 @@ void MaterialScene::CreateObjects()
 
 		glm::vec3 pos = glm::vec3(col, 0.0f, -row);
 
-		glm::mat4 model = glm::translate(pos) * glm::scale(glm::mat4(1.0f), glm::vec3(0.3f));
-		objects[i].setModelMatrix(model);
+		transforms[i] = glm::translate(pos) * glm::scale(glm::mat4(1.0f), glm::vec3(0.3f));
 		col++;
 	}
+
+	culler.addInstances(BasicShapes::getSphere(), transforms, sphereMaterials);
+
+	culler.build();
+
+	// light 0 follows the SpotLight, the rest are small lights scattered over the spheres
+	std::vector<GPULight> lights(MAX_LIGHTS);
+	lights[0].positionRadius = glm::vec4(1.0f, 1.0f, 1.0f, 10.0f);
+
+	for (uint32_t i = 1; i < MAX_LIGHTS; i++)
+	{
+		float x = float(rand() % 1000) / 100.0f - 1.0f;
+		float y = float(rand() % 100) / 100.0f + 0.2f;
+		float z = float(rand() % 500) / 100.0f - 4.0f;
+		float radius = float(rand() % 100) / 100.0f + 0.75f;
+
+		float r = float(rand() % 255) / 255.0f;
+		float g = float(rand() % 255) / 255.0f;
+		float b = float(rand() % 255) / 255.0f;
+
+		lights[i].positionRadius = glm::vec4(x, y, z, radius);
+		lights[i].colorIntensity = glm::vec4(r, g, b, 0.5f);
+	}
+
+	lightClusters.build(MAX_LIGHTS);
+	lightClusters.setLights(lights);
+	lightClusters.setLightCount(256);
 }
 
 void MaterialScene::CreateUniforms(const VulkanSwapChain& swapChain)
@@ -625,12 +650,13 @@ void MaterialScene::CreateUniforms(const VulkanSwapChain& swapChain)
 
 	light = SpotLight(glm::vec3(1.0, 1.0, 1.0)); 
 
-	uboScene.proj = glm::perspective(glm::radians(camera->GetFOV()), aspectRatio, 0.1f, 1000.0f);
+	uboScene.proj = glm::perspective(glm::radians(camera->GetFOV()), aspectRatio, NEAR_PLANE, FAR_PLANE);
 	uboScene.proj[1][1] *= -1;
 	glm::mat4 cameraView = camera->GetViewMatrix();
 	uboScene.view = cameraView;
-	uboScene.lightPos = light.getLightPos();
 	uboScene.viewPos = camera->GetCameraPosition();
+
+	lightClusters.setProjection(uboScene.proj, NEAR_PLANE, FAR_PLANE, dim);
 }
 
 void MaterialScene::UpdateUniforms(uint32_t index)
@@ -659,9 +685,12 @@ void MaterialScene::UpdateUniforms(uint32_t index)
 	
 	light.setLightPos(lightPos);
 
+	GPULight movingLight;
+	movingLight.positionRadius = glm::vec4(lightPos, 10.0f);
+	lightClusters.setLight(0, movingLight);
+
 	glm::mat4 cameraView = camera->GetViewMatrix();
 	uboScene.view = cameraView;
-	uboScene.lightPos = lightPos;
 	uboScene.viewPos = camera->GetCameraPosition();
 
 	memcpy(graphicsPipeline.uniformBuffers[index].mappedMemory, &uboScene, sizeof(uboScene));
@@ -693,6 +722,8 @@ void MaterialScene::RecordCommandBuffers(uint32_t index)
 	if (vkBeginCommandBuffer(commandBuffersList[index], &beginInfo) != VK_SUCCESS)
 		throw std::runtime_error("Failed to being recording command buffer!");
 
+	recorder.begin(commandBuffersList[index]);
+
 	VkRenderPassBeginInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassInfo.renderPass = renderPass;
@@ -707,11 +738,20 @@ void MaterialScene::RecordCommandBuffers(uint32_t index)
 	renderPassInfo.pClearValues = clearColors;
 	VkDeviceSize offsets[] = { 0 };
 
-	// draw scene
+	culler.cull(commandBuffersList[index], 0, uboScene.proj * uboScene.view);
+	lightClusters.cull(commandBuffersList[index], uboScene.view, true);
+
+	// depth pre-pass
 	vkCmdBeginRenderPass(commandBuffersList[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipeline);
-	vkCmdBindDescriptorSets(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipelineLayout,
-		0, 1, &graphicsPipeline.descriptorSets[index], 0, nullptr);
+	recorder.bindPipeline(depthPipeline);
+	recorder.bindDescriptorSet(graphicsPipeline.pipelineLayout, 0, graphicsPipeline.descriptorSets[index]);
+
+	DrawScene(commandBuffersList[index], graphicsPipeline.pipelineLayout, false);
+
+	// shade the visible surfaces with their clusters' lights
+	vkCmdNextSubpass(commandBuffersList[index], VK_SUBPASS_CONTENTS_INLINE);
+	recorder.bindPipeline(graphicsPipeline.pipeline);
+	recorder.bindDescriptorSet(graphicsPipeline.pipelineLayout, 2, lightClusters.getDescriptorSet());
 
 	DrawScene(commandBuffersList[index], graphicsPipeline.pipelineLayout, true);
 
@@ -733,6 +773,7 @@ void MaterialScene::DrawUI(uint32_t index)
 
 	ui->NewWindow("Application");
 	ui->DisplayFPS();
+	ui->DisplayDrawStats(recorder.getStats());
 	ui->DrawSliderVec3("Camera Position", &cameraPos, -20.0f, 20.0f);
 	ui->EndWindow();
 
@@ -748,40 +789,37 @@ void MaterialScene::DrawUI(uint32_t index)
 			ui->DrawCheckBox("Show Demo Window", &showDemoWindow);
 			ui->DrawSliderVec4("Clear Color", &clearColor, 0.0f, 1.0f);
 
+			// the scene is recorded every frame, so the count just goes into the next culling dispatch
+			int lightCount = static_cast<int>(lightClusters.getLightCount());
+			if (ImGui::SliderInt("Lights", &lightCount, 1, static_cast<int>(lightClusters.getMaxLights())))
+				lightClusters.setLightCount(static_cast<uint32_t>(lightCount));
+
 			// select individual spheres
 			if (ui->NewTreeNode("Spheres"))
 			{
-				for (int i = 0; i < objects.size(); i++)
+				for (int i = 0; i < materials.size(); i++)
 				{
-					bool materialChanged = false;
-
 					if (ui->NewTreeNode((void*)(intptr_t)i, "Sphere %i", i + 1))
 					{
-						glm::vec3* amb = &objects[i].material->ubo.ambient;
-						glm::vec3* dif = &objects[i].material->ubo.diffuse;
-						glm::vec3* spc = &objects[i].material->ubo.specular;
-						float* shine = &objects[i].material->ubo.shininess;
-
-						if (ui->DrawSliderVec3("Ambient Color", amb, 0.0f, 1.0f))
-							materialChanged = true;
-
-						if (ui->DrawSliderVec3("Diffuse Color", dif, 0.0f, 1.0f))
-							materialChanged = true;
-
-						if (ui->DrawSliderVec3("Specular Color", spc, 0.0f, 1.0f))
-							materialChanged = true;
-
-						if (ui->DrawSliderFloat("Shininess", shine, 1.0f, 256.0f))
-							materialChanged = true;
-
-						if (materialChanged)
-							objects[i].material->updateMaterial();
+						if (DrawMaterialEditor(&materials[i]))
+							culler.updateMaterials();
 							
 						ui->EndTreeNode();
 					}
 				}
 				ui->EndTreeNode();
 			}
+
+			// sphere clicked in the viewport
+			if (selectedObject != -1)
+			{
+				ui->AddSpacing(1);
+				std::string label = "Picked: Sphere " + std::to_string(selectedObject + 1);
+				ui->DrawUIText(label.c_str());
+
+				if (DrawMaterialEditor(&materials[selectedObject]))
+					culler.updateMaterials();
+			}
 		}
 		ui->EndWindow();
 	}
@@ -789,3 +827,22 @@ void MaterialScene::DrawUI(uint32_t index)
 	ui->EndFrame();
 	ui->RenderFrame(commandBuffersList[index], index);
 }
+
+bool MaterialScene::DrawMaterialEditor(Material* material)
+{
+	bool materialChanged = false;
+
+	if (ui->DrawSliderVec3("Ambient Color", &material->ubo.ambient, 0.0f, 1.0f))
+		materialChanged = true;
+
+	if (ui->DrawSliderVec3("Diffuse Color", &material->ubo.diffuse, 0.0f, 1.0f))
+		materialChanged = true;
+
+	if (ui->DrawSliderVec3("Specular Color", &material->ubo.specular, 0.0f, 1.0f))
+		materialChanged = true;
+
+	if (ui->DrawSliderFloat("Shininess", &material->ubo.shininess, 1.0f, 256.0f))
+		materialChanged = true;
+
+	return materialChanged;
+}
@@ -2,6 +2,8 @@
 
 #include "VulkanScene.h"
 #include "Renderer/UI.h"
+#include "Renderer/GPUCulling.h"
+#include "Renderer/LightClusters.h"
 
 class MaterialScene : public VulkanScene // TO DO: flesh out this class, and try different presets
 {
@@ -37,13 +39,27 @@ private:
 	void RecordCommandBuffers(uint32_t index);
 
 	void DrawUI(uint32_t index);
+	bool DrawMaterialEditor(Material* material);
+
+	// select the sphere under the cursor
+	void PickObject();
+	int32_t selectedObject = -1;
+	bool wasLeftPressed = false;
 
 	// scene data
 	VulkanGraphicsPipeline graphicsPipeline;
 	VkRenderPass renderPass;
 
-	SpotLight light;
-	std::vector<Mesh> objects;
+	// forward+: subpass 0 only writes depth, then the shading subpass runs once per visible sample with the
+	// lights culled into clusters before the render pass
+	VkPipeline depthPipeline = VK_NULL_HANDLE;
+	LightClusters lightClusters;
+	const uint32_t MAX_LIGHTS = 1024;
+	const float NEAR_PLANE = 0.1f, FAR_PLANE = 1000.0f;
+
+	SpotLight light; // light 0, circles over the spheres
+	std::vector<Material> materials; // one per sphere, indexed like the culler's objects
+	GPUCuller culler;
 	uint32_t currentFrame = 0;
 	bool animate = true;
 	bool isCameraMoving = false;
@@ -54,7 +70,6 @@ private:
 	{
 		glm::mat4 proj;
 		glm::mat4 view;
-		glm::vec3 lightPos;
 		glm::vec3 viewPos;
 	} uboScene;
 	
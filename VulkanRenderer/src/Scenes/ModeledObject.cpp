@@ -21,6 +21,7 @@ ModeledObject::ModeledObject(std::string name, const VulkanSwapChain& swapChain)
 
 	object = ModelLoader::loadModel("ZeldaChest", "Medium_Chest.obj");
 
+	CreateLights();
 	CreateRenderPass(swapChain);
 	CreateUniforms(swapChain);
 	CreateFramebuffer(swapChain);
@@ -39,45 +40,62 @@ ModeledObject::~ModeledObject()
 
 void ModeledObject::RecordScene()
 {
-	// begin recording command buffers
-	
-	for (size_t i = 0; i < commandBuffersList.size(); i++)
-	{
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0; // defines how we want to use the command buffer
-		beginInfo.pInheritanceInfo = nullptr; // only important if we're using secondary command buffers
-
-		if (vkBeginCommandBuffer(commandBuffersList[i], &beginInfo) != VK_SUCCESS)
-			throw std::runtime_error("Failed to being recording command buffer!");
-
-		VkRenderPassBeginInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = framebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = graphicsPipeline.scissors.extent;
-
-		VkClearValue clearColors[2] = {};
-		clearColors[0].color = { 0.1f, 0.1f, 0.1f, 1.0f };
-		clearColors[1].depthStencil = { 1.0f, 0 };
-
-		renderPassInfo.clearValueCount = 2;
-		renderPassInfo.pClearValues = clearColors;
-
-		vkCmdBindPipeline(commandBuffersList[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipeline);
-		vkCmdBindDescriptorSets(commandBuffersList[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipelineLayout, 
-			0, 1, &graphicsPipeline.descriptorSets[i], 0, nullptr);
-		
-		vkCmdBeginRenderPass(commandBuffersList[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		
-		DrawScene(commandBuffersList[i], graphicsPipeline.pipelineLayout, true);
-
-		vkCmdEndRenderPass(commandBuffersList[i]);
-
-		if (vkEndCommandBuffer(commandBuffersList[i]) != VK_SUCCESS)
-			throw std::runtime_error("Failed to record command buffer");
-	}
+	static Camera* camera = Camera::GetCamera();
+
+	// every command buffer draws the same meshes, so sort them once
+	drawList.clear();
+	object->submit(drawList, graphicsPipeline.pipeline, graphicsPipeline.pipelineLayout, true, camera->GetCameraPosition(), FAR_PLANE);
+	drawList.sort();
+
+	depthDrawList.clear();
+	object->submit(depthDrawList, depthPipeline, graphicsPipeline.pipelineLayout, false, camera->GetCameraPosition(), FAR_PLANE);
+	depthDrawList.sort();
+}
+
+void ModeledObject::RecordCommandBuffer(uint32_t index)
+{
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = 0; // defines how we want to use the command buffer
+	beginInfo.pInheritanceInfo = nullptr; // only important if we're using secondary command buffers
+
+	if (vkBeginCommandBuffer(commandBuffersList[index], &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("Failed to being recording command buffer!");
+
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = framebuffers[index];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = graphicsPipeline.scissors.extent;
+
+	VkClearValue clearColors[2] = {};
+	clearColors[0].color = { 0.1f, 0.1f, 0.1f, 1.0f };
+	clearColors[1].depthStencil = { 1.0f, 0 };
+
+	renderPassInfo.clearValueCount = 2;
+	renderPassInfo.pClearValues = clearColors;
+
+	lightClusters.cull(commandBuffersList[index], ubo.view, true);
+
+	recorder.begin(commandBuffersList[index]);
+	recorder.bindDescriptorSet(graphicsPipeline.pipelineLayout, 0, graphicsPipeline.descriptorSets[index]);
+
+	// depth pre-pass
+	vkCmdBeginRenderPass(commandBuffersList[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	recorder.bindDescriptorSet(graphicsPipeline.pipelineLayout, 1, ObjectTable::getDescriptorSet());
+	depthDrawList.record(recorder);
+
+	// shade the visible surfaces with their clusters' lights
+	vkCmdNextSubpass(commandBuffersList[index], VK_SUBPASS_CONTENTS_INLINE);
+	recorder.bindDescriptorSet(graphicsPipeline.pipelineLayout, 3, lightClusters.getDescriptorSet());
+
+	DrawScene(commandBuffersList[index], graphicsPipeline.pipelineLayout, true);
+
+	vkCmdEndRenderPass(commandBuffersList[index]);
+
+	if (vkEndCommandBuffer(commandBuffersList[index]) != VK_SUCCESS)
+		throw std::runtime_error("Failed to record command buffer");
 }
 
 void ModeledObject::RecreateScene(const VulkanSwapChain& swapChain)
@@ -97,7 +115,13 @@ void ModeledObject::RecreateScene(const VulkanSwapChain& swapChain)
 
 void ModeledObject::DrawScene(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout, bool useMaterial)
 {
-	object->draw(commandBuffer, pipelineLayout, useMaterial);
+	recorder.bindDescriptorSet(pipelineLayout, 1, ObjectTable::getDescriptorSet());
+
+	// one texture set for every mesh, instead of a set per material
+	if (useMaterial && TextureTable::isEnabled())
+		recorder.bindDescriptorSet(pipelineLayout, 2, TextureTable::getDescriptorSet());
+
+	drawList.record(recorder);
 }
 
 VulkanReturnValues ModeledObject::PresentScene(const VulkanSwapChain& swapChain)
@@ -124,6 +148,8 @@ VulkanReturnValues ModeledObject::PresentScene(const VulkanSwapChain& swapChain)
 	if (imagesInFlight[imageIndex] != VK_NULL_HANDLE)
 		vkWaitForFences(logicalDevice, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
 
+	RecordCommandBuffer(imageIndex);
+
 	// mark image as now being in use by this frame
 	imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
@@ -181,6 +207,8 @@ void ModeledObject::DestroyScene(bool isRecreation)
 {
 	vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
 	graphicsPipeline.destroyGraphicsPipeline(logicalDevice);
+	vkDestroyPipeline(logicalDevice, depthPipeline, nullptr);
+	descriptorAllocator.reset();
 
 	for (size_t i = 0; i < framebuffers.size(); i++)
 	{
@@ -204,6 +232,7 @@ void ModeledObject::DestroyScene(bool isRecreation)
 		}	
 
 		delete object;
+		lightClusters.destroy();
 	}
 }
 
@@ -263,7 +292,9 @@ void ModeledObject::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	auto vertShaderCode = HelperFunctions::readShaderFile(SHADERPATH"Model/model_vertex_shader.spv");
 	VkShaderModule vertShaderModule = HelperFunctions::CreateShaderModules(vertShaderCode);
 
-	auto fragShaderCode = HelperFunctions::readShaderFile(SHADERPATH"Model/model_fragment_shader.spv");
+	// the bindless variant samples the TextureTable instead of a per material set
+	auto fragShaderCode = HelperFunctions::readShaderFile(TextureTable::isEnabled() ?
+		SHADERPATH"Model/model_fragment_bindless.spv" : SHADERPATH"Model/model_fragment_shader.spv");
 	VkShaderModule fragShaderModule = HelperFunctions::CreateShaderModules(fragShaderCode);
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
@@ -377,20 +408,22 @@ void ModeledObject::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	VkPipelineDepthStencilStateCreateInfo depthStencilInfo{};
 	depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthStencilInfo.depthTestEnable = VK_TRUE;
-	depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
-	depthStencilInfo.depthWriteEnable = VK_TRUE;
+	depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL; // the pre-pass already wrote the closest depth
+	depthStencilInfo.depthWriteEnable = VK_FALSE;
 	depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
 	depthStencilInfo.stencilTestEnable = VK_FALSE;
 #pragma endregion
 
-	VkDescriptorSetLayout layouts[] = { graphicsPipeline.descriptorSetLayout, object->meshes[0]->descriptorSetLayout, object->meshes[0]->material->descriptorSetLayout};
+	VkDescriptorSetLayout textureLayout = TextureTable::isEnabled() ? TextureTable::getDescriptorSetLayout() : object->meshes[0]->material->descriptorSetLayout;
+	VkDescriptorSetLayout layouts[] = { graphicsPipeline.descriptorSetLayout, ObjectTable::getDescriptorSetLayout(), textureLayout,
+		lightClusters.getDescriptorSetLayout() };
 	//VkDescriptorSetLayout layouts[] = { graphicsPipeline.descriptorSetLayout, object->meshes[0]->material->descriptorSetLayout};
 	// ** Pipeline Layout ** 
 	VkPipelineLayoutCreateInfo layoutInfo = {};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	layoutInfo.pushConstantRangeCount = 0;
 	layoutInfo.pPushConstantRanges = nullptr;
-	layoutInfo.setLayoutCount = 3;
+	layoutInfo.setLayoutCount = 4;
 	layoutInfo.pSetLayouts = layouts;
 
 	if (vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &graphicsPipeline.pipelineLayout) != VK_SUCCESS)
@@ -411,7 +444,7 @@ void ModeledObject::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	graphicsPipelineInfo.pDepthStencilState = &depthStencilInfo;
 	graphicsPipelineInfo.layout = graphicsPipeline.pipelineLayout;
 	graphicsPipelineInfo.renderPass = renderPass;
-	graphicsPipelineInfo.subpass = 0;
+	graphicsPipelineInfo.subpass = 1;
 	graphicsPipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // use this to create new pipeline from an existing pipeline
 	graphicsPipelineInfo.basePipelineIndex = -1;
 
@@ -419,6 +452,17 @@ void ModeledObject::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &graphicsPipeline.pipeline) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create graphics pipeline");
 
+	// the depth pre-pass: same vertex shader, no fragment shader and no color attachment
+	depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencilInfo.depthWriteEnable = VK_TRUE;
+	colorBlendingInfo.attachmentCount = 0;
+
+	graphicsPipelineInfo.stageCount = 1;
+	graphicsPipelineInfo.subpass = 0;
+
+	if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &depthPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pre-pass pipeline");
+
 	vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
 	vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
 }
@@ -455,29 +499,41 @@ void ModeledObject::CreateRenderPass(const VulkanSwapChain& swapChain)
 	depthAttachmentReference.attachment = 1;
 	depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentReference;
-	subpass.pDepthStencilAttachment = &depthAttachmentReference;
-
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	// depth pre-pass, then shading against its depth
+	VkSubpassDescription subpasses[2] = {};
+	subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[0].pDepthStencilAttachment = &depthAttachmentReference;
+
+	subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[1].colorAttachmentCount = 1;
+	subpasses[1].pColorAttachments = &colorAttachmentReference;
+	subpasses[1].pDepthStencilAttachment = &depthAttachmentReference;
+
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = 1;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
 	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment };
 	VkRenderPassCreateInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 	renderPassInfo.attachmentCount = 2;
 	renderPassInfo.pAttachments = attachments;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
+	renderPassInfo.subpassCount = 2;
+	renderPassInfo.pSubpasses = subpasses;
+	renderPassInfo.dependencyCount = 2;
+	renderPassInfo.pDependencies = dependencies;
 
 	if (vkCreateRenderPass(VulkanDevice::GetVulkanDevice()->GetLogicalDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create render pass");
@@ -544,8 +600,34 @@ void ModeledObject::CreateUniforms(const VulkanSwapChain& swapChain)
 	ubo.cameraPosition = camera->GetCameraPosition();
 	ubo.model = glm::mat4(1.0f);
 	ubo.view = camera->GetViewMatrix();
-	ubo.projection = glm::perspective(glm::radians(camera->GetFOV()), float(swapChain.swapChainDimensions.width / swapChain.swapChainDimensions.height), 0.1f, 1000.0f);
+	ubo.projection = glm::perspective(glm::radians(camera->GetFOV()), float(swapChain.swapChainDimensions.width / swapChain.swapChainDimensions.height), NEAR_PLANE, FAR_PLANE);
 	ubo.projection[1][1] *= -1;	
+
+	lightClusters.setProjection(ubo.projection, NEAR_PLANE, FAR_PLANE, swapChain.swapChainDimensions);
+}
+
+void ModeledObject::CreateLights()
+{
+	std::vector<GPULight> lights(MAX_LIGHTS);
+
+	// the old fixed light in front of the chest, about as bright as it was unattenuated
+	lights[0].positionRadius = glm::vec4(0.0f, 1.0f, -5.0f, 20.0f);
+	lights[0].colorIntensity = glm::vec4(1.0f, 1.0f, 1.0f, 1.3f);
+
+	// and a ring of small colored lights around it
+	for (uint32_t i = 1; i < MAX_LIGHTS; i++)
+	{
+		float angle = glm::two_pi<float>() * float(i) / float(MAX_LIGHTS - 1);
+		float height = float(i % 4) * 0.5f;
+
+		glm::vec3 color = glm::vec3(0.5f) + 0.5f * glm::vec3(cos(angle), cos(angle + 2.0f), cos(angle + 4.0f));
+
+		lights[i].positionRadius = glm::vec4(2.0f * cos(angle), height, 2.0f * sin(angle), 1.5f);
+		lights[i].colorIntensity = glm::vec4(color, 0.5f);
+	}
+
+	lightClusters.build(MAX_LIGHTS);
+	lightClusters.setLights(lights);
 }
 
 void ModeledObject::UpdateUniforms(uint32_t index)
@@ -588,42 +670,10 @@ void ModeledObject::CreateDescriptorSets(const VulkanSwapChain& swapChain)
 	std::vector<VkImageView> imageViews;
 	std::vector<VkSampler> samplers;
 	size_t swapChainSize = swapChain.swapChainImages.size();
-	uint32_t descriptorCount = static_cast<uint32_t>(swapChainSize);
-
-#pragma region DESCRIPTOR_POOL
-	VkDescriptorPoolSize poolSize = {};
-	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSize.descriptorCount = descriptorCount;
-
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.maxSets = descriptorCount;
-	poolInfo.poolSizeCount = 1;
-	poolInfo.pPoolSizes = &poolSize;
-
-	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &graphicsPipeline.descriptorPool) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create descriptor pool");
-
-	graphicsPipeline.isDescriptorPoolEmpty = false;
-#pragma endregion
 
 #pragma region BINDINGS
-	
-	// create binding of UBO
-	VkDescriptorSetLayoutBinding uboBinding = {};
-	uboBinding.binding = 0;
-	uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboBinding.descriptorCount = 1;
-	uboBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	uboBinding.pImmutableSamplers = nullptr;
-
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = 1;
-	layoutInfo.pBindings = &uboBinding;
-
-	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &graphicsPipeline.descriptorSetLayout) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create descriptor set layout!");
+	graphicsPipeline.descriptorSetLayout = Descriptors::getLayout({
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT) });
 #pragma endregion
 
 
@@ -635,42 +685,15 @@ void ModeledObject::CreateDescriptorSets(const VulkanSwapChain& swapChain)
 		HelperFunctions::createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			graphicsPipeline.uniformBuffers[i].buffer, graphicsPipeline.uniformBuffers[i].bufferMemory);
 	
-#pragma region POOLS_SET_LAYOUT
-	
-
-	std::vector<VkDescriptorSetLayout> layout(swapChainSize, graphicsPipeline.descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = graphicsPipeline.descriptorPool;
-	allocInfo.descriptorSetCount = descriptorCount;
-	allocInfo.pSetLayouts = layout.data();
+#pragma region SETS
+	// the layout is cached and the sets come from the scene's allocator, so the pipeline owns neither
 	graphicsPipeline.descriptorSets.resize(swapChainSize);
 
-	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, graphicsPipeline.descriptorSets.data()) != VK_SUCCESS)
-		throw std::runtime_error("Failed to allocate descriptor sets");
-
-#pragma endregion
-
-#pragma region WRITES
-	VkWriteDescriptorSet descriptorWrite = {};
-
 	for (size_t i = 0; i < swapChainSize; i++)
 	{
-		VkDescriptorBufferInfo bufferInfo = {};
-		bufferInfo.buffer = graphicsPipeline.uniformBuffers[i].buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
-
-		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrite.dstSet = graphicsPipeline.descriptorSets[i];
-		descriptorWrite.dstBinding = 0;
-		descriptorWrite.dstArrayElement = 0;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrite.pBufferInfo = &bufferInfo;
-
-		
-		vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, nullptr);
+		graphicsPipeline.descriptorSets[i] = descriptorAllocator.allocate(graphicsPipeline.descriptorSetLayout);
+		Descriptors::write(graphicsPipeline.descriptorSets[i], graphicsPipeline.descriptorSetLayout,
+			{ DescriptorInfo(graphicsPipeline.uniformBuffers[i].buffer, 0, sizeof(UniformBufferObject)) });
 	}
 #pragma endregion
 	
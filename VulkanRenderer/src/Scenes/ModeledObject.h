@@ -18,6 +18,7 @@
 #define MODELED_OBJECT_H
 
 #include "VulkanScene.h"
+#include "Renderer/LightClusters.h"
 #include <chrono>
 
 class ModeledObject : public VulkanScene
@@ -47,6 +48,10 @@ private:
 	void UpdateUniforms(uint32_t index);
 	void CreateDescriptorSets(const VulkanSwapChain& swapChain);
 	void CreateCommandBuffers();
+	void CreateLights();
+
+	// the light clusters follow the camera, so each image's commands are recorded again before it's drawn
+	void RecordCommandBuffer(uint32_t index);
 
 	VulkanGraphicsPipeline graphicsPipeline;
 	VkRenderPass renderPass;
@@ -68,6 +73,16 @@ private:
 	} ubo;
 	
 	size_t currentFrame = 0;
+
+	// the model's meshes sorted by pipeline, material and mesh, filled once per RecordScene()
+	DrawList drawList, depthDrawList;
+
+	// forward+: subpass 0 only writes depth, then the shading subpass runs once per visible pixel with the
+	// lights culled into clusters before the render pass
+	VkPipeline depthPipeline = VK_NULL_HANDLE;
+	LightClusters lightClusters;
+	const uint32_t MAX_LIGHTS = 64;
+	const float NEAR_PLANE = 0.1f, FAR_PLANE = 1000.0f;
 };
 
 
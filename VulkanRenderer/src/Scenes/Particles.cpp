@@ -1,108 +1,111 @@
 #include "Particles.h"
-#include <random>
+#include <chrono>
 
 const int MAX_NUM_PARTICLES = 1024 * 1024;
-const int WORK_GROUP_SIZE = 256;
-const int NUM_GROUPS = MAX_NUM_PARTICLES / WORK_GROUP_SIZE;
 
 Particles::Particles(std::string name, const VulkanSwapChain& swapChain)
 {
 	sceneName = name;
 
-	srand(unsigned int (time(NULL))); // seed random number generator
-
 	CreateUniforms(swapChain);
-	CreateParticles(false);
+	CreateParticles();
 	CreateRenderPass(swapChain);
 	CreateFramebuffers(swapChain);
 	CreateCommandBuffers();
 	CreateSyncObjects(swapChain);
-	CreateComputeDescriptorSets(swapChain);
-	CreateComputePipeline();
 	CreateGraphicsDescriptorSets(swapChain);
 	CreateGraphicsPipeline(swapChain);
 
-	RecordScene();
-
+	ui = new UI(commandPool, swapChain, renderPass, graphicsPipeline, VK_SAMPLE_COUNT_1_BIT);
 }
 
 Particles::~Particles()
 {
+	delete ui;
 }
 
 void Particles::RecordScene()
 {
+	// recorded every frame by RecordCommandBuffers(), the draw follows the copy the last particle update wrote
+}
+
+void Particles::RecordCommandBuffers(uint32_t imageIndex)
+{
+	VkCommandBuffer commandBuffer = commandBuffersList[imageIndex];
+
 	VkRenderPassBeginInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassInfo.renderArea.offset = { 0, 0 };
 	renderPassInfo.renderArea.extent = graphicsPipeline.scissors.extent;
 	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = graphicsPipeline.framebuffers[imageIndex];
 
 	VkClearValue clearColors[2] = {};
 	clearColors[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
 	clearColors[1].depthStencil = { 1.0f, 0 };
-
-	
-	VkDeviceSize offsets[] = { 0 };
+	renderPassInfo.clearValueCount = 2;
+	renderPassInfo.pClearValues = clearColors;
 
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; // allows resubmission while also already pending execution.
-
-	// begin recording command buffers
-	for (size_t i = 0; i < commandBuffersList.size(); i++)
-	{
-		if (vkBeginCommandBuffer(commandBuffersList[i], &beginInfo) != VK_SUCCESS)
-			throw std::runtime_error("Failed to being recording command buffer!");
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		renderPassInfo.framebuffer = graphicsPipeline.framebuffers[i];
-		renderPassInfo.clearValueCount = 2;
-		renderPassInfo.pClearValues = clearColors;
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("Failed to being recording command buffer!");
 
-		// bind compute pipeline and dispatch compute shader to calculate particle positions
-		vkCmdBindPipeline(commandBuffersList[i], VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.pipeline);
-		vkCmdBindDescriptorSets(commandBuffersList[i], VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.pipelineLayout, 
-			0, 1, &computePipeline.descriptorSet, 0, nullptr);
-		vkCmdPushConstants(commandBuffersList[i], computePipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePush), &pushConstants);
-		vkCmdDispatch(commandBuffersList[i], NUM_GROUPS, 1, 1);
+	// bind graphics pipeline and begin render pass to draw particles to framebuffers
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipelineLayout,
+		0, 1, &graphicsPipeline.descriptorSets[imageIndex], 0, nullptr);
 
-		// bind graphics pipeline and begin render pass to draw particles to framebuffers
-		vkCmdBeginRenderPass(commandBuffersList[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(commandBuffersList[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipeline);
-		vkCmdBindDescriptorSets(commandBuffersList[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipelineLayout,
-			0, 1, &graphicsPipeline.descriptorSets[i], 0, nullptr);
+	// one point per live particle
+	particleSystem.draw(commandBuffer, graphicsPipeline.pipelineLayout, 1);
 
-		// bind storage buffer as a vertex buffer
-		vkCmdBindVertexBuffers(commandBuffersList[i], 0, 1, &computePipeline.storageBuffer->buffer, offsets);
+	DrawUI(commandBuffer, imageIndex);
 
-		// draw particles
-		vkCmdDraw(commandBuffersList[i], MAX_NUM_PARTICLES, 1, 0, 0);
+	vkCmdEndRenderPass(commandBuffer);
 
-		vkCmdEndRenderPass(commandBuffersList[i]);
-
-		if (vkEndCommandBuffer(commandBuffersList[i]) != VK_SUCCESS)
-			throw std::runtime_error("Failed to record command buffer");
-	}
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to record command buffer");
 }
 
 void Particles::RecreateScene(const VulkanSwapChain& swapChain)
 {
 	vkDeviceWaitIdle(logicalDevice); // wait for all operations to finish
-	ReadBackParticleData();
 
+	// the particles stay on the GPU, only what depends on the swap chain is recreated
 	DestroyScene(true);
 
 	CreateUniforms(swapChain);
-	CreateParticles(true);
 	CreateRenderPass(swapChain);
 	CreateFramebuffers(swapChain);
 	CreateCommandBuffers();
-	CreateComputeDescriptorSets(swapChain);
-	CreateComputePipeline();
 	CreateGraphicsDescriptorSets(swapChain);
 	CreateGraphicsPipeline(swapChain);
 
-	RecordScene();
+	delete ui;
+	ui = new UI(commandPool, swapChain, renderPass, graphicsPipeline, VK_SAMPLE_COUNT_1_BIT);
+}
+
+void Particles::DrawUI(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	ui->NewUIFrame();
+
+	ui->NewWindow("Application");
+	{
+		ui->DisplayFPS();
+
+		// measured on the compute queue, a couple of updates behind
+		std::string gridTime = "Grid build: " + std::to_string(particleSystem.getGridTime()) + " ms";
+		std::string simulateTime = "Simulation: " + std::to_string(particleSystem.getSimulateTime()) + " ms";
+		ui->DrawUIText(gridTime.c_str());
+		ui->DrawUIText(simulateTime.c_str());
+	}
+	ui->EndWindow();
+
+	ui->EndFrame();
+	ui->RenderFrame(commandBuffer, imageIndex);
 }
 
 void Particles::DrawScene(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout, bool useMaterial)
@@ -138,7 +141,17 @@ VulkanReturnValues Particles::PresentScene(const VulkanSwapChain& swapChain)
 	}
 
 
-	UpdateUniforms(currentFrame);
+	// simulate by the time since the last frame. a stall is clamped so it doesn't throw every particle through the walls
+	static auto lastTime = std::chrono::high_resolution_clock::now();
+	auto now = std::chrono::high_resolution_clock::now();
+	float dt = std::min(std::chrono::duration<float, std::chrono::seconds::period>(now - lastTime).count(), 0.1f);
+	lastTime = now;
+
+	// emit, simulate and compact the particles on the compute queue while the last frame still renders
+	particleSystem.update(dt);
+
+	UpdateUniforms(imageIndex);
+	RecordCommandBuffers(imageIndex);
 
 	// mark image as now being in use by this frame
 	imagesInFlight[imageIndex] = inFlightFences[currentFrame];
@@ -146,16 +159,18 @@ VulkanReturnValues Particles::PresentScene(const VulkanSwapChain& swapChain)
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = { presentCompleteSemaphores[currentFrame] };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
+	// the particles only have to be ready once the draw reads them
+	VkSemaphore waitSemaphores[] = { presentCompleteSemaphores[currentFrame], particleSystem.getSimulatedSemaphore() };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT };
+	submitInfo.waitSemaphoreCount = 2;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffersList[imageIndex];
 
-	VkSemaphore signalSemaphores[] = { renderCompleteSemaphores[currentFrame] };
-	submitInfo.signalSemaphoreCount = 1;
+	// presentation only waits on the first, the next update writing this copy of the particles on the second
+	VkSemaphore signalSemaphores[] = { renderCompleteSemaphores[currentFrame], particleSystem.getDrawnSemaphore() };
+	submitInfo.signalSemaphoreCount = 2;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	vkResetFences(logicalDevice, 1, &inFlightFences[currentFrame]);
@@ -203,9 +218,9 @@ void Particles::DestroyScene(bool isRecreation)
 			vkDestroySemaphore(logicalDevice, presentCompleteSemaphores[i], nullptr);
 			vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
 		}
+
+		particleSystem.destroy();
 	}
-		
-	computePipeline.destroyComputePipeline(logicalDevice);
 }
 
 void Particles::HandleKeyboardInput(const uint8_t* keystates, float dt)
@@ -261,76 +276,33 @@ void Particles::CreateCommandBuffers()
 		throw std::runtime_error("Failed to allocate command buffers");
 }
 
-void Particles::CreateParticles(bool isRecreation)
+void Particles::CreateParticles()
 {
-	pushConstants.xBounds = (std::rand() % 4) + 1; 
-	pushConstants.yBounds = (std::rand() % 4) + 1;
-	pushConstants.zBounds = (std::rand() % 4) + 1; // add 1 to make sure we always have a bound
+	// four fountains in the corners of the floor aimed at the middle, each in its own color
+	const glm::vec4 colors[4] = { { 1.0f, 0.4f, 0.2f, 1.0f }, { 0.2f, 0.6f, 1.0f, 1.0f }, { 0.4f, 1.0f, 0.3f, 1.0f }, { 1.0f, 0.9f, 0.3f, 1.0f } };
 
-	// don't recreate all the particles from scratch
-	// simply recreate the buffer and reinput the data
-	if (!isRecreation)
+	for (int i = 0; i < 4; i++)
 	{
-		// randomly fill particle data
-		for (int i = 0; i < MAX_NUM_PARTICLES; i++)
-		{
-			// random number between -1.0 and 1.0
-			glm::vec4 position = {
-				float((std::rand() % 100 - 50) / 50.0f),
-				float((std::rand() % 100 - 50) / 50.0f),
-				float((std::rand() % 100 - 50) / 50.0f),
-				1.0f
-			};
-
-			glm::vec4 velocity = {
-				std::rand() % 5,
-				std::rand() % 5,
-				std::rand() % 5,
-				1.0f
-			};
-
-			// grab random RGB ranged from 0.1f - 1.0f; avoids all black particles
-			glm::vec4 color = {
-				(float)((std::rand() % 255 + 0.1f) / 255.0f),
-				(float)((std::rand() % 255 + 0.1f) / 255.0f),
-				(float)((std::rand() % 255 + 0.1f) / 255.0f),
-				1.0f
-			};
-
-			Particle newParticle = { position, velocity, color };
-			particles.push_back(newParticle);
-		}
-
+		ParticleEmitter emitter;
+		emitter.position = glm::vec3((i & 1) ? 3.0f : -3.0f, -4.0f, (i & 2) ? 3.0f : -3.0f);
+		emitter.direction = glm::normalize(glm::vec3(-emitter.position.x, 20.0f, -emitter.position.z));
+		emitter.spread = 0.25f;
+		emitter.color = colors[i];
+		emitter.rate = 60000.0f;
+		emitter.minSpeed = 7.0f;
+		emitter.maxSpeed = 9.0f;
+		emitter.minLifetime = 2.0f;
+		emitter.maxLifetime = 4.0f;
+		particleSystem.addEmitter(emitter);
 	}
-	
-
-	VkDeviceSize size = sizeof(particles[0]) * particles.size();
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	HelperFunctions::createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-		stagingBuffer, stagingBufferMemory);
-
-	// map particle data to storage buffer
-	void* data;
-	vkMapMemory(logicalDevice, stagingBufferMemory, 0, size, 0, &data);
-	memcpy(data, particles.data(), (size_t)size);
-	vkUnmapMemory(logicalDevice, stagingBufferMemory);
-	
-	VulkanBuffer buffer;
-
-	// since we'll be reading this data back, we need to make sure the CPU can see it 
-	HelperFunctions::createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-		buffer.buffer, buffer.bufferMemory);
 
-	HelperFunctions::copyBuffer(commandPool, stagingBuffer, buffer.buffer, size, VulkanDevice::GetVulkanDevice()->GetQueues().renderQueue);
+	// they fall back onto the floor of the box and bounce inside it
+	particleSystem.setGravity(glm::vec3(0.0f, -9.81f, 0.0f));
+	particleSystem.setBounds(glm::vec3(0.0f), glm::vec3(6.0f, 4.0f, 6.0f), 0.4f);
 
-	computePipeline.storageBuffer = buffer;
-
-	vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+	// and keep a little apart from each other, so they pile up on the floor instead of collapsing into a sheet
+	particleSystem.setInteraction(0.05f, 60.0f);
+	particleSystem.build(MAX_NUM_PARTICLES);
 }
 
 void Particles::CreateUniforms(const VulkanSwapChain& swapChain)
@@ -371,31 +343,21 @@ void Particles::CreateUniforms(const VulkanSwapChain& swapChain)
 		graphicsPipeline.uniformBuffers[i] = ub;
 	}
 
-	VulkanBuffer buffer;
-
-	// create compute uniform buffer
-	HelperFunctions::createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		buffer.buffer, buffer.bufferMemory);
-
-	HelperFunctions::copyBuffer(commandPool, stagingBuffer, buffer.buffer, size, VulkanDevice::GetVulkanDevice()->GetQueues().renderQueue);
-
-	computePipeline.uniformBuffer = buffer;
-
 	vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
 	vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
 }
 
-void Particles::UpdateUniforms(uint32_t currentFrame)
+void Particles::UpdateUniforms(uint32_t imageIndex)
 {
 	
 	Camera* const camera = Camera::GetCamera();
 	ubo.view = camera->GetViewMatrix();
 
+	// one buffer per swap chain image, the one its command buffer binds
 	void* data;
-	vkMapMemory(logicalDevice, graphicsPipeline.uniformBuffers[currentFrame].bufferMemory, 0, sizeof(UBO), 0, &data);
+	vkMapMemory(logicalDevice, graphicsPipeline.uniformBuffers[imageIndex].bufferMemory, 0, sizeof(UBO), 0, &data);
 	memcpy(data, &ubo, sizeof(UBO));
-	vkUnmapMemory(logicalDevice, graphicsPipeline.uniformBuffers[currentFrame].bufferMemory);
+	vkUnmapMemory(logicalDevice, graphicsPipeline.uniformBuffers[imageIndex].bufferMemory);
 }
 
 void Particles::CreateRenderPass(const VulkanSwapChain& swapChain)
@@ -436,28 +398,7 @@ void Particles::CreateRenderPass(const VulkanSwapChain& swapChain)
 	subpass.pColorAttachments = &colorAttachmentReference;
 	subpass.pDepthStencilAttachment = &depthAttachmentReference;
 
-	// vertex shader depends on compute shader to finish calculating particle data for next frame
-	// documentation says this is a better way of synchronization compared to pipeline barriers
-	// https://github.com/KhronosGroup/Vulkan-Docs/wiki/Synchronization-Examples#compute-to-graphics-dependencies
-
-	// vertex shader waits on compute shader
-	VkSubpassDependency computeFinishedDependency{};
-	computeFinishedDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	computeFinishedDependency.dstSubpass = 0;
-	computeFinishedDependency.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-	computeFinishedDependency.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-	computeFinishedDependency.dstStageMask = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
-	computeFinishedDependency.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-
-	// compute shader waits on vertex shader
-	VkSubpassDependency vertexFinishedDependency{};
-	vertexFinishedDependency.srcSubpass = 0;
-	vertexFinishedDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
-	vertexFinishedDependency.srcStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
-	vertexFinishedDependency.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	vertexFinishedDependency.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-	vertexFinishedDependency.dstAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
-
+	// ParticleSystem::update() makes the particles visible to the vertex shader itself
 	VkSubpassDependency dependency{};
 	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 	dependency.dstSubpass = 0;
@@ -467,7 +408,7 @@ void Particles::CreateRenderPass(const VulkanSwapChain& swapChain)
 	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
 	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment };
-	VkSubpassDependency dependencies[] = { computeFinishedDependency, vertexFinishedDependency , dependency };
+	VkSubpassDependency dependencies[] = { dependency };
 
 	VkRenderPassCreateInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -475,7 +416,7 @@ void Particles::CreateRenderPass(const VulkanSwapChain& swapChain)
 	renderPassInfo.pAttachments = attachments;
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 3;
+	renderPassInfo.dependencyCount = 1;
 	renderPassInfo.pDependencies = dependencies;
 
 	
@@ -542,30 +483,10 @@ void Particles::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 #pragma endregion
 
 #pragma region VERTEX_INPUT_STATE
-	VkVertexInputBindingDescription bindDesc{};
-	bindDesc.binding = 0;
-	bindDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	bindDesc.stride = sizeof(Particle);
-
-	VkVertexInputAttributeDescription attrDesc[2] = {};
-	attrDesc[0].binding = 0;
-	attrDesc[0].location = 0;
-	attrDesc[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attrDesc[0].offset = offsetof(Particle, Particle::position);
-
-	attrDesc[1].binding = 0;
-	attrDesc[1].location = 1;
-	attrDesc[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attrDesc[1].offset = offsetof(Particle, Particle::color);
-
-
 	// ** Vertex Input State **
+	// no vertex buffers, the vertex shader fetches its particle through the alive list
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindDesc;
-	vertexInputInfo.vertexAttributeDescriptionCount = 2;
-	vertexInputInfo.pVertexAttributeDescriptions = attrDesc;
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {};
 	inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -661,10 +582,13 @@ void Particles::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	VkPipelineShaderStageCreateInfo stages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
 	// ** Pipeline Layout ** 
+	// the camera, then the particles and their alive lists
+	VkDescriptorSetLayout setLayouts[] = { graphicsPipeline.descriptorSetLayout, particleSystem.getDescriptorSetLayout() };
+
 	VkPipelineLayoutCreateInfo layoutInfo = {};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	layoutInfo.setLayoutCount = 1;
-	layoutInfo.pSetLayouts = &graphicsPipeline.descriptorSetLayout;
+	layoutInfo.setLayoutCount = 2;
+	layoutInfo.pSetLayouts = setLayouts;
 
 	graphicsPipeline.result = vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &graphicsPipeline.pipelineLayout);
 	if (graphicsPipeline.result != VK_SUCCESS)
@@ -698,64 +622,6 @@ void Particles::CreateGraphicsPipeline(const VulkanSwapChain& swapChain)
 	vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
 }
 
-void Particles::CreateComputePipeline()
-{
-	auto compShaderCode = HelperFunctions::readShaderFile(SHADERPATH"Particles/particles_compute_shader.spv");
-	VkShaderModule compShaderModule = HelperFunctions::CreateShaderModules(compShaderCode);
-
-	// Specialization Constants
-	int data[] = { MAX_NUM_PARTICLES };
-
-	VkSpecializationMapEntry entries =
-	{
-		0,
-		0,
-		sizeof(int)
-	};
-
-	VkSpecializationInfo specInfo;
-	specInfo.dataSize = sizeof(int);
-	specInfo.mapEntryCount = 1;
-	specInfo.pMapEntries = &entries;
-	specInfo.pData = data;
-
-	VkPushConstantRange push{};
-	push.size = sizeof(ComputePush);
-	push.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-	push.offset = 0;
-
-	VkPipelineShaderStageCreateInfo compShaderStageInfo{};
-	compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-	compShaderStageInfo.module = compShaderModule;
-	compShaderStageInfo.pName = "main";
-	compShaderStageInfo.pSpecializationInfo = &specInfo;
-
-	
-
-	VkPipelineLayoutCreateInfo computeLayoutInfo{};
-	computeLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	computeLayoutInfo.setLayoutCount = 1;
-	computeLayoutInfo.pSetLayouts = &computePipeline.descriptorSetLayout;
-	computeLayoutInfo.pushConstantRangeCount = 1;
-	computeLayoutInfo.pPushConstantRanges = &push;
-
-	if (vkCreatePipelineLayout(logicalDevice, &computeLayoutInfo, nullptr, &computePipeline.pipelineLayout))
-		throw std::runtime_error("Failed to create compute pipeline layout!");
-
-	VkComputePipelineCreateInfo computePipelineInfo{};
-	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-	computePipelineInfo.stage = compShaderStageInfo;
-	computePipelineInfo.layout = computePipeline.pipelineLayout;
-	computePipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	computePipelineInfo.basePipelineIndex = -1;
-
-	if (vkCreateComputePipelines(logicalDevice, VK_NULL_HANDLE, 1, &computePipelineInfo, nullptr, &computePipeline.pipeline))
-		throw std::runtime_error("Failed to create compute pipeline");
-
-	vkDestroyShaderModule(logicalDevice, compShaderModule, nullptr);
-}
-
 void Particles::CreateSyncObjects(const VulkanSwapChain& swapChain)
 {
 	renderCompleteSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -778,26 +644,6 @@ void Particles::CreateSyncObjects(const VulkanSwapChain& swapChain)
 			vkCreateFence(logicalDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
 			throw std::runtime_error("Failed to create sync objects for a frame");
 	}
-
-	computeFinishedBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-	computeFinishedBarrier.pNext = nullptr;
-	computeFinishedBarrier.buffer = computePipeline.storageBuffer->buffer;
-	computeFinishedBarrier.size = sizeof(Particle) * MAX_NUM_PARTICLES;
-	computeFinishedBarrier.offset = 0;
-	computeFinishedBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	computeFinishedBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	computeFinishedBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-	computeFinishedBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
-
-	vertexFinishedBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-	vertexFinishedBarrier.pNext = nullptr;
-	vertexFinishedBarrier.buffer = computePipeline.storageBuffer->buffer;
-	vertexFinishedBarrier.size = sizeof(Particle) * MAX_NUM_PARTICLES;
-	vertexFinishedBarrier.offset = 0;
-	vertexFinishedBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	vertexFinishedBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	vertexFinishedBarrier.srcAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
-	vertexFinishedBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
 }
 
 void Particles::CreateGraphicsDescriptorSets(const VulkanSwapChain& swapChain)
@@ -873,118 +719,3 @@ void Particles::CreateGraphicsDescriptorSets(const VulkanSwapChain& swapChain)
 		vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, nullptr);
 	}
 }
-
-void Particles::CreateComputeDescriptorSets(const VulkanSwapChain& swapChain)
-{
-	
-
-	// create storage buffer binding for particles
-	VkDescriptorSetLayoutBinding ssboBinding = {};
-	ssboBinding.binding = 0;
-	ssboBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	ssboBinding.descriptorCount = 1;
-	ssboBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-	// create binding for uniform buffer
-	VkDescriptorSetLayoutBinding uboBinding = {};
-	uboBinding.binding = 1;
-	uboBinding.descriptorCount = 1;
-	uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-	VkDescriptorSetLayoutBinding bindings[] = { ssboBinding, uboBinding };
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = 2;
-	layoutInfo.pBindings = bindings;
-
-	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &computePipeline.descriptorSetLayout) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create compute descriptor set layout!");
-
-	// create descriptor pools
-
-	VkDescriptorPoolSize ssboPoolSize{};
-	ssboPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	ssboPoolSize.descriptorCount = 1;
-
-	VkDescriptorPoolSize uboPoolSize{};
-	uboPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboPoolSize.descriptorCount = 1;
-
-	VkDescriptorPoolSize sizes[] = { ssboPoolSize, uboPoolSize };
-	VkDescriptorPoolCreateInfo computePoolInfo{};
-	computePoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	computePoolInfo.poolSizeCount = 2;
-	computePoolInfo.pPoolSizes = sizes;
-	computePoolInfo.maxSets = 2;
-
-	if (vkCreateDescriptorPool(logicalDevice, &computePoolInfo, nullptr, &computePipeline.descriptorPool) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create compute descriptor pool");
-
-	// create descriptor sets
-	VkDescriptorSetAllocateInfo computeAllocInfo{};
-	computeAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	computeAllocInfo.descriptorPool = computePipeline.descriptorPool;
-	computeAllocInfo.descriptorSetCount = 1;
-	computeAllocInfo.pSetLayouts = &computePipeline.descriptorSetLayout;
-
-	if (vkAllocateDescriptorSets(logicalDevice, &computeAllocInfo, &computePipeline.descriptorSet) != VK_SUCCESS)
-		throw std::runtime_error("Failed to allocated compute descriptor sets");
-
-	VkDescriptorBufferInfo bufferInfo = {};
-	bufferInfo.buffer = computePipeline.storageBuffer->buffer;
-	bufferInfo.offset = 0;
-	bufferInfo.range = sizeof(Particle) * MAX_NUM_PARTICLES;
-
-	VkWriteDescriptorSet descriptorWrite{};
-	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrite.dstSet = computePipeline.descriptorSet;
-	descriptorWrite.dstBinding = 0;
-	descriptorWrite.dstArrayElement = 0;
-	descriptorWrite.descriptorCount = 1;
-	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	descriptorWrite.pBufferInfo = &bufferInfo;
-
-	VkDescriptorBufferInfo uboInfo = {};
-	uboInfo.buffer = computePipeline.uniformBuffer->buffer;
-	uboInfo.offset = 0;
-	uboInfo.range = sizeof(UBO);
-
-	VkWriteDescriptorSet uboWrite = {};
-	uboWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	uboWrite.dstSet = computePipeline.descriptorSet;
-	uboWrite.dstBinding = 1;
-	uboWrite.dstArrayElement = 0;
-	uboWrite.descriptorCount = 1;
-	uboWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboWrite.pBufferInfo = &uboInfo;
-
-	VkWriteDescriptorSet writes[] = { descriptorWrite, uboWrite };
-
-	vkUpdateDescriptorSets(logicalDevice, 2, writes, 0, nullptr);
-}
-
-void Particles::ReadBackParticleData()
-{
-	
-
-	// read back particle data
-	VkDeviceSize size = sizeof(particles[0]) * MAX_NUM_PARTICLES;
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	HelperFunctions::createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer, stagingBufferMemory);
-
-	HelperFunctions::copyBuffer(commandPool, computePipeline.storageBuffer->buffer, stagingBuffer, size, VulkanDevice::GetVulkanDevice()->GetQueues().renderQueue);
-
-	void* data;
-	vkMapMemory(logicalDevice, stagingBufferMemory, 0, size, 0, &data);
-	memcpy(particles.data(), data, (size_t)size);
-	vkUnmapMemory(logicalDevice, stagingBufferMemory);
-
-	vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
-
-}
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include "VulkanScene.h"
 #include "VulkanDevice.h"
+#include "Renderer/ParticleSystem.h"
+#include "Renderer/UI.h"
 #include <time.h>
 
 class Particles : public VulkanScene
@@ -23,23 +25,21 @@ private:
 	virtual void DestroyScene(bool isRecreation) override;
 
 	void CreateCommandBuffers();
-	void CreateParticles(bool isRecreation);
+	void CreateParticles();
 	void CreateRenderPass(const VulkanSwapChain& swapChain);
 	void CreateFramebuffers(const VulkanSwapChain& swapChain);
 	void CreateGraphicsPipeline(const VulkanSwapChain& swapChain);
-	void CreateComputePipeline();
 	void CreateSyncObjects(const VulkanSwapChain& swapChain);
 	void CreateGraphicsDescriptorSets(const VulkanSwapChain& swapChain);
-	void CreateComputeDescriptorSets(const VulkanSwapChain& swapChain);
 	void CreateUniforms(const VulkanSwapChain& swapChain);
-	void UpdateUniforms(uint32_t currentFrame);
+	void UpdateUniforms(uint32_t imageIndex);
 
-	void ReadBackParticleData();
+	// the particle count and the copy drawn change every frame, so each frame is recorded again
+	void RecordCommandBuffers(uint32_t imageIndex);
 
 	uint32_t currentFrame = 0;
 
 	VulkanGraphicsPipeline graphicsPipeline;
-	VulkanComputePipeline computePipeline;
 	VkRenderPass renderPass;
 
 	struct UBO
@@ -49,17 +49,14 @@ private:
 		alignas(16) glm::mat4 proj;
 	} ubo;
 
-	struct ComputePush
-	{
-		int xBounds;
-		int yBounds;
-		int zBounds;
-	} pushConstants;
-
 	glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, -10.0f);
 
-	std::vector<Particle> particles;
-	VkBufferMemoryBarrier computeFinishedBarrier, vertexFinishedBarrier;
+	// lives on the GPU as long as the scene does, so recreating the swap chain keeps the particles
+	ParticleSystem particleSystem;
+
+	// UI
+	UI* ui = nullptr;
+	void DrawUI(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 };
 
 
@@ -1,5 +1,6 @@
 #include "ShadowMap.h"
 #include "Renderer/Loaders.h"
+#include <chrono>
 
 ShadowMap::ShadowMap(std::string name, const VulkanSwapChain& swapChain)
 {
@@ -10,21 +11,22 @@ ShadowMap::ShadowMap(std::string name, const VulkanSwapChain& swapChain)
 
 	CreateSyncObjects(swapChain);
 
+	// the graph creates the shadow map the descriptors point at
+	CreateRenderGraph(swapChain);
+
 	CreateShadowResources();
-	CreateShadowRenderPass(swapChain);
-	CreateShadowFramebuffers(swapChain);
 	CreateShadowDescriptorSets(swapChain);
 
 	CreateDebugResources(swapChain);
 
-	CreateSceneRenderPass(swapChain);
-	CreateSceneFramebuffers(swapChain);
 	CreateSceneDescriptorSets(swapChain);
+	CreateCascadeDescriptorSets(swapChain);
+	CreatePointDescriptorSets(swapChain);
 
 	CreatePipelines(swapChain);
-	CreateCommandBuffers();
+	CreateCommandBuffers(swapChain);
 
-	ui = new UI(commandPool, swapChain, renderPass, graphicsPipeline, VK_SAMPLE_COUNT_8_BIT);
+	ui = new UI(commandPool, swapChain, renderGraph.getRenderPass(scenePass), graphicsPipeline, VK_SAMPLE_COUNT_8_BIT);
 
 }
 
@@ -38,13 +40,10 @@ ShadowMap::~ShadowMap()
 
 void ShadowMap::DrawScene(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout, bool useMaterial)
 {
-	ground.draw(commandBuffer, pipelineLayout, useMaterial);
-	cube.draw(commandBuffer, pipelineLayout, useMaterial);
-	sphere.draw(commandBuffer, pipelineLayout, useMaterial);
-	monkey.draw(commandBuffer, pipelineLayout, useMaterial);
+	// every pass draws its own culler view, see CreateRenderGraph()
 }
 
-void ShadowMap::DrawUI(uint32_t frameIndex)
+void ShadowMap::DrawUI(VkCommandBuffer commandBuffer, uint32_t frameIndex)
 {
 	static Camera* camera = Camera::GetCamera();
 
@@ -54,24 +53,139 @@ void ShadowMap::DrawUI(uint32_t frameIndex)
 	{
 		glm::vec3 camPos = camera->GetCameraPosition();
 		ui->DisplayFPS();
+		// serial recording goes through the scene's recorder, the worker threads through their own
+		DrawStats stats = recorder.getStats();
+		stats += parallelRecorder.getStats();
+		ui->DisplayDrawStats(stats);
+
+		bool multithreaded = parallelRecorder.isEnabled();
+		if (ui->DrawCheckBox("Multithreaded Recording", &multithreaded))
+			parallelRecorder.setEnabled(multithreaded);
+
+		if (multithreaded)
+			ui->DrawUIText(parallelRecorder.isReusingFrame() ? "Scene passes: reused" : "Scene passes: re-recorded");
 		ui->DrawUITextVec3("Camera Position", camPos);
 	}
 	ui->EndWindow();
 
 	ui->NewWindow("Scene Data"); // TO DO: as always, figure out why depth values aren't rendered properly to texture
 	{ 
-		glm::vec3 lightPosition = light.getLightPos();
-		ui->DrawSliderVec3("Light Position", &lightPosition, -5.0f, 5.0f);
-		light.setLightPos(lightPosition);
+		// the scene pass switches pipelines, and the graph switches shadow passes
+		const char* modes[] = { "Spot Light", "Directional Light (Cascades)", "Point Light (Cube)" };
+		if (ImGui::BeginMenu(modes[shadowMode]))
+		{
+			for (int32_t i = 0; i < 3; i++)
+			{
+				if (ImGui::MenuItem(modes[i]) && shadowMode != i)
+				{
+					shadowMode = i;
+					parallelRecorder.markDirty();
+				}
+			}
+
+			ImGui::EndMenu();
+		}
+
+		ui->AddSpacing(2);
+
+		ui->DrawCheckBox("Cache Shadow Maps", &cacheShadows);
+		ui->DrawCheckBox("Animate Monkey", &animateMonkey);
+		bool shadowDrawn = shadowMode == CASCADED_SHADOWS ? cascadeCache.isDirty : (shadowMode == POINT_SHADOWS ? pointCache.isDirty : spotCache.isDirty);
+		ui->DrawUIText(shadowDrawn ? "Shadow pass: drawn" : "Shadow pass: skipped");
+
+		ui->AddSpacing(2);
+
+		// baked into the scene pipelines, see PresentScene()
+		const char* patterns[] = { "Grid", "Poisson Disk", "Rotated Grid" };
+		if (ImGui::BeginMenu(patterns[pcfPattern]))
+		{
+			for (int32_t i = 0; i < 3; i++)
+			{
+				if (ImGui::MenuItem(patterns[i]) && pcfPattern != i)
+				{
+					pcfPattern = i;
+					pcfChanged = true;
+				}
+			}
+
+			ImGui::EndMenu();
+		}
+
+		if (ImGui::SliderInt("PCF Radius", &pcfRadius, 0, 4))
+			pcfChanged = true;
+
+		ui->AddSpacing(2);
+
+		if (shadowMode == CASCADED_SHADOWS)
+		{
+			glm::vec3 direction = sun.getDirection();
+			if (ui->DrawSliderVec3("Light Direction", &direction, -1.0f, 1.0f) && glm::length(direction) > 0.01f)
+				sun.setDirection(direction);
+
+			ui->DrawSliderFloat("Shadow Distance", &shadowDistance, 10.0f, 500.0f);
+			ui->DrawSliderFloat("Split Lambda", &cascadeSplitLambda, 0.0f, 1.0f);
+			ui->DrawSliderFloat("Blend Band", &cascadeBlendBand, 0.0f, 0.5f);
+			ui->DrawCheckBox("Show Cascades", &showCascades);
+
+			for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+			{
+				std::string split = "Cascade " + std::to_string(i) + " ends at " + std::to_string(uboCascades.splitDepths[i]);
+				ui->DrawUIText(split.c_str());
+			}
+		}
+		else if (shadowMode == POINT_SHADOWS)
+		{
+			glm::vec3 lightPosition = bulb.getLightPos();
+			if (ui->DrawSliderVec3("Light Position", &lightPosition, -10.0f, 10.0f))
+				bulb.setLightPos(lightPosition);
+
+			float range = bulb.getRange();
+			if (ui->DrawSliderFloat("Light Range", &range, 1.0f, 60.0f))
+				bulb.setRange(range);
+		}
+		else
+		{
+			glm::vec3 lightPosition = light.getLightPos();
+			ui->DrawSliderVec3("Light Position", &lightPosition, -5.0f, 5.0f);
+			light.setLightPos(lightPosition);
+
+			ui->AddSpacing(2);
+
+			// the debug pass only runs while this is checked, and it starts running a frame after the box is ticked
+			ui->DrawCheckBox("Show Light Depth Texture", &showDepthTexture);
+			if (showDepthTexture && renderGraph.isPassLive(debugPass))
+			{
+				VkImageView view = renderGraph.getImageView(debugImage);
+				ui->DrawImage("Light Depth Texture", &shadowSampler, &view, glm::vec2(256));
+			}
+		}
 
 		ui->AddSpacing(2);
 
-		ui->DrawImage("Light Depth Texture", debugTex, &shadowSampler, glm::vec2(256));
+		// visible counts are only known when culling on the CPU
+		bool cpuCulling = culler.getCullMode() == CullMode::CPU;
+		if (ui->DrawCheckBox("CPU Culling", &cpuCulling))
+			culler.setCullMode(cpuCulling ? CullMode::CPU : CullMode::GPU);
+
+		if (cpuCulling)
+		{
+			// the scene has too few objects to reach the tree on its own
+			bool bvhCulling = culler.getAlwaysCullWithBVH();
+			if (ui->DrawCheckBox("Cull With BVH", &bvhCulling))
+				culler.setAlwaysCullWithBVH(bvhCulling);
+
+			uint32_t total = culler.getObjectCount();
+			std::string cameraCulled = "Camera culled: " + std::to_string(total - culler.getVisibleCount(CAMERA_VIEW)) + " / " + std::to_string(total);
+			uint32_t lightView = shadowMode == CASCADED_SHADOWS ? CASCADE_VIEW : (shadowMode == POINT_SHADOWS ? POINT_VIEW : LIGHT_VIEW);
+			std::string lightCulled = "Shadow casters culled: " + std::to_string(total - culler.getVisibleCount(lightView)) + " / " + std::to_string(total);
+			ui->DrawUIText(cameraCulled.c_str());
+			ui->DrawUIText(lightCulled.c_str());
+		}
 	}
 	ui->EndWindow();
 
 	ui->EndFrame();
-	ui->RenderFrame(commandBuffersList[frameIndex], frameIndex);
+	ui->RenderFrame(commandBuffer, frameIndex);
 }
 
 VulkanReturnValues ShadowMap::PresentScene(const VulkanSwapChain& swapChain)
@@ -80,6 +194,20 @@ VulkanReturnValues ShadowMap::PresentScene(const VulkanSwapChain& swapChain)
 
 	uint32_t imageIndex;
 
+	// a new shadow filter only needs new scene pipelines, but the old ones may still be in use by frames in flight
+	if (pcfChanged)
+	{
+		vkWaitForFences(logicalDevice, static_cast<uint32_t>(inFlightFences.size()), inFlightFences.data(), VK_TRUE, UINT64_MAX);
+
+		// the layouts stay
+		vkDestroyPipeline(logicalDevice, graphicsPipeline.pipeline, nullptr);
+		vkDestroyPipeline(logicalDevice, cascadeScenePipeline.pipeline, nullptr);
+		vkDestroyPipeline(logicalDevice, pointScenePipeline.pipeline, nullptr);
+		CreateScenePipelines();
+		parallelRecorder.markDirty();
+		pcfChanged = false;
+	}
+
 	/*
 	********** PREPARATION ************
 	*/
@@ -220,95 +348,75 @@ void ShadowMap::RecordCommandBuffers(uint32_t index)
 {
 	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
 
-	VkRenderPassBeginInfo renderPassInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
-	renderPassInfo.renderArea.offset = { 0, 0 };
-
-	VkClearValue clearValues[2];
-	VkDeviceSize offsets[] = { 0 };
-
 	if (vkBeginCommandBuffer(commandBuffersList[index], &beginInfo) != VK_SUCCESS)
 		throw std::runtime_error("Failed to being recording command buffer!");
 
-	// perform shadow pass to generate shadow map
-	{
-		clearValues[0].depthStencil = {1.0f, 0};
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = shadowPipeline.framebuffers[0];
-		renderPassInfo.renderArea.extent = shadowPipeline.scissors.extent;
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = clearValues;
+	recorder.begin(commandBuffersList[index]);
 
-		vkCmdBeginRenderPass(commandBuffersList[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		vkCmdSetViewport(commandBuffersList[index], 0, 1, &shadowPipeline.viewport);
-		vkCmdSetScissor(commandBuffersList[index], 0, 1, &shadowPipeline.scissors);
-		vkCmdSetDepthBias(commandBuffersList[index], depthBiasConstant, 0.0f, depthBiasSlope);
-
-		vkCmdBindPipeline(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.pipeline);
-		vkCmdBindDescriptorSets(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.pipelineLayout,
-			0, 1, &shadowPipeline.descriptorSets[index], 0, nullptr);
-
-		// the floor doesn't cast shadows, so no need to render it here
-		DrawScene(commandBuffersList[index], shadowPipeline.pipelineLayout);
-
-		vkCmdEndRenderPass(commandBuffersList[index]);
-	}
-
-	// run fsq shaders to write depth map to an offscreen texture
-	{
-		clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
+	// the shadow map of the current light is only drawn again when it would come out different
+	ShadowCache& cache = shadowMode == CASCADED_SHADOWS ? cascadeCache : (shadowMode == POINT_SHADOWS ? pointCache : spotCache);
+	if (shadowMode == CASCADED_SHADOWS)
+		UpdateShadowCache(cache, uboCascades.viewProj, CASCADE_COUNT);
+	else if (shadowMode == POINT_SHADOWS)
+		UpdateShadowCache(cache, uboPoint.faceViewProj, 6);
+	else
+		UpdateShadowCache(cache, &uboShadow.viewProj, 1);
 
-		renderPassInfo.framebuffer = debugPipeline.framebuffers[0];
-		renderPassInfo.renderArea.extent = debugPipeline.scissors.extent;
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = clearValues;
+	// cull each view before its pass begins, skipped shadow passes need no culling. the cascades and the cube
+	// faces share their draws, so each is culled as one box
+	if (cache.isDirty && shadowMode == CASCADED_SHADOWS)
+		culler.cull(commandBuffersList[index], CASCADE_VIEW, sun.getCasterViewProj());
+	else if (cache.isDirty && shadowMode == POINT_SHADOWS)
+		culler.cull(commandBuffersList[index], POINT_VIEW, bulb.getCasterViewProj());
+	else if (cache.isDirty)
+		culler.cull(commandBuffersList[index], LIGHT_VIEW, uboShadow.viewProj);
+	culler.cull(commandBuffersList[index], CAMERA_VIEW, uboScene.proj * uboScene.view);
 
-		vkCmdBeginRenderPass(commandBuffersList[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// the recorder caches passes in the order they're recorded, so it can't reuse them across a change of live passes
+	if (renderGraph.cullPasses())
+		parallelRecorder.markDirty();
 
-		vkCmdSetViewport(commandBuffersList[index], 0, 1, &debugPipeline.viewport);
-		vkCmdSetScissor(commandBuffersList[index], 0, 1, &debugPipeline.scissors);
+	// the passes recorded for this image last time are reused unless the culled draws changed
+	parallelRecorder.beginFrame(index, culler.getDrawVersion());
 
-		vkCmdBindPipeline(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, debugPipeline.pipeline);
-		vkCmdBindDescriptorSets(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, debugPipeline.pipelineLayout,
-			0, 1, &debugPipeline.descriptorSets[0], 0, nullptr);
+	// shadow map or cascades, the debug view when shown, then the scene
+	renderGraph.execute(commandBuffersList[index], index);
 
-		float push[] = { light.getNearPlane(), light.getFarPlane() };
-		vkCmdPushConstants(commandBuffersList[index], debugPipeline.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, 2 * sizeof(float), push);
+	if (vkEndCommandBuffer(commandBuffersList[index]) != VK_SUCCESS)
+		throw std::runtime_error("Failed to record command buffer");
+}
 
-		vkCmdDraw(commandBuffersList[index], 3, 1, 0, 0);
+void ShadowMap::UpdateShadowCache(ShadowCache& cache, const glm::mat4* viewProjs, uint32_t count)
+{
+	std::vector<glm::mat4> current(viewProjs, viewProjs + count);
+	uint64_t transformVersion = culler.getTransformVersion();
 
-		vkCmdEndRenderPass(commandBuffersList[index]);
-	}
+	bool lightMoved = cache.viewProjs != current;
+	cache.isDirty = !cacheShadows || !cache.isValid || lightMoved;
 
-	// render the scene normally, rendering the depth map to a UI image
+	// when objects moved, the shadow only changes if one was a caster or something entered or left the light's reach
+	if (lightMoved || transformVersion != cache.transformVersion)
 	{
-		VkClearValue clearColors[2] = {};
-		clearColors[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearColors[1].depthStencil = { 1.0f, 0 };
-
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = graphicsPipeline.framebuffers[index];
-		renderPassInfo.renderArea.extent = graphicsPipeline.scissors.extent;
-		renderPassInfo.clearValueCount = 2;
-		renderPassInfo.pClearValues = clearColors;
-
-		vkCmdBeginRenderPass(commandBuffersList[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdSetViewport(commandBuffersList[index], 0, 1, &graphicsPipeline.viewport);
-		vkCmdSetScissor(commandBuffersList[index], 0, 1, &graphicsPipeline.scissors);
-
-		vkCmdBindDescriptorSets(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipelineLayout,
-			0, 1, &graphicsPipeline.descriptorSets[index], 0, nullptr);
-
-		vkCmdBindPipeline(commandBuffersList[index], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipeline);
-
-		DrawScene(commandBuffersList[index], graphicsPipeline.pipelineLayout, true);
-
-		DrawUI(index);
-		vkCmdEndRenderPass(commandBuffersList[index]);
+		casters.clear();
+		if (shadowMode == CASCADED_SHADOWS)
+			culler.queryObjectsInFrustum(sun.getCasterViewProj(), casters);
+		else if (shadowMode == POINT_SHADOWS)
+			culler.queryObjectsInSphere(bulb.getLightPos(), bulb.getRange(), casters);
+		else
+			culler.queryObjectsInFrustum(uboShadow.viewProj, casters);
+		std::sort(casters.begin(), casters.end());
+
+		cache.isDirty |= casters != cache.casters;
+		for (size_t i = 0; i < casters.size() && !cache.isDirty; i++)
+			cache.isDirty = culler.getTransformVersion(casters[i]) > cache.transformVersion;
+
+		cache.casters.swap(casters);
+		cache.transformVersion = transformVersion;
 	}
 
-	if (vkEndCommandBuffer(commandBuffersList[index]) != VK_SUCCESS)
-		throw std::runtime_error("Failed to record command buffer");
+	// what the pass draws with this frame
+	if (cache.isDirty)
+		cache.viewProjs = current;
 }
 
 void ShadowMap::RecreateScene(const VulkanSwapChain& swapChain)
@@ -316,35 +424,41 @@ void ShadowMap::RecreateScene(const VulkanSwapChain& swapChain)
 	DestroyScene(true);
 
 	CreateUniforms(swapChain);
+	CreateRenderGraph(swapChain);
 
 	CreateShadowResources();
-	CreateShadowRenderPass(swapChain);
-	CreateShadowFramebuffers(swapChain);
 	CreateShadowDescriptorSets(swapChain);
 
 	CreateDebugResources(swapChain);
 
-	CreateSceneRenderPass(swapChain);
-	CreateSceneFramebuffers(swapChain);
 	CreateSceneDescriptorSets(swapChain);
+	CreateCascadeDescriptorSets(swapChain);
+	CreatePointDescriptorSets(swapChain);
 
 	CreatePipelines(swapChain);
-	CreateCommandBuffers();
+	CreateCommandBuffers(swapChain);
 
 	delete ui;
-	ui = new UI(commandPool, swapChain, renderPass, graphicsPipeline, VK_SAMPLE_COUNT_8_BIT);
+	ui = new UI(commandPool, swapChain, renderGraph.getRenderPass(scenePass), graphicsPipeline, VK_SAMPLE_COUNT_8_BIT);
 }
 
 void ShadowMap::DestroyScene(bool isRecreation)
 {
-	vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
+	// the cached passes reference the pipelines and framebuffers destroyed here
+	parallelRecorder.markDirty();
+
 	graphicsPipeline.destroyGraphicsPipeline(logicalDevice);
 	debugPipeline.destroyGraphicsPipeline(logicalDevice);
 	shadowPipeline.destroyGraphicsPipeline(logicalDevice);
+	cascadePipeline.destroyGraphicsPipeline(logicalDevice);
+	cascadeScenePipeline.destroyGraphicsPipeline(logicalDevice);
+	pointPipeline.destroyGraphicsPipeline(logicalDevice);
+	pointScenePipeline.destroyGraphicsPipeline(logicalDevice);
+	descriptorAllocator.reset();
 
-	msaaTex.destroyTexture();
-	debugTex.destroyTexture();
+	renderGraph.destroy();
 	vkDestroySampler(logicalDevice, shadowSampler, nullptr);
+	vkDestroySampler(logicalDevice, shadowCompareSampler, nullptr);
 
 	uint32_t size = static_cast<uint32_t>(commandBuffersList.size());
 	vkFreeCommandBuffers(logicalDevice, commandPool, size, commandBuffersList.data());
@@ -363,6 +477,8 @@ void ShadowMap::DestroyScene(bool isRecreation)
 		ground.destroyMesh();
 		monkey.destroyMesh();
 		sphere.destroyMesh();
+		culler.destroy();
+		parallelRecorder.destroy();
 	}
 }
 
@@ -378,7 +494,7 @@ void ShadowMap::CreateSceneObjects()
 
 	ground = BasicShapes::createPlane();
 	ground.setMaterialWithPreset(MaterialPresets::EMERALD);
-	model = glm::scale(glm::vec3(5.0f));
+	model = glm::scale(glm::vec3(80.0f));
 	ground.setModelMatrix(model);
 
 	monkey = BasicShapes::createMonkey();
@@ -391,6 +507,32 @@ void ShadowMap::CreateSceneObjects()
 	sphere.setMaterialWithPreset(MaterialPresets::OBSIDIAN);
 	model = glm::translate(glm::vec3(1.0f, 0.5f, 0.0f)) * glm::scale(glm::vec3(0.5f));
 	sphere.setModelMatrix(model);
+
+	// a field of pillars around them, far enough out to need every cascade
+	std::vector<glm::mat4> pillarTransforms;
+	for (int32_t x = -6; x <= 6; x++)
+	{
+		for (int32_t z = -6; z <= 6; z++)
+		{
+			if (std::abs(x) < 1 && std::abs(z) < 1)
+				continue;
+
+			// the box is a unit cube around the origin
+			float height = 2.0f + float((x * 7 + z * 13) & 3);
+			pillarTransforms.push_back(glm::translate(glm::vec3(x * 6.0f, 0.5f * height, z * 6.0f)) * glm::scale(glm::vec3(0.8f, height, 0.8f)));
+		}
+	}
+	pillarMaterial.setPreset(MaterialPresets::WHITE_PLASTIC);
+
+	culler.addObject(&ground);
+	culler.addObject(&cube);
+	culler.addObject(&sphere);
+	monkeyObject = culler.addObject(&monkey);
+	culler.addInstances(BasicShapes::getBox(), pillarTransforms, { &pillarMaterial });
+	culler.build(4);
+
+	// only a handful of objects, testing them on the CPU is cheaper than a dispatch per view
+	culler.setCullMode(CullMode::CPU);
 }
 
 void ShadowMap::CreateUniforms(const VulkanSwapChain& swapChain)
@@ -401,9 +543,17 @@ void ShadowMap::CreateUniforms(const VulkanSwapChain& swapChain)
 
 	uboShadow.viewProj = light.getLightProj() * light.getLightView();
 
+	sun = DirectionalLight(glm::vec3(-0.5f, -1.0f, -0.3f));
+	uboCascades = {}; // filled in per frame while the cascades are used
+
+	// low enough for the pillars to throw long shadows
+	bulb = PointLight(glm::vec3(0.0f, 3.0f, 0.0f), glm::vec3(1.0f), 30.0f);
+	uboPoint = {}; // filled in per frame while the cube is used
+
 	Camera* camera = Camera::GetCamera();
+	cameraAspect = float(dim.width) / float(dim.height);
 	uboScene.view = camera->GetViewMatrix();
-	uboScene.proj = glm::perspective(glm::radians(45.0f), float(dim.width) / float(dim.height), 0.1f, 1000.0f);
+	uboScene.proj = glm::perspective(glm::radians(45.0f), cameraAspect, NEAR_PLANE, FAR_PLANE);
 	uboScene.proj[1][1] *= -1;
 	uboScene.lightVP = uboShadow.viewProj;
 	uboScene.lightPos = glm::vec4(light.getLightPos(), 1.0);
@@ -411,6 +561,14 @@ void ShadowMap::CreateUniforms(const VulkanSwapChain& swapChain)
 
 void ShadowMap::UpdateUniforms(uint32_t index)
 {
+	static auto startTime = std::chrono::high_resolution_clock::now();
+	if (animateMonkey)
+	{
+		float time = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+		glm::mat4 model = glm::translate(glm::vec3(0.0f, 0.5f, 0.0f)) * glm::rotate(time, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::scale(glm::vec3(0.5f));
+		culler.setModelMatrix(monkeyObject, model);
+	}
+
 	uboShadow.viewProj = light.getLightProj() * light.getLightView();
 	glm::vec3 lightPos = light.getLightPos();
 
@@ -428,6 +586,36 @@ void ShadowMap::UpdateUniforms(uint32_t index)
 
 	graphicsPipeline.uniformBuffers[index].unmap();
 	shadowPipeline.uniformBuffers[index].unmap();
+
+	if (shadowMode == POINT_SHADOWS)
+	{
+		std::vector<glm::mat4> faces = bulb.computeFaceViewProjs(POINT_NEAR_PLANE);
+		std::copy(faces.begin(), faces.end(), uboPoint.faceViewProj);
+		uboPoint.lightPosRange = glm::vec4(bulb.getLightPos(), bulb.getRange());
+
+		pointPipeline.uniformBuffers[index].map();
+		memcpy(pointPipeline.uniformBuffers[index].mappedMemory, &uboPoint, sizeof(uboPoint));
+		pointPipeline.uniformBuffers[index].unmap();
+	}
+
+	if (shadowMode != CASCADED_SHADOWS)
+		return;
+
+	// the cascades follow the camera
+	std::vector<ShadowCascade> cascades = sun.computeCascades(uboScene.view, glm::radians(45.0f), cameraAspect, NEAR_PLANE,
+		std::min(shadowDistance, FAR_PLANE), CASCADE_COUNT, cascadeMapDim, cascadeSplitLambda);
+
+	for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+	{
+		uboCascades.viewProj[i] = cascades[i].viewProj;
+		uboCascades.splitDepths[i] = cascades[i].splitDepth;
+	}
+	uboCascades.lightDirection = glm::vec4(sun.getDirection(), 0.0f);
+	uboCascades.params = glm::vec4(cascadeBlendBand, showCascades ? 1.0f : 0.0f, 0.0f, 0.0f);
+
+	cascadePipeline.uniformBuffers[index].map();
+	memcpy(cascadePipeline.uniformBuffers[index].mappedMemory, &uboCascades, sizeof(uboCascades));
+	cascadePipeline.uniformBuffers[index].unmap();
 }
 
 
@@ -436,8 +624,9 @@ void ShadowMap::CreatePipelines(const VulkanSwapChain& swapChain)
 #pragma region SETUP
 
 	// vertex descriptions
-	VkVertexInputBindingDescription bindingDescription = ModelVertex::getBindingDescription();
-	std::array<VkVertexInputAttributeDescription, 3> attributeDescription = ModelVertex::getAttributeDescriptions();
+	// vertices plus the culler's per instance object indices, shared by the scene and shadow pipelines
+	std::array<VkVertexInputBindingDescription, 2> bindingDescription = GPUCuller::getBindingDescriptions();
+	std::array<VkVertexInputAttributeDescription, 4> attributeDescription = GPUCuller::getAttributeDescriptions();
 
 	VkPipelineColorBlendAttachmentState colorBlendingAttachment = 
 	{
@@ -450,7 +639,7 @@ void ShadowMap::CreatePipelines(const VulkanSwapChain& swapChain)
 	};
 
 
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo(1, bindingDescription, 3, attributeDescription.data());
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo(2, bindingDescription[0], 4, attributeDescription.data());
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = HelperFunctions::initializers::pipelineInputAssemblyStateCreateInfo();
 	VkPipelineViewportStateCreateInfo viewportState = HelperFunctions::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
 	VkPipelineRasterizationStateCreateInfo rasterizerState = HelperFunctions::initializers::pipelineRasterizationStateCreateInfo();
@@ -478,56 +667,25 @@ void ShadowMap::CreatePipelines(const VulkanSwapChain& swapChain)
 
 #pragma endregion
 
-#pragma region SCENE_PIPELINE
+#pragma region SCENE_PIPELINES
 	{
-		auto vertShaderCode = HelperFunctions::readShaderFile(SHADERPATH"ShadowMap/scene_vert.spv");
-		VkShaderModule vertShaderModule = HelperFunctions::CreateShaderModules(vertShaderCode);
-
-		auto fragShaderCode = HelperFunctions::readShaderFile(SHADERPATH"ShadowMap/scene_frag.spv");
-		VkShaderModule fragShaderModule = HelperFunctions::CreateShaderModules(fragShaderCode);
-
-		VkPipelineShaderStageCreateInfo shaderStages[] =
+		// the spot light, cascade and cube variants of the scene only differ in their fragment shader and set 0.
+		// objects and materials are read from the culler's tables
+		VulkanGraphicsPipeline* scenePipelines[3] = { &graphicsPipeline, &cascadeScenePipeline, &pointScenePipeline };
+		for (VulkanGraphicsPipeline* scenePipeline : scenePipelines)
 		{
-			HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule),
-			HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule),
-		};
-
-		// models and shapes have the same descriptor set layout
-		VkDescriptorSetLayout layouts[3] = { graphicsPipeline.descriptorSetLayout, cube.descriptorSetLayout, cube.material->descriptorSetLayout };
-
-		VkPipelineLayoutCreateInfo layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(3, layouts);
-
-		graphicsPipeline.result = vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &graphicsPipeline.pipelineLayout);
-		if (graphicsPipeline.result != VK_SUCCESS)
-			throw std::runtime_error("Failed to create pipeline layout");
+			VkDescriptorSetLayout layouts[2] = { scenePipeline->descriptorSetLayout, culler.getDescriptorSetLayout() };
+			VkPipelineLayoutCreateInfo layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(2, layouts);
 
-		multisampleState.sampleShadingEnable = VK_TRUE;
-		multisampleState.minSampleShading = 0.8f;
+			if (vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &scenePipeline->pipelineLayout) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create pipeline layout");
 
-		graphicsPipeline.viewport.x = 0.0f;
-		graphicsPipeline.viewport.y = 0.0f;
-		graphicsPipeline.viewport.minDepth = 0.0f;
-		graphicsPipeline.viewport.maxDepth = 1.0f;
-		graphicsPipeline.viewport.width = (float)dim.width;
-		graphicsPipeline.viewport.height = (float)dim.height;
-		graphicsPipeline.scissors.offset = { 0, 0 };
-		graphicsPipeline.scissors.extent = dim;
-		viewportState.pViewports = &graphicsPipeline.viewport;
-		viewportState.pScissors = &graphicsPipeline.scissors;
-
-
-		pipelineInfo.stageCount = 2;
-		pipelineInfo.pStages = shaderStages;
-		pipelineInfo.renderPass = renderPass;
-		pipelineInfo.layout = graphicsPipeline.pipelineLayout;
-		pipelineInfo.pViewportState = &viewportState;
-
-		graphicsPipeline.result = vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &graphicsPipeline.pipeline);
-		if (graphicsPipeline.result != VK_SUCCESS)
-			throw std::runtime_error("Failed to create graphics pipeline");
+			scenePipeline->viewport = { 0.0f, 0.0f, (float)dim.width, (float)dim.height, 0.0f, 1.0f };
+			scenePipeline->scissors.offset = { 0, 0 };
+			scenePipeline->scissors.extent = dim;
+		}
 
-		vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
-		vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
+		CreateScenePipelines();
 	}
 #pragma endregion
 
@@ -567,7 +725,7 @@ void ShadowMap::CreatePipelines(const VulkanSwapChain& swapChain)
 		dynamicState.dynamicStateCount = 3;
 
 		// ** Pipeline Layout ** 
-		VkDescriptorSetLayout layouts[] = { shadowPipeline.descriptorSetLayout, cube.descriptorSetLayout };
+		VkDescriptorSetLayout layouts[] = { shadowPipeline.descriptorSetLayout, culler.getDescriptorSetLayout() };
 
 		VkPipelineLayoutCreateInfo layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(2, layouts);
 
@@ -575,7 +733,7 @@ void ShadowMap::CreatePipelines(const VulkanSwapChain& swapChain)
 		if (shadowPipeline.result != VK_SUCCESS)
 			throw std::runtime_error("Failed to create pipeline layout");
 
-		pipelineInfo.renderPass = renderPass;
+		pipelineInfo.renderPass = renderGraph.getRenderPass(shadowPass);
 		pipelineInfo.stageCount = 1;
 		pipelineInfo.pStages = &shaderStage;
 		pipelineInfo.layout = shadowPipeline.pipelineLayout;
@@ -588,6 +746,68 @@ void ShadowMap::CreatePipelines(const VulkanSwapChain& swapChain)
 	}
 #pragma endregion
 
+#pragma region CASCADE_PIPELINE
+	{
+		// same state as the shadow pipeline, the multiview render pass draws it once per cascade
+		auto vertShaderCode = HelperFunctions::readShaderFile(SHADERPATH"ShadowMap/cascade_shadow_vert.spv");
+		VkShaderModule vertShaderModule = HelperFunctions::CreateShaderModules(vertShaderCode);
+
+		VkPipelineShaderStageCreateInfo shaderStage = HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule);
+
+		cascadePipeline.viewport = { 0.0f, 0.0f, (float)cascadeMapDim, (float)cascadeMapDim, 0.0f, 1.0f };
+		cascadePipeline.scissors.offset = { 0, 0 };
+		cascadePipeline.scissors.extent = { cascadeMapDim, cascadeMapDim };
+		viewportState.pViewports = &cascadePipeline.viewport;
+		viewportState.pScissors = &cascadePipeline.scissors;
+
+		VkDescriptorSetLayout layouts[] = { cascadePipeline.descriptorSetLayout, culler.getDescriptorSetLayout() };
+		VkPipelineLayoutCreateInfo layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(2, layouts);
+
+		if (vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &cascadePipeline.pipelineLayout) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create pipeline layout");
+
+		pipelineInfo.renderPass = renderGraph.getRenderPass(cascadePass);
+		pipelineInfo.pStages = &shaderStage;
+		pipelineInfo.layout = cascadePipeline.pipelineLayout;
+
+		if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &cascadePipeline.pipeline) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create graphics pipeline");
+
+		vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
+	}
+#pragma endregion
+
+#pragma region POINT_PIPELINE
+	{
+		// same state as the cascade pipeline, the multiview render pass draws it once per cube face
+		auto vertShaderCode = HelperFunctions::readShaderFile(SHADERPATH"ShadowMap/point_shadow_vert.spv");
+		VkShaderModule vertShaderModule = HelperFunctions::CreateShaderModules(vertShaderCode);
+
+		VkPipelineShaderStageCreateInfo shaderStage = HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule);
+
+		pointPipeline.viewport = { 0.0f, 0.0f, (float)pointMapDim, (float)pointMapDim, 0.0f, 1.0f };
+		pointPipeline.scissors.offset = { 0, 0 };
+		pointPipeline.scissors.extent = { pointMapDim, pointMapDim };
+		viewportState.pViewports = &pointPipeline.viewport;
+		viewportState.pScissors = &pointPipeline.scissors;
+
+		VkDescriptorSetLayout layouts[] = { pointPipeline.descriptorSetLayout, culler.getDescriptorSetLayout() };
+		VkPipelineLayoutCreateInfo layoutInfo = HelperFunctions::initializers::pipelineLayoutCreateInfo(2, layouts);
+
+		if (vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &pointPipeline.pipelineLayout) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create pipeline layout");
+
+		pipelineInfo.renderPass = renderGraph.getRenderPass(pointPass);
+		pipelineInfo.pStages = &shaderStage;
+		pipelineInfo.layout = pointPipeline.pipelineLayout;
+
+		if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &pointPipeline.pipeline) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create graphics pipeline");
+
+		vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
+	}
+#pragma endregion
+
 #pragma region DEBUG_PIPELINE
 	{
 		auto vertShaderCode = HelperFunctions::readShaderFile(SHADERPATH"Global/full_screen_quad.spv");
@@ -641,7 +861,7 @@ void ShadowMap::CreatePipelines(const VulkanSwapChain& swapChain)
 
 		vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &debugPipeline.pipelineLayout);
 
-		pipelineInfo.renderPass = renderPass;
+		pipelineInfo.renderPass = renderGraph.getRenderPass(debugPass);
 		pipelineInfo.stageCount = 2;
 		pipelineInfo.pStages = shaderStages;
 		pipelineInfo.layout = debugPipeline.pipelineLayout;
@@ -654,6 +874,89 @@ void ShadowMap::CreatePipelines(const VulkanSwapChain& swapChain)
 #pragma endregion
 }
 
+void ShadowMap::CreateScenePipelines()
+{
+	// same vertex input as every culler pipeline, and the scene pass's 8x multisampled color and depth
+	std::array<VkVertexInputBindingDescription, 2> bindingDescription = GPUCuller::getBindingDescriptions();
+	std::array<VkVertexInputAttributeDescription, 4> attributeDescription = GPUCuller::getAttributeDescriptions();
+
+	VkPipelineColorBlendAttachmentState colorBlendingAttachment =
+	{
+		VK_TRUE,
+		VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		VK_BLEND_OP_ADD,
+		VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		VK_BLEND_OP_ADD,
+		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+	};
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = HelperFunctions::initializers::pipelineVertexInputStateCreateInfo(2, bindingDescription[0], 4, attributeDescription.data());
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = HelperFunctions::initializers::pipelineInputAssemblyStateCreateInfo();
+	VkPipelineViewportStateCreateInfo viewportState = HelperFunctions::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
+	VkPipelineRasterizationStateCreateInfo rasterizerState = HelperFunctions::initializers::pipelineRasterizationStateCreateInfo();
+	VkPipelineMultisampleStateCreateInfo multisampleState = HelperFunctions::initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_8_BIT);
+	VkPipelineColorBlendStateCreateInfo colorBlendState = HelperFunctions::initializers::pipelineColorBlendStateCreateInfo(1, colorBlendingAttachment);
+	VkPipelineDepthStencilStateCreateInfo depthStencilState = HelperFunctions::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+	multisampleState.sampleShadingEnable = VK_TRUE;
+	multisampleState.minSampleShading = 0.8f;
+
+	VkDynamicState dynamicStateEnables[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState = HelperFunctions::initializers::pipelineDynamicStateCreateInfo(2, dynamicStateEnables);
+
+	// the shadow filter, see pcf.glsl
+	int32_t pcfConstants[2] = { pcfRadius, pcfPattern };
+	VkSpecializationMapEntry pcfEntries[2] = { { 0, 0, sizeof(int32_t) }, { 1, sizeof(int32_t), sizeof(int32_t) } };
+	VkSpecializationInfo pcfSpecialization = { 2, pcfEntries, sizeof(pcfConstants), pcfConstants };
+
+	auto vertShaderCode = HelperFunctions::readShaderFile(SHADERPATH"ShadowMap/scene_vert.spv");
+	VkShaderModule vertShaderModule = HelperFunctions::CreateShaderModules(vertShaderCode);
+
+	VulkanGraphicsPipeline* scenePipelines[3] = { &graphicsPipeline, &cascadeScenePipeline, &pointScenePipeline };
+	const char* fragShaders[3] = { SHADERPATH"ShadowMap/scene_frag.spv", SHADERPATH"ShadowMap/cascade_scene_frag.spv",
+		SHADERPATH"ShadowMap/point_scene_frag.spv" };
+
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		auto fragShaderCode = HelperFunctions::readShaderFile(fragShaders[i]);
+		VkShaderModule fragShaderModule = HelperFunctions::CreateShaderModules(fragShaderCode);
+
+		VkPipelineShaderStageCreateInfo shaderStages[] =
+		{
+			HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule),
+			HelperFunctions::initializers::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule),
+		};
+		shaderStages[1].pSpecializationInfo = &pcfSpecialization;
+
+		viewportState.pViewports = &scenePipelines[i]->viewport;
+		viewportState.pScissors = &scenePipelines[i]->scissors;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = shaderStages;
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssemblyState;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizerState;
+		pipelineInfo.pMultisampleState = &multisampleState;
+		pipelineInfo.pColorBlendState = &colorBlendState;
+		pipelineInfo.pDepthStencilState = &depthStencilState;
+		pipelineInfo.pDynamicState = &dynamicState;
+		pipelineInfo.renderPass = renderGraph.getRenderPass(scenePass);
+		pipelineInfo.subpass = 0;
+		pipelineInfo.layout = scenePipelines[i]->pipelineLayout;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineInfo.basePipelineIndex = -1;
+
+		if (vkCreateGraphicsPipelines(logicalDevice, nullptr, 1, &pipelineInfo, nullptr, &scenePipelines[i]->pipeline) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create graphics pipeline");
+
+		vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
+	}
+
+	vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
+}
+
 void ShadowMap::CreateSyncObjects(const VulkanSwapChain& swapChain)
 {
 	// create semaphores
@@ -677,9 +980,9 @@ void ShadowMap::CreateSyncObjects(const VulkanSwapChain& swapChain)
 	}
 }
 
-void ShadowMap::CreateCommandBuffers()
+void ShadowMap::CreateCommandBuffers(const VulkanSwapChain& swapChain)
 {
-	commandBuffersList.resize(graphicsPipeline.framebuffers.size());
+	commandBuffersList.resize(swapChain.swapChainImages.size());
 
 	VkCommandBufferAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -692,65 +995,170 @@ void ShadowMap::CreateCommandBuffers()
 }
 
 
-// ********* SHADOW PIPELINE **************
+// ********* RENDER GRAPH **************
 
-void ShadowMap::CreateShadowRenderPass(const VulkanSwapChain& swapChain)
+void ShadowMap::CreateRenderGraph(const VulkanSwapChain& swapChain)
 {
-	VkAttachmentDescription depthAttachmentDescription = {};
-	depthAttachmentDescription.format = depthFormat;
-	depthAttachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	depthAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-	// Attachment will be transitioned to shader read at render pass end
-	depthAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-
-	VkAttachmentReference depthAttachmentReference = {};
-	depthAttachmentReference.attachment = 0;
-	depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 0;
-	subpass.pColorAttachments = nullptr;
-	subpass.pDepthStencilAttachment = &depthAttachmentReference;
-
-	// Use subpass dependencies for layout transitions
-	std::array<VkSubpassDependency, 2> dependencies;
-
-	// wait for scene render pass to finish reading from depth buffer
-	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[0].dstSubpass = 0;
-	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	// scene pass must wait for the shadow pass to write to the depth buffer
-	dependencies[1].srcSubpass = 0;
-	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	VkRenderPassCreateInfo renderPassCreateInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &depthAttachmentDescription;
-	renderPassCreateInfo.subpassCount = 1;
-	renderPassCreateInfo.pSubpasses = &subpass;
-	renderPassCreateInfo.dependencyCount = 2;
-	renderPassCreateInfo.pDependencies = dependencies.data();
-
-	if (vkCreateRenderPass(logicalDevice, &renderPassCreateInfo, nullptr, &renderPass))
-		throw std::runtime_error("Failed to create shadow render pass");
+	VkExtent2D dim = swapChain.swapChainDimensions;
+	VkExtent2D shadowDim = { shadowMapDim, shadowMapDim };
+
+	// new images, nothing drawn into them yet
+	spotCache = {};
+	cascadeCache = {};
+	pointCache = {};
+
+	VkClearValue black = {};
+	black.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	VkClearValue farDepth = {};
+	farDepth.depthStencil = { 1.0f, 0 };
+
+	shadowDepthImage = renderGraph.createImage("Shadow Map", depthFormat, shadowDim);
+	cascadeImage = renderGraph.createImage("Shadow Cascades", VK_FORMAT_D32_SFLOAT, { cascadeMapDim, cascadeMapDim }, VK_SAMPLE_COUNT_1_BIT, CASCADE_COUNT);
+	pointImage = renderGraph.createImage("Point Shadow Cube", VK_FORMAT_D32_SFLOAT, { pointMapDim, pointMapDim }, VK_SAMPLE_COUNT_1_BIT, 6);
+	debugImage = renderGraph.createImage("Shadow Map Debug", swapChain.swapChainImageFormat, shadowDim);
+	uint32_t colorImage = renderGraph.createImage("Scene Color", swapChain.swapChainImageFormat, dim, VK_SAMPLE_COUNT_8_BIT);
+	uint32_t depthImage = renderGraph.createImage("Scene Depth", VK_FORMAT_D24_UNORM_S8_UINT, dim, VK_SAMPLE_COUNT_8_BIT);
+	uint32_t swapChainImage = renderGraph.importSwapChain(swapChain);
+
+	// perform shadow pass to generate shadow map
+	shadowPass = renderGraph.addGraphicsPass("Shadow", [this](const RenderGraph::PassContext& context)
+		{
+			uint32_t index = context.imageIndex;
+			spotCache.isValid = true;
+
+			// the culled draws are split evenly over the worker threads
+			parallelRecorder.recordRenderPass(context.commandBuffer, context.beginInfo, recorder, parallelRecorder.getThreadCount(),
+				[&](CommandRecorder& passRecorder, uint32_t job, uint32_t jobCount)
+				{
+					VkCommandBuffer commandBuffer = passRecorder.getCommandBuffer();
+					vkCmdSetViewport(commandBuffer, 0, 1, &shadowPipeline.viewport);
+					vkCmdSetScissor(commandBuffer, 0, 1, &shadowPipeline.scissors);
+					vkCmdSetDepthBias(commandBuffer, depthBiasConstant, 0.0f, depthBiasSlope);
+
+					passRecorder.bindPipeline(shadowPipeline.pipeline);
+					passRecorder.bindDescriptorSet(shadowPipeline.pipelineLayout, 0, shadowPipeline.descriptorSets[index]);
+
+					// the floor doesn't cast shadows, so no need to render it here
+					culler.draw(passRecorder, shadowPipeline.pipelineLayout, LIGHT_VIEW, 1, job, jobCount);
+				});
+		});
+
+	renderGraph.writeDepth(shadowPass, shadowDepthImage, farDepth);
+	renderGraph.setRunCondition(shadowPass, [this]() { return spotCache.isDirty; });
+
+	// every cascade in one pass, each view renders its own layer
+	cascadePass = renderGraph.addGraphicsPass("Shadow Cascades", [this](const RenderGraph::PassContext& context)
+		{
+			uint32_t index = context.imageIndex;
+			cascadeCache.isValid = true;
+
+			parallelRecorder.recordRenderPass(context.commandBuffer, context.beginInfo, recorder, parallelRecorder.getThreadCount(),
+				[&](CommandRecorder& passRecorder, uint32_t job, uint32_t jobCount)
+				{
+					VkCommandBuffer commandBuffer = passRecorder.getCommandBuffer();
+					vkCmdSetViewport(commandBuffer, 0, 1, &cascadePipeline.viewport);
+					vkCmdSetScissor(commandBuffer, 0, 1, &cascadePipeline.scissors);
+					vkCmdSetDepthBias(commandBuffer, depthBiasConstant, 0.0f, depthBiasSlope);
+
+					passRecorder.bindPipeline(cascadePipeline.pipeline);
+					passRecorder.bindDescriptorSet(cascadePipeline.pipelineLayout, 0, cascadePipeline.descriptorSets[index]);
+
+					culler.draw(passRecorder, cascadePipeline.pipelineLayout, CASCADE_VIEW, 1, job, jobCount);
+				});
+		});
+
+	renderGraph.setViewCount(cascadePass, CASCADE_COUNT);
+	renderGraph.writeDepth(cascadePass, cascadeImage, farDepth);
+	renderGraph.setRunCondition(cascadePass, [this]() { return cascadeCache.isDirty; });
+
+	// every cube face in one pass, each view renders its own layer
+	pointPass = renderGraph.addGraphicsPass("Point Shadow", [this](const RenderGraph::PassContext& context)
+		{
+			uint32_t index = context.imageIndex;
+			pointCache.isValid = true;
+
+			parallelRecorder.recordRenderPass(context.commandBuffer, context.beginInfo, recorder, parallelRecorder.getThreadCount(),
+				[&](CommandRecorder& passRecorder, uint32_t job, uint32_t jobCount)
+				{
+					VkCommandBuffer commandBuffer = passRecorder.getCommandBuffer();
+					vkCmdSetViewport(commandBuffer, 0, 1, &pointPipeline.viewport);
+					vkCmdSetScissor(commandBuffer, 0, 1, &pointPipeline.scissors);
+					vkCmdSetDepthBias(commandBuffer, depthBiasConstant, 0.0f, depthBiasSlope);
+
+					passRecorder.bindPipeline(pointPipeline.pipeline);
+					passRecorder.bindDescriptorSet(pointPipeline.pipelineLayout, 0, pointPipeline.descriptorSets[index]);
+
+					culler.draw(passRecorder, pointPipeline.pipelineLayout, POINT_VIEW, 1, job, jobCount);
+				});
+		});
+
+	renderGraph.setViewCount(pointPass, 6);
+	renderGraph.writeDepth(pointPass, pointImage, farDepth);
+	renderGraph.setRunCondition(pointPass, [this]() { return pointCache.isDirty; });
+
+	// run fsq shaders to write depth map to an offscreen texture
+	debugPass = renderGraph.addGraphicsPass("Shadow Map Debug", [this](const RenderGraph::PassContext& context)
+		{
+			parallelRecorder.recordRenderPass(context.commandBuffer, context.beginInfo, recorder, 1,
+				[&](CommandRecorder& passRecorder, uint32_t job, uint32_t jobCount)
+				{
+					VkCommandBuffer commandBuffer = passRecorder.getCommandBuffer();
+					vkCmdSetViewport(commandBuffer, 0, 1, &debugPipeline.viewport);
+					vkCmdSetScissor(commandBuffer, 0, 1, &debugPipeline.scissors);
+
+					passRecorder.bindPipeline(debugPipeline.pipeline);
+					passRecorder.bindDescriptorSet(debugPipeline.pipelineLayout, 0, debugPipeline.descriptorSets[0]);
+
+					float push[] = { light.getNearPlane(), light.getFarPlane() };
+					vkCmdPushConstants(commandBuffer, debugPipeline.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, 2 * sizeof(float), push);
+
+					passRecorder.draw(3, 1, 0, 0);
+				});
+		});
+
+	renderGraph.readTexture(debugPass, shadowDepthImage);
+	renderGraph.writeColor(debugPass, debugImage, black);
+
+	// render the scene normally, rendering the depth map to a UI image
+	scenePass = renderGraph.addGraphicsPass("Scene", [this](const RenderGraph::PassContext& context)
+		{
+			uint32_t index = context.imageIndex;
+
+			parallelRecorder.recordRenderPass(context.commandBuffer, context.beginInfo, recorder, parallelRecorder.getThreadCount(),
+				[&](CommandRecorder& passRecorder, uint32_t job, uint32_t jobCount)
+				{
+					VkCommandBuffer commandBuffer = passRecorder.getCommandBuffer();
+					vkCmdSetViewport(commandBuffer, 0, 1, &graphicsPipeline.viewport);
+					vkCmdSetScissor(commandBuffer, 0, 1, &graphicsPipeline.scissors);
+
+					VulkanGraphicsPipeline& pipeline = shadowMode == CASCADED_SHADOWS ? cascadeScenePipeline :
+						(shadowMode == POINT_SHADOWS ? pointScenePipeline : graphicsPipeline);
+					passRecorder.bindPipeline(pipeline.pipeline);
+					passRecorder.bindDescriptorSet(pipeline.pipelineLayout, 0, pipeline.descriptorSets[index]);
+
+					culler.draw(passRecorder, pipeline.pipelineLayout, CAMERA_VIEW, 1, job, jobCount);
+				},
+				[&](VkCommandBuffer commandBuffer) { DrawUI(commandBuffer, index); });
+		});
+
+	renderGraph.writeColor(scenePass, colorImage, black);
+	renderGraph.writeDepth(scenePass, depthImage, farDepth);
+	renderGraph.writeResolve(scenePass, swapChainImage);
+	// each scene pipeline only samples the shadows of its own light, the other shadow pass is culled
+	renderGraph.readTexture(scenePass, shadowDepthImage, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, [this]() { return shadowMode == SPOT_SHADOWS; });
+	renderGraph.readTexture(scenePass, cascadeImage, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, [this]() { return shadowMode == CASCADED_SHADOWS; });
+	renderGraph.readTexture(scenePass, pointImage, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, [this]() { return shadowMode == POINT_SHADOWS; });
+
+	// the UI samples the debug texture, but only while it's shown
+	renderGraph.readTexture(scenePass, debugImage, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR,
+		[this]() { return showDepthTexture && shadowMode == SPOT_SHADOWS; });
+
+	renderGraph.compile();
 }
 
+
+// ********* SHADOW PIPELINE **************
+
 void ShadowMap::CreateShadowDescriptorSets(const VulkanSwapChain& swapChain)
 {
 	// shadow pass only needs a vertex shader uniform buffer for light vp
@@ -834,40 +1242,12 @@ void ShadowMap::CreateShadowDescriptorSets(const VulkanSwapChain& swapChain)
 	}
 }
 
-void ShadowMap::CreateShadowFramebuffers(const VulkanSwapChain& swapChain)
-{
-	VkFramebufferCreateInfo info = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
-	info.renderPass = renderPass;
-	info.attachmentCount = 1;
-	info.pAttachments = &shadowPipeline.depthStencilBufferView;
-	info.width = shadowMapDim;
-	info.height = shadowMapDim;
-	info.layers = 1;
-
-	shadowPipeline.framebuffers.resize(1);
-
-	if (vkCreateFramebuffer(logicalDevice, &info, nullptr, &shadowPipeline.framebuffers[0]) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create shadow pass framebuffer");
-
-}
-
 void ShadowMap::CreateShadowResources()
 {
 	VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
 	VkFilter filter = VK_FILTER_LINEAR;
 
-	HelperFunctions::createImage(shadowMapDim, shadowMapDim, 1, 1,
-		VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TYPE_2D, depthFormat, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		shadowPipeline.depthStencilBuffer, shadowPipeline.depthStencilBufferMemory);
-
-	HelperFunctions::createImageView(shadowPipeline.depthStencilBuffer,
-		shadowPipeline.depthStencilBufferView, depthFormat,
-		VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, 1);
-
-	shadowPipeline.isDepthBufferEmpty = false;
-
+	// the shadow map itself belongs to the render graph
 	// create sampler
 	VkSamplerCreateInfo sampler = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
 	sampler.minFilter = filter;
@@ -884,6 +1264,104 @@ void ShadowMap::CreateShadowResources()
 	sampler.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 	if (vkCreateSampler(logicalDevice, &sampler, nullptr, &shadowSampler) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create shadow map sampler");
+
+	// the hardware only blends 2x2 compares when both depth formats can be filtered, otherwise every tap is one texel
+	VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	VkFormatProperties spotProperties, cascadeProperties;
+	vkGetPhysicalDeviceFormatProperties(VulkanDevice::GetVulkanDevice()->GetPhysicalDevice(), depthFormat, &spotProperties);
+	vkGetPhysicalDeviceFormatProperties(VulkanDevice::GetVulkanDevice()->GetPhysicalDevice(), VK_FORMAT_D32_SFLOAT, &cascadeProperties);
+
+	bool canFilter = (spotProperties.optimalTilingFeatures & features) && (cascadeProperties.optimalTilingFeatures & features);
+	HelperFunctions::createSampler(shadowCompareSampler, canFilter ? VK_FILTER_LINEAR : VK_FILTER_NEAREST, addressMode, VK_FALSE, 1.0f, 0.0f, 1,
+		VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE, VK_COMPARE_OP_LESS_OR_EQUAL);
+}
+
+
+void ShadowMap::CreateCascadeDescriptorSets(const VulkanSwapChain& swapChain)
+{
+	size_t swapChainSize = swapChain.swapChainImages.size();
+
+	// the cascade pass only needs the matrices, the scene also needs the scene uniforms and the cascades themselves
+	cascadePipeline.descriptorSetLayout = Descriptors::getLayout({
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT) });
+
+	cascadeScenePipeline.descriptorSetLayout = Descriptors::getLayout({
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT) });
+
+	VkDescriptorImageInfo cascadeInfo = {};
+	cascadeInfo.imageLayout = renderGraph.getReadLayout(cascadeImage);
+	cascadeInfo.imageView = renderGraph.getImageView(cascadeImage);
+	cascadeInfo.sampler = shadowCompareSampler;
+
+	cascadePipeline.uniformBuffers.resize(swapChainSize);
+	cascadePipeline.descriptorSets.resize(swapChainSize);
+	cascadeScenePipeline.descriptorSets.resize(swapChainSize);
+
+	for (size_t i = 0; i < swapChainSize; i++)
+	{
+		HelperFunctions::createBuffer(sizeof(uboCascades), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			cascadePipeline.uniformBuffers[i].buffer, cascadePipeline.uniformBuffers[i].bufferMemory);
+
+		cascadePipeline.descriptorSets[i] = descriptorAllocator.allocate(cascadePipeline.descriptorSetLayout);
+		Descriptors::write(cascadePipeline.descriptorSets[i], cascadePipeline.descriptorSetLayout,
+			{ DescriptorInfo(cascadePipeline.uniformBuffers[i].buffer, 0, sizeof(uboCascades)) });
+
+		// the scene uniforms are shared with the spot light's scene pipeline
+		cascadeScenePipeline.descriptorSets[i] = descriptorAllocator.allocate(cascadeScenePipeline.descriptorSetLayout);
+		Descriptors::write(cascadeScenePipeline.descriptorSets[i], cascadeScenePipeline.descriptorSetLayout,
+			{
+				DescriptorInfo(graphicsPipeline.uniformBuffers[i].buffer, 0, sizeof(uboScene)),
+				DescriptorInfo(cascadeInfo),
+				DescriptorInfo(cascadePipeline.uniformBuffers[i].buffer, 0, sizeof(uboCascades))
+			});
+	}
+}
+
+
+void ShadowMap::CreatePointDescriptorSets(const VulkanSwapChain& swapChain)
+{
+	size_t swapChainSize = swapChain.swapChainImages.size();
+
+	// the cube pass culls against the light's position and range as well, the scene reads the cube through the
+	// same comparison sampler as the other shadow maps
+	pointPipeline.descriptorSetLayout = Descriptors::getLayout({
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT) });
+
+	pointScenePipeline.descriptorSetLayout = Descriptors::getLayout({
+		HelperFunctions::initializers::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
+		HelperFunctions::initializers::descriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT) });
+
+	VkDescriptorImageInfo cubeInfo = {};
+	cubeInfo.imageLayout = renderGraph.getReadLayout(pointImage);
+	cubeInfo.imageView = renderGraph.getImageView(pointImage);
+	cubeInfo.sampler = shadowCompareSampler;
+
+	pointPipeline.uniformBuffers.resize(swapChainSize);
+	pointPipeline.descriptorSets.resize(swapChainSize);
+	pointScenePipeline.descriptorSets.resize(swapChainSize);
+
+	for (size_t i = 0; i < swapChainSize; i++)
+	{
+		HelperFunctions::createBuffer(sizeof(uboPoint), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			pointPipeline.uniformBuffers[i].buffer, pointPipeline.uniformBuffers[i].bufferMemory);
+
+		pointPipeline.descriptorSets[i] = descriptorAllocator.allocate(pointPipeline.descriptorSetLayout);
+		Descriptors::write(pointPipeline.descriptorSets[i], pointPipeline.descriptorSetLayout,
+			{ DescriptorInfo(pointPipeline.uniformBuffers[i].buffer, 0, sizeof(uboPoint)) });
+
+		pointScenePipeline.descriptorSets[i] = descriptorAllocator.allocate(pointScenePipeline.descriptorSetLayout);
+		Descriptors::write(pointScenePipeline.descriptorSets[i], pointScenePipeline.descriptorSetLayout,
+			{
+				DescriptorInfo(graphicsPipeline.uniformBuffers[i].buffer, 0, sizeof(uboScene)),
+				DescriptorInfo(cubeInfo),
+				DescriptorInfo(pointPipeline.uniformBuffers[i].buffer, 0, sizeof(uboPoint))
+			});
+	}
 }
 
 
@@ -921,8 +1399,8 @@ void ShadowMap::CreateDebugResources(const VulkanSwapChain& swapChain)
 
 
 		VkDescriptorImageInfo info = {};
-		info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-		info.imageView = shadowPipeline.depthStencilBufferView;
+		info.imageLayout = renderGraph.getReadLayout(shadowDepthImage);
+		info.imageView = renderGraph.getImageView(shadowDepthImage);
 		info.sampler = shadowSampler;
 
 		VkWriteDescriptorSet write = HelperFunctions::initializers::writeDescriptorSet(debugPipeline.descriptorSets[0], &info);
@@ -930,82 +1408,6 @@ void ShadowMap::CreateDebugResources(const VulkanSwapChain& swapChain)
 
 		debugPipeline.isDescriptorPoolEmpty = false;
 	}
-
-	// render pass
-	{
-		VkAttachmentDescription colorDescription = {};
-		colorDescription.format = swapChain.swapChainImageFormat;
-		colorDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-		colorDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		colorDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		colorDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		colorDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		colorDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorDescription.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		VkAttachmentReference colorReference = {};
-		colorReference.attachment = 0;
-		colorReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-		VkSubpassDescription subpass = {};
-		subpass.colorAttachmentCount = 1;
-		subpass.pColorAttachments = &colorReference;
-		subpass.pDepthStencilAttachment = nullptr;
-
-		VkSubpassDependency dependencies[2];
-
-		// scene pass must wait for debug pass to finish reading from the shadow map
-		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-		// shadow pass waits for render pass fragment shader to finish 
-		dependencies[1].srcSubpass = 0;
-		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-		VkRenderPassCreateInfo renderPassInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
-		renderPassInfo.attachmentCount = 1;
-		renderPassInfo.pAttachments = &colorDescription;
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 2;
-		renderPassInfo.pDependencies = dependencies;
-
-		vkCreateRenderPass(logicalDevice, &renderPassInfo, nullptr, &renderPass);
-	}
-
-	// framebuffer
-	{
-		VkImageView attachment = {};
-
-		HelperFunctions::createImage(shadowMapDim, shadowMapDim, 1, 1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TYPE_2D,
-			swapChain.swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, debugTex.image, debugTex.imageMemory);
-
-		HelperFunctions::createImageView(debugTex.image, debugTex.imageView, 
-			swapChain.swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 
-			VK_IMAGE_VIEW_TYPE_2D, 1);
-
-		VkFramebufferCreateInfo sceneFramebufferInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
-		sceneFramebufferInfo.renderPass = renderPass;
-		sceneFramebufferInfo.attachmentCount = 1;
-		sceneFramebufferInfo.pAttachments = &debugTex.imageView;
-		sceneFramebufferInfo.width = shadowMapDim;
-		sceneFramebufferInfo.height = shadowMapDim;
-		sceneFramebufferInfo.layers = 1;
-
-		debugPipeline.framebuffers.resize(1);
-		vkCreateFramebuffer(logicalDevice, &sceneFramebufferInfo, nullptr, &debugPipeline.framebuffers[0]);
-	}
 }
 
 // ********* SCENE PIPELINE ***************
@@ -1102,9 +1504,9 @@ void ShadowMap::CreateSceneDescriptorSets(const VulkanSwapChain& swapChain)
 		uboInfo.range = sizeof(uboScene);
 
 		VkDescriptorImageInfo imageInfo = {};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = shadowPipeline.depthStencilBufferView;
-		imageInfo.sampler = shadowSampler;
+		imageInfo.imageLayout = renderGraph.getReadLayout(shadowDepthImage);
+		imageInfo.imageView = renderGraph.getImageView(shadowDepthImage);
+		imageInfo.sampler = shadowCompareSampler;
 
 		VkWriteDescriptorSet writeDescriptors[2] =
 		{
@@ -1116,150 +1518,3 @@ void ShadowMap::CreateSceneDescriptorSets(const VulkanSwapChain& swapChain)
 	}
 #pragma endregion
 }
-
-void ShadowMap::CreateSceneFramebuffers(const VulkanSwapChain& swapChain)
-{
-	graphicsPipeline.framebuffers.resize(swapChain.swapChainImageViews.size());
-	VkExtent2D dim = swapChain.swapChainDimensions;
-
-	HelperFunctions::createImage(dim.width, dim.height, 1, 1, VK_SAMPLE_COUNT_8_BIT,
-		VK_IMAGE_TYPE_2D, VK_FORMAT_D24_UNORM_S8_UINT, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		graphicsPipeline.depthStencilBuffer, graphicsPipeline.depthStencilBufferMemory);
-
-	HelperFunctions::createImageView(graphicsPipeline.depthStencilBuffer, graphicsPipeline.depthStencilBufferView,
-		VK_FORMAT_D24_UNORM_S8_UINT, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, 1);
-
-	graphicsPipeline.isDepthBufferEmpty = false;
-
-	// multisampling resolve texture
-
-	HelperFunctions::createImage(dim.width, dim.height, 1, 1, VK_SAMPLE_COUNT_8_BIT,
-		VK_IMAGE_TYPE_2D, swapChain.swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, msaaTex.image, msaaTex.imageMemory);
-
-	HelperFunctions::createImageView(msaaTex.image, msaaTex.imageView,
-		swapChain.swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D, 1);
-
-	VkImageView attachments[3];
-
-	VkFramebufferCreateInfo sceneFramebufferInfo = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
-	sceneFramebufferInfo.renderPass = renderPass;
-	sceneFramebufferInfo.attachmentCount = 3;
-	sceneFramebufferInfo.pAttachments = attachments;
-	sceneFramebufferInfo.width = dim.width;
-	sceneFramebufferInfo.height = dim.height;
-	sceneFramebufferInfo.layers = 1;
-
-	for (size_t i = 0; i < swapChain.swapChainImageViews.size(); i++)
-	{
-		attachments[0] = msaaTex.imageView;
-		attachments[1] = graphicsPipeline.depthStencilBufferView;
-		attachments[2] = swapChain.swapChainImageViews[i];
-
-		if (vkCreateFramebuffer(logicalDevice, &sceneFramebufferInfo, nullptr, &graphicsPipeline.framebuffers[i]) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create one or more framebuffers");
-	}
-}
-
-void ShadowMap::CreateSceneRenderPass(const VulkanSwapChain& swapChain)
-{
-	VkAttachmentDescription sceneColorAttachment = {};
-	sceneColorAttachment.format = swapChain.swapChainImageFormat;
-	sceneColorAttachment.flags = 0;
-	sceneColorAttachment.samples = VK_SAMPLE_COUNT_8_BIT;
-	sceneColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	sceneColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	sceneColorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	sceneColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	sceneColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	sceneColorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference sceneColorReference = {};
-	sceneColorReference.attachment = 0;
-	sceneColorReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// depth attachment
-	VkAttachmentDescription sceneDepthAttachment = {};
-	sceneDepthAttachment.format = VK_FORMAT_D24_UNORM_S8_UINT;
-	sceneDepthAttachment.flags = 0;
-	sceneDepthAttachment.samples = VK_SAMPLE_COUNT_8_BIT;
-	sceneDepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	sceneDepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	sceneDepthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	sceneDepthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	sceneDepthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	sceneDepthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference sceneDepthReference = {};
-	sceneDepthReference.attachment = 1;
-	sceneDepthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-
-	// multisampling resolve attachment
-	VkAttachmentDescription multisamplingResolveAttachment = {};
-	multisamplingResolveAttachment.format = swapChain.swapChainImageFormat;
-	multisamplingResolveAttachment.flags = 0;
-	multisamplingResolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	multisamplingResolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-	multisamplingResolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	multisamplingResolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	multisamplingResolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	multisamplingResolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	multisamplingResolveAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference multisamplingResolveReference = {};
-	multisamplingResolveReference.attachment = 2;
-	multisamplingResolveReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &sceneColorReference;
-	subpass.pDepthStencilAttachment = &sceneDepthReference;
-	subpass.pResolveAttachments = &multisamplingResolveReference;
-
-	std::array<VkSubpassDependency, 3> dependencies;
-
-	// scene pass must wait for debug pass to finish reading from the shadow map
-	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[0].dstSubpass = 0;
-	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	// wait for multisampling for finish
-	dependencies[1].srcSubpass = 0;
-	dependencies[1].dstSubpass = 0;
-	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	// shadow pass waits for render pass fragment shader to finish 
-	dependencies[2].srcSubpass = 0;
-	dependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[2].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[2].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	VkAttachmentDescription attachments[] = { sceneColorAttachment, sceneDepthAttachment, multisamplingResolveAttachment };
-
-	VkRenderPassCreateInfo renderPassInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
-	renderPassInfo.attachmentCount = 3;
-	renderPassInfo.pAttachments = attachments;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 3;
-	renderPassInfo.pDependencies = dependencies.data();
-
-	graphicsPipeline.result = vkCreateRenderPass(logicalDevice, &renderPassInfo, nullptr, &renderPass);
-	if (graphicsPipeline.result != VK_SUCCESS)
-		throw std::runtime_error("Failed to create render pass");
-}
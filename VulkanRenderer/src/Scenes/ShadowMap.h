@@ -1,6 +1,9 @@
 #pragma once
 #include "VulkanScene.h"
 #include "Renderer/UI.h"
+#include "Renderer/GPUCulling.h"
+#include "Renderer/ParallelRecorder.h"
+#include "Renderer/RenderGraph.h"
 
 // Shadow Mapping requires us to render the scene offscreen from a light's perspective
 // and determine which areas of our scene are occluded (light is blocked)
@@ -27,17 +30,17 @@ private:
 	virtual void DrawScene(VkCommandBuffer& commandBuffer, VkPipelineLayout& pipelineLayout, bool useMaterial = false) override;
 
 	void CreatePipelines(const VulkanSwapChain& swapChain);
+	void CreateScenePipelines(); // the three scene pipelines, with the current shadow filter
+	void CreateRenderGraph(const VulkanSwapChain& swapChain);
 
-	void CreateSceneRenderPass(const VulkanSwapChain& swapChain);
 	void CreateSceneDescriptorSets(const VulkanSwapChain& swapChain);
-	void CreateSceneFramebuffers(const VulkanSwapChain& swapChain);
 
 	void CreateDebugResources(const VulkanSwapChain& swapChain);
 
-	void CreateShadowRenderPass(const VulkanSwapChain& swapChain);
 	void CreateShadowResources();
 	void CreateShadowDescriptorSets(const VulkanSwapChain& swapChain);
-	void CreateShadowFramebuffers(const VulkanSwapChain& swapChain);
+	void CreateCascadeDescriptorSets(const VulkanSwapChain& swapChain);
+	void CreatePointDescriptorSets(const VulkanSwapChain& swapChain);
 
 
 	void CreateSyncObjects(const VulkanSwapChain& swapChain);
@@ -46,18 +49,33 @@ private:
 	void CreateSceneObjects();
 	void UpdateUniforms(uint32_t index);
 
-	void CreateCommandBuffers();
+	void CreateCommandBuffers(const VulkanSwapChain& swapChain);
 
 	void RecordCommandBuffers(uint32_t index);
 
 	// scene data
 	VulkanGraphicsPipeline graphicsPipeline, debugPipeline;
-	VkRenderPass renderPass;
-	Texture msaaTex, debugTex;
+
+	// shadow map, cascades or cube, the debug view, then the scene. only the shadow pass of the current light runs,
+	// and the debug view only while the UI shows it
+	RenderGraph renderGraph;
+	uint32_t shadowPass, cascadePass, pointPass, debugPass, scenePass;
+	uint32_t shadowDepthImage, cascadeImage, pointImage, debugImage;
+	bool showDepthTexture = false;
 
 	bool isCameraMoving = false;
 
+	// shadows from a spot light with one shadow map, from a directional light with cascades, or from a point light
+	// with a cube
+	enum ShadowMode { SPOT_SHADOWS = 0, CASCADED_SHADOWS = 1, POINT_SHADOWS = 2 };
+	int32_t shadowMode = SPOT_SHADOWS;
+
 	SpotLight light = {};
+	DirectionalLight sun = {};
+	PointLight bulb = {};
+
+	const float NEAR_PLANE = 0.1f, FAR_PLANE = 1000.0f;
+	float cameraAspect = 1.0f;
 
 	struct // scene uniform buffer data
 	{
@@ -68,8 +86,16 @@ private:
 	} uboScene;
 
 	Mesh cube, ground, monkey, sphere;
+	Material pillarMaterial; // the pillars are culler instances of the shared box
+
+	// the camera and each light are culled separately, all cascades together and all cube faces together
+	enum CullView { CAMERA_VIEW = 0, LIGHT_VIEW = 1, CASCADE_VIEW = 2, POINT_VIEW = 3 };
+	GPUCuller culler;
 	size_t currentFrame = 0;
 
+	// records each pass into secondary command buffers on worker threads
+	ParallelRecorder parallelRecorder;
+
 	// shadow mapping data
 	float depthBiasConstant = 1.25f; // constant depth bias factor, always applied
 	float depthBiasSlope = 1.75f;    // slope depth bias factor, applied depending on polygon's slope
@@ -81,10 +107,73 @@ private:
 	} uboShadow;
 
 	VulkanGraphicsPipeline shadowPipeline;
-	VkSampler shadowSampler;
+	VkSampler shadowSampler;		// plain depth reads, for the debug views
+	VkSampler shadowCompareSampler; // the scene's shadow lookups
+
+	// soft shadows. every tap of the scene shaders' filter is a hardware filtered 2x2 depth compare. the kernel is
+	// baked into the scene pipelines as specialization constants, so changing it rebuilds those pipelines
+	enum PCFPattern { PCF_GRID = 0, PCF_POISSON = 1, PCF_ROTATED_GRID = 2 };
+	int32_t pcfPattern = PCF_POISSON;
+	int32_t pcfRadius = 1; // in texels, 0 is a single tap
+	bool pcfChanged = false;
 	VkFormat depthFormat = VK_FORMAT_D32_SFLOAT_S8_UINT;
 
+	// cascaded shadow maps. the camera frustum up to shadowDistance is split into slices, each covered by a layer
+	// of one depth image. a single multiview pass renders every layer
+	static const uint32_t CASCADE_COUNT = 4; // must match the cascade shaders
+	uint32_t cascadeMapDim = 2048;
+	float shadowDistance = 80.0f;	 // nothing further away is shadowed
+	float cascadeSplitLambda = 0.9f; // uniform (0) to logarithmic (1) splits
+	float cascadeBlendBand = 0.1f;	 // part of a cascade that fades into the next one
+	bool showCascades = false;
+
+	struct // cascade data, read by the cascade pass and the scene
+	{
+		glm::mat4 viewProj[CASCADE_COUNT];
+		glm::vec4 splitDepths;	  // view space distance each cascade ends at
+		glm::vec4 lightDirection; // xyz = direction the light travels in
+		glm::vec4 params;		  // x = blend band, y = tint the cascades
+	} uboCascades;
+
+	// draws every cascade, and the scene with them
+	VulkanGraphicsPipeline cascadePipeline, cascadeScenePipeline;
+
+	// omnidirectional shadows. the six faces of the point light's cube are the layers of one depth image, and a
+	// single multiview pass renders all of them. every view draws the same culled objects, the vertex shader
+	// drops the ones outside its own face
+	uint32_t pointMapDim = 1024;
+	const float POINT_NEAR_PLANE = 0.05f;
+
+	struct // cube data, read by the cube pass and the scene
+	{
+		glm::mat4 faceViewProj[6]; // +x, -x, +y, -y, +z, -z
+		glm::vec4 lightPosRange;   // xyz = world space position, w = range
+	} uboPoint;
+
+	// draws every face, and the scene with them
+	VulkanGraphicsPipeline pointPipeline, pointScenePipeline;
+
+	// shadow caching. a shadow map remembers the light matrices and casters it was drawn with, and its pass is
+	// skipped while they stay the same. only objects inside the light's reach count as casters, so anything moving
+	// elsewhere leaves the shadow alone. the graph keeps a skipped pass's image as it was
+	struct ShadowCache
+	{
+		std::vector<glm::mat4> viewProjs; // light matrices of the last draw
+		std::vector<uint32_t> casters;	  // sorted objects inside the light's reach at the last draw
+		uint64_t transformVersion = 0;	  // GPUCuller::getTransformVersion() at the last draw
+		bool isValid = false;			  // drawn at least once since the graph was compiled
+		bool isDirty = true;			  // drawn this frame
+	};
+	ShadowCache spotCache, cascadeCache, pointCache;
+	bool cacheShadows = true;
+	std::vector<uint32_t> casters; // scratch list compared against the cache's casters
+	void UpdateShadowCache(ShadowCache& cache, const glm::mat4* viewProjs, uint32_t count);
+
+	// spins the monkey, so the casters move every frame
+	bool animateMonkey = false;
+	uint32_t monkeyObject = 0;
+
 	// UI
 	UI* ui = nullptr;
-	void DrawUI(uint32_t frameIndex);
+	void DrawUI(VkCommandBuffer commandBuffer, uint32_t frameIndex);
 };
\ No newline at end of file
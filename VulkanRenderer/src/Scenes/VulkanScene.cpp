@@ -11,6 +11,11 @@ VulkanScene::~VulkanScene()
 	ModelLoader::destroy();
 	TextureLoader::destroy();
 	BasicShapes::destroyShapes();
+	ObjectTable::destroy(); // after every mesh and material has released its slot
+	MaterialTable::destroy();
+	TextureTable::destroy();
+	descriptorAllocator.destroy();
+	Descriptors::destroy(); // last, the tables above hold sets and layouts from it
 	vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
 }
 
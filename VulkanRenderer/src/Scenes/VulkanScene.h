@@ -22,6 +22,11 @@
 #include "Renderer/Camera.h"
 #include "Renderer/Loaders.h"
 #include "Renderer/BasicShapes.h"
+#include "Renderer/ObjectTable.h"
+#include "Renderer/MaterialTable.h"
+#include "Renderer/TextureTable.h"
+#include "Renderer/Descriptors.h"
+#include "Renderer/DrawList.h"
 #include "Renderer/Light.h"
 #include "SDL_scancode.h"
 #include "SDL_mouse.h"
@@ -68,6 +73,12 @@ protected:
 	std::vector<VkCommandBuffer> commandBuffersList;
 	VkDevice logicalDevice;
 
+	// per swap chain image sets, reset whenever the scene is destroyed or recreated
+	DescriptorAllocator descriptorAllocator;
+
+	// scenes record their binds and draws through this, so redundant binds are dropped and counted
+	CommandRecorder recorder;
+
 	// Synchronzation Objects
 	std::vector<VkSemaphore> renderCompleteSemaphores, presentCompleteSemaphores;
 	std::vector<VkFence> inFlightFences, imagesInFlight;
@@ -15,6 +15,7 @@
 */
 
 #include "VulkanDevice.h"
+#include <cstring>
 
 VulkanDevice* VulkanDevice::device = nullptr;
 std::vector<const char*> requiredDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
@@ -51,22 +52,54 @@ void VulkanDevice::CreateDevices(VkInstance appInstance, VkSurfaceKHR appSurface
     VkPhysicalDeviceFeatures2 features = {};
     features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
 
-    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = {};
-    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
-    timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
-    features.pNext = &timelineSemaphoreFeatures;
+    // 1.1 core features, multiview renders e.g. every shadow cascade in one pass (see RenderGraph::setViewCount)
+    VkPhysicalDeviceVulkan11Features vulkan11Features = {};
+    vulkan11Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    features.pNext = &vulkan11Features;
+
+    // 1.2 core features, covers timeline semaphores and draw indirect count
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan11Features.pNext = &vulkan12Features;
+
+    // vkCmdPipelineBarrier2KHR, used by RenderGraph. the struct may only be chained when the extension exists
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features = {};
+    synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    if (device->isExtensionAvailable(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+        vulkan12Features.pNext = &synchronization2Features;
 
 
     vkGetPhysicalDeviceProperties(device->physicalDevice, &properties);
     vkGetPhysicalDeviceFeatures2(device->physicalDevice, &features);
     features.features.samplerAnisotropy = VK_TRUE;
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+
+    // required by every 1.1 device
+    if (vulkan11Features.multiview != VK_TRUE)
+        throw std::runtime_error("GPU doesn't support multiview!");
+    device->drawIndirectCountSupported = vulkan12Features.drawIndirectCount == VK_TRUE;
+    device->synchronization2Supported = synchronization2Features.synchronization2 == VK_TRUE;
+
+    // GPU culling draws a whole view with one indirect call holding many draws, and each draw's firstInstance
+    // points at its batch's instances. without both features GPUCuller stays on its CPU path
+    device->multiDrawIndirectSupported = features.features.multiDrawIndirect == VK_TRUE &&
+        features.features.drawIndirectFirstInstance == VK_TRUE;
+
+    // bindless textures (see TextureTable). the queried features are handed straight to vkCreateDevice,
+    // so everything checked here is enabled whenever it's supported
+    device->descriptorIndexingSupported = device->isExtensionAvailable(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+        vulkan12Features.runtimeDescriptorArray == VK_TRUE &&
+        vulkan12Features.descriptorBindingPartiallyBound == VK_TRUE &&
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+        vulkan12Features.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
 
     QueueFamilyIndices indices = findQueueFamilies(appSurface);
 
     float priority = 1.0f;
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.computeFamily.value() };
 
     for (uint32_t queueFamily : uniqueQueueFamilies)
     {
@@ -79,6 +112,10 @@ void VulkanDevice::CreateDevices(VkInstance appInstance, VkSurfaceKHR appSurface
     }
 
     requiredDeviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);    
+    if (device->descriptorIndexingSupported)
+        requiredDeviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    if (device->synchronization2Supported)
+        requiredDeviceExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -96,6 +133,7 @@ void VulkanDevice::CreateDevices(VkInstance appInstance, VkSurfaceKHR appSurface
 
     vkGetDeviceQueue(device->logicalDevice, indices.graphicsFamily.value(), 0, &device->queues.renderQueue);
     vkGetDeviceQueue(device->logicalDevice, indices.presentFamily.value(), 0, &device->queues.presentQueue);
+    vkGetDeviceQueue(device->logicalDevice, indices.computeFamily.value(), 0, &device->queues.computeQueue);
 }
 
 VulkanDevice* VulkanDevice::GetVulkanDevice()
@@ -128,6 +166,22 @@ bool VulkanDevice::checkDeviceSupportedExtensions(VkPhysicalDevice dev)
     return requiredExtensions.empty();
 }
 
+bool VulkanDevice::isExtensionAvailable(const char* extensionName)
+{
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    for (VkExtensionProperties ext : availableExtensions)
+    {
+        if (strcmp(ext.extensionName, extensionName) == 0)
+            return true;
+    }
+
+    return false;
+}
+
 VkFormat VulkanDevice::findSupportedFormats(std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
 {
     for (VkFormat format : candidates) {
@@ -172,5 +226,17 @@ VulkanDevice::QueueFamilyIndices VulkanDevice::findQueueFamilies(VkSurfaceKHR su
         i++;
     }
 
+    // a family without graphics runs compute alongside rendering instead of between it
+    device->familyIndices.computeFamily = device->familyIndices.graphicsFamily;
+    for (uint32_t family = 0; family < queueFamilyCount; family++)
+    {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            device->familyIndices.computeFamily = family;
+            break;
+        }
+    }
+
     return device->familyIndices;
 }
@@ -40,6 +40,11 @@ public:
 	VkPhysicalDevice GetPhysicalDevice() { return physicalDevice; }
 	VkDevice GetLogicalDevice() { return logicalDevice; }
 	
+	bool IsDrawIndirectCountSupported() { return drawIndirectCountSupported; }
+	bool IsMultiDrawIndirectSupported() { return multiDrawIndirectSupported; }
+	bool IsDescriptorIndexingSupported() { return descriptorIndexingSupported; }
+	bool IsSynchronization2Supported() { return synchronization2Supported; }
+	
 	VkFormat findSupportedFormats(std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
 private:
@@ -55,15 +60,21 @@ private:
 
 	// helper functions 
 	bool checkDeviceSupportedExtensions(VkPhysicalDevice dev);
+	bool isExtensionAvailable(const char* extensionName);
 	
 	VkPhysicalDevice physicalDevice;
 	VkDevice logicalDevice;
 
+	bool drawIndirectCountSupported = false;
+	bool multiDrawIndirectSupported = false;
+	bool descriptorIndexingSupported = false;
+	bool synchronization2Supported = false;
+
 	struct QueueFamilyIndices
 	{
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
-		//std::optional<uint32_t> computeFamily;
+		std::optional<uint32_t> computeFamily; // a compute only family when there is one, else the graphics family
 
 		bool isComplete()
 		{
@@ -75,7 +86,7 @@ private:
 	{
 		VkQueue renderQueue;
 		VkQueue presentQueue;
-		//VkQueue computeQueue;
+		VkQueue computeQueue; // can be the render queue, see QueueFamilyIndices::computeFamily
 	} queues;
 
 	QueueFamilyIndices findQueueFamilies(VkSurfaceKHR surface);
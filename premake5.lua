@@ -12,6 +12,9 @@ IncludeDir["ImGui"] = "VulkanRenderer/vendor/ImGui"
 IncludeDir["vulkan"] = "VulkanRenderer/vendor/vulkan"
 include "VulkanRenderer/vendor/ImGui"
 
+-- files the shaders pull in with #include
+ShaderIncludes = os.matchfiles("VulkanRenderer/shaders/**.glsl")
+
 project "VulkanRenderer"
 	location "VulkanRenderer"
 	kind "ConsoleApp"
@@ -31,6 +34,10 @@ project "VulkanRenderer"
 		"%{IncludeDir.vulkan}/**hpp",
 		"%{IncludeDir.vulkan}/**h",
 		"%{IncludeDir.SDL2}/**h",
+		"%{prj.name}/shaders/**.vert",
+		"%{prj.name}/shaders/**.frag",
+		"%{prj.name}/shaders/**.comp",
+		"%{prj.name}/shaders/**.glsl",
 	}
 
 	includedirs
@@ -53,6 +60,21 @@ project "VulkanRenderer"
 
 	defines { "_CRT_SECURE_NO_WARNINGS" }
 
+	-- every shader is compiled next to its source as <name>.spv, which is the path the scenes load.
+	-- includes such as Global/pcf.glsl resolve relative to the including shader. the build can't see
+	-- which shader includes what, so each one is rebuilt whenever any include changes
+	filter "files:**.vert or files:**.frag or files:**.comp"
+		buildmessage "Compiling %{file.relpath}"
+		buildcommands
+		{
+			'"$(VULKAN_SDK)/Bin/glslc" "%{file.abspath}" -o "%{file.directory}/%{file.basename}.spv"'
+		}
+		buildinputs { ShaderIncludes }
+		buildoutputs { "%{file.directory}/%{file.basename}.spv" }
+
+	filter "files:**.glsl"
+		buildaction "None"
+
 	filter "system:windows"
 		systemversion "latest"
 		